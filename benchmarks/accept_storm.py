@@ -0,0 +1,61 @@
+import socket
+import time
+import casyncio
+
+BURSTS = (100, 1_000, 4_000)
+
+
+def _python_listener(loop, lsock, on_accept):
+    """Accept loop as start_server ran it before casyncio.Listener."""
+    def accept():
+        while True:
+            try:
+                client, _ = lsock.accept()
+            except BlockingIOError:
+                return
+            client.setblocking(False)
+            on_accept(None, client.detach())
+    loop.add_reader(lsock.fileno(), accept)
+
+
+def bench_burst(n: int, native: bool) -> float:
+    """Accepts/s for a burst of *n* connects queued before the loop runs."""
+    loop = casyncio.EventLoop()
+    lsock = socket.create_server(("127.0.0.1", 0), backlog=n)
+    lsock.setblocking(False)
+    accepted = []
+
+    def on_accept(reader, fd):
+        accepted.append(fd)
+        if len(accepted) == n:
+            loop.stop()
+
+    clients = [socket.create_connection(lsock.getsockname()) for _ in range(n)]
+    start = time.perf_counter()
+    if native:
+        listener = casyncio.Listener(loop, lsock.fileno(), on_accept)
+    else:
+        _python_listener(loop, lsock, on_accept)
+    loop.run_forever()
+    elapsed = time.perf_counter() - start
+    if native:
+        listener.close()
+    else:
+        loop.remove_reader(lsock.fileno())
+    for fd in accepted:
+        loop._c_close(fd)
+    for c in clients:
+        c.close()
+    lsock.close()
+    return n / elapsed
+
+
+def bench(bursts=BURSTS) -> list[tuple[int, float, float]]:
+    """Return (burst, native accepts/s, Python accepts/s) rows."""
+    return [(n, bench_burst(n, True), bench_burst(n, False)) for n in bursts]
+
+
+if __name__ == "__main__":
+    print(f"{'burst':>8} {'Listener/s':>14} {'python/s':>14}")
+    for n, nat, py in bench():
+        print(f"{n:>8} {nat:>14.0f} {py:>14.0f}")
@@ -0,0 +1,126 @@
+import resource
+import socket
+import time
+import casyncio
+
+CONNECTIONS = (1_000, 10_000, 50_000)
+BACKENDS = ("epoll", "io_uring")
+PAYLOAD = b"x" * 64
+
+
+def _connect_pairs(n: int) -> list[tuple[socket.socket, socket.socket]]:
+    lsock = socket.create_server(("127.0.0.1", 0), backlog=1024)
+    addr = lsock.getsockname()
+    pairs = []
+    try:
+        for _ in range(n):
+            c = socket.create_connection(addr)
+            s, _ = lsock.accept()
+            c.setblocking(False)
+            s.setblocking(False)
+            pairs.append((c, s))
+    finally:
+        lsock.close()
+    return pairs
+
+
+def max_connections() -> int:
+    """Connections that fit in RLIMIT_NOFILE (two fds each, plus headroom)."""
+    soft, _ = resource.getrlimit(resource.RLIMIT_NOFILE)
+    return max(0, (soft - 64) // 2)
+
+
+def _cpu_seconds() -> float:
+    """User plus system time of this process: syscalls show up as the latter."""
+    ru = resource.getrusage(resource.RUSAGE_SELF)
+    return ru.ru_utime + ru.ru_stime
+
+
+def bench_backend(backend: str, conns: int, rounds: int = 4) -> dict:
+    """Ping-pong PAYLOAD *rounds* times over *conns* loopback connections."""
+    loop = casyncio.EventLoop(backend=backend)
+    pairs = _connect_pairs(conns)
+    remaining = conns
+    latencies = []
+
+    class Echo:
+        """Server side: a native transport, so io_uring does its recv and send."""
+
+        def connection_made(self, transport):
+            self.transport = transport
+
+        def data_received(self, data):
+            self.transport.write(data)
+
+        def connection_lost(self, exc):
+            pass
+
+    def client(sock):
+        left = rounds
+        sent_at = 0.0
+
+        def send():
+            nonlocal sent_at
+            sent_at = time.perf_counter()
+            sock.send(PAYLOAD)
+
+        def on_read():
+            nonlocal left, remaining
+            try:
+                data = sock.recv(65536)
+            except BlockingIOError:
+                return
+            if not data:
+                return
+            latencies.append(time.perf_counter() - sent_at)
+            left -= 1
+            if left:
+                send()
+            else:
+                loop.remove_reader(sock.fileno())
+                remaining -= 1
+                if not remaining:
+                    loop.stop()
+        return on_read, send
+
+    sends = []
+    transports = []
+    for c, s in pairs:
+        transports.append(casyncio.SocketTransport(loop, s, Echo()))
+        on_read, send = client(c)
+        loop.add_reader(c.fileno(), on_read)
+        sends.append(send)
+    start = time.perf_counter()
+    cpu_start = _cpu_seconds()
+    for send in sends:
+        send()
+    loop.run_forever()
+    cpu = _cpu_seconds() - cpu_start
+    elapsed = time.perf_counter() - start
+    for tr in transports:
+        tr.abort()
+    for c, _ in pairs:
+        c.close()
+    latencies.sort()
+    return {
+        "backend": loop.backend,
+        "connections": conns,
+        "msgs_per_s": len(latencies) / elapsed,
+        "cpu_us_per_msg": cpu / len(latencies) * 1e6,
+        "p50_us": latencies[len(latencies) // 2] * 1e6,
+        "p99_us": latencies[int(len(latencies) * 0.99)] * 1e6,
+    }
+
+
+def bench(connections=CONNECTIONS, backends=BACKENDS, rounds: int = 4) -> list[dict]:
+    limit = max_connections()
+    sizes = sorted({min(n, limit) for n in connections})
+    return [bench_backend(b, n, rounds) for n in sizes for b in backends]
+
+
+if __name__ == "__main__":
+    cols = ("backend", "connections", "msgs_per_s", "cpu_us_per_msg", "p50_us", "p99_us")
+    print(" ".join(f"{c:>12}" for c in cols))
+    for row in bench():
+        print(" ".join(f"{row[c]:>12}" if isinstance(row[c], str) else f"{row[c]:>12.0f}"
+                       for c in cols))
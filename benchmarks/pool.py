@@ -0,0 +1,94 @@
+import asyncio
+import os
+import socket
+import tempfile
+import time
+from concurrent.futures import ThreadPoolExecutor
+import casyncio
+from py_async_lib.executor import run_in_executor
+
+OPS = 20_000
+BLOCK = 4096
+
+
+def _file(blocks: int = 256) -> tuple[int, str]:
+    fd, path = tempfile.mkstemp()
+    os.write(fd, os.urandom(BLOCK * blocks))
+    return fd, path
+
+
+def _drive(loop, submit, ops: int) -> float:
+    """Keep 64 reads in flight until *ops* have completed; return ops/s."""
+    left = ops
+    issued = 0
+
+    def on_done(fut):
+        nonlocal left
+        fut.result()
+        left -= 1
+        if not left:
+            loop.stop()
+        else:
+            issue()
+
+    def issue():
+        nonlocal issued
+        if issued < ops:
+            offset = (issued % 256) * BLOCK
+            issued += 1
+            submit(offset).add_done_callback(on_done)
+
+    start = time.perf_counter()
+    for _ in range(min(64, ops)):
+        issue()
+    loop.run_forever()
+    elapsed = time.perf_counter() - start
+    assert not left, "loop stopped early"
+    return ops / elapsed
+
+
+def bench_pool(fd: int, ops: int) -> float:
+    loop = casyncio.EventLoop()
+    return _drive(loop, lambda off: loop.pool_pread(fd, BLOCK, off), ops)
+
+
+def bench_executor(fd: int, ops: int) -> float:
+    """The Python ThreadPoolExecutor path on a casyncio loop."""
+    loop = casyncio.EventLoop()
+    # nothing else keeps the loop waiting for the executor threads
+    r, w = socket.socketpair()
+    loop.add_reader(r.fileno(), lambda: None)
+    try:
+        with ThreadPoolExecutor() as ex:
+            return _drive(loop, lambda off: run_in_executor(loop, os.pread, fd, BLOCK, off,
+                                                            executor=ex), ops)
+    finally:
+        loop.remove_reader(r.fileno())
+        r.close()
+        w.close()
+
+
+def bench_asyncio(fd: int, ops: int) -> float:
+    loop = asyncio.new_event_loop()
+    try:
+        return _drive(loop, lambda off: loop.run_in_executor(None, os.pread, fd, BLOCK, off), ops)
+    finally:
+        loop.close()
+
+
+def bench(ops: int = OPS) -> dict:
+    fd, path = _file()
+    try:
+        return {
+            "pool": bench_pool(fd, ops),
+            "executor": bench_executor(fd, ops),
+            "asyncio": bench_asyncio(fd, ops),
+        }
+    finally:
+        os.close(fd)
+        os.unlink(path)
+
+
+if __name__ == "__main__":
+    for kind, rate in bench().items():
+        print(f"{kind:>9}: {rate:10,.0f} preads/s")
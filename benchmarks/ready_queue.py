@@ -0,0 +1,43 @@
+import time
+import asyncio
+import casyncio
+
+DEPTHS = (10, 100, 1_000, 10_000, 100_000, 1_000_000)
+
+
+def _noop():
+    pass
+
+
+def bench_casyncio(depth: int) -> float:
+    """Return seconds per callback when draining *depth* queued callbacks."""
+    loop = casyncio.EventLoop()
+    for _ in range(depth):
+        loop.call_soon(_noop)
+    start = time.perf_counter()
+    loop.run_forever()
+    return (time.perf_counter() - start) / depth
+
+
+def bench_asyncio(depth: int) -> float:
+    """Same fan-out drain on Python's default event loop."""
+    loop = asyncio.new_event_loop()
+    for _ in range(depth):
+        loop.call_soon(_noop)
+    loop.call_soon(loop.stop)
+    start = time.perf_counter()
+    loop.run_forever()
+    elapsed = time.perf_counter() - start
+    loop.close()
+    return elapsed / depth
+
+
+def bench(depths=DEPTHS) -> list[tuple[int, float, float]]:
+    """Return (depth, casyncio, asyncio) per-callback costs in seconds."""
+    return [(d, bench_casyncio(d), bench_asyncio(d)) for d in depths]
+
+
+if __name__ == "__main__":
+    print(f"{'depth':>9} {'casyncio ns/cb':>15} {'asyncio ns/cb':>15}")
+    for depth, cas, std in bench():
+        print(f"{depth:>9} {cas * 1e9:>15.1f} {std * 1e9:>15.1f}")
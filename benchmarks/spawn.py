@@ -0,0 +1,67 @@
+import asyncio
+import time
+import casyncio
+
+SPAWNS = 500
+BALLAST_MB = 512
+
+
+def bench_casyncio(n: int, inflight: int = 16) -> float:
+    """Spawns/s of /bin/true through casyncio.Process, *inflight* at a time."""
+    loop = casyncio.EventLoop()
+    left = n
+    started = 0
+
+    def on_exit(fut):
+        nonlocal left
+        assert fut.result() == 0
+        left -= 1
+        if not left:
+            loop.stop()
+        else:
+            spawn()
+
+    def spawn():
+        nonlocal started
+        if started < n:
+            started += 1
+            casyncio.Process(loop, ["true"]).wait().add_done_callback(on_exit)
+
+    start = time.perf_counter()
+    for _ in range(min(inflight, n)):
+        spawn()
+    loop.run_forever()
+    elapsed = time.perf_counter() - start
+    assert not left, "loop stopped early"
+    return n / elapsed
+
+
+def bench_asyncio(n: int, inflight: int = 16) -> float:
+    async def main():
+        sem = asyncio.Semaphore(inflight)
+
+        async def one():
+            async with sem:
+                proc = await asyncio.create_subprocess_exec("true")
+                assert await proc.wait() == 0
+
+        start = time.perf_counter()
+        await asyncio.gather(*(one() for _ in range(n)))
+        return time.perf_counter() - start
+
+    return n / asyncio.run(main())
+
+
+def bench(n: int = SPAWNS, ballast_mb: int = BALLAST_MB) -> dict:
+    """Spawn rates from a parent holding *ballast_mb* of touched memory."""
+    ballast = bytearray(ballast_mb << 20)
+    ballast[::4096] = b"\1" * len(range(0, len(ballast), 4096))
+    try:
+        return {"casyncio": bench_casyncio(n), "asyncio": bench_asyncio(n)}
+    finally:
+        del ballast
+
+
+if __name__ == "__main__":
+    for kind, rate in bench().items():
+        print(f"{kind:>9}: {rate:10,.0f} spawns/s")
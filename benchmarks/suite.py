@@ -0,0 +1,521 @@
+"""Loop benchmark suite: ops/s and latency percentiles as JSON.
+
+    PYTHONPATH=. python -m benchmarks.suite [--only call_soon,echo_small]
+        [--loops casyncio,asyncio,uvloop] [--scale 0.1] [--out results.json]
+
+Every scenario runs the same Python code on each loop (uvloop only when it
+is installed), so the numbers compare the loops rather than the callers.
+Latencies are per operation, in microseconds.
+"""
+import argparse
+import asyncio
+import json
+import os
+import platform
+import socket
+import sys
+import threading
+import time
+
+import casyncio
+from py_async_lib.executor import run_in_executor
+from py_async_lib.highlevel import create_datagram_endpoint
+from py_async_lib.stream_writer import StreamWriter
+
+try:
+    import uvloop
+except ModuleNotFoundError:  # pragma: no cover - optional comparison
+    uvloop = None
+
+LOOPS = {
+    "casyncio": casyncio.EventLoop,
+    # spins 50us before each blocking wait: trades a core for wakeup latency
+    "casyncio_busy": lambda: casyncio.EventLoop(busy_poll=50e-6),
+    "asyncio": asyncio.new_event_loop,
+}
+if uvloop is not None:  # pragma: no cover
+    LOOPS["uvloop"] = uvloop.new_event_loop
+
+_now = time.perf_counter_ns
+
+
+def _result(ops: int, elapsed_ns: int, lat_ns: list) -> dict:
+    lat = sorted(lat_ns)
+
+    def pct(q):
+        return round(lat[min(len(lat) - 1, int(q * len(lat)))] / 1e3, 3) if lat else None
+
+    return {
+        "ops": ops,
+        "ops_per_s": round(ops * 1e9 / max(elapsed_ns, 1), 1),
+        "p50_us": pct(0.50),
+        "p99_us": pct(0.99),
+        "p999_us": pct(0.999),
+    }
+
+
+def _drive(loop, start) -> None:
+    """Call start() from the loop and run until something calls loop.stop()."""
+    # casyncio's run_forever() returns once nothing is being watched
+    keep_r, keep_w = socket.socketpair()
+    loop.add_reader(keep_r.fileno(), lambda: None)
+    loop.call_soon(start)
+    try:
+        loop.run_forever()
+    finally:
+        loop.remove_reader(keep_r.fileno())
+        keep_r.close()
+        keep_w.close()
+
+
+def _run(loop, coro):
+    if isinstance(loop, casyncio.EventLoop):
+        task = loop.create_task(coro)
+        task.add_done_callback(lambda _: loop.stop())
+        _drive(loop, lambda: None)
+        return task.result()
+    return loop.run_until_complete(coro)
+
+
+def bench_call_soon(loop, n: int) -> dict:
+    """Chained call_soon(); latency is schedule-to-run of each hop."""
+    lat = []
+    left = n
+    sched = 0
+
+    def cb():
+        nonlocal left, sched
+        lat.append(_now() - sched)
+        left -= 1
+        if left:
+            sched = _now()
+            loop.call_soon(cb)
+        else:
+            loop.stop()
+
+    def start():
+        nonlocal sched
+        sched = _now()
+        loop.call_soon(cb)
+
+    t0 = _now()
+    _drive(loop, start)
+    return _result(n, _now() - t0, lat)
+
+
+def bench_timers(loop, n: int) -> dict:
+    """Arm n timers over 0-5 ms and cancel every other one.
+
+    ops/s covers the arm/cancel churn; latency is how late the surviving
+    timers fire, counted from when the arming callback returned if that
+    was after their deadline.
+    """
+    lat = []
+    fired = 0
+    churn_ns = 0
+    churn_end = 0
+    want = n - n // 2
+
+    def on_timer(deadline):
+        nonlocal fired
+        lat.append(max(0, _now() - max(deadline, churn_end)))
+        fired += 1
+        if fired == want:
+            loop.stop()
+
+    def start():
+        nonlocal churn_ns, churn_end
+        t0 = _now()
+        for i in range(n):
+            delay = (i * 7919 % 5000) / 1e6
+            deadline = _now() + int(delay * 1e9)
+            h = loop.call_later(delay, lambda d=deadline: on_timer(d))
+            if i % 2:
+                h.cancel()
+        churn_end = _now()
+        churn_ns = churn_end - t0
+
+    _drive(loop, start)
+    return _result(n + n // 2, churn_ns, lat)
+
+
+class _Peer:
+    """Non-blocking socket driven by add_reader/add_writer, drained to EAGAIN."""
+
+    def __init__(self, loop, sock, on_data):
+        self.loop = loop
+        self.sock = sock
+        self.fd = sock.fileno()
+        self.on_data = on_data
+        self.out = bytearray()
+        sock.setblocking(False)
+        loop.add_reader(self.fd, self._readable)
+
+    def _readable(self):
+        while True:
+            try:
+                data = self.sock.recv(262144)
+            except BlockingIOError:
+                return
+            if not data:
+                self.loop.remove_reader(self.fd)
+                return
+            self.on_data(self, data)
+
+    def send(self, data):
+        if self.out:
+            self.out += data
+            return
+        try:
+            n = self.sock.send(data)
+        except BlockingIOError:
+            n = 0
+        if n < len(data):
+            self.out += data[n:]
+            self.loop.add_writer(self.fd, self._writable)
+
+    def _writable(self):
+        while self.out:
+            try:
+                n = self.sock.send(self.out)
+            except BlockingIOError:
+                return
+            del self.out[:n]
+        self.loop.remove_writer(self.fd)
+
+    def close(self):
+        self.loop.remove_reader(self.fd)
+        if self.out:
+            self.loop.remove_writer(self.fd)
+        self.sock.close()
+
+
+def bench_echo(loop, conns: int, msgs: int, size: int) -> dict:
+    """Loopback TCP echo; latency is the round trip of one message."""
+    srv = socket.socket()
+    srv.bind(("127.0.0.1", 0))
+    srv.listen(conns)
+    pairs = []
+    for _ in range(conns):
+        c = socket.create_connection(srv.getsockname())
+        c.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        s, _ = srv.accept()
+        s.setsockopt(socket.IPPROTO_TCP, socket.TCP_NODELAY, 1)
+        pairs.append((c, s))
+    srv.close()
+    payload = b"x" * size
+    lat = []
+    active = conns
+    peers = []
+
+    def make_client():
+        state = {"got": 0, "left": msgs, "sent": 0}
+
+        def on_data(peer, data):
+            nonlocal active
+            state["got"] += len(data)
+            if state["got"] < size:
+                return
+            lat.append(_now() - state["sent"])
+            state["got"] -= size
+            state["left"] -= 1
+            if state["left"]:
+                state["sent"] = _now()
+                peer.send(payload)
+            else:
+                active -= 1
+                if not active:
+                    loop.stop()
+
+        return state, on_data
+
+    def start():
+        for c, s in pairs:
+            peers.append(_Peer(loop, s, lambda peer, data: peer.send(data)))
+            state, on_data = make_client()
+            peer = _Peer(loop, c, on_data)
+            peers.append(peer)
+            state["sent"] = _now()
+            peer.send(payload)
+
+    t0 = _now()
+    try:
+        _drive(loop, start)
+    finally:
+        for p in peers:
+            p.close()
+    return _result(conns * msgs, _now() - t0, lat)
+
+
+def _feeder(sock, lines: int, line: bytes) -> threading.Thread:
+    def run():
+        chunk = line * 512
+        left = lines
+        with sock:
+            while left:
+                k = min(left, 512)
+                sock.sendall(chunk if k == 512 else line * k)
+                left -= k
+
+    t = threading.Thread(target=run, daemon=True)
+    t.start()
+    return t
+
+
+def bench_readline(loop, n: int) -> dict:
+    """StreamReader.readline() over ~80-byte lines; latency per call."""
+    r, w = socket.socketpair()
+    line = b"GET /index.html HTTP/1.1 header-field: some-value-to-parse 0123456789 abcdef\n"
+    lat = []
+
+    async def main():
+        if isinstance(loop, casyncio.EventLoop):
+            r.setblocking(False)
+            reader = casyncio.StreamReader(loop, r.fileno())
+        else:
+            # keep the writer: collecting it closes the transport
+            reader, writer = await asyncio.open_connection(sock=r)
+        feeder = _feeder(w, n, line)
+        t0 = _now()
+        for _ in range(n):
+            t = _now()
+            got = await reader.readline()
+            lat.append(_now() - t)
+        assert got == line
+        elapsed = _now() - t0
+        feeder.join()
+        return elapsed
+
+    try:
+        elapsed = _run(loop, main())
+    finally:
+        if isinstance(loop, casyncio.EventLoop):
+            loop.remove_reader(r.fileno())
+        r.close()
+    return _result(n, elapsed, lat)
+
+
+def bench_drain(loop, n: int, chunk: int = 65536) -> dict:
+    """write() + drain() against a slower reader; latency is the drain wait."""
+    r, w = socket.socketpair()
+    lat = []
+
+    def sink():
+        with r:
+            while r.recv(1 << 20):
+                pass
+
+    t = threading.Thread(target=sink, daemon=True)
+    t.start()
+    data = b"y" * chunk
+
+    async def main():
+        if isinstance(loop, casyncio.EventLoop):
+            w.setblocking(False)
+            writer = StreamWriter(loop, w.detach())
+        else:
+            _, writer = await asyncio.open_connection(sock=w)
+        t0 = _now()
+        for _ in range(n):
+            writer.write(data)
+            t1 = _now()
+            await writer.drain()
+            lat.append(_now() - t1)
+        elapsed = _now() - t0
+        writer.close()
+        return elapsed
+
+    elapsed = _run(loop, main())
+    if not isinstance(loop, casyncio.EventLoop):
+        # let the transport flush and close
+        loop.run_until_complete(asyncio.sleep(0))
+    t.join(5)
+    return _result(n, elapsed, lat)
+
+
+def bench_threadsafe(loop, threads: int, per_thread: int) -> dict:
+    """call_soon_threadsafe() from several threads; latency is call-to-run."""
+    lat = []
+    total = threads * per_thread
+    seen = 0
+
+    def record(t):
+        nonlocal seen
+        lat.append(_now() - t)
+        seen += 1
+        if seen == total:
+            loop.stop()
+
+    def produce():
+        for _ in range(per_thread):
+            t = _now()
+            loop.call_soon_threadsafe(lambda t=t: record(t))
+
+    workers = [threading.Thread(target=produce) for _ in range(threads)]
+
+    def start():
+        for th in workers:
+            th.start()
+
+    t0 = _now()
+    _drive(loop, start)
+    elapsed = _now() - t0
+    for th in workers:
+        th.join()
+    return _result(total, elapsed, lat)
+
+
+def bench_executor(loop, n: int, inflight: int = 16) -> dict:
+    """run_in_executor() round trips, inflight at a time."""
+    lat = []
+    issued = 0
+    done = 0
+    if isinstance(loop, casyncio.EventLoop):
+        submit = lambda: run_in_executor(loop, int)
+    else:
+        submit = lambda: loop.run_in_executor(None, int)
+
+    def on_done(fut, t):
+        nonlocal done
+        fut.result()
+        lat.append(_now() - t)
+        done += 1
+        if done == n:
+            loop.stop()
+        else:
+            issue()
+
+    def issue():
+        nonlocal issued
+        if issued < n:
+            issued += 1
+            t = _now()
+            submit().add_done_callback(lambda f, t=t: on_done(f, t))
+
+    def start():
+        for _ in range(min(inflight, n)):
+            issue()
+
+    t0 = _now()
+    _drive(loop, start)
+    return _result(n, _now() - t0, lat)
+
+
+def bench_udp(loop, bursts: int, burst: int = 64, size: int = 200) -> dict:
+    """UDP bursts between two endpoints; latency is send-to-last-receipt of a burst."""
+    lat = []
+    payload = b"m" * size
+    got = 0
+    left = bursts
+    sent = 0
+
+    class Sink(asyncio.DatagramProtocol):
+        def datagram_received(self, data, addr):
+            nonlocal got, left
+            got += 1
+            if got < burst:
+                return
+            lat.append(_now() - sent)
+            got = 0
+            left -= 1
+            if left:
+                send_burst()
+            else:
+                loop.stop()
+
+    async def open_endpoints():
+        rt, _ = await create_datagram_endpoint(Sink, local_addr=("127.0.0.1", 0), loop=loop)
+        st, _ = await create_datagram_endpoint(asyncio.DatagramProtocol,
+                                               remote_addr=rt.get_extra_info("sockname"),
+                                               loop=loop)
+        return rt, st
+
+    rt, st = _run(loop, open_endpoints())
+
+    def send_burst():
+        nonlocal sent
+        sent = _now()
+        for _ in range(burst):
+            st.sendto(payload)
+
+    t0 = _now()
+    _drive(loop, send_burst)
+    elapsed = _now() - t0
+    rt.close()
+    st.close()
+    if not isinstance(loop, casyncio.EventLoop):
+        loop.run_until_complete(asyncio.sleep(0))
+    return _result(bursts * burst, elapsed, lat)
+
+
+def _scenarios(scale: float) -> dict:
+    def s(n):
+        return max(4, int(n * scale))
+
+    return {
+        "call_soon": lambda loop: bench_call_soon(loop, s(200_000)),
+        "timers": lambda loop: bench_timers(loop, s(50_000)),
+        "echo_small": lambda loop: bench_echo(loop, min(64, s(64)), s(200), 64),
+        "echo_large": lambda loop: bench_echo(loop, min(8, s(8)), s(50), 256 * 1024),
+        "readline": lambda loop: bench_readline(loop, s(200_000)),
+        "drain": lambda loop: bench_drain(loop, s(2_000)),
+        "threadsafe_1": lambda loop: bench_threadsafe(loop, 1, s(100_000)),
+        "threadsafe_4": lambda loop: bench_threadsafe(loop, 4, s(50_000)),
+        "executor": lambda loop: bench_executor(loop, s(20_000)),
+        "udp": lambda loop: bench_udp(loop, s(3_000)),
+    }
+
+
+def run(only=None, loops=None, scale: float = 1.0) -> dict:
+    """Run the chosen scenarios on each loop; returns the JSON-ready report."""
+    scenarios = _scenarios(scale)
+    names = only or list(scenarios)
+    unknown = set(names) - set(scenarios)
+    if unknown:
+        raise ValueError(f"unknown scenarios: {', '.join(sorted(unknown))}")
+    kinds = [k for k in (loops or LOOPS) if k in LOOPS]
+    results = {}
+    for name in names:
+        results[name] = {}
+        for kind in kinds:
+            loop = LOOPS[kind]()
+            try:
+                results[name][kind] = scenarios[name](loop)
+            finally:
+                if hasattr(loop, "close"):
+                    loop.close()
+    return {
+        "meta": {
+            "python": sys.version.split()[0],
+            "platform": platform.platform(),
+            "cpus": os.cpu_count(),
+            "loops": kinds,
+            "scale": scale,
+            "time": time.strftime("%Y-%m-%dT%H:%M:%S%z"),
+        },
+        "results": results,
+    }
+
+
+def main(argv=None) -> None:
+    ap = argparse.ArgumentParser(description=__doc__.splitlines()[0])
+    ap.add_argument("--only", help="comma-separated scenarios")
+    ap.add_argument("--loops", help="comma-separated loops (default: all available)")
+    ap.add_argument("--scale", type=float, default=1.0, help="multiply every op count")
+    ap.add_argument("--out", help="write the JSON here instead of stdout")
+    args = ap.parse_args(argv)
+    report = run(
+        only=args.only.split(",") if args.only else None,
+        loops=args.loops.split(",") if args.loops else None,
+        scale=args.scale,
+    )
+    text = json.dumps(report, indent=2)
+    if args.out:
+        with open(args.out, "w") as f:
+            f.write(text + "\n")
+    else:
+        print(text)
+
+
+if __name__ == "__main__":
+    main()
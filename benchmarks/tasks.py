@@ -0,0 +1,58 @@
+import asyncio
+import time
+import casyncio
+
+TASKS = 200_000
+_CACHE = {i: i * 2 for i in range(1024)}
+
+
+async def _handler(key):
+    # the common case: a cache hit that finishes without awaiting I/O
+    return _CACHE.get(key & 1023)
+
+
+def bench_casyncio(n: int, eager: bool) -> float:
+    """Tasks/s for n cache-hit handlers spawned on a casyncio loop."""
+    loop = casyncio.EventLoop(eager_tasks=eager)
+    elapsed = 0.0
+
+    def spawn():
+        nonlocal elapsed
+        start = time.perf_counter()
+        for i in range(n):
+            loop.create_task(_handler(i))
+        elapsed -= start
+
+    def finish():
+        nonlocal elapsed
+        elapsed += time.perf_counter()
+
+    loop.call_soon(spawn)
+    loop.call_soon(lambda: loop.call_soon(finish))
+    loop.run_forever()
+    return n / elapsed
+
+
+def bench_asyncio(n: int) -> float:
+    async def main():
+        loop = asyncio.get_running_loop()
+        start = time.perf_counter()
+        for i in range(n):
+            last = loop.create_task(_handler(i))
+        await last   # FIFO: the last one done means all are
+        return time.perf_counter() - start
+
+    return n / asyncio.run(main())
+
+
+def bench(n: int = TASKS) -> dict:
+    return {
+        "eager": bench_casyncio(n, True),
+        "lazy": bench_casyncio(n, False),
+        "asyncio": bench_asyncio(n),
+    }
+
+
+if __name__ == "__main__":
+    for kind, rate in bench().items():
+        print(f"{kind:>8}: {rate:12,.0f} tasks/s")
@@ -0,0 +1,65 @@
+import asyncio
+import socket
+import threading
+import time
+import casyncio
+
+THREADS = (1, 4)
+PER_THREAD = 50_000
+
+
+def _run(loop, run, threads: int, per_thread: int) -> float:
+    """Callbacks/s submitted with call_soon_threadsafe() from *threads* threads."""
+    total = threads * per_thread
+    left = total
+
+    def tick():
+        nonlocal left
+        left -= 1
+        if not left:
+            loop.stop()
+
+    def produce():
+        submit = loop.call_soon_threadsafe
+        for _ in range(per_thread):
+            submit(tick)
+
+    workers = [threading.Thread(target=produce) for _ in range(threads)]
+    start = time.perf_counter()
+    for t in workers:
+        t.start()
+    run()
+    elapsed = time.perf_counter() - start
+    for t in workers:
+        t.join()
+    return total / elapsed
+
+
+def bench_casyncio(threads: int, per_thread: int) -> float:
+    loop = casyncio.EventLoop()
+    r, w = socket.socketpair()
+    loop.add_reader(r.fileno(), lambda: None)   # keep the loop waiting
+    try:
+        return _run(loop, loop.run_forever, threads, per_thread)
+    finally:
+        loop.remove_reader(r.fileno())
+        r.close()
+        w.close()
+
+
+def bench_asyncio(threads: int, per_thread: int) -> float:
+    loop = asyncio.new_event_loop()
+    try:
+        return _run(loop, loop.run_forever, threads, per_thread)
+    finally:
+        loop.close()
+
+
+def bench(threads=THREADS, per_thread: int = PER_THREAD) -> list[tuple[int, float, float]]:
+    return [(n, bench_casyncio(n, per_thread), bench_asyncio(n, per_thread)) for n in threads]
+
+
+if __name__ == "__main__":
+    print(f"{'threads':>8} {'casyncio/s':>12} {'asyncio/s':>12}")
+    for n, cas, std in bench():
+        print(f"{n:>8} {cas:>12.0f} {std:>12.0f}")
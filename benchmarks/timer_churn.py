@@ -0,0 +1,64 @@
+import time
+import tracemalloc
+import casyncio
+
+SIZES = (1_000, 10_000, 100_000, 500_000)
+TIMEOUT = 60.0
+
+
+def _noop():
+    pass
+
+
+def _rate(n: int, fn) -> float:
+    start = time.perf_counter()
+    fn()
+    return n / (time.perf_counter() - start)
+
+
+def bench_size(n: int) -> dict:
+    """Measure arm/re-arm/cancel ops/s and memory with *n* live timers."""
+    loop = casyncio.EventLoop()
+    handles = []
+    arm = _rate(n, lambda: handles.extend(loop.call_later(TIMEOUT, _noop) for _ in range(n)))
+    # idle-timeout pattern: push every deadline back on each read
+    rearm = _rate(n, lambda: [h.reschedule(TIMEOUT) for h in handles])
+    # re-arm the asyncio way: cancel and schedule a fresh timer
+    def cancel_and_arm():
+        for i, h in enumerate(handles):
+            h.cancel()
+            handles[i] = loop.call_later(TIMEOUT, _noop)
+    rearm_cancel = _rate(n, cancel_and_arm)
+    cancel = _rate(n, lambda: [h.cancel() for h in handles])
+
+    handles.clear()
+    tracemalloc.start()
+    base = tracemalloc.get_traced_memory()[0]
+    handles.extend(loop.call_later(TIMEOUT, _noop) for _ in range(n))
+    armed = tracemalloc.get_traced_memory()[0] - base
+    for h in handles:
+        h.cancel()
+    handles.clear()
+    residual = tracemalloc.get_traced_memory()[0] - base
+    tracemalloc.stop()
+    return {
+        "timers": n,
+        "arm_ops": arm,
+        "reschedule_ops": rearm,
+        "cancel_rearm_ops": rearm_cancel,
+        "cancel_ops": cancel,
+        "bytes_per_timer": armed / n,
+        "residual_bytes": residual,
+    }
+
+
+def bench(sizes=SIZES) -> list[dict]:
+    return [bench_size(n) for n in sizes]
+
+
+if __name__ == "__main__":
+    cols = ("timers", "arm_ops", "reschedule_ops", "cancel_rearm_ops",
+            "cancel_ops", "bytes_per_timer", "residual_bytes")
+    print(" ".join(f"{c:>16}" for c in cols))
+    for row in bench():
+        print(" ".join(f"{row[c]:>16.0f}" for c in cols))
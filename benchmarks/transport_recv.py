@@ -0,0 +1,77 @@
+import socket
+import time
+import casyncio
+from py_async_lib.transports import (BaseProtocol, BufferedProtocol,
+                                     PySocketTransport)
+
+CHUNK = 16 * 1024
+TOTAL = 64 * 1024 * 1024
+
+
+class _Counting(BaseProtocol):
+    def __init__(self, loop, total):
+        self.loop, self.left = loop, total
+
+    def data_received(self, data):
+        self.left -= len(data)
+        if self.left <= 0:
+            self.loop.stop()
+
+
+class _BufferedCounting(BufferedProtocol):
+    def __init__(self, loop, total):
+        self.loop, self.left = loop, total
+        self.mem = memoryview(bytearray(256 * 1024))
+
+    def get_buffer(self, sizehint):
+        return self.mem
+
+    def buffer_updated(self, nbytes):
+        self.left -= nbytes
+        if self.left <= 0:
+            self.loop.stop()
+
+
+def bench_one(kind: str, total: int = TOTAL) -> float:
+    """MB/s received through one transport flavour ('buffered'/'plain'/'python')."""
+    loop = casyncio.EventLoop()
+    r, w = socket.socketpair()
+    w.setblocking(False)
+    if kind == "buffered":
+        prot = _BufferedCounting(loop, total)
+        transport = casyncio.SocketTransport(loop, r, prot)
+    elif kind == "plain":
+        prot = _Counting(loop, total)
+        transport = casyncio.SocketTransport(loop, r, prot)
+    else:
+        prot = _Counting(loop, total)
+        transport = PySocketTransport(loop, r, prot)
+    chunk = b"z" * CHUNK
+    sent = 0
+
+    def pump():
+        nonlocal sent
+        while sent < total:
+            try:
+                sent += w.send(chunk)
+            except BlockingIOError:
+                return
+        loop.remove_writer(w.fileno())
+
+    loop.add_writer(w.fileno(), pump)
+    start = time.perf_counter()
+    loop.run_forever()
+    elapsed = time.perf_counter() - start
+    loop.remove_writer(w.fileno())
+    transport.close()
+    w.close()
+    return total / elapsed / 1e6
+
+
+def bench(total: int = TOTAL) -> dict:
+    return {kind: bench_one(kind, total) for kind in ("buffered", "plain", "python")}
+
+
+if __name__ == "__main__":
+    for kind, rate in bench().items():
+        print(f"{kind:>10}: {rate:8.1f} MB/s")
@@ -3,47 +3,595 @@
 
 #include <Python.h>
 #include <sys/epoll.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
 #include <stdint.h>
 
+/*
+ * A queued loop.sendfile(): the kernel copies straight from the file with
+ * sendfile(2), or through a bounded buffer when it cannot (non-socket
+ * targets, files sendfile refuses).  fd is a private dup.
+ */
+typedef struct FileSeg {
+    int fd;
+    off_t offset;       /* next byte to send */
+    Py_ssize_t left;    /* bytes still to send */
+    Py_ssize_t sent;
+    int copy;           /* use the pread()/write() fallback */
+    PyObject *fut;      /* resolved with sent once done */
+} FileSeg;
+
+/* sendfile() bytes per call, and the fallback's copy buffer */
+#define SENDFILE_CHUNK 0x7ffff000
+#define SENDFILE_COPY_BUF (64 * 1024)
+
+/* One queued write: a buffer view that keeps the source object alive. */
 typedef struct {
-    char *data;
+    Py_buffer view;
+    Py_ssize_t off;     /* bytes of view already sent */
+    FileSeg *file;      /* a sendfile() segment instead of view, or NULL */
+} OutSeg;
+
+/*
+ * A MSG_ZEROCOPY send the kernel may still be reading from: obj stays
+ * referenced until the completion for id arrives on the error queue.
+ */
+typedef struct {
+    uint32_t id;        /* the kernel's per-socket zerocopy send counter */
+    int done;           /* completed, waiting for earlier ids */
     Py_ssize_t len;
-    Py_ssize_t pos;
-    PyObject *waiters;
+    PyObject *obj;
+} ZcSend;
+
+/* default size from which a segment goes out with MSG_ZEROCOPY */
+#define ZEROCOPY_DEFAULT_THRESHOLD (128 * 1024)
+
+/* callback duration histogram: bucket 0 is < 1us, bucket k < 2^k us */
+#define STATS_HIST_BUCKETS 24
+
+/*
+ * loop.stats() counters: plain increments on the loop thread.  Callback
+ * timing costs two clock reads per callback and only runs when enabled.
+ */
+typedef struct LoopStats {
+    uint64_t iterations;
+    uint64_t callbacks;
+    uint64_t ready_high_water;
+    uint64_t waits;             /* epoll_wait / io_uring_enter calls */
+    uint64_t wait_events;
+    uint64_t wait_events_max;
+    uint64_t wait_ns;           /* time spent inside those calls */
+    uint64_t timers_armed;
+    uint64_t timers_fired;
+    uint64_t timers_cancelled;
+    uint64_t bytes_sent;        /* by the write queue paths */
+    uint64_t write_eagain;
+    uint64_t read_eagain;
+    uint64_t slow_callbacks;
+    uint64_t datagrams_received;
+    uint64_t datagrams_sent;
+    uint64_t dgram_syscalls;    /* recvmmsg() + sendmmsg() calls */
+    uint64_t zerocopy_sends;
+    uint64_t zerocopy_copied;   /* completions where the kernel copied anyway */
+    uint64_t interest_updates;  /* epoll_ctl / io_uring poll changes */
+    uint64_t busy_polls;        /* waits that spun before blocking */
+    uint64_t busy_poll_hits;    /* ... and found events without sleeping */
+    uint64_t ring_accepts;      /* connections from multishot accept */
+    uint64_t ring_recvs;        /* multishot recv completions with data */
+    uint64_t ring_sends;        /* SENDMSG operations submitted */
+    uint64_t cb_hist[STATS_HIST_BUCKETS];
+} LoopStats;
+
+/*
+ * Per-fd write queue.  Immutable bytes are referenced rather than copied;
+ * segs[head:head+count] are unsent in order and flushed with one
+ * sendmsg/writev per IOV_MAX segments.
+ */
+typedef struct OutBuf {
+    OutSeg *segs;
+    size_t head;
+    size_t count;
+    size_t cap;
+    Py_ssize_t nbytes;  /* unsent bytes across all segments, files included */
+    int not_socket;     /* sendmsg gave ENOTSOCK; use writev */
+    Py_ssize_t high;    /* pause the writer above this many bytes */
+    Py_ssize_t low;     /* ... and resume it at or below this many */
+    int paused;
+    PyObject *protocol; /* gets pause_writing()/resume_writing(), or NULL */
+    PyObject *waiters;  /* drain() futures, resolved on resume */
+    LoopStats *stats;   /* the owning loop's counters */
+    Py_ssize_t zc_threshold;  /* MSG_ZEROCOPY for segments this big; 0 is off */
+    ZcSend *zc;         /* zc[zc_head:zc_head+zc_count] await completion */
+    size_t zc_head;
+    size_t zc_count;
+    size_t zc_cap;
+    uint32_t zc_next;   /* id the kernel gives the next zerocopy send */
+    Py_ssize_t zc_bytes;  /* sent but not completed; still count as buffered */
+    struct OutBuf *next_free;  /* on the loop's free list */
 } OutBuf;
 
+#define INITIAL_OUTSEG_CAPACITY 8
+/* a recycled OutBuf keeps a segment array up to this size */
+#define OUTBUF_RETAIN_SEGS 64
+#define OUTBUF_FREELIST_DEFAULT 256
+#define DEFAULT_WRITE_HIGH (64 * 1024)
+#define DEFAULT_WRITE_LOW (DEFAULT_WRITE_HIGH / 4)
+
+/*
+ * The array each wait fills.  It doubles when a wait fills it and halves
+ * after EVENTS_SHRINK_WAITS waits in a row used under a quarter of it.
+ */
+typedef struct {
+    struct epoll_event *evs;
+    int cap;
+    int quiet;          /* consecutive waits that used under cap / 4 */
+} EventArray;
+
+#define EVENTS_MIN 64
+#define EVENTS_MAX 4096
+#define EVENTS_SHRINK_WAITS 64
+
 #define INITIAL_TIMER_CAPACITY 64
+#define INITIAL_READY_CAPACITY 64
 
+/* Power-of-two ring buffer of strong references to ready callbacks. */
 typedef struct {
-    int64_t deadline_ns;
+    PyObject **items;
+    size_t head;
+    size_t count;
+    size_t capacity;
+} ReadyQueue;
+
+/* positional arguments a Handle stores without an extra allocation */
+#define HANDLE_INLINE_ARGS 4
+
+/*
+ * casyncio.Handle: a cancellable callback(*args) sitting in the ready
+ * queue, run inside context.  The arguments are argv[1..nargs]; argv[0]
+ * is scratch for PY_VECTORCALL_ARGUMENTS_OFFSET.  argv is inline_argv
+ * unless there are more than HANDLE_INLINE_ARGS.
+ */
+typedef struct {
+    PyObject_HEAD
     PyObject *callback;
     int canceled;
+    Py_ssize_t nargs;
+    PyObject **argv;
+    PyObject *context;        /* a contextvars.Context, or NULL */
+    PyObject *inline_argv[1 + HANDLE_INLINE_ARGS];
+} PyHandleObject;
+
+struct PyEventLoopObject;
+
+/*
+ * casyncio.TimerHandle: the handle object is itself the timer heap node.
+ * The heap is ordered by key_ns, which may lag behind deadline_ns after a
+ * reschedule() to a later time; the node is re-sifted lazily when it
+ * reaches the top.  loop is borrowed and only valid while heap_index >= 0.
+ */
+typedef struct {
+    PyHandleObject base;
+    int64_t deadline_ns;
+    int64_t key_ns;
     int heap_index;
+    struct PyEventLoopObject *loop;
 } TimerNode;
 
+/* StreamReader read sizing: grows while reads fill it, shrinks otherwise. */
+#define SR_MIN_READ 4096
+#define SR_MAX_READ (256 * 1024)
+#define SR_MAX_RETAIN (1024 * 1024)
+#define SR_DEFAULT_LIMIT (64 * 1024)
+
+enum { SR_WANT_ANY, SR_WANT_EXACT, SR_WANT_LINE, SR_WANT_UNTIL };
+
+/*
+ * casyncio.StreamReader: per-fd input buffer drained until EAGAIN.  The
+ * live bytes are buf[start:end]; scan_from remembers how far the pending
+ * separator search already got so it never rescans old bytes.
+ */
+typedef struct {
+    PyObject_HEAD
+    PyObject *loop;
+    int fd;
+    char *buf;
+    size_t start;
+    size_t end;
+    size_t cap;
+    size_t scan_from;
+    size_t rsize;
+    int eof;
+    PyObject *exc;
+    PyObject *waiter;
+    int want;
+    Py_ssize_t want_n;
+    PyObject *want_sep;
+    Py_ssize_t limit;   /* stop reading above 2 * limit buffered bytes */
+    int paused;
+} PyStreamReaderObject;
+
+/*
+ * casyncio.SocketTransport: reads until EAGAIN, either straight into the
+ * protocol's get_buffer() memory (buffered protocols) or into a reusable
+ * buffer handed to data_received() as one exact-size bytes per recv.
+ * Writes go through the loop's OutBuf; the fd is the loop's to close.
+ */
+typedef struct {
+    PyObject_HEAD
+    struct PyEventLoopObject *loop;
+    PyObject *sock;
+    int fd;                   /* -1 once closed */
+    PyObject *protocol;
+    PyObject *data_received;  /* bound methods cached from the protocol */
+    PyObject *get_buffer;     /* NULL unless the protocol is buffered */
+    PyObject *buffer_updated;
+    PyObject *extra;          /* get_extra_info() values */
+    char *rbuf;
+    size_t rcap;
+    size_t rsize;             /* adaptive like StreamReader's */
+    int paused;
+    int closing;
+    PyObject *lost_exc;       /* for the scheduled connection_lost() */
+} PySocketTransportObject;
+
+/* datagrams per recvmmsg()/sendmmsg() call */
+#define DGRAM_BATCH 32
+/* receive slot: the largest UDP payload, or one GRO-coalesced train */
+#define DGRAM_SLOT 65536
+/* full recvmmsg() batches per readiness event before requeueing */
+#define DGRAM_MAX_ROUNDS 8
+/* UDP_SEGMENT limits: segments and payload bytes per GSO message */
+#define DGRAM_GSO_SEGS 64
+#define DGRAM_GSO_BYTES 65000
+
+/*
+ * recvmmsg() buffers shared by a loop's DatagramTransports.  Allocated on
+ * first use; every datagram is copied out before protocol code runs, so
+ * one set serves all transports.  Untouched slot pages never become
+ * resident.
+ */
+typedef struct DgramPool {
+    struct mmsghdr msgs[DGRAM_BATCH];
+    struct iovec iov[DGRAM_BATCH];
+    struct sockaddr_storage names[DGRAM_BATCH];
+    char control[DGRAM_BATCH][64];   /* room for the UDP_GRO cmsg */
+    char *bufs;                      /* DGRAM_BATCH * DGRAM_SLOT */
+} DgramPool;
+
+/* One queued sendto(); addrlen 0 sends to the connected peer. */
+typedef struct {
+    PyObject *data;   /* bytes */
+    struct sockaddr_storage addr;
+    socklen_t addrlen;
+} DgramOut;
+
+/*
+ * casyncio.DatagramTransport: drains a UDP socket with recvmmsg() into the
+ * loop's DgramPool and hands the protocol either one datagrams_received()
+ * list per batch or datagram_received() per datagram.  sendto() queues;
+ * the queue is flushed once per loop pass with sendmmsg(), runs of
+ * equal-size datagrams to one destination going out as a single UDP_SEGMENT
+ * (GSO) message.  With UDP_GRO the kernel may deliver coalesced trains,
+ * which are split back into datagrams.
+ */
+typedef struct {
+    PyObject_HEAD
+    struct PyEventLoopObject *loop;
+    PyObject *sock;
+    int fd;                     /* -1 once closed */
+    int family;
+    PyObject *protocol;
+    PyObject *datagram_received;
+    PyObject *datagrams_received;  /* batch callback, or NULL */
+    PyObject *error_received;      /* or NULL */
+    PyObject *extra;
+    PyObject *peer;             /* address of a connected socket, or NULL */
+    PyObject *flush_cb;         /* bound _flush, queued or set as the writer */
+    struct sockaddr_storage last_name;   /* sender behind last_addr */
+    socklen_t last_namelen;
+    PyObject *last_addr;
+    struct sockaddr_storage last_dst;    /* parsed form of last_dst_obj */
+    socklen_t last_dstlen;
+    PyObject *last_dst_obj;
+    DgramOut *sq;
+    Py_ssize_t sq_head;
+    Py_ssize_t sq_len;
+    Py_ssize_t sq_cap;
+    Py_ssize_t sq_bytes;
+    Py_ssize_t high;
+    Py_ssize_t low;
+    int write_paused;           /* pause_writing() was called */
+    int flush_pending;          /* _flush queued or waiting for EPOLLOUT */
+    int gso;                    /* UDP_SEGMENT usable */
+    int gso_max_seg;            /* larger segments failed (path MTU) */
+    int gro;                    /* UDP_GRO enabled */
+    int paused;
+    int closing;
+    PyObject *lost_exc;
+} PyDatagramTransportObject;
+
+/* accept4() calls per readiness event before yielding to other callbacks */
+#define LISTENER_MAX_ACCEPT 64
+/* back-off after EMFILE/ENFILE/ENOBUFS before accepting again */
+#define LISTENER_RETRY_DELAY 0.1
+
+/*
+ * casyncio.Listener: drains a listening socket with accept4() and hands
+ * each connection to on_accept as a native StreamReader plus a writer.
+ */
+typedef struct {
+    PyObject_HEAD
+    PyObject *loop;
+    int fd;
+    PyObject *on_accept;
+    PyObject *writer_type;  /* called as writer_type(loop, fd), or NULL */
+    Py_ssize_t limit;       /* StreamReader limit for accepted connections */
+    int max_accept;
+    int closed;
+} PyListenerObject;
+
+/* stdin/stdout/stderr specs, matching the subprocess module's constants */
+#define PROC_PIPE (-1)
+#define PROC_STDOUT (-2)
+#define PROC_DEVNULL (-3)
+#define PROC_INHERIT (-4)
+
+/*
+ * casyncio.Process: a child started with posix_spawn() (CLONE_VFORK in
+ * glibc, so the parent's page tables are never copied) and watched through
+ * a pidfd registered on the loop; exit is an ordinary readable event.  The
+ * parent pipe ends are non-blocking and belong to the process until
+ * close_stdin()/close().
+ */
+typedef struct {
+    PyObject_HEAD
+    struct PyEventLoopObject *loop;
+    pid_t pid;
+    int pidfd;          /* -1 once the child is reaped */
+    int stdio[3];       /* parent pipe ends, -1 when not piped or closed */
+    int returncode;     /* valid once pidfd is -1 */
+    PyObject *waiters;  /* wait() futures */
+} PyProcessObject;
+
+/* One add_done_callback() entry; context NULL marks a native task wakeup. */
+typedef struct {
+    PyObject *fn;
+    PyObject *context;
+} FutureCallback;
+
+enum { FUT_PENDING, FUT_CANCELLED, FUT_FINISHED };
+
+/*
+ * casyncio.Future: on a casyncio loop, completion queues the future itself
+ * once (cb_scheduled) and the loop runs every callback in one pass; other
+ * loops get one call_soon() per callback like asyncio.Future.
+ */
+typedef struct {
+    PyObject_HEAD
+    PyObject *loop;
+    int state;
+    int blocking;             /* _asyncio_future_blocking */
+    int cb_scheduled;
+    PyObject *result;
+    PyObject *exception;
+    PyObject *cancel_msg;
+    FutureCallback *callbacks;
+    Py_ssize_t ncallbacks;
+    Py_ssize_t callbacks_cap;
+} PyFutureObject;
+
+/*
+ * casyncio.Task: drives a coroutine with PyIter_Send().  Steps are queued
+ * as the task object itself (step_scheduled) and a native future wakes
+ * the task without a bound-method callback.
+ */
+typedef struct {
+    PyFutureObject base;
+    PyObject *coro;
+    PyObject *context;
+    PyObject *fut_waiter;
+    PyObject *name;           /* NULL until asked for: "Task-<id>" */
+    uint64_t id;
+    PyObject *step_exc;       /* thrown into the coroutine by the next step */
+    PyObject *cancel_msg;
+    int must_cancel;
+    int step_scheduled;
+    int num_cancels_requested;
+} PyTaskObject;
+
 typedef struct {
     PyObject *reader;
     PyObject *writer;
     OutBuf *obuf;
+    uint32_t registered;  /* EPOLLIN/EPOLLOUT mask known to the kernel */
+    uint32_t pending;     /* mask wanted once queued changes are applied */
+    int queued;           /* fd is on the loop's dirty list */
+    int emptied;          /* every watcher went while still registered */
+    uint64_t file_dev;    /* ... and the file the fd named at that point */
+    uint64_t file_ino;
+    int read_paused;      /* EPOLLIN dropped by pause_reading */
+    int read_missed;      /* readiness arrived while paused */
+    uint32_t poll_gen;    /* io_uring: generation of the armed poll */
+    int close_pending;    /* _c_close() waits for obuf to drain */
+    PyObject *owner;      /* native SocketTransport driving this fd, or NULL */
+    struct UringIO *uio;  /* io_uring operations doing this fd's I/O, or NULL */
 } FDCallback;
 
 int socket_write_now(int fd, OutBuf *ob);
 
-typedef struct {
+/*
+ * Per-loop allocators (slab.c).  BufPool keeps freed read buffers in
+ * power-of-two size classes, each a free list threaded through the
+ * buffers themselves; other sizes, a NULL pool and returns past the
+ * retention limit go straight to malloc/free.
+ */
+#define BUFPOOL_MIN_SHIFT 12
+#define BUFPOOL_MAX_SHIFT 20
+#define BUFPOOL_CLASSES (BUFPOOL_MAX_SHIFT - BUFPOOL_MIN_SHIFT + 1)
+#define BUFPOOL_DEFAULT_LIMIT (8 * 1024 * 1024)
+
+typedef struct BufPool {
+    void *free[BUFPOOL_CLASSES];
+    size_t nfree[BUFPOOL_CLASSES];
+    size_t retained;    /* bytes on the free lists */
+    size_t limit;       /* ... kept at most */
+    size_t in_use;      /* bytes handed out and not yet returned */
+    uint64_t hits;
+    uint64_t misses;
+} BufPool;
+
+void *bufpool_get(BufPool *p, size_t *size);
+void bufpool_put(BufPool *p, void *buf, size_t size);
+void bufpool_trim(BufPool *p);
+void bufpool_clear(BufPool *p);
+
+/* FDCallback slots are carved from zeroed blocks and freed with the loop. */
+#define FDSLAB_SLOTS 64
+
+typedef struct FDSlab {
+    struct FDSlab *next;
+    size_t used;
+    FDCallback slots[FDSLAB_SLOTS];
+} FDSlab;
+
+FDCallback *fdslab_alloc(FDSlab **slabs);
+void fdslab_free_all(FDSlab **slabs);
+
+/* Handle/TimerHandle objects kept for reuse across the process */
+#define HANDLE_FREELIST_DEFAULT 256
+
+/* io_uring backend (uring.c). */
+struct UringRing;
+struct io_uring_cqe;
+
+#define URING_ENTRIES 256
+#define URING_IGNORE UINT64_MAX   /* user_data of SQEs whose CQE is dropped */
+#define URING_BUFS 4096           /* receive buffer ring: a power of two */
+#define URING_BUF_SIZE 2048
+#define URING_BGID 0
+
+struct UringRing *uring_open(unsigned entries);
+void uring_close(struct UringRing *r);
+int uring_poll_add(struct UringRing *r, int fd, uint32_t events, uint64_t user_data);
+int uring_poll_remove(struct UringRing *r, uint64_t target);
+int uring_enable_io(struct UringRing *r);
+int uring_accept_multishot(struct UringRing *r, int fd, uint64_t user_data);
+int uring_recv_multishot(struct UringRing *r, int fd, uint64_t user_data);
+int uring_sendmsg(struct UringRing *r, int fd, const struct msghdr *msg, uint64_t user_data);
+int uring_cancel(struct UringRing *r, uint64_t target);
+const char *uring_buf(struct UringRing *r, unsigned bid);
+void uring_buf_return(struct UringRing *r, unsigned bid);
+int uring_submit(struct UringRing *r);
+int uring_wait(struct UringRing *r, int64_t timeout_ns, struct io_uring_cqe *out, int max);
+
+/*
+ * A native Listener's or SocketTransport's fd on an io_uring loop.  One
+ * multishot accept or recv is armed while the fd has an unpaused reader;
+ * its completions are gathered here and the reader is then scheduled as
+ * if the fd had polled readable.  A transport's queued writes go out as
+ * one SENDMSG at a time, which keeps its buffers alive until it
+ * completes.  Closing the fd leaves an orphan that is freed once the
+ * kernel is done with it.
+ */
+#define URING_SEND_IOV 64
+
+typedef struct UringSend {
+    struct msghdr msg;
+    struct iovec iov[URING_SEND_IOV];
+    PyObject *objs[URING_SEND_IOV];  /* owners of iov[0:nobjs] */
+    int nobjs;
+} UringSend;
+
+typedef struct UringIO {
+    struct UringIO *prev, *next;  /* the loop's uios list */
+    int fd;
+    int accept;           /* a listener: completions are new connections */
+    int armed;            /* multishot accept/recv in flight */
+    int cancelling;       /* ... and an ASYNC_CANCEL queued for it */
+    int sending;          /* a SENDMSG in flight */
+    int orphan;           /* the fd is closed */
+    int eof;              /* recv saw end of stream */
+    int err;              /* errno that ended the accept/recv, or 0 */
+    int send_err;         /* errno of a failed send, or 0 */
+    uint32_t ev_seq;      /* evs[ev_idx] of wait ev_seq is this fd's event */
+    int ev_idx;
+    char *rbuf;           /* rbuf[roff:rlen] received, not yet delivered */
+    size_t roff, rlen, rcap;
+    int *fds;             /* fds[0:nfds] accepted, not yet dispatched */
+    size_t nfds, fdcap;
+    UringSend *send;      /* SENDMSG arguments, allocated on first use */
+} UringIO;
+
+/* Worker pool for blocking calls (pool.c).  Jobs embed PoolJob first. */
+typedef struct PoolJob {
+    struct PoolJob *next;
+    void (*run)(struct PoolJob *job);   /* called on a worker thread */
+} PoolJob;
+
+struct WorkPool;
+
+#define POOL_MAX_THREADS 32
+
+struct WorkPool *pool_open(unsigned max_threads, int efd, int *sleeping);
+int pool_submit(struct WorkPool *p, PoolJob *job);
+int pool_has_done(struct WorkPool *p);
+PoolJob *pool_take_done(struct WorkPool *p);
+PoolJob *pool_close(struct WorkPool *p);
+
+/*
+ * call_soon_threadsafe() submission.  Producers push onto a lock-free
+ * stack; the loop thread takes the whole stack with one exchange and
+ * reverses it into the ready queue, so no lock is shared with producers.
+ */
+typedef struct XNode {
+    struct XNode *next;
+    PyObject *item;
+} XNode;
+
+typedef struct PyEventLoopObject {
     PyObject_HEAD
-    int epfd;
-    PyObject *ready_q;
+    int epfd;                /* epoll backend, or -1 */
+    struct UringRing *uring; /* io_uring backend, or NULL */
+    UringIO *uios;           /* io_uring operation state, live and orphaned */
+    uint32_t uring_seq;      /* counts _uring_collect() calls */
+    ReadyQueue ready_q;
     TimerNode **timer_heap;
     size_t timer_count;
     size_t timer_capacity;
     FDCallback **fdmap;
     int fdcap;
+    int *dirty_fds;          /* fds whose pending mask awaits epoll_ctl */
+    int ndirty;
+    int dirty_cap;
     sigset_t sigmask;
     int sfd;
     PyObject *signal_handlers;
     int running;
-    int aw_rfd;
-    int aw_wfd;
+    int efd;                 /* eventfd that wakes the loop for xq_top */
+    XNode *xq_top;           /* cross-thread submissions, newest first */
+    int xq_sleeping;         /* set while blocked: the next producer writes efd */
+    struct WorkPool *pool;   /* started by the first pool job, or NULL */
+    unsigned pool_size;      /* worker thread limit */
+    Py_ssize_t pool_inflight; /* submitted jobs not yet delivered */
+    int tfd;                 /* timerfd driving the heap, or -1 */
+    int64_t tfd_armed_ns;    /* absolute expiry currently armed, 0 if idle */
+    int64_t timer_slack_ns;  /* wakeups are rounded up to this grid */
+    int64_t busy_poll_ns;    /* spin with zero-timeout waits this long first */
+    EventArray events;       /* kept between runs; a running loop owns it */
+    int events_cap;          /* size of the array in use, for stats() */
+    int eager_tasks;         /* create_task() default for eager= */
+    LoopStats stats;
+    int cb_timing;           /* time each callback into stats.cb_hist */
+    int64_t slow_cb_ns;      /* report callbacks at least this long, 0 off */
+    PyObject *last_slow;     /* (callable, seconds) of the latest, or NULL */
+    struct DgramPool *dgram_pool;  /* recvmmsg() buffers, or NULL */
+    BufPool bufpool;         /* StreamReader and SocketTransport read buffers */
+    OutBuf *outbuf_free;     /* write queues of closed fds, kept for reuse */
+    size_t outbuf_nfree;
+    size_t outbuf_limit;
+    uint64_t outbuf_hits;
+    uint64_t outbuf_misses;
+    FDSlab *fd_slabs;
 } PyEventLoopObject;
 
 #endif // CASYNCIO_LOOP_H
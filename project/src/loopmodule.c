@@ -9,6 +9,22 @@
 #include <sys/signalfd.h>
 #include <pthread.h>
 #include <fcntl.h>
+#include <limits.h>
+#include <math.h>
+#include <sys/timerfd.h>
+#include <sys/eventfd.h>
+#include <sys/stat.h>
+#include <sys/sendfile.h>
+#include <netdb.h>
+#include <arpa/inet.h>
+#include <netinet/udp.h>
+#include <linux/errqueue.h>
+#include <spawn.h>
+#include <sys/wait.h>
+#include <sys/syscall.h>
+#include <sys/ioctl.h>
+#include <string.h>
+#include <linux/io_uring.h>
 
 /* timer heap helpers */
 static void _swap_nodes(PyEventLoopObject *self, size_t i, size_t j)
@@ -24,7 +40,7 @@ static void _sift_up(PyEventLoopObject *self, size_t i)
 {
     while (i > 0) {
         size_t parent = (i - 1) / 2;
-        if (self->timer_heap[i]->deadline_ns < self->timer_heap[parent]->deadline_ns) {
+        if (self->timer_heap[i]->key_ns < self->timer_heap[parent]->key_ns) {
             _swap_nodes(self, i, parent);
             i = parent;
         } else {
@@ -40,9 +56,9 @@ static void _sift_down(PyEventLoopObject *self, size_t i)
         size_t left = 2 * i + 1;
         size_t right = 2 * i + 2;
         size_t smallest = i;
-        if (left < n && self->timer_heap[left]->deadline_ns < self->timer_heap[smallest]->deadline_ns)
+        if (left < n && self->timer_heap[left]->key_ns < self->timer_heap[smallest]->key_ns)
             smallest = left;
-        if (right < n && self->timer_heap[right]->deadline_ns < self->timer_heap[smallest]->deadline_ns)
+        if (right < n && self->timer_heap[right]->key_ns < self->timer_heap[smallest]->key_ns)
             smallest = right;
         if (smallest != i) {
             _swap_nodes(self, i, smallest);
@@ -64,682 +80,8042 @@ static int _heap_push(PyEventLoopObject *self, TimerNode *node)
         self->timer_capacity = newcap;
     }
     size_t idx = self->timer_count++;
+    Py_INCREF(node);
     self->timer_heap[idx] = node;
     node->heap_index = (int)idx;
+    node->key_ns = node->deadline_ns;
+    node->loop = self;
     _sift_up(self, idx);
     return 0;
 }
 
+/* Drop a pending node from the middle of the heap in O(log n). */
+static void _heap_remove(PyEventLoopObject *self, TimerNode *node)
+{
+    size_t i = (size_t)node->heap_index;
+    node->heap_index = -1;
+    self->timer_count--;
+    if (i != self->timer_count) {
+        TimerNode *last = self->timer_heap[self->timer_count];
+        self->timer_heap[i] = last;
+        last->heap_index = (int)i;
+        _sift_up(self, i);
+        _sift_down(self, (size_t)last->heap_index);
+    }
+    Py_DECREF(node);
+}
+
 static TimerNode *_heap_pop(PyEventLoopObject *self)
 {
     if (self->timer_count == 0)
         return NULL;
     TimerNode *min = self->timer_heap[0];
+    min->heap_index = -1;
     self->timer_count--;
     if (self->timer_count > 0) {
         self->timer_heap[0] = self->timer_heap[self->timer_count];
         self->timer_heap[0]->heap_index = 0;
         _sift_down(self, 0);
     }
-    return min;
+    return min; /* the heap's reference is handed to the caller */
 }
 
 static TimerNode *_heap_peek(PyEventLoopObject *self)
 {
-    return self->timer_count ? self->timer_heap[0] : NULL;
+    /* settle nodes whose deadline was pushed back since they were keyed */
+    while (self->timer_count) {
+        TimerNode *top = self->timer_heap[0];
+        if (top->key_ns >= top->deadline_ns)
+            return top;
+        top->key_ns = top->deadline_ns;
+        _sift_down(self, 0);
+    }
+    return NULL;
 }
 
-int
-socket_write_now(int fd, OutBuf *ob)
+/* ready queue helpers */
+static int _ready_push(PyEventLoopObject *self, PyObject *callback)
 {
-    while (ob->pos < ob->len) {
-        const char *buf = ob->data + ob->pos;
-        size_t remaining = ob->len - ob->pos;
-        ssize_t n = send(fd, buf, remaining, MSG_NOSIGNAL);
-        if (n == -1) {
-            if (errno == EAGAIN || errno == EWOULDBLOCK)
-                return 1; /* pending */
-            return -1;     /* fatal */
+    ReadyQueue *q = &self->ready_q;
+    if (q->count == q->capacity) {
+        size_t newcap = q->capacity ? q->capacity * 2 : INITIAL_READY_CAPACITY;
+        PyObject **newarr = PyMem_Malloc(newcap * sizeof(*newarr));
+        if (!newarr) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        if (q->count) {
+            /* unwrap so the oldest entry lands at index 0 */
+            size_t first = q->capacity - q->head;
+            memcpy(newarr, q->items + q->head, first * sizeof(*newarr));
+            memcpy(newarr + first, q->items, q->head * sizeof(*newarr));
         }
-        ob->pos += n;
+        PyMem_Free(q->items);
+        q->items = newarr;
+        q->head = 0;
+        q->capacity = newcap;
     }
-    return 0; /* complete */
+    Py_INCREF(callback);
+    q->items[(q->head + q->count) & (q->capacity - 1)] = callback;
+    q->count++;
+    if (q->count > self->stats.ready_high_water)
+        self->stats.ready_high_water = q->count;
+    return 0;
 }
 
-static OutBuf *
-outbuf_new(void)
+static PyObject *_ready_pop(PyEventLoopObject *self)
 {
-    OutBuf *ob = calloc(1, sizeof(OutBuf));
-    if (!ob)
-        return NULL;
-    ob->waiters = PyList_New(0);
-    if (!ob->waiters) {
-        free(ob);
+    ReadyQueue *q = &self->ready_q;
+    if (q->count == 0)
         return NULL;
-    }
-    return ob;
+    PyObject *callback = q->items[q->head];
+    q->head = (q->head + 1) & (q->capacity - 1);
+    q->count--;
+    return callback; /* strong reference handed to the caller */
 }
 
-static int
-loop_init(PyEventLoopObject *self, PyObject *args, PyObject *kwds)
+static void _ready_clear(PyEventLoopObject *self)
 {
-    self->epfd = epoll_create1(EPOLL_CLOEXEC);
-    if (self->epfd == -1) {
-        PyErr_SetFromErrno(PyExc_OSError);
-        return -1;
-    }
-
-    self->aw_rfd = -1;
-    self->aw_wfd = -1;
+    PyObject *callback;
+    while ((callback = _ready_pop(self)))
+        Py_DECREF(callback);
+    PyMem_Free(self->ready_q.items);
+    self->ready_q.items = NULL;
+    self->ready_q.capacity = 0;
+}
 
-    self->ready_q = PyList_New(0);
-    if (!self->ready_q)
-        return -1;
+/* write queue helpers */
+static ssize_t
+_outbuf_sendv(OutBuf *ob, int fd, struct iovec *iov, int iovcnt)
+{
+    ssize_t n = -1;
+    if (!ob->not_socket) {
+        struct msghdr msg = {.msg_iov = iov, .msg_iovlen = (size_t)iovcnt};
+        n = sendmsg(fd, &msg, MSG_NOSIGNAL);
+        if (n == -1 && errno == ENOTSOCK)
+            ob->not_socket = 1;   /* pipes and ttys */
+    }
+    if (ob->not_socket)
+        n = writev(fd, iov, iovcnt);
+    if (n > 0)
+        ob->stats->bytes_sent += (uint64_t)n;
+    else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK))
+        ob->stats->write_eagain++;
+    return n;
+}
 
-    self->timer_heap = NULL;
-    self->timer_count = 0;
-    self->timer_capacity = 0;
+/* Drop n sent bytes from the front of the queue, releasing finished views. */
+static void
+_outbuf_consume(OutBuf *ob, Py_ssize_t n)
+{
+    ob->nbytes -= n;
+    while (n > 0) {
+        OutSeg *seg = &ob->segs[ob->head];
+        Py_ssize_t rem = seg->view.len - seg->off;
+        if (n < rem) {
+            seg->off += n;
+            return;
+        }
+        n -= rem;
+        PyBuffer_Release(&seg->view);
+        ob->head++;
+        ob->count--;
+    }
+    if (!ob->count)
+        ob->head = 0;
+}
 
-    self->fdmap = NULL;
-    self->fdcap = 0;
+static int _future_resolve(PyObject *fut, PyObject *result, PyObject *exc);
 
-    sigemptyset(&self->sigmask);
-    sigaddset(&self->sigmask, SIGINT);
-    sigaddset(&self->sigmask, SIGTERM);
-    sigaddset(&self->sigmask, SIGCHLD);
-    pthread_sigmask(SIG_BLOCK, &self->sigmask, NULL);
-    self->sfd = signalfd(-1, &self->sigmask, SFD_CLOEXEC | SFD_NONBLOCK);
-    if (self->sfd == -1) {
-        PyErr_SetFromErrno(PyExc_OSError);
-        return -1;
+/* Resolve a file segment's future (with exc, or the bytes sent) and free it. */
+static void
+_fileseg_finish(FileSeg *f, PyObject *exc)
+{
+    if (f->fut) {
+        PyObject *sent = exc ? NULL : PyLong_FromSsize_t(f->sent);
+        if ((!exc && !sent) || _future_resolve(f->fut, sent, exc) < 0)
+            PyErr_WriteUnraisable(f->fut);
+        Py_XDECREF(sent);
+        Py_DECREF(f->fut);
     }
+    close(f->fd);
+    PyMem_Free(f);
+}
 
-    int pipefd[2];
-    if (pipe2(pipefd, O_CLOEXEC | O_NONBLOCK) == -1) {
-        PyErr_SetFromErrno(PyExc_OSError);
-        return -1;
+/* One pread()/write() round through a bounded buffer; like write()'s result. */
+static ssize_t
+_fileseg_copy(int fd, FileSeg *f)
+{
+    char buf[SENDFILE_COPY_BUF];
+    size_t want = f->left < (Py_ssize_t)sizeof(buf) ? (size_t)f->left : sizeof(buf);
+    ssize_t r = pread(f->fd, buf, want, f->offset);
+    if (r <= 0)
+        return r;
+    /* a short write leaves the rest to be read again next time */
+    ssize_t w = write(fd, buf, (size_t)r);
+    if (w > 0)
+        f->offset += w;
+    return w;
+}
+
+/*
+ * Send the file segment at the head of the queue: 0 once it is done (or
+ * the file ended early), 1 on EAGAIN, -1 with errno on failure.
+ */
+static int
+_outbuf_sendfile(OutBuf *ob, int fd, FileSeg *f)
+{
+    while (f->left > 0) {
+        ssize_t n;
+        if (!f->copy && !ob->not_socket) {
+            size_t chunk = f->left > SENDFILE_CHUNK ? SENDFILE_CHUNK : (size_t)f->left;
+            n = sendfile(fd, f->fd, &f->offset, chunk);
+            if (n == -1 && (errno == EINVAL || errno == ENOSYS || errno == EOPNOTSUPP)) {
+                f->copy = 1;   /* e.g. a file system without splice support */
+                continue;
+            }
+        } else {
+            n = _fileseg_copy(fd, f);
+        }
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                ob->stats->write_eagain++;
+                return 1;
+            }
+            return -1;
+        }
+        if (n == 0) {
+            /* the file is shorter than asked for */
+            ob->nbytes -= f->left;
+            f->left = 0;
+            break;
+        }
+        f->sent += n;
+        f->left -= n;
+        ob->nbytes -= n;
+        ob->stats->bytes_sent += (uint64_t)n;
     }
-    self->aw_rfd = pipefd[0];
-    self->aw_wfd = pipefd[1];
+    return 0;
+}
 
-    self->signal_handlers = PyDict_New();
-    if (!self->signal_handlers)
-        return -1;
+static inline int
+_outbuf_zc_eligible(const OutBuf *ob, const OutSeg *seg)
+{
+    return ob->zc_threshold && !seg->file && seg->view.len - seg->off >= ob->zc_threshold;
+}
 
-    struct epoll_event ev = {.events = EPOLLIN, .data.u32 = (uint32_t)self->sfd};
-    if (epoll_ctl(self->epfd, EPOLL_CTL_ADD, self->sfd, &ev) == -1) {
-        PyErr_SetFromErrno(PyExc_OSError);
-        return -1;
+/* Room for one more zerocopy record; -1 (nothing set) when out of memory. */
+static int
+_outbuf_zc_reserve(OutBuf *ob)
+{
+    if (ob->zc_head + ob->zc_count < ob->zc_cap)
+        return 0;
+    if (ob->zc_head) {
+        memmove(ob->zc, ob->zc + ob->zc_head, ob->zc_count * sizeof(ZcSend));
+        ob->zc_head = 0;
+        return 0;
     }
-    struct epoll_event ev2 = {.events = EPOLLIN, .data.u32 = (uint32_t)self->aw_rfd};
-    if (epoll_ctl(self->epfd, EPOLL_CTL_ADD, self->aw_rfd, &ev2) == -1) {
-        PyErr_SetFromErrno(PyExc_OSError);
+    size_t newcap = ob->zc_cap ? ob->zc_cap * 2 : INITIAL_OUTSEG_CAPACITY;
+    ZcSend *newzc = PyMem_Realloc(ob->zc, newcap * sizeof(ZcSend));
+    if (!newzc)
         return -1;
-    }
-
-    self->running = 0;
-
+    ob->zc = newzc;
+    ob->zc_cap = newcap;
     return 0;
 }
 
+/*
+ * Send the rest of seg with MSG_ZEROCOPY and keep its object referenced
+ * until the completion arrives.  Falls back to a copying send when the
+ * record cannot be allocated or the socket's optmem budget is spent.
+ */
+static ssize_t
+_outbuf_send_zerocopy(OutBuf *ob, int fd, OutSeg *seg)
+{
+    struct iovec iov = {(char *)seg->view.buf + seg->off, (size_t)(seg->view.len - seg->off)};
+    if (_outbuf_zc_reserve(ob) < 0)
+        return _outbuf_sendv(ob, fd, &iov, 1);
+    struct msghdr msg = {.msg_iov = &iov, .msg_iovlen = 1};
+    ssize_t n = sendmsg(fd, &msg, MSG_NOSIGNAL | MSG_ZEROCOPY);
+    if (n == -1 && errno == ENOBUFS)
+        return _outbuf_sendv(ob, fd, &iov, 1);
+    if (n > 0) {
+        ZcSend *z = &ob->zc[ob->zc_head + ob->zc_count++];
+        z->id = ob->zc_next++;
+        z->done = 0;
+        z->len = n;
+        z->obj = Py_NewRef(seg->view.obj);
+        ob->zc_bytes += n;
+        ob->stats->zerocopy_sends++;
+        ob->stats->bytes_sent += (uint64_t)n;
+    } else if (n == -1 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+        ob->stats->write_eagain++;
+    }
+    return n;
+}
+
+/* Mark zerocopy sends lo..hi done and release the completed prefix. */
 static void
-loop_dealloc(PyEventLoopObject *self)
+_outbuf_zc_complete(OutBuf *ob, uint32_t lo, uint32_t hi)
 {
-    if (self->epfd != -1)
-        close(self->epfd);
-    if (self->fdmap) {
-        for (int i = 0; i < self->fdcap; i++) {
-            FDCallback *slot = self->fdmap[i];
-            if (!slot)
-                continue;
-            Py_XDECREF(slot->reader);
-            Py_XDECREF(slot->writer);
-            if (slot->obuf) {
-                free(slot->obuf->data);
-                Py_XDECREF(slot->obuf->waiters);
-                free(slot->obuf);
-            }
-            free(slot);
-        }
-        free(self->fdmap);
+    for (size_t i = 0; i < ob->zc_count; i++) {
+        ZcSend *z = &ob->zc[ob->zc_head + i];
+        if (z->id - lo <= hi - lo)   /* ids wrap */
+            z->done = 1;
     }
-    if (self->sfd != -1)
-        close(self->sfd);
-    if (self->aw_rfd != -1)
-        close(self->aw_rfd);
-    if (self->aw_wfd != -1)
-        close(self->aw_wfd);
-    Py_XDECREF(self->signal_handlers);
-    Py_XDECREF(self->ready_q);
-    for (size_t i = 0; i < self->timer_count; i++) {
-        Py_DECREF(self->timer_heap[i]->callback);
-        PyMem_Free(self->timer_heap[i]);
+    while (ob->zc_count && ob->zc[ob->zc_head].done) {
+        ZcSend *z = &ob->zc[ob->zc_head++];
+        ob->zc_count--;
+        ob->zc_bytes -= z->len;
+        Py_DECREF(z->obj);
     }
-    PyMem_Free(self->timer_heap);
-    Py_TYPE(self)->tp_free((PyObject *)self);
+    if (!ob->zc_count)
+        ob->zc_head = 0;
 }
 
+/*
+ * Collect MSG_ZEROCOPY completions from fd's error queue; 1 if there were
+ * any.  Each notification covers a range of send ids.
+ */
 static int
-ensure_fdslot(PyEventLoopObject *self, int fd)
+_outbuf_reap_zerocopy(OutBuf *ob, int fd)
 {
-    if (fd >= self->fdcap) {
-        int newcap = self->fdcap ? self->fdcap : 8;
-        while (newcap <= fd)
-            newcap *= 2;
-        FDCallback **newmap = realloc(self->fdmap, newcap * sizeof(FDCallback *));
-        if (!newmap) {
-            PyErr_NoMemory();
-            return -1;
+    char control[CMSG_SPACE(sizeof(struct sock_extended_err) + sizeof(struct sockaddr_in6))];
+    int found = 0;
+    for (;;) {
+        struct msghdr msg = {.msg_control = control, .msg_controllen = sizeof(control)};
+        if (recvmsg(fd, &msg, MSG_ERRQUEUE | MSG_DONTWAIT) == -1) {
+            if (errno == EINTR)
+                continue;
+            return found;   /* EAGAIN once the queue is empty */
         }
-        for (int i = self->fdcap; i < newcap; i++)
-            newmap[i] = NULL;
-        self->fdmap = newmap;
-        self->fdcap = newcap;
-    }
-    if (!self->fdmap[fd]) {
-        self->fdmap[fd] = calloc(1, sizeof(FDCallback));
-        if (!self->fdmap[fd]) {
-            PyErr_NoMemory();
-            return -1;
+        for (struct cmsghdr *cm = CMSG_FIRSTHDR(&msg); cm; cm = CMSG_NXTHDR(&msg, cm)) {
+            if (!((cm->cmsg_level == SOL_IP && cm->cmsg_type == IP_RECVERR) ||
+                  (cm->cmsg_level == SOL_IPV6 && cm->cmsg_type == IPV6_RECVERR)))
+                continue;
+            struct sock_extended_err ee;
+            memcpy(&ee, CMSG_DATA(cm), sizeof(ee));
+            if (ee.ee_origin != SO_EE_ORIGIN_ZEROCOPY)
+                continue;
+            if (ee.ee_code & SO_EE_CODE_ZEROCOPY_COPIED)
+                ob->stats->zerocopy_copied += (uint64_t)(ee.ee_data - ee.ee_info) + 1;
+            _outbuf_zc_complete(ob, ee.ee_info, ee.ee_data);
+            found = 1;
         }
-        self->fdmap[fd]->obuf = NULL;
     }
-    return 0;
 }
 
-static PyObject *
-loop_call_soon(PyEventLoopObject *self, PyObject *arg)
+/*
+ * Flush the queue in order: runs of buffers with one sendmsg()/writev()
+ * each, file segments with sendfile(), and segments over the zerocopy
+ * threshold alone with MSG_ZEROCOPY.
+ */
+int
+socket_write_now(int fd, OutBuf *ob)
 {
-    if (PyList_Append(self->ready_q, arg) < 0)
-        return NULL;
-    Py_RETURN_NONE;
+    struct iovec iov[IOV_MAX];
+    while (ob->count) {
+        OutSeg *first = &ob->segs[ob->head];
+        if (first->file) {
+            int r = _outbuf_sendfile(ob, fd, first->file);
+            if (r != 0)
+                return r;
+            _fileseg_finish(first->file, NULL);
+            first->file = NULL;
+            ob->head++;
+            if (!--ob->count)
+                ob->head = 0;
+            continue;
+        }
+        ssize_t n;
+        if (_outbuf_zc_eligible(ob, first)) {
+            n = _outbuf_send_zerocopy(ob, fd, first);
+        } else {
+            int iovcnt = 0;
+            for (size_t i = 0; i < ob->count && iovcnt < IOV_MAX; i++) {
+                OutSeg *seg = &ob->segs[ob->head + i];
+                if (seg->file || (i && _outbuf_zc_eligible(ob, seg)))
+                    break;
+                iov[iovcnt].iov_base = (char *)seg->view.buf + seg->off;
+                iov[iovcnt].iov_len = (size_t)(seg->view.len - seg->off);
+                iovcnt++;
+            }
+            n = _outbuf_sendv(ob, fd, iov, iovcnt);
+        }
+        if (n == -1) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+                return 1; /* pending */
+            return -1;     /* fatal */
+        }
+        _outbuf_consume(ob, n);
+    }
+    return 0; /* complete */
 }
 
-static PyObject *
-loop_call_soon_threadsafe(PyEventLoopObject *self, PyObject *arg)
+/* Room for one more segment at the tail; NULL with MemoryError set. */
+static OutSeg *
+_outbuf_reserve(OutBuf *ob)
 {
-    if (PyList_Append(self->ready_q, arg) < 0)
-        return NULL;
-    char c = 'x';
-    if (write(self->aw_wfd, &c, 1) == -1 && errno != EAGAIN) {
-        PyErr_SetFromErrno(PyExc_OSError);
-        return NULL;
+    if (ob->head + ob->count == ob->cap) {
+        if (ob->head) {
+            memmove(ob->segs, ob->segs + ob->head, ob->count * sizeof(OutSeg));
+            ob->head = 0;
+        } else {
+            size_t newcap = ob->cap ? ob->cap * 2 : INITIAL_OUTSEG_CAPACITY;
+            OutSeg *newsegs = PyMem_Realloc(ob->segs, newcap * sizeof(OutSeg));
+            if (!newsegs) {
+                PyErr_NoMemory();
+                return NULL;
+            }
+            ob->segs = newsegs;
+            ob->cap = newcap;
+        }
     }
-    Py_RETURN_NONE;
+    OutSeg *seg = &ob->segs[ob->head + ob->count];
+    seg->file = NULL;
+    return seg;
 }
 
-static PyObject *
-loop_call_later(PyEventLoopObject *self, PyObject *args, PyObject *kwds)
+/*
+ * Queue the unsent tail of view.  bytes are immutable so the view itself is
+ * kept; anything else may be mutated by the caller and is copied.
+ * Ownership of view passes to the queue either way.
+ */
+static int
+_outbuf_append(OutBuf *ob, Py_buffer *view, Py_ssize_t off)
 {
-    double delay;
-    PyObject *callback;
-    static char *kwlist[] = {"delay", "callback", NULL};
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "dO:call_later", kwlist,
-                                     &delay, &callback))
-        return NULL;
-    if (!PyCallable_Check(callback)) {
-        PyErr_SetString(PyExc_TypeError, "callback must be callable");
-        return NULL;
+    if (off >= view->len) {
+        PyBuffer_Release(view);
+        return 0;
     }
-    if (delay <= 0.0)
-        return loop_call_soon(self, callback);
-
-    TimerNode *node = PyMem_Malloc(sizeof(TimerNode));
-    if (!node)
-        return PyErr_NoMemory();
-    struct timespec now;
-    clock_gettime(CLOCK_MONOTONIC, &now);
-    int64_t now_ns = (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
-    node->deadline_ns = now_ns + (int64_t)(delay * 1e9);
-    Py_INCREF(callback);
-    node->callback = callback;
-    node->canceled = 0;
-    if (_heap_push(self, node) < 0) {
-        Py_DECREF(callback);
-        PyMem_Free(node);
-        return PyErr_NoMemory();
+    OutSeg *seg = _outbuf_reserve(ob);
+    if (!seg) {
+        PyBuffer_Release(view);
+        return -1;
     }
-    PyObject *handle = PyCapsule_New(node, "TimerNode", NULL);
-    if (!handle) {
-        node->canceled = 1;
-        Py_DECREF(callback);
-        PyMem_Free(node);
-        return NULL;
+    if (view->obj && PyBytes_CheckExact(view->obj)) {
+        seg->view = *view;
+        seg->off = off;
+    } else {
+        PyObject *copy = PyBytes_FromStringAndSize((char *)view->buf + off, view->len - off);
+        PyBuffer_Release(view);
+        if (!copy)
+            return -1;
+        int r = PyObject_GetBuffer(copy, &seg->view, PyBUF_SIMPLE);
+        Py_DECREF(copy);
+        if (r < 0)
+            return -1;
+        seg->off = 0;
     }
-    return handle;
+    ob->nbytes += seg->view.len - seg->off;
+    ob->count++;
+    return 0;
 }
 
-static PyObject *
-loop_create_task(PyEventLoopObject *self, PyObject *args, PyObject *kwds)
+/* Queue a file segment; ob takes ownership of f either way. */
+static int
+_outbuf_append_file(OutBuf *ob, FileSeg *f)
 {
-    PyObject *coro;
-    static char *kwlist[] = {"coro", NULL};
-    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O:create_task", kwlist, &coro))
-        return NULL;
-    PyObject *tasks = PyImport_ImportModule("asyncio.tasks");
-    if (!tasks)
-        return NULL;
-    PyObject *Task = PyObject_GetAttrString(tasks, "Task");
-    Py_DECREF(tasks);
-    if (!Task)
-        return NULL;
-    PyObject *args_tuple = PyTuple_Pack(1, coro);
-    if (!args_tuple) {
-        Py_DECREF(Task);
-        return NULL;
+    OutSeg *seg = _outbuf_reserve(ob);
+    if (!seg) {
+        Py_CLEAR(f->fut);
+        _fileseg_finish(f, NULL);
+        return -1;
     }
-    PyObject *kw = Py_BuildValue("{s:O}", "loop", self);
-    if (!kw) {
-        Py_DECREF(Task);
-        Py_DECREF(args_tuple);
-        return NULL;
+    memset(&seg->view, 0, sizeof(seg->view));
+    seg->off = 0;
+    seg->file = f;
+    ob->nbytes += f->left;
+    ob->count++;
+    return 0;
+}
+
+/* Release everything queued or in flight, leaving ob empty. */
+static void
+_outbuf_drop(OutBuf *ob)
+{
+    PyObject *type = NULL, *value = NULL, *tb = NULL, *exc = NULL;
+    int fetched = 0;
+    for (size_t i = 0; i < ob->count; i++) {
+        OutSeg *seg = &ob->segs[ob->head + i];
+        if (!seg->file) {
+            PyBuffer_Release(&seg->view);
+            continue;
+        }
+        /* the fd is being closed: unsent files fail their sendfile() */
+        if (!fetched) {
+            PyErr_Fetch(&type, &value, &tb);
+            fetched = 1;
+            exc = PyObject_CallFunction(PyExc_ConnectionResetError, "s",
+                                        "connection closed before the file was sent");
+            if (!exc)
+                PyErr_WriteUnraisable(NULL);
+        }
+        if (!exc)
+            Py_CLEAR(seg->file->fut);
+        _fileseg_finish(seg->file, exc);
     }
-    PyObject *task = PyObject_Call(Task, args_tuple, kw);
-    Py_DECREF(Task);
-    Py_DECREF(args_tuple);
-    Py_DECREF(kw);
-    return task;
+    Py_XDECREF(exc);
+    if (fetched)
+        PyErr_Restore(type, value, tb);
+    ob->head = ob->count = 0;
+    ob->nbytes = 0;
+    for (size_t i = 0; i < ob->zc_count; i++)
+        Py_DECREF(ob->zc[ob->zc_head + i].obj);
+    PyMem_Free(ob->zc);
+    ob->zc = NULL;
+    ob->zc_head = ob->zc_count = ob->zc_cap = 0;
+    ob->zc_bytes = 0;
+    Py_CLEAR(ob->protocol);
 }
 
-static PyObject *
-loop_add_reader(PyEventLoopObject *self, PyObject *args)
+static void
+_outbuf_free(OutBuf *ob)
 {
-    int fd;
-    PyObject *cb;
-    if (!PyArg_ParseTuple(args, "iO:add_reader", &fd, &cb))
-        return NULL;
-    if (!PyCallable_Check(cb)) {
-        PyErr_SetString(PyExc_TypeError, "callback must be callable");
-        return NULL;
+    _outbuf_drop(ob);
+    PyMem_Free(ob->segs);
+    Py_XDECREF(ob->waiters);
+    free(ob);
+}
+
+/* Settings and counters back at their defaults; segs and waiters are kept. */
+static void
+_outbuf_reset(OutBuf *ob)
+{
+    ob->not_socket = 0;
+    ob->high = DEFAULT_WRITE_HIGH;
+    ob->low = DEFAULT_WRITE_LOW;
+    ob->paused = 0;
+    ob->zc_threshold = 0;
+    ob->zc_next = 0;
+    ob->next_free = NULL;
+}
+
+/* A write queue for a new fd: a recycled one when the loop kept any. */
+static OutBuf *
+outbuf_new(PyEventLoopObject *self)
+{
+    OutBuf *ob = self->outbuf_free;
+    if (ob) {
+        self->outbuf_free = ob->next_free;
+        self->outbuf_nfree--;
+        self->outbuf_hits++;
+        _outbuf_reset(ob);
+        return ob;
     }
-    if (ensure_fdslot(self, fd) < 0)
+    ob = calloc(1, sizeof(OutBuf));
+    if (!ob)
         return NULL;
-    FDCallback *slot = self->fdmap[fd];
-    int op = (slot->reader || slot->writer) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
-    uint32_t events = EPOLLET | EPOLLIN | (slot->writer ? EPOLLOUT : 0);
-    struct epoll_event ev = {.events = events, .data.u32 = (uint32_t)fd};
-    if (epoll_ctl(self->epfd, op, fd, &ev) == -1) {
-        PyErr_SetFromErrno(PyExc_OSError);
+    ob->waiters = PyList_New(0);
+    if (!ob->waiters) {
+        free(ob);
         return NULL;
     }
-    Py_XINCREF(cb);
-    Py_XDECREF(slot->reader);
-    slot->reader = cb;
-    Py_RETURN_NONE;
+    self->outbuf_misses++;
+    _outbuf_reset(ob);
+    ob->stats = &self->stats;
+    return ob;
 }
 
-static PyObject *
-loop_remove_reader(PyEventLoopObject *self, PyObject *arg)
+/*
+ * Done with a closed fd's queue: keep it for the next fd unless the free
+ * list is full, drain() futures are still attached, or its segment array
+ * grew large.
+ */
+static void
+_outbuf_recycle(PyEventLoopObject *self, OutBuf *ob)
 {
-    int fd = PyLong_AsLong(arg);
-    if (fd == -1 && PyErr_Occurred())
-        return NULL;
-    if (fd >= self->fdcap || !self->fdmap[fd] || !self->fdmap[fd]->reader)
-        Py_RETURN_FALSE;
-    FDCallback *slot = self->fdmap[fd];
-    Py_CLEAR(slot->reader);
-    uint32_t events = EPOLLET | (slot->writer ? EPOLLOUT : 0);
-    int op = events & (EPOLLIN | EPOLLOUT) ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
-    struct epoll_event ev = {.events = events, .data.u32 = (uint32_t)fd};
-    if (epoll_ctl(self->epfd, op, fd, &ev) == -1) {
-        PyErr_SetFromErrno(PyExc_OSError);
-        return NULL;
+    if (self->outbuf_nfree >= self->outbuf_limit || PyList_GET_SIZE(ob->waiters) ||
+        ob->cap > OUTBUF_RETAIN_SEGS) {
+        _outbuf_free(ob);
+        return;
     }
-    Py_RETURN_TRUE;
+    _outbuf_drop(ob);
+    ob->next_free = self->outbuf_free;
+    self->outbuf_free = ob;
+    self->outbuf_nfree++;
+}
+
+static void
+_protocol_notify(PyObject *protocol, const char *name)
+{
+    if (!protocol)
+        return;
+    PyObject *res = PyObject_CallMethod(protocol, name, NULL);
+    if (res)
+        Py_DECREF(res);
+    else
+        PyErr_WriteUnraisable(protocol);
 }
 
+/* cached asyncio lookups */
+static PyObject *asyncio_IncompleteReadError = NULL;
+static PyObject *asyncio_CancelledError = NULL;
+static PyObject *asyncio_InvalidStateError = NULL;
+static PyObject *asyncio_get_running_loop = NULL;
+static PyObject *asyncio_set_running_loop = NULL;
+static PyObject *asyncio_tasks = NULL;
+static PyObject *asyncio_current_tasks = NULL;
+
 static PyObject *
-loop_add_writer(PyEventLoopObject *self, PyObject *args)
+_asyncio_attr(PyObject **cache, const char *name)
 {
-    int fd;
-    PyObject *cb;
-    if (!PyArg_ParseTuple(args, "iO:add_writer", &fd, &cb))
-        return NULL;
-    if (!PyCallable_Check(cb)) {
+    if (!*cache) {
+        PyObject *asyncio = PyImport_ImportModule("asyncio");
+        if (!asyncio)
+            return NULL;
+        *cache = PyObject_GetAttrString(asyncio, name);
+        Py_DECREF(asyncio);
+    }
+    return *cache; /* borrowed */
+}
+
+/* getattr(obj, name, None) as 1/0 with *out set, or -1 on a real error. */
+static int
+_optional_attr(PyObject *obj, const char *name, PyObject **out)
+{
+    *out = PyObject_GetAttrString(obj, name);
+    if (*out)
+        return 1;
+    if (!PyErr_ExceptionMatches(PyExc_AttributeError))
+        return -1;
+    PyErr_Clear();
+    return 0;
+}
+
+/* Future and Task are defined with the loop methods; these helpers resolve them */
+static PyTypeObject PyEventLoop_Type;
+static PyTypeObject PyFuture_Type;
+static PyTypeObject PyTask_Type;
+static PyObject *_future_new(PyObject *loop);
+static int _fut_finish(PyFutureObject *fut, PyObject *result, PyObject *exc);
+static int _fut_ready(PyObject *fut);
+
+/*
+ * Future for awaiting inside whichever asyncio loop is running, or bound to
+ * the casyncio loop when called from plain callbacks.
+ */
+static PyObject *
+_new_future(PyObject *loop)
+{
+    PyObject *get_running = _asyncio_attr(&asyncio_get_running_loop, "_get_running_loop");
+    if (!get_running)
+        return NULL;
+    PyObject *running = PyObject_CallNoArgs(get_running);
+    if (!running)
+        return NULL;
+    PyObject *fut = _future_new(running == Py_None ? loop : running);
+    Py_DECREF(running);
+    return fut;
+}
+
+/* done() without a method call for native futures; -1 on error. */
+static int
+_future_done(PyObject *fut)
+{
+    if (PyObject_TypeCheck(fut, &PyFuture_Type))
+        return ((PyFutureObject *)fut)->state != FUT_PENDING;
+    PyObject *done = PyObject_CallMethod(fut, "done", NULL);
+    if (!done)
+        return -1;
+    int r = PyObject_IsTrue(done);
+    Py_DECREF(done);
+    return r;
+}
+
+/* set_result(result), or set_exception(exc) when exc is not NULL. */
+static int
+_future_resolve(PyObject *fut, PyObject *result, PyObject *exc)
+{
+    if (PyObject_TypeCheck(fut, &PyFuture_Type))
+        return _fut_finish((PyFutureObject *)fut, result, exc);
+    PyObject *res = exc ? PyObject_CallMethod(fut, "set_exception", "O", exc)
+                        : PyObject_CallMethod(fut, "set_result", "O", result);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    return 0;
+}
+
+/* Bytes not yet done with: unsent, or zerocopy sends not yet completed. */
+static inline Py_ssize_t
+_outbuf_pending(const OutBuf *ob)
+{
+    return ob->nbytes + ob->zc_bytes;
+}
+
+/* Pause above the high mark; resume and resolve drain() at the low mark. */
+static int
+_outbuf_flow(OutBuf *ob)
+{
+    Py_ssize_t pending = _outbuf_pending(ob);
+    if (!ob->paused) {
+        if (pending > ob->high) {
+            ob->paused = 1;
+            _protocol_notify(ob->protocol, "pause_writing");
+        }
+        return 0;
+    }
+    if (pending > ob->low)
+        return 0;
+    ob->paused = 0;
+    Py_ssize_t nw = PyList_GET_SIZE(ob->waiters);
+    for (Py_ssize_t j = 0; j < nw; j++) {
+        PyObject *fut = PyList_GET_ITEM(ob->waiters, j);
+        int skip = _future_done(fut);
+        if (skip < 0)
+            return -1;
+        if (skip)
+            continue;   /* cancelled while waiting */
+        if (_future_resolve(fut, Py_None, NULL) < 0)
+            return -1;
+    }
+    if (PyList_SetSlice(ob->waiters, 0, nw, NULL) < 0)
+        return -1;
+    _protocol_notify(ob->protocol, "resume_writing");
+    return 0;
+}
+
+/* Take the pending exception as a normalized instance (new reference). */
+static PyObject *
+_fetch_exception(void)
+{
+    PyObject *type, *value, *tb;
+    PyErr_Fetch(&type, &value, &tb);
+    PyErr_NormalizeException(&type, &value, &tb);
+    if (tb) {
+        PyException_SetTraceback(value, tb);
+        Py_DECREF(tb);
+    }
+    Py_XDECREF(type);
+    return value;
+}
+
+static inline int64_t
+_monotonic_ns(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
+}
+
+/*
+ * Seconds as nanoseconds.  NaN and infinities raise ValueError naming
+ * `what`; values past the int64 range clamp to it, so a timer for 1e300
+ * seconds stays pending instead of wrapping into the past.
+ */
+static int
+_secs_to_ns(double secs, const char *what, int64_t *out)
+{
+    if (!isfinite(secs)) {
+        PyErr_Format(PyExc_ValueError, "%s must be a finite number", what);
+        return -1;
+    }
+    /* 2**63 is exact as a double; the cast is defined strictly inside it */
+    double ns = secs * 1e9;
+    if (ns >= 9223372036854775808.0)
+        *out = INT64_MAX;
+    else if (ns <= -9223372036854775808.0)
+        *out = INT64_MIN;
+    else
+        *out = (int64_t)ns;
+    return 0;
+}
+
+/* now + delta_ns, pinned at INT64_MAX rather than overflowing */
+static inline int64_t
+_deadline_ns(int64_t delta_ns)
+{
+    int64_t now = _monotonic_ns(), deadline;
+    if (__builtin_add_overflow(now, delta_ns, &deadline))
+        return delta_ns > 0 ? INT64_MAX : INT64_MIN;
+    return deadline;
+}
+
+/* Handle / TimerHandle */
+static int
+handle_traverse(PyHandleObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->callback);
+    Py_VISIT(self->context);
+    for (Py_ssize_t i = 1; i <= self->nargs; i++)
+        Py_VISIT(self->argv[i]);
+    return 0;
+}
+
+/* Drop the callback, its arguments and its context. */
+static void
+_handle_release_call(PyHandleObject *h)
+{
+    PyObject **argv = h->argv;
+    Py_ssize_t n = h->nargs;
+    h->argv = h->inline_argv;
+    h->nargs = 0;
+    Py_CLEAR(h->callback);
+    Py_CLEAR(h->context);
+    for (Py_ssize_t i = 1; i <= n; i++)
+        Py_DECREF(argv[i]);
+    if (argv != h->inline_argv)
+        PyMem_Free(argv);
+}
+
+static int
+handle_clear(PyHandleObject *self)
+{
+    _handle_release_call(self);
+    return 0;
+}
+
+/*
+ * Handle and TimerHandle objects kept for reuse, as CPython does for its
+ * own short-lived objects.  Process-wide rather than per loop, since a
+ * handle can outlive its loop; linked through the cleared callback.
+ */
+typedef struct {
+    PyHandleObject *top;
+    Py_ssize_t count;
+} HandleFreelist;
+
+static PyTypeObject PyHandle_Type;
+static PyTypeObject PyTimerHandle_Type;
+
+static HandleFreelist handle_freelist, timer_freelist;
+static Py_ssize_t handle_freelist_limit = HANDLE_FREELIST_DEFAULT;
+
+static inline HandleFreelist *
+_handle_freelist(PyTypeObject *type)
+{
+    if (type == &PyHandle_Type)
+        return &handle_freelist;
+    if (type == &PyTimerHandle_Type)
+        return &timer_freelist;
+    return NULL;   /* subclasses are freed normally */
+}
+
+/* A new untracked handle of type with nothing to call; NULL with an error set. */
+static PyHandleObject *
+_handle_alloc(PyTypeObject *type)
+{
+    HandleFreelist *fl = _handle_freelist(type);
+    PyHandleObject *h = fl ? fl->top : NULL;
+    if (h) {
+        fl->top = (PyHandleObject *)h->callback;
+        fl->count--;
+        PyObject_Init((PyObject *)h, type);
+    } else if (!(h = PyObject_GC_New(PyHandleObject, type))) {
+        return NULL;
+    }
+    h->callback = NULL;
+    h->canceled = 0;
+    h->nargs = 0;
+    h->argv = h->inline_argv;
+    h->context = NULL;
+    return h;
+}
+
+/*
+ * Give h callback(*args) to run inside context, or inside a copy of the
+ * current context when that is NULL, as asyncio's handles do.
+ */
+static int
+_handle_set_call(PyHandleObject *h, PyObject *callback, PyObject *const *args,
+                 Py_ssize_t nargs, PyObject *context)
+{
+    h->callback = Py_NewRef(callback);
+    h->context = context ? Py_NewRef(context) : PyContext_CopyCurrent();
+    if (!h->context)
+        return -1;
+    if (nargs > HANDLE_INLINE_ARGS) {
+        PyObject **argv = PyMem_Malloc((size_t)(nargs + 1) * sizeof(PyObject *));
+        if (!argv) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        h->argv = argv;
+    }
+    for (Py_ssize_t i = 0; i < nargs; i++)
+        h->argv[i + 1] = Py_NewRef(args[i]);
+    h->nargs = nargs;
+    return 0;
+}
+
+/*
+ * Call the handle's callback inside its context.  The arguments are
+ * detached first and the rest held, so a cancel() from inside the
+ * callback cannot free anything mid-call.
+ */
+static int
+_handle_run(PyHandleObject *h)
+{
+    PyObject *fn = Py_NewRef(h->callback);
+    PyObject *ctx = Py_XNewRef(h->context);
+    PyObject **argv = h->argv;
+    Py_ssize_t nargs = h->nargs;
+    h->argv = h->inline_argv;
+    h->nargs = 0;
+    PyObject *res = NULL;
+    if (!ctx || PyContext_Enter(ctx) == 0) {
+        res = PyObject_Vectorcall(fn, argv + 1, (size_t)nargs | PY_VECTORCALL_ARGUMENTS_OFFSET,
+                                  NULL);
+        if (ctx) {
+            PyObject *type, *value, *tb;
+            PyErr_Fetch(&type, &value, &tb);
+            if (PyContext_Exit(ctx) < 0) {
+                Py_XDECREF(type);
+                Py_XDECREF(value);
+                Py_XDECREF(tb);
+                Py_CLEAR(res);
+            } else {
+                PyErr_Restore(type, value, tb);
+            }
+        }
+    }
+    Py_DECREF(fn);
+    Py_XDECREF(ctx);
+    for (Py_ssize_t i = 1; i <= nargs; i++)
+        Py_DECREF(argv[i]);
+    if (argv != h->inline_argv)
+        PyMem_Free(argv);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    return 0;
+}
+
+static void
+_handle_freelist_trim(HandleFreelist *fl)
+{
+    while (fl->count > handle_freelist_limit) {
+        PyHandleObject *h = fl->top;
+        fl->top = (PyHandleObject *)h->callback;
+        fl->count--;
+        PyObject_GC_Del(h);
+    }
+}
+
+static void
+handle_dealloc(PyHandleObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    _handle_release_call(self);
+    HandleFreelist *fl = _handle_freelist(Py_TYPE(self));
+    if (fl && fl->count < handle_freelist_limit) {
+        self->callback = (PyObject *)fl->top;
+        fl->top = self;
+        fl->count++;
+        return;
+    }
+    PyObject_GC_Del(self);
+}
+
+static PyObject *
+handle_cancel(PyHandleObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!self->canceled) {
+        self->canceled = 1;
+        _handle_release_call(self);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+handle_cancelled(PyHandleObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyBool_FromLong(self->canceled);
+}
+
+static PyObject *
+handle_get_context(PyHandleObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return Py_NewRef(self->context ? self->context : Py_None);
+}
+
+static PyObject *
+timerhandle_when(TimerNode *self, PyObject *Py_UNUSED(ignored))
+{
+    /* a clamped deadline reads back the way asyncio keeps it */
+    if (self->deadline_ns == INT64_MAX)
+        return PyFloat_FromDouble(Py_HUGE_VAL);
+    return PyFloat_FromDouble((double)self->deadline_ns / 1e9);
+}
+
+static PyObject *
+timerhandle_cancel(TimerNode *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->heap_index >= 0) {
+        self->loop->stats.timers_cancelled++;
+        _heap_remove(self->loop, self);
+    }
+    return handle_cancel((PyHandleObject *)self, NULL);
+}
+
+static PyObject *
+timerhandle_reschedule(TimerNode *self, PyObject *arg)
+{
+    double delay = PyFloat_AsDouble(arg);
+    int64_t delay_ns;
+    if (delay == -1.0 && PyErr_Occurred())
+        return NULL;
+    if (_secs_to_ns(delay, "delay", &delay_ns) < 0)
+        return NULL;
+    if (self->heap_index < 0)
+        Py_RETURN_FALSE;
+    self->deadline_ns = _deadline_ns(delay_ns);
+    /* moving later is O(1): the node is re-keyed once it reaches the top */
+    if (self->deadline_ns < self->key_ns) {
+        self->key_ns = self->deadline_ns;
+        _sift_up(self->loop, (size_t)self->heap_index);
+    }
+    Py_RETURN_TRUE;
+}
+
+static PyMethodDef handle_methods[] = {
+    {"cancel", (PyCFunction)handle_cancel, METH_NOARGS,
+     PyDoc_STR("Cancel the callback")},
+    {"cancelled", (PyCFunction)handle_cancelled, METH_NOARGS,
+     PyDoc_STR("Return True if the callback was cancelled")},
+    {"get_context", (PyCFunction)handle_get_context, METH_NOARGS,
+     PyDoc_STR("Return the contextvars.Context the callback runs in")},
+    {NULL, NULL, 0, NULL},
+};
+
+static PyMethodDef timerhandle_methods[] = {
+    {"when", (PyCFunction)timerhandle_when, METH_NOARGS,
+     PyDoc_STR("Return the scheduled time in loop time() seconds")},
+    {"cancel", (PyCFunction)timerhandle_cancel, METH_NOARGS,
+     PyDoc_STR("Cancel the timer and remove it from the loop")},
+    {"reschedule", (PyCFunction)timerhandle_reschedule, METH_O,
+     PyDoc_STR("Move a pending timer to fire delay seconds from now; "
+               "return False if it already fired or was cancelled")},
+    {NULL, NULL, 0, NULL},
+};
+
+static PyTypeObject PyHandle_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "casyncio.Handle",
+    .tp_basicsize = sizeof(PyHandleObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    .tp_traverse = (traverseproc)handle_traverse,
+    .tp_clear = (inquiry)handle_clear,
+    .tp_dealloc = (destructor)handle_dealloc,
+    .tp_methods = handle_methods,
+};
+
+static PyTypeObject PyTimerHandle_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "casyncio.TimerHandle",
+    .tp_basicsize = sizeof(TimerNode),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_base = &PyHandle_Type,
+    .tp_traverse = (traverseproc)handle_traverse,
+    .tp_clear = (inquiry)handle_clear,
+    .tp_dealloc = (destructor)handle_dealloc,
+    .tp_methods = timerhandle_methods,
+};
+
+static inline int
+_is_handle(PyObject *obj)
+{
+    return Py_IS_TYPE(obj, &PyHandle_Type) || Py_IS_TYPE(obj, &PyTimerHandle_Type);
+}
+
+/* timer wakeup helpers */
+static inline int64_t
+_timer_wake_ns(PyEventLoopObject *self, int64_t deadline_ns)
+{
+    int64_t slack = self->timer_slack_ns;
+    if (slack <= 0 || deadline_ns > INT64_MAX - slack)
+        return deadline_ns;
+    /* round up to the slack grid so nearby deadlines share one wakeup */
+    return (deadline_ns + slack - 1) / slack * slack;
+}
+
+static int
+_timerfd_arm(PyEventLoopObject *self, int64_t wake_ns)
+{
+    if (wake_ns == self->tfd_armed_ns)
+        return 0;
+    struct itimerspec its = {0};
+    its.it_value.tv_sec = wake_ns / 1000000000;
+    its.it_value.tv_nsec = wake_ns % 1000000000;
+    /* a zero it_value disarms the timer */
+    if (timerfd_settime(self->tfd, TFD_TIMER_ABSTIME, &its, NULL) == -1) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+    self->tfd_armed_ns = wake_ns;
+    return 0;
+}
+
+/* user_data for a poll SQE: fd in the low half, generation in the high half */
+static inline uint64_t
+_uring_ud(int fd, uint32_t gen)
+{
+    return (uint64_t)gen << 32 | (uint32_t)fd;
+}
+
+/* Poll generations stay within 31 bits and skip 0, which marks internal fds. */
+#define URING_GEN_MAX 0x7fffffffu
+
+static inline void
+_poll_gen_next(FDCallback *slot)
+{
+    slot->poll_gen = slot->poll_gen % URING_GEN_MAX + 1;
+}
+
+/*
+ * user_data for an accept/recv/send SQE: the UringIO with the top bit set,
+ * which no poll's user_data has, and the operation in the low bits.
+ */
+#define URING_OP_TAG (1ULL << 63)
+#define URING_OP_RECV 1     /* multishot accept or recv */
+#define URING_OP_SEND 2
+
+static inline uint64_t
+_uring_op_ud(UringIO *io, int op)
+{
+    return URING_OP_TAG | (uint64_t)(uintptr_t)io | (uint64_t)op;
+}
+
+static inline UringIO *
+_uring_op_io(uint64_t user_data)
+{
+    return (UringIO *)(uintptr_t)(user_data & ~(URING_OP_TAG | 3));
+}
+
+/* Watch one of the loop's own fds (signalfd, wakeup eventfd, timerfd); -1 sets errno. */
+static int
+_watch_internal(PyEventLoopObject *self, int fd)
+{
+    if (self->uring)
+        return uring_poll_add(self->uring, fd, EPOLLIN, _uring_ud(fd, 0));
+    struct epoll_event ev = {.events = EPOLLIN, .data.u32 = (uint32_t)fd};
+    return epoll_ctl(self->epfd, EPOLL_CTL_ADD, fd, &ev);
+}
+
+static int
+loop_init(PyEventLoopObject *self, PyObject *args, PyObject *kwds)
+{
+    int use_timerfd = 0;
+    double slack = 0.0;
+    const char *backend = "epoll";
+    int eager_tasks = 0;
+    int pool_size = 0;
+    double busy_poll = 0.0;
+    static char *kwlist[] = {"timerfd", "timer_slack", "backend", "eager_tasks",
+                             "pool_size", "busy_poll", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|$pdspid:EventLoop", kwlist,
+                                     &use_timerfd, &slack, &backend, &eager_tasks,
+                                     &pool_size, &busy_poll))
+        return -1;
+    if (pool_size < 0) {
+        PyErr_SetString(PyExc_ValueError, "pool_size must be >= 0");
+        return -1;
+    }
+    if (pool_size == 0) {
+        /* ThreadPoolExecutor's default */
+        long ncpu = sysconf(_SC_NPROCESSORS_ONLN);
+        pool_size = ncpu > 0 ? (int)ncpu + 4 : 8;
+        if (pool_size > POOL_MAX_THREADS)
+            pool_size = POOL_MAX_THREADS;
+    }
+    if (slack < 0.0) {
+        PyErr_SetString(PyExc_ValueError, "timer_slack must be >= 0");
+        return -1;
+    }
+    if (busy_poll < 0.0) {
+        PyErr_SetString(PyExc_ValueError, "busy_poll must be >= 0");
+        return -1;
+    }
+    int64_t slack_ns, busy_poll_ns;
+    if (_secs_to_ns(slack, "timer_slack", &slack_ns) < 0 ||
+        _secs_to_ns(busy_poll, "busy_poll", &busy_poll_ns) < 0)
+        return -1;
+    if (strcmp(backend, "epoll") != 0 && strcmp(backend, "io_uring") != 0) {
+        PyErr_Format(PyExc_ValueError,
+                     "backend must be 'epoll' or 'io_uring', not '%s'", backend);
+        return -1;
+    }
+    self->tfd = -1;
+    self->tfd_armed_ns = 0;
+    self->timer_slack_ns = slack_ns;
+    self->busy_poll_ns = busy_poll_ns;
+    self->events = (EventArray){NULL, 0, 0};
+    self->events_cap = EVENTS_MIN;
+    self->eager_tasks = eager_tasks;
+    self->pool = NULL;
+    self->pool_size = (unsigned)pool_size;
+    self->pool_inflight = 0;
+    self->bufpool.limit = BUFPOOL_DEFAULT_LIMIT;
+    self->outbuf_limit = OUTBUF_FREELIST_DEFAULT;
+
+    /* io_uring falls back to epoll when the kernel or seccomp refuses it */
+    self->epfd = -1;
+    self->uring = NULL;
+    if (strcmp(backend, "io_uring") == 0)
+        self->uring = uring_open(URING_ENTRIES);
+    if (!self->uring) {
+        self->epfd = epoll_create1(EPOLL_CLOEXEC);
+        if (self->epfd == -1) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            return -1;
+        }
+    }
+
+    self->efd = -1;
+    self->xq_top = NULL;
+    self->xq_sleeping = 0;
+
+    self->ready_q.items = NULL;
+    self->ready_q.head = 0;
+    self->ready_q.count = 0;
+    self->ready_q.capacity = 0;
+
+    self->timer_heap = NULL;
+    self->timer_count = 0;
+    self->timer_capacity = 0;
+
+    self->fdmap = NULL;
+    self->fdcap = 0;
+    self->dirty_fds = NULL;
+    self->ndirty = 0;
+    self->dirty_cap = 0;
+
+    sigemptyset(&self->sigmask);
+    sigaddset(&self->sigmask, SIGINT);
+    sigaddset(&self->sigmask, SIGTERM);
+    sigaddset(&self->sigmask, SIGCHLD);
+    pthread_sigmask(SIG_BLOCK, &self->sigmask, NULL);
+    self->sfd = signalfd(-1, &self->sigmask, SFD_CLOEXEC | SFD_NONBLOCK);
+    if (self->sfd == -1) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    self->efd = eventfd(0, EFD_CLOEXEC | EFD_NONBLOCK);
+    if (self->efd == -1) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    self->signal_handlers = PyDict_New();
+    if (!self->signal_handlers)
+        return -1;
+
+    if (_watch_internal(self, self->sfd) < 0 || _watch_internal(self, self->efd) < 0) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        return -1;
+    }
+
+    /* io_uring waits take a nanosecond timeout, so it needs no timerfd */
+    if (use_timerfd && !self->uring) {
+        self->tfd = timerfd_create(CLOCK_MONOTONIC, TFD_CLOEXEC | TFD_NONBLOCK);
+        if (self->tfd == -1) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            return -1;
+        }
+        if (_watch_internal(self, self->tfd) < 0) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            return -1;
+        }
+    }
+
+    self->running = 0;
+
+    return 0;
+}
+
+static void _pool_shutdown(PyEventLoopObject *self);
+static int _uring_io_shutdown(PyEventLoopObject *self);
+
+static void
+loop_dealloc(PyEventLoopObject *self)
+{
+    _pool_shutdown(self);
+    Py_CLEAR(self->last_slow);
+    if (self->epfd != -1)
+        close(self->epfd);
+    if (self->uring && _uring_io_shutdown(self) < 0)
+        self->uring = NULL;
+    uring_close(self->uring);
+    if (self->fdmap) {
+        for (int i = 0; i < self->fdcap; i++) {
+            FDCallback *slot = self->fdmap[i];
+            if (!slot)
+                continue;
+            Py_XDECREF(slot->reader);
+            Py_XDECREF(slot->writer);
+            Py_XDECREF(slot->owner);
+            if (slot->obuf)
+                _outbuf_free(slot->obuf);
+        }
+        free(self->fdmap);
+    }
+    fdslab_free_all(&self->fd_slabs);
+    while (self->outbuf_free) {
+        OutBuf *ob = self->outbuf_free;
+        self->outbuf_free = ob->next_free;
+        _outbuf_free(ob);
+    }
+    bufpool_clear(&self->bufpool);
+    free(self->events.evs);
+    free(self->dirty_fds);
+    if (self->dgram_pool) {
+        free(self->dgram_pool->bufs);
+        free(self->dgram_pool);
+    }
+    if (self->sfd != -1)
+        close(self->sfd);
+    if (self->efd != -1)
+        close(self->efd);
+    XNode *node = self->xq_top;
+    while (node) {
+        XNode *next = node->next;
+        Py_DECREF(node->item);
+        PyMem_RawFree(node);
+        node = next;
+    }
+    if (self->tfd != -1)
+        close(self->tfd);
+    Py_XDECREF(self->signal_handlers);
+    _ready_clear(self);
+    for (size_t i = 0; i < self->timer_count; i++) {
+        self->timer_heap[i]->heap_index = -1;
+        Py_DECREF(self->timer_heap[i]);
+    }
+    PyMem_Free(self->timer_heap);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int
+ensure_fdslot(PyEventLoopObject *self, int fd)
+{
+    if (fd >= self->fdcap) {
+        int newcap = self->fdcap ? self->fdcap : 8;
+        while (newcap <= fd)
+            newcap *= 2;
+        FDCallback **newmap = realloc(self->fdmap, newcap * sizeof(FDCallback *));
+        if (!newmap) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        for (int i = self->fdcap; i < newcap; i++)
+            newmap[i] = NULL;
+        self->fdmap = newmap;
+        self->fdcap = newcap;
+    }
+    if (!self->fdmap[fd]) {
+        self->fdmap[fd] = fdslab_alloc(&self->fd_slabs);
+        if (!self->fdmap[fd]) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        self->fdmap[fd]->obuf = NULL;
+    }
+    return 0;
+}
+
+/* io_uring operations for native listeners and transports */
+
+/*
+ * Give fd's reads, and a transport's writes, to io_uring operations.
+ * Without a ring that supports them the fd stays readiness-driven.
+ */
+static int
+_uring_io_attach(PyEventLoopObject *self, int fd, int accept)
+{
+    if (!self->uring || !uring_enable_io(self->uring))
+        return 0;
+    if (ensure_fdslot(self, fd) < 0)
+        return -1;
+    FDCallback *slot = self->fdmap[fd];
+    if (slot->uio)
+        return 0;
+    UringIO *io = calloc(1, sizeof(UringIO));
+    if (!io) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    io->fd = fd;
+    io->accept = accept;
+    io->next = self->uios;
+    if (io->next)
+        io->next->prev = io;
+    self->uios = io;
+    slot->uio = io;
+    return 0;
+}
+
+static void
+_uring_stash_release(PyEventLoopObject *self, UringIO *io)
+{
+    bufpool_put(&self->bufpool, io->rbuf, io->rcap);
+    io->rbuf = NULL;
+    io->roff = io->rlen = io->rcap = 0;
+}
+
+/* Append received bytes to io's stash; -1 when out of memory. */
+static int
+_uring_stash(PyEventLoopObject *self, UringIO *io, const char *data, size_t n)
+{
+    if (io->rlen + n > io->rcap) {
+        size_t keep = io->rlen - io->roff;
+        size_t cap = keep + n > 2 * io->rcap ? keep + n : 2 * io->rcap;
+        char *nb = bufpool_get(&self->bufpool, &cap);
+        if (!nb)
+            return -1;
+        if (keep)
+            memcpy(nb, io->rbuf + io->roff, keep);
+        _uring_stash_release(self, io);
+        io->rbuf = nb;
+        io->rcap = cap;
+        io->rlen = keep;
+    }
+    memcpy(io->rbuf + io->rlen, data, n);
+    io->rlen += n;
+    return 0;
+}
+
+/* Drop the references a completed (or abandoned) SENDMSG held. */
+static void
+_uring_send_release(UringIO *io)
+{
+    UringSend *snd = io->send;
+    for (int i = 0; snd && i < snd->nobjs; i++)
+        Py_CLEAR(snd->objs[i]);
+    if (snd)
+        snd->nobjs = 0;
+}
+
+static void
+_uring_io_free(PyEventLoopObject *self, UringIO *io)
+{
+    if (io->prev)
+        io->prev->next = io->next;
+    else
+        self->uios = io->next;
+    if (io->next)
+        io->next->prev = io->prev;
+    _uring_send_release(io);
+    _uring_stash_release(self, io);
+    for (size_t i = 0; i < io->nfds; i++)
+        close(io->fds[i]);
+    free(io->fds);
+    free(io->send);
+    free(io);
+}
+
+/* Arm or cancel fd's multishot accept/recv to match its reader; -1 sets errno. */
+static int
+_uring_io_arm(PyEventLoopObject *self, FDCallback *slot)
+{
+    UringIO *io = slot->uio;
+    int want = slot->reader && !slot->read_paused && !io->eof && !io->err;
+    if (want && !io->armed) {
+        uint64_t ud = _uring_op_ud(io, URING_OP_RECV);
+        int r = io->accept ? uring_accept_multishot(self->uring, io->fd, ud)
+                           : uring_recv_multishot(self->uring, io->fd, ud);
+        if (r < 0)
+            return -1;
+        io->armed = 1;
+    } else if (!want && io->armed && !io->cancelling) {
+        if (uring_cancel(self->uring, _uring_op_ud(io, URING_OP_RECV)) < 0)
+            return -1;
+        io->cancelling = 1;
+    }
+    return 0;
+}
+
+/*
+ * The fd is being closed or handed back to readiness polling: cancel what
+ * is in flight and free io once the kernel has let go of it.  Connections
+ * accepted but not yet dispatched are closed.
+ */
+static int
+_uring_io_detach(PyEventLoopObject *self, FDCallback *slot)
+{
+    UringIO *io = slot->uio;
+    int rc = 0;
+    slot->uio = NULL;
+    io->orphan = 1;
+    if (io->armed && !io->cancelling) {
+        if (uring_cancel(self->uring, _uring_op_ud(io, URING_OP_RECV)) < 0)
+            rc = -1;
+        io->cancelling = 1;
+    }
+    if (io->sending && uring_cancel(self->uring, _uring_op_ud(io, URING_OP_SEND)) < 0)
+        rc = -1;
+    for (size_t i = 0; i < io->nfds; i++)
+        close(io->fds[i]);
+    io->nfds = 0;
+    _uring_stash_release(self, io);
+    if (!io->armed && !io->sending)
+        _uring_io_free(self, io);
+    return rc;
+}
+
+/*
+ * Queue one SENDMSG for the plain segments at the head of fd's write queue.
+ * 1 if a send is in flight, 0 if there was nothing it could take (an empty
+ * queue, or a file or zerocopy segment first), -1 with errno set, also for
+ * a send that failed since the last call.
+ */
+static int
+_uring_send(PyEventLoopObject *self, FDCallback *slot)
+{
+    UringIO *io = slot->uio;
+    OutBuf *ob = slot->obuf;
+    if (io->send_err) {
+        errno = io->send_err;
+        io->send_err = 0;
+        return -1;
+    }
+    if (io->sending)
+        return 1;
+    if (!io->send && !(io->send = calloc(1, sizeof(UringSend)))) {
+        errno = ENOMEM;
+        return -1;
+    }
+    UringSend *snd = io->send;
+    int n = 0;
+    for (size_t i = 0; i < ob->count && n < URING_SEND_IOV; i++) {
+        OutSeg *seg = &ob->segs[ob->head + i];
+        if (seg->file || _outbuf_zc_eligible(ob, seg))
+            break;
+        snd->iov[n].iov_base = (char *)seg->view.buf + seg->off;
+        snd->iov[n].iov_len = (size_t)(seg->view.len - seg->off);
+        snd->objs[n] = Py_XNewRef(seg->view.obj);
+        n++;
+    }
+    snd->nobjs = n;
+    if (!n)
+        return 0;
+    memset(&snd->msg, 0, sizeof(snd->msg));
+    snd->msg.msg_iov = snd->iov;
+    snd->msg.msg_iovlen = (size_t)n;
+    if (uring_sendmsg(self->uring, io->fd, &snd->msg, _uring_op_ud(io, URING_OP_SEND)) < 0) {
+        int saved = errno;
+        _uring_send_release(io);
+        errno = saved;
+        return -1;
+    }
+    io->sending = 1;
+    self->stats.ring_sends++;
+    return 1;
+}
+
+/* epoll interest helpers */
+static inline uint32_t
+_fd_wanted(FDCallback *slot)
+{
+    /* io_uring operations do a uio's reads, and its writes while one is in flight */
+    uint32_t want = slot->reader && !slot->read_paused && !slot->uio ? EPOLLIN : 0;
+    if (slot->writer ||
+        (slot->obuf && slot->obuf->nbytes && !(slot->uio && slot->uio->sending)))
+        want |= EPOLLOUT;
+    /* stay registered for the EPOLLERR that signals zerocopy completions */
+    if (!want && slot->obuf && slot->obuf->zc_count)
+        want = EPOLLERR;
+    return want;
+}
+
+/* Bring the kernel registration in line with slot->pending; -1 sets errno. */
+static int
+_fd_apply(PyEventLoopObject *self, int fd, FDCallback *slot)
+{
+    uint32_t want = slot->pending;
+    self->stats.interest_updates++;
+    if (self->uring) {
+        /*
+         * Replace the multishot poll.  Bumping the generation makes any
+         * completion still in flight for the old poll recognisably stale.
+         */
+        if (slot->registered &&
+            uring_poll_remove(self->uring, _uring_ud(fd, slot->poll_gen)) < 0)
+            return -1;
+        _poll_gen_next(slot);
+        if (want && uring_poll_add(self->uring, fd, EPOLLET | want,
+                                   _uring_ud(fd, slot->poll_gen)) < 0)
+            return -1;
+        slot->registered = want;
+        return 0;
+    }
+    if (!want) {
+        if (slot->registered &&
+            epoll_ctl(self->epfd, EPOLL_CTL_DEL, fd, NULL) == -1 &&
+            errno != ENOENT && errno != EBADF)
+            return -1;
+        slot->registered = 0;
+        return 0;
+    }
+    struct epoll_event ev = {.events = EPOLLET | want, .data.u32 = (uint32_t)fd};
+    int r = epoll_ctl(self->epfd, slot->registered ? EPOLL_CTL_MOD : EPOLL_CTL_ADD,
+                      fd, &ev);
+    /* the fd was closed (dropping its registration) and the number reused */
+    if (r == -1 && errno == ENOENT && slot->registered)
+        r = epoll_ctl(self->epfd, EPOLL_CTL_ADD, fd, &ev);
+    if (r == -1)
+        return -1;
+    slot->registered = want;
+    return 0;
+}
+
+/* Note which file fd names; unknown (0, 0) if it is already closed. */
+static void
+_fd_note_file(int fd, FDCallback *slot)
+{
+    struct stat st;
+    slot->file_dev = slot->file_ino = 0;
+    if (fstat(fd, &st) == 0) {
+        slot->file_dev = (uint64_t)st.st_dev;
+        slot->file_ino = (uint64_t)st.st_ino;
+    }
+}
+
+/*
+ * Recompute the interest set for fd and queue it for the flush before the
+ * next epoll_wait.  Only a first registration is applied immediately, so
+ * add_reader() can raise for an fd that cannot be polled.  Removing every
+ * watcher of a registered fd notes the file it names: should the fd be
+ * closed and its number reused before the flush, the flush re-registers
+ * it even though the mask looks unchanged.
+ */
+static int
+_fd_interest(PyEventLoopObject *self, int fd, FDCallback *slot)
+{
+    if (slot->uio) {
+        if (_uring_io_arm(self, slot) < 0) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            return -1;
+        }
+        /* a closed listener leaves its fd to whoever polls it next */
+        if (slot->uio->accept && !slot->reader && _uring_io_detach(self, slot) < 0) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            return -1;
+        }
+    }
+    uint32_t before = slot->pending;
+    slot->pending = _fd_wanted(slot);
+    if (slot->pending && !slot->registered) {
+        if (_fd_apply(self, fd, slot) < 0) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            return -1;
+        }
+        return 0;
+    }
+    if (!slot->pending && before && slot->registered && !slot->emptied) {
+        slot->emptied = 1;
+        _fd_note_file(fd, slot);
+    }
+    if (slot->pending == slot->registered || slot->queued)
+        return 0;
+    if (self->ndirty == self->dirty_cap) {
+        int newcap = self->dirty_cap ? self->dirty_cap * 2 : 16;
+        int *newarr = realloc(self->dirty_fds, newcap * sizeof(int));
+        if (!newarr) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        self->dirty_fds = newarr;
+        self->dirty_cap = newcap;
+    }
+    self->dirty_fds[self->ndirty++] = fd;
+    slot->queued = 1;
+    return 0;
+}
+
+/* Apply queued interest changes, skipping fds whose net change is zero. */
+static int
+_flush_interest(PyEventLoopObject *self)
+{
+    int rc = 0;
+    for (int i = 0; i < self->ndirty; i++) {
+        int fd = self->dirty_fds[i];
+        FDCallback *slot = self->fdmap[fd];
+        slot->queued = 0;
+        if (slot->pending == slot->registered) {
+            /* a net-zero toggle costs nothing unless the fd was reused */
+            if (!slot->emptied || !slot->pending)
+                continue;
+            uint64_t dev = slot->file_dev, ino = slot->file_ino;
+            _fd_note_file(fd, slot);
+            slot->emptied = 0;
+            if (ino && slot->file_dev == dev && slot->file_ino == ino)
+                continue;
+        }
+        slot->emptied = 0;
+        if (_fd_apply(self, fd, slot) < 0) {
+            if (errno == EBADF) {
+                /* closed with watchers still attached; nothing to update */
+                slot->registered = 0;
+            } else if (rc == 0) {
+                PyErr_SetFromErrno(PyExc_OSError);
+                rc = -1;
+            }
+        }
+    }
+    self->ndirty = 0;
+    return rc;
+}
+
+/*
+ * Drop every watcher and the write queue of fd, deregister it, and close
+ * it.  The kernel registration goes first: an io_uring poll holds its own
+ * reference to the file and would outlive close().
+ */
+static int
+_fd_close(PyEventLoopObject *self, int fd)
+{
+    FDCallback *slot = fd < self->fdcap ? self->fdmap[fd] : NULL;
+    int rc = 0;
+    if (slot) {
+        Py_CLEAR(slot->reader);
+        Py_CLEAR(slot->writer);
+        if (slot->obuf) {
+            if (slot->obuf->zc_count) {
+                /*
+                 * Reset rather than let close() keep sending from buffers
+                 * that are about to be released.
+                 */
+                struct linger lg = {1, 0};
+                (void)setsockopt(fd, SOL_SOCKET, SO_LINGER, &lg, sizeof(lg));
+            }
+            _outbuf_recycle(self, slot->obuf);
+            slot->obuf = NULL;
+        }
+        Py_CLEAR(slot->owner);
+        if (slot->uio && _uring_io_detach(self, slot) < 0)
+            rc = -1;
+        slot->read_paused = slot->read_missed = slot->close_pending = 0;
+        slot->pending = 0;
+        slot->emptied = 0;
+        if (slot->registered && _fd_apply(self, fd, slot) < 0 && errno != EBADF)
+            rc = -1;
+        slot->registered = 0;
+    }
+    /* a queued POLL_REMOVE or cancel would keep the socket open past close() */
+    if (self->uring && uring_submit(self->uring) < 0 && rc == 0)
+        rc = -1;
+    if (close(fd) == -1 && errno != EINTR && rc == 0)
+        rc = -1;
+    if (rc < 0)
+        PyErr_SetFromErrno(PyExc_OSError);
+    return rc;
+}
+
+/*
+ * Check a call_*(fixed..., callback, *args, context=None) fastcall: the
+ * callback is args[nfixed]; *context is the keyword, or NULL for None.
+ */
+static int
+_parse_call(const char *fname, PyObject *const *args, Py_ssize_t nargs, PyObject *kwnames,
+            Py_ssize_t nfixed, PyObject **context)
+{
+    *context = NULL;
+    if (nargs <= nfixed) {
+        PyErr_Format(PyExc_TypeError, "%s() missing required argument 'callback'", fname);
+        return -1;
+    }
+    Py_ssize_t nkw = kwnames ? PyTuple_GET_SIZE(kwnames) : 0;
+    for (Py_ssize_t i = 0; i < nkw; i++) {
+        PyObject *key = PyTuple_GET_ITEM(kwnames, i);
+        if (PyUnicode_CompareWithASCIIString(key, "context") != 0) {
+            PyErr_Format(PyExc_TypeError, "%s() got an unexpected keyword argument '%U'",
+                         fname, key);
+            return -1;
+        }
+        *context = args[nargs + i];
+    }
+    if (*context == Py_None) {
+        *context = NULL;
+    } else if (*context && !PyContext_CheckExact(*context)) {
+        PyErr_Format(PyExc_TypeError, "context must be a contextvars.Context, not %s",
+                     Py_TYPE(*context)->tp_name);
+        return -1;
+    }
+    if (!PyCallable_Check(args[nfixed])) {
+        PyErr_Format(PyExc_TypeError, "a callable object was expected by %s(), got %R",
+                     fname, args[nfixed]);
+        return -1;
+    }
+    return 0;
+}
+
+/* A tracked Handle for callback(*args); not queued anywhere yet. */
+static PyHandleObject *
+_new_handle(PyObject *const *args, Py_ssize_t nargs, PyObject *context)
+{
+    PyHandleObject *h = _handle_alloc(&PyHandle_Type);
+    if (!h)
+        return NULL;
+    if (_handle_set_call(h, args[0], args + 1, nargs - 1, context) < 0) {
+        Py_DECREF(h);
+        return NULL;
+    }
+    PyObject_GC_Track(h);
+    return h;
+}
+
+static PyObject *
+loop_call_soon(PyEventLoopObject *self, PyObject *const *args, Py_ssize_t nargs,
+               PyObject *kwnames)
+{
+    PyObject *context;
+    if (_parse_call("call_soon", args, nargs, kwnames, 0, &context) < 0)
+        return NULL;
+    PyHandleObject *h = _new_handle(args, nargs, context);
+    if (!h)
+        return NULL;
+    if (_ready_push(self, (PyObject *)h) < 0) {
+        Py_DECREF(h);
+        return NULL;
+    }
+    return (PyObject *)h;
+}
+
+/*
+ * Queue a handle from any thread.  Only the first submission after the
+ * loop went to sleep writes the eventfd; while the loop is awake it picks
+ * the stack up at the top of its next iteration anyway.
+ */
+static PyObject *
+loop_call_soon_threadsafe(PyEventLoopObject *self, PyObject *const *args, Py_ssize_t nargs,
+                          PyObject *kwnames)
+{
+    PyObject *context;
+    if (_parse_call("call_soon_threadsafe", args, nargs, kwnames, 0, &context) < 0)
+        return NULL;
+    PyHandleObject *h = _new_handle(args, nargs, context);
+    if (!h)
+        return NULL;
+    XNode *node = PyMem_RawMalloc(sizeof(*node));
+    if (!node) {
+        Py_DECREF(h);
+        return PyErr_NoMemory();
+    }
+    node->item = Py_NewRef(h);
+    node->next = __atomic_load_n(&self->xq_top, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&self->xq_top, &node->next, node, 1,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        ;
+    if (__atomic_exchange_n(&self->xq_sleeping, 0, __ATOMIC_SEQ_CST) &&
+        eventfd_write(self->efd, 1) == -1 && errno != EAGAIN) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        Py_DECREF(h);
+        return NULL;
+    }
+    return (PyObject *)h;
+}
+
+/* Move every cross-thread submission to the ready queue, oldest first. */
+static int
+_xq_drain(PyEventLoopObject *self)
+{
+    XNode *node = __atomic_exchange_n(&self->xq_top, NULL, __ATOMIC_ACQUIRE);
+    XNode *fifo = NULL;
+    while (node) {
+        XNode *next = node->next;
+        node->next = fifo;
+        fifo = node;
+        node = next;
+    }
+    int rc = 0;
+    while (fifo) {
+        XNode *next = fifo->next;
+        if (rc == 0 && _ready_push(self, fifo->item) < 0)
+            rc = -1;
+        Py_DECREF(fifo->item);
+        PyMem_RawFree(fifo);
+        fifo = next;
+    }
+    return rc;
+}
+
+/* worker pool jobs */
+enum { JOB_CALL, JOB_PREAD, JOB_PWRITE, JOB_FSYNC, JOB_STAT, JOB_GETADDRINFO };
+
+typedef struct {
+    PoolJob base;
+    int op;
+    PyObject *fut;
+    int fd;               /* pool_stat(): -1 to stat obj as a path */
+    int64_t offset;
+    PyObject *obj;        /* pread target bytes, stat path, getaddrinfo host */
+    PyObject *obj2;       /* getaddrinfo port, stat path as given */
+    Py_buffer view;       /* pwrite source */
+    struct addrinfo hints;
+    PyObject *callable;   /* run_in_pool(): called with the GIL on a worker */
+    PyObject *args;
+    /* filled in by the worker */
+    ssize_t ret;
+    int err;
+    struct stat st;
+    struct addrinfo *ai;
+    PyObject *result;
+    PyObject *exc;
+} LoopJob;
+
+static PyObject *os_stat_result = NULL;
+static PyObject *socket_gaierror = NULL;
+
+static PyObject *
+_module_attr(PyObject **cache, const char *module, const char *name)
+{
+    if (!*cache) {
+        PyObject *mod = PyImport_ImportModule(module);
+        if (!mod)
+            return NULL;
+        *cache = PyObject_GetAttrString(mod, name);
+        Py_DECREF(mod);
+    }
+    return *cache; /* borrowed */
+}
+
+static void
+_job_run(PoolJob *base)
+{
+    LoopJob *job = (LoopJob *)base;
+    switch (job->op) {
+    case JOB_CALL: {
+        PyGILState_STATE g = PyGILState_Ensure();
+        job->result = PyObject_Call(job->callable, job->args, NULL);
+        if (!job->result)
+            job->exc = _fetch_exception();
+        PyGILState_Release(g);
+        return;
+    }
+    case JOB_PREAD:
+        do {
+            job->ret = pread(job->fd, PyBytes_AS_STRING(job->obj),
+                             (size_t)PyBytes_GET_SIZE(job->obj), (off_t)job->offset);
+        } while (job->ret == -1 && errno == EINTR);
+        break;
+    case JOB_PWRITE:
+        do {
+            job->ret = pwrite(job->fd, job->view.buf, (size_t)job->view.len, (off_t)job->offset);
+        } while (job->ret == -1 && errno == EINTR);
+        break;
+    case JOB_FSYNC:
+        job->ret = fsync(job->fd);
+        break;
+    case JOB_STAT:
+        job->ret = job->fd >= 0 ? fstat(job->fd, &job->st)
+                                : stat(PyBytes_AS_STRING(job->obj), &job->st);
+        break;
+    case JOB_GETADDRINFO:
+        /* ret holds the EAI_* code here */
+        job->ret = getaddrinfo(job->obj ? PyBytes_AS_STRING(job->obj) : NULL,
+                               job->obj2 ? PyBytes_AS_STRING(job->obj2) : NULL,
+                               &job->hints, &job->ai);
+        job->err = job->ret == EAI_SYSTEM ? errno : 0;
+        return;
+    }
+    job->err = job->ret == -1 ? errno : 0;
+}
+
+static void
+_job_free(LoopJob *job)
+{
+    Py_XDECREF(job->fut);
+    Py_XDECREF(job->obj);
+    Py_XDECREF(job->obj2);
+    if (job->view.obj)
+        PyBuffer_Release(&job->view);
+    Py_XDECREF(job->callable);
+    Py_XDECREF(job->args);
+    Py_XDECREF(job->result);
+    Py_XDECREF(job->exc);
+    if (job->ai)
+        freeaddrinfo(job->ai);
+    PyMem_RawFree(job);
+}
+
+static LoopJob *
+_job_new(PyEventLoopObject *self, int op)
+{
+    LoopJob *job = PyMem_RawCalloc(1, sizeof(*job));
+    if (!job) {
+        PyErr_NoMemory();
+        return NULL;
+    }
+    job->base.run = _job_run;
+    job->op = op;
+    job->fd = -1;
+    job->fut = _future_new((PyObject *)self);
+    if (!job->fut) {
+        PyMem_RawFree(job);
+        return NULL;
+    }
+    return job;
+}
+
+/* Hand job to the pool (started on first use); returns its future. */
+static PyObject *
+_job_submit(PyEventLoopObject *self, LoopJob *job)
+{
+    if (!self->pool) {
+        self->pool = pool_open(self->pool_size, self->efd, &self->xq_sleeping);
+        if (!self->pool) {
+            _job_free(job);
+            return PyErr_NoMemory();
+        }
+    }
+    PyObject *fut = Py_NewRef(job->fut);
+    if (pool_submit(self->pool, &job->base) < 0) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        Py_DECREF(fut);
+        _job_free(job);
+        return NULL;
+    }
+    self->pool_inflight++;
+    return fut;
+}
+
+static PyObject *
+_stat_result(const struct stat *st)
+{
+    PyObject *stat_result = _module_attr(&os_stat_result, "os", "stat_result");
+    if (!stat_result)
+        return NULL;
+#define TS_NS(ts) ((long long)(ts).tv_sec * 1000000000LL + (ts).tv_nsec)
+#define TS_F(ts) ((double)(ts).tv_sec + (ts).tv_nsec * 1e-9)
+    /* the 10 sequence fields, float times, ns times, blksize, blocks, rdev */
+    PyObject *fields = Py_BuildValue(
+        "(kKKkkkLLLLdddLLLlLK)",
+        (unsigned long)st->st_mode, (unsigned long long)st->st_ino,
+        (unsigned long long)st->st_dev, (unsigned long)st->st_nlink,
+        (unsigned long)st->st_uid, (unsigned long)st->st_gid, (long long)st->st_size,
+        (long long)st->st_atim.tv_sec, (long long)st->st_mtim.tv_sec,
+        (long long)st->st_ctim.tv_sec,
+        TS_F(st->st_atim), TS_F(st->st_mtim), TS_F(st->st_ctim),
+        TS_NS(st->st_atim), TS_NS(st->st_mtim), TS_NS(st->st_ctim),
+        (long)st->st_blksize, (long long)st->st_blocks, (unsigned long long)st->st_rdev);
+#undef TS_NS
+#undef TS_F
+    if (!fields)
+        return NULL;
+    PyObject *res = PyObject_CallOneArg(stat_result, fields);
+    Py_DECREF(fields);
+    return res;
+}
+
+/* socket.getaddrinfo()'s list of (family, type, proto, canonname, sockaddr). */
+static PyObject *
+_addrinfo_list(const struct addrinfo *ai)
+{
+    PyObject *list = PyList_New(0);
+    if (!list)
+        return NULL;
+    for (; ai; ai = ai->ai_next) {
+        char host[INET6_ADDRSTRLEN];
+        PyObject *addr;
+        if (ai->ai_family == AF_INET) {
+            const struct sockaddr_in *sin = (const struct sockaddr_in *)ai->ai_addr;
+            inet_ntop(AF_INET, &sin->sin_addr, host, sizeof(host));
+            addr = Py_BuildValue("(si)", host, ntohs(sin->sin_port));
+        } else if (ai->ai_family == AF_INET6) {
+            const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)ai->ai_addr;
+            inet_ntop(AF_INET6, &sin6->sin6_addr, host, sizeof(host));
+            addr = Py_BuildValue("(siII)", host, ntohs(sin6->sin6_port),
+                                 ntohl(sin6->sin6_flowinfo), sin6->sin6_scope_id);
+        } else {
+            continue;
+        }
+        PyObject *item = addr ? Py_BuildValue("(iiisN)", ai->ai_family, ai->ai_socktype,
+                                              ai->ai_protocol,
+                                              ai->ai_canonname ? ai->ai_canonname : "",
+                                              addr)
+                              : NULL;
+        if (!item || PyList_Append(list, item) < 0) {
+            Py_XDECREF(item);
+            Py_DECREF(list);
+            return NULL;
+        }
+        Py_DECREF(item);
+    }
+    return list;
+}
+
+/* Resolve a finished job's future unless it was cancelled meanwhile. */
+static int
+_job_deliver(LoopJob *job)
+{
+    int done = _future_done(job->fut);
+    if (done)
+        return done < 0 ? -1 : 0;
+    PyObject *result = NULL, *exc = NULL;
+    if (job->op == JOB_CALL) {
+        result = job->result;
+        exc = job->exc;
+        job->result = job->exc = NULL;
+    } else if (job->op == JOB_GETADDRINFO) {
+        if (job->ret == EAI_SYSTEM) {
+            errno = job->err;
+            PyErr_SetFromErrno(PyExc_OSError);
+        } else if (job->ret != 0) {
+            PyObject *gaierror = _module_attr(&socket_gaierror, "socket", "gaierror");
+            if (gaierror) {
+                PyObject *e = Py_BuildValue("(is)", (int)job->ret, gai_strerror((int)job->ret));
+                if (e) {
+                    PyErr_SetObject(gaierror, e);
+                    Py_DECREF(e);
+                }
+            }
+        } else {
+            result = _addrinfo_list(job->ai);
+        }
+    } else if (job->ret == -1) {
+        errno = job->err;
+        if (job->op == JOB_STAT && job->obj2)
+            PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, job->obj2);
+        else
+            PyErr_SetFromErrno(PyExc_OSError);
+    } else if (job->op == JOB_PREAD) {
+        /* the bytes object is still private to the job: shrink it in place */
+        if (job->ret < PyBytes_GET_SIZE(job->obj) && _PyBytes_Resize(&job->obj, job->ret) < 0)
+            job->obj = NULL;
+        result = job->obj;
+        job->obj = NULL;
+    } else if (job->op == JOB_PWRITE) {
+        result = PyLong_FromSsize_t(job->ret);
+    } else if (job->op == JOB_STAT) {
+        result = _stat_result(&job->st);
+    } else {
+        result = Py_NewRef(Py_None);
+    }
+    if (!result && !exc)
+        exc = _fetch_exception();
+    int rc = _future_resolve(job->fut, result, exc);
+    Py_XDECREF(result);
+    Py_XDECREF(exc);
+    return rc;
+}
+
+/* Deliver every finished job in one batch, in completion order. */
+static int
+_pool_drain(PyEventLoopObject *self)
+{
+    PoolJob *job = pool_take_done(self->pool);
+    int rc = 0;
+    while (job) {
+        PoolJob *next = job->next;
+        self->pool_inflight--;
+        if (rc == 0 && _job_deliver((LoopJob *)job) < 0)
+            rc = -1;
+        _job_free((LoopJob *)job);
+        job = next;
+    }
+    return rc;
+}
+
+/*
+ * Join the workers and fail every undelivered job's future with
+ * RuntimeError("loop closed"), so nothing awaiting one waits forever.
+ */
+static void
+_pool_shutdown(PyEventLoopObject *self)
+{
+    if (!self->pool)
+        return;
+    PoolJob *left;
+    /* running run_in_pool() jobs need the GIL to finish */
+    Py_BEGIN_ALLOW_THREADS
+    left = pool_close(self->pool);
+    Py_END_ALLOW_THREADS
+    self->pool = NULL;
+    self->pool_inflight = 0;
+    if (!left)
+        return;
+    PyObject *type, *value, *tb;
+    PyErr_Fetch(&type, &value, &tb);
+    while (left) {
+        PoolJob *next = left->next;
+        LoopJob *job = (LoopJob *)left;
+        int done = _future_done(job->fut);
+        if (!done) {
+            PyObject *exc = PyObject_CallFunction(PyExc_RuntimeError, "s", "loop closed");
+            if (exc && _future_resolve(job->fut, NULL, exc) == 0)
+                done = 1;
+            Py_XDECREF(exc);
+        }
+        if (done != 1)
+            PyErr_WriteUnraisable(job->fut);
+        _job_free(job);
+        left = next;
+    }
+    PyErr_Restore(type, value, tb);
+}
+
+static PyObject *
+loop_run_in_pool(PyEventLoopObject *self, PyObject *args)
+{
+    Py_ssize_t n = PyTuple_GET_SIZE(args);
+    if (n < 1) {
+        PyErr_SetString(PyExc_TypeError, "run_in_pool() needs a callable");
+        return NULL;
+    }
+    LoopJob *job = _job_new(self, JOB_CALL);
+    if (!job)
+        return NULL;
+    job->callable = Py_NewRef(PyTuple_GET_ITEM(args, 0));
+    job->args = PyTuple_GetSlice(args, 1, n);
+    if (!job->args) {
+        _job_free(job);
+        return NULL;
+    }
+    return _job_submit(self, job);
+}
+
+static PyObject *
+loop_pool_pread(PyEventLoopObject *self, PyObject *args)
+{
+    int fd;
+    Py_ssize_t size;
+    long long offset;
+    if (!PyArg_ParseTuple(args, "inL:pool_pread", &fd, &size, &offset))
+        return NULL;
+    if (size < 0) {
+        PyErr_SetString(PyExc_ValueError, "negative size");
+        return NULL;
+    }
+    LoopJob *job = _job_new(self, JOB_PREAD);
+    if (!job)
+        return NULL;
+    job->fd = fd;
+    job->offset = offset;
+    job->obj = PyBytes_FromStringAndSize(NULL, size);
+    if (!job->obj) {
+        _job_free(job);
+        return NULL;
+    }
+    return _job_submit(self, job);
+}
+
+static PyObject *
+loop_pool_pwrite(PyEventLoopObject *self, PyObject *args)
+{
+    int fd;
+    Py_buffer view;
+    long long offset;
+    if (!PyArg_ParseTuple(args, "iy*L:pool_pwrite", &fd, &view, &offset))
+        return NULL;
+    LoopJob *job = _job_new(self, JOB_PWRITE);
+    if (!job) {
+        PyBuffer_Release(&view);
+        return NULL;
+    }
+    job->fd = fd;
+    job->offset = offset;
+    job->view = view;
+    return _job_submit(self, job);
+}
+
+static PyObject *
+loop_pool_fsync(PyEventLoopObject *self, PyObject *arg)
+{
+    int fd = PyObject_AsFileDescriptor(arg);
+    if (fd == -1)
+        return NULL;
+    LoopJob *job = _job_new(self, JOB_FSYNC);
+    if (!job)
+        return NULL;
+    job->fd = fd;
+    return _job_submit(self, job);
+}
+
+static PyObject *
+loop_pool_stat(PyEventLoopObject *self, PyObject *arg)
+{
+    LoopJob *job = _job_new(self, JOB_STAT);
+    if (!job)
+        return NULL;
+    if (PyLong_Check(arg)) {
+        job->fd = PyLong_AsLong(arg);
+        if (job->fd == -1 && PyErr_Occurred()) {
+            _job_free(job);
+            return NULL;
+        }
+    } else if (!PyUnicode_FSConverter(arg, &job->obj)) {
+        _job_free(job);
+        return NULL;
+    } else {
+        job->obj2 = Py_NewRef(arg);   /* for the error's filename */
+    }
+    return _job_submit(self, job);
+}
+
+/* host/port argument as the bytes getaddrinfo() wants, NULL for None. */
+static int
+_gai_arg(PyObject *arg, int is_host, PyObject **out)
+{
+    if (arg == Py_None) {
+        *out = NULL;
+    } else if (PyBytes_Check(arg)) {
+        *out = Py_NewRef(arg);
+    } else if (PyUnicode_Check(arg)) {
+        *out = is_host ? PyUnicode_AsEncodedString(arg, "idna", NULL)
+                       : PyUnicode_AsUTF8String(arg);
+    } else if (!is_host && PyLong_Check(arg)) {
+        long port = PyLong_AsLong(arg);
+        if (port == -1 && PyErr_Occurred())
+            return -1;
+        *out = PyBytes_FromFormat("%ld", port);
+    } else {
+        PyErr_Format(PyExc_TypeError, "getaddrinfo() argument must be str, bytes or None, not %s",
+                     Py_TYPE(arg)->tp_name);
+        return -1;
+    }
+    return *out || arg == Py_None ? 0 : -1;
+}
+
+static PyObject *
+loop_getaddrinfo(PyEventLoopObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *host, *port;
+    int family = 0, type = 0, proto = 0, flags = 0;
+    static char *kwlist[] = {"host", "port", "family", "type", "proto", "flags", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OO|$iiii:getaddrinfo", kwlist,
+                                     &host, &port, &family, &type, &proto, &flags))
+        return NULL;
+    LoopJob *job = _job_new(self, JOB_GETADDRINFO);
+    if (!job)
+        return NULL;
+    if (_gai_arg(host, 1, &job->obj) < 0 || _gai_arg(port, 0, &job->obj2) < 0) {
+        _job_free(job);
+        return NULL;
+    }
+    job->hints.ai_family = family;
+    job->hints.ai_socktype = type;
+    job->hints.ai_protocol = proto;
+    job->hints.ai_flags = flags;
+    return _job_submit(self, job);
+}
+
+/* A TimerHandle for args[0](*args[1:]), armed for deadline_ns or run now. */
+static PyObject *
+_schedule_timer(PyEventLoopObject *self, int64_t deadline_ns, PyObject *const *args,
+                Py_ssize_t nargs, PyObject *context, int run_now)
+{
+    TimerNode *node = (TimerNode *)_handle_alloc(&PyTimerHandle_Type);
+    if (!node)
+        return NULL;
+    node->heap_index = -1;
+    if (_handle_set_call(&node->base, args[0], args + 1, nargs - 1, context) < 0) {
+        Py_DECREF(node);
+        return NULL;
+    }
+    node->deadline_ns = deadline_ns;
+    node->key_ns = deadline_ns;
+    node->loop = NULL;
+    PyObject_GC_Track(node);
+    int r = run_now ? _ready_push(self, (PyObject *)node) : _heap_push(self, node);
+    if (r < 0) {
+        Py_DECREF(node);
+        return run_now ? NULL : PyErr_NoMemory();
+    }
+    if (!run_now)
+        self->stats.timers_armed++;
+    return (PyObject *)node;
+}
+
+static PyObject *
+loop_call_later(PyEventLoopObject *self, PyObject *const *args, Py_ssize_t nargs,
+                PyObject *kwnames)
+{
+    PyObject *context;
+    if (_parse_call("call_later", args, nargs, kwnames, 1, &context) < 0)
+        return NULL;
+    double delay = PyFloat_AsDouble(args[0]);
+    int64_t delay_ns;
+    if (delay == -1.0 && PyErr_Occurred())
+        return NULL;
+    if (_secs_to_ns(delay, "delay", &delay_ns) < 0)
+        return NULL;
+    if (delay_ns <= 0)
+        return _schedule_timer(self, _monotonic_ns(), args + 1, nargs - 1, context, 1);
+    return _schedule_timer(self, _deadline_ns(delay_ns), args + 1, nargs - 1, context, 0);
+}
+
+static PyObject *
+loop_call_at(PyEventLoopObject *self, PyObject *const *args, Py_ssize_t nargs,
+             PyObject *kwnames)
+{
+    PyObject *context;
+    if (_parse_call("call_at", args, nargs, kwnames, 1, &context) < 0)
+        return NULL;
+    double when = PyFloat_AsDouble(args[0]);
+    int64_t when_ns;
+    if (when == -1.0 && PyErr_Occurred())
+        return NULL;
+    if (_secs_to_ns(when, "when", &when_ns) < 0)
+        return NULL;
+    return _schedule_timer(self, when_ns, args + 1, nargs - 1, context, 0);
+}
+
+static PyObject *
+loop_time(PyEventLoopObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyFloat_FromDouble((double)_monotonic_ns() / 1e9);
+}
+
+/* Future */
+static PyObject *kwnames_context = NULL;   /* ("context",) */
+static uint64_t task_counter = 0;
+
+/* obj.name(*args, context=context) */
+static PyObject *
+_call_with_context(PyObject *obj, const char *name, PyObject *const *args, size_t nargs,
+                   PyObject *context)
+{
+    if (!kwnames_context && !(kwnames_context = Py_BuildValue("(s)", "context")))
+        return NULL;
+    PyObject *meth = PyObject_GetAttrString(obj, name);
+    if (!meth)
+        return NULL;
+    PyObject *stack[3];
+    for (size_t i = 0; i < nargs; i++)
+        stack[i] = args[i];
+    stack[nargs] = context;
+    PyObject *res = PyObject_Vectorcall(meth, stack, nargs, kwnames_context);
+    Py_DECREF(meth);
+    return res;
+}
+
+static PyObject *
+_make_cancelled_error(PyObject *msg)
+{
+    PyObject *CancelledError = _asyncio_attr(&asyncio_CancelledError, "CancelledError");
+    if (!CancelledError)
+        return NULL;
+    return msg && msg != Py_None ? PyObject_CallOneArg(CancelledError, msg)
+                                 : PyObject_CallNoArgs(CancelledError);
+}
+
+static void
+_set_invalid_state(const char *msg)
+{
+    PyObject *InvalidStateError = _asyncio_attr(&asyncio_InvalidStateError, "InvalidStateError");
+    if (InvalidStateError)
+        PyErr_SetString(InvalidStateError, msg);
+}
+
+/* Raise exc keeping the traceback it was stored with. */
+static void
+_raise_stored(PyObject *exc)
+{
+    PyErr_Restore(Py_NewRef(Py_TYPE(exc)), Py_NewRef(exc), PyException_GetTraceback(exc));
+}
+
+static PyObject *
+_future_alloc(PyTypeObject *type, PyObject *loop)
+{
+    PyFutureObject *fut = (PyFutureObject *)type->tp_alloc(type, 0);
+    if (!fut)
+        return NULL;
+    fut->loop = Py_NewRef(loop);
+    fut->state = FUT_PENDING;
+    return (PyObject *)fut;
+}
+
+static PyObject *
+_future_new(PyObject *loop)
+{
+    return _future_alloc(&PyFuture_Type, loop);
+}
+
+static int
+_fut_add_callback(PyFutureObject *fut, PyObject *fn, PyObject *context)
+{
+    if (fut->ncallbacks == fut->callbacks_cap) {
+        Py_ssize_t newcap = fut->callbacks_cap ? fut->callbacks_cap * 2 : 2;
+        FutureCallback *arr = PyMem_Realloc(fut->callbacks, newcap * sizeof(*arr));
+        if (!arr) {
+            PyErr_NoMemory();
+            return -1;
+        }
+        fut->callbacks = arr;
+        fut->callbacks_cap = newcap;
+    }
+    fut->callbacks[fut->ncallbacks].fn = Py_NewRef(fn);
+    fut->callbacks[fut->ncallbacks].context = Py_XNewRef(context);
+    fut->ncallbacks++;
+    return 0;
+}
+
+static void
+_fut_clear_callbacks(FutureCallback *cbs, Py_ssize_t n)
+{
+    for (Py_ssize_t i = 0; i < n; i++) {
+        Py_DECREF(cbs[i].fn);
+        Py_XDECREF(cbs[i].context);
+    }
+    PyMem_Free(cbs);
+}
+
+/*
+ * Hand the callbacks of a done future to its loop.  A casyncio loop gets
+ * the future itself, once, however many callbacks there are; a future
+ * nobody waits on never touches the ready queue.
+ */
+static int
+_fut_schedule_callbacks(PyFutureObject *fut)
+{
+    if (!fut->ncallbacks)
+        return 0;
+    if (Py_IS_TYPE(fut->loop, &PyEventLoop_Type)) {
+        if (fut->cb_scheduled)
+            return 0;
+        fut->cb_scheduled = 1;
+        return _ready_push((PyEventLoopObject *)fut->loop, (PyObject *)fut);
+    }
+    FutureCallback *cbs = fut->callbacks;
+    Py_ssize_t n = fut->ncallbacks;
+    fut->callbacks = NULL;
+    fut->ncallbacks = fut->callbacks_cap = 0;
+    int rc = 0;
+    for (Py_ssize_t i = 0; i < n && rc == 0; i++) {
+        PyObject *args[2] = {cbs[i].fn, (PyObject *)fut};
+        PyObject *res = _call_with_context(fut->loop, "call_soon", args, 2, cbs[i].context);
+        if (!res)
+            rc = -1;
+        Py_XDECREF(res);
+    }
+    _fut_clear_callbacks(cbs, n);
+    return rc;
+}
+
+static int
+_fut_finish(PyFutureObject *fut, PyObject *result, PyObject *exc)
+{
+    if (fut->state != FUT_PENDING) {
+        _set_invalid_state("invalid state");
+        return -1;
+    }
+    if (exc) {
+        if (PyExceptionClass_Check(exc)) {
+            exc = PyObject_CallNoArgs(exc);
+            if (!exc)
+                return -1;
+        } else {
+            Py_INCREF(exc);
+        }
+        if (!PyExceptionInstance_Check(exc)) {
+            Py_DECREF(exc);
+            PyErr_SetString(PyExc_TypeError, "invalid exception object");
+            return -1;
+        }
+        if (PyErr_GivenExceptionMatches(exc, PyExc_StopIteration)) {
+            Py_DECREF(exc);
+            PyErr_SetString(PyExc_TypeError,
+                            "StopIteration interacts badly with generators "
+                            "and cannot be raised into a Future");
+            return -1;
+        }
+        fut->exception = exc;
+    } else {
+        fut->result = Py_NewRef(result);
+    }
+    fut->state = FUT_FINISHED;
+    return _fut_schedule_callbacks(fut);
+}
+
+/* 1 if fut was cancelled, 0 if it was already done. */
+static int
+_fut_cancel(PyFutureObject *fut, PyObject *msg)
+{
+    if (fut->state != FUT_PENDING)
+        return 0;
+    fut->state = FUT_CANCELLED;
+    Py_XSETREF(fut->cancel_msg, Py_XNewRef(msg));
+    return _fut_schedule_callbacks(fut) < 0 ? -1 : 1;
+}
+
+/* result() as a new reference, or NULL with the stored error raised. */
+static PyObject *
+_fut_result(PyFutureObject *fut)
+{
+    if (fut->state == FUT_CANCELLED) {
+        PyObject *exc = _make_cancelled_error(fut->cancel_msg);
+        if (exc) {
+            PyErr_SetObject((PyObject *)Py_TYPE(exc), exc);
+            Py_DECREF(exc);
+        }
+        return NULL;
+    }
+    if (fut->state == FUT_PENDING) {
+        _set_invalid_state("Result is not set.");
+        return NULL;
+    }
+    if (fut->exception) {
+        _raise_stored(fut->exception);
+        return NULL;
+    }
+    return Py_NewRef(fut->result);
+}
+
+static int _task_wakeup(PyTaskObject *task, PyObject *fut);
+static int _task_step(PyTaskObject *task, PyObject *exc);
+
+static int
+_fut_run_callbacks(PyFutureObject *fut)
+{
+    FutureCallback *cbs = fut->callbacks;
+    Py_ssize_t n = fut->ncallbacks;
+    fut->callbacks = NULL;
+    fut->ncallbacks = fut->callbacks_cap = 0;
+    /*
+     * Every callback runs, task wakeups included, as asyncio's separate
+     * handles would.  The first failure propagates once the list is done;
+     * any later ones are reported as unraisable.
+     */
+    PyObject *err_type = NULL, *err_value = NULL, *err_tb = NULL;
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *ctx = cbs[i].context;
+        int rc;
+        if (!ctx) {
+            rc = _task_wakeup((PyTaskObject *)cbs[i].fn, (PyObject *)fut);
+        } else if (PyContext_Enter(ctx) < 0) {
+            rc = -1;
+        } else {
+            PyObject *res = PyObject_CallOneArg(cbs[i].fn, (PyObject *)fut);
+            PyObject *type, *value, *tb;
+            PyErr_Fetch(&type, &value, &tb);
+            if (PyContext_Exit(ctx) < 0) {
+                Py_XDECREF(type);
+                Py_XDECREF(value);
+                Py_XDECREF(tb);
+                Py_CLEAR(res);
+            } else {
+                PyErr_Restore(type, value, tb);
+            }
+            rc = res ? 0 : -1;
+            Py_XDECREF(res);
+        }
+        if (rc == 0)
+            continue;
+        if (!err_type)
+            PyErr_Fetch(&err_type, &err_value, &err_tb);
+        else
+            PyErr_WriteUnraisable(cbs[i].fn);
+    }
+    _fut_clear_callbacks(cbs, n);
+    if (!err_type)
+        return 0;
+    PyErr_Restore(err_type, err_value, err_tb);
+    return -1;
+}
+
+/* A future or task popped from the ready queue: run its step or callbacks. */
+static int
+_fut_ready(PyObject *obj)
+{
+    if (PyObject_TypeCheck(obj, &PyTask_Type)) {
+        PyTaskObject *task = (PyTaskObject *)obj;
+        if (task->step_scheduled) {
+            task->step_scheduled = 0;
+            PyObject *exc = task->step_exc;
+            task->step_exc = NULL;
+            int rc = _task_step(task, exc);
+            Py_XDECREF(exc);
+            return rc;
+        }
+    }
+    PyFutureObject *fut = (PyFutureObject *)obj;
+    if (!fut->cb_scheduled)
+        return 0;
+    fut->cb_scheduled = 0;
+    return _fut_run_callbacks(fut);
+}
+
+static int
+fut_traverse(PyFutureObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->loop);
+    Py_VISIT(self->result);
+    Py_VISIT(self->exception);
+    Py_VISIT(self->cancel_msg);
+    for (Py_ssize_t i = 0; i < self->ncallbacks; i++) {
+        Py_VISIT(self->callbacks[i].fn);
+        Py_VISIT(self->callbacks[i].context);
+    }
+    return 0;
+}
+
+static int
+fut_clear(PyFutureObject *self)
+{
+    Py_CLEAR(self->loop);
+    Py_CLEAR(self->result);
+    Py_CLEAR(self->exception);
+    Py_CLEAR(self->cancel_msg);
+    FutureCallback *cbs = self->callbacks;
+    Py_ssize_t n = self->ncallbacks;
+    self->callbacks = NULL;
+    self->ncallbacks = self->callbacks_cap = 0;
+    if (cbs)
+        _fut_clear_callbacks(cbs, n);
+    return 0;
+}
+
+static void
+fut_dealloc(PyFutureObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    Py_TYPE(self)->tp_clear((PyObject *)self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+/* The loop argument, or asyncio's running loop. */
+static PyObject *
+_loop_or_running(PyObject *loop)
+{
+    if (loop && loop != Py_None)
+        return Py_NewRef(loop);
+    PyObject *get_running = _asyncio_attr(&asyncio_get_running_loop, "_get_running_loop");
+    if (!get_running)
+        return NULL;
+    PyObject *running = PyObject_CallNoArgs(get_running);
+    if (running == Py_None) {
+        Py_DECREF(running);
+        PyErr_SetString(PyExc_RuntimeError, "no running event loop");
+        return NULL;
+    }
+    return running;
+}
+
+static int
+fut_init(PyFutureObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *loop = NULL;
+    static char *kwlist[] = {"loop", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|$O:Future", kwlist, &loop))
+        return -1;
+    loop = _loop_or_running(loop);
+    if (!loop)
+        return -1;
+    Py_XSETREF(self->loop, loop);
+    return 0;
+}
+
+static PyObject *
+fut_result(PyFutureObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return _fut_result(self);
+}
+
+static PyObject *
+fut_exception(PyFutureObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->state == FUT_PENDING) {
+        _set_invalid_state("Exception is not set.");
+        return NULL;
+    }
+    if (self->state == FUT_CANCELLED)
+        return _fut_result(self);
+    return Py_NewRef(self->exception ? self->exception : Py_None);
+}
+
+static PyObject *
+fut_done(PyFutureObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyBool_FromLong(self->state != FUT_PENDING);
+}
+
+static PyObject *
+fut_cancelled(PyFutureObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyBool_FromLong(self->state == FUT_CANCELLED);
+}
+
+static PyObject *
+fut_cancel(PyFutureObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *msg = Py_None;
+    static char *kwlist[] = {"msg", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O:cancel", kwlist, &msg))
+        return NULL;
+    int r = _fut_cancel(self, msg);
+    if (r < 0)
+        return NULL;
+    return PyBool_FromLong(r);
+}
+
+static PyObject *
+fut_set_result(PyFutureObject *self, PyObject *result)
+{
+    if (_fut_finish(self, result, NULL) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+fut_set_exception(PyFutureObject *self, PyObject *exc)
+{
+    if (_fut_finish(self, NULL, exc) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+fut_add_done_callback(PyFutureObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *fn, *context = Py_None;
+    static char *kwlist[] = {"fn", "context", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|$O:add_done_callback", kwlist,
+                                     &fn, &context))
+        return NULL;
+    if (context == Py_None) {
+        context = PyContext_CopyCurrent();
+        if (!context)
+            return NULL;
+    } else {
+        Py_INCREF(context);
+    }
+    int rc = _fut_add_callback(self, fn, context);
+    Py_DECREF(context);
+    if (rc < 0)
+        return NULL;
+    if (self->state != FUT_PENDING && _fut_schedule_callbacks(self) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+fut_remove_done_callback(PyFutureObject *self, PyObject *fn)
+{
+    Py_ssize_t kept = 0;
+    for (Py_ssize_t i = 0; i < self->ncallbacks; i++) {
+        FutureCallback *cb = &self->callbacks[i];
+        int eq = 0;
+        /* native task wakeups are not the caller's to remove */
+        if (cb->context) {
+            eq = PyObject_RichCompareBool(cb->fn, fn, Py_EQ);
+            if (eq < 0)
+                return NULL;
+        }
+        if (eq) {
+            Py_DECREF(cb->fn);
+            Py_DECREF(cb->context);
+        } else {
+            self->callbacks[kept++] = *cb;
+        }
+    }
+    Py_ssize_t removed = self->ncallbacks - kept;
+    self->ncallbacks = kept;
+    return PyLong_FromSsize_t(removed);
+}
+
+static PyObject *
+fut_get_loop(PyFutureObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return Py_NewRef(self->loop);
+}
+
+static PyObject *
+fut_make_cancelled_error(PyFutureObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return _make_cancelled_error(self->cancel_msg);
+}
+
+static PyObject *
+fut_get_blocking(PyFutureObject *self, void *Py_UNUSED(closure))
+{
+    return PyBool_FromLong(self->blocking);
+}
+
+static int
+fut_set_blocking(PyFutureObject *self, PyObject *value, void *Py_UNUSED(closure))
+{
+    if (!value) {
+        PyErr_SetString(PyExc_AttributeError, "cannot delete _asyncio_future_blocking");
+        return -1;
+    }
+    int b = PyObject_IsTrue(value);
+    if (b < 0)
+        return -1;
+    self->blocking = b;
+    return 0;
+}
+
+static PyObject *
+fut_get_cancel_message(PyFutureObject *self, void *Py_UNUSED(closure))
+{
+    return Py_NewRef(self->cancel_msg ? self->cancel_msg : Py_None);
+}
+
+static int
+fut_set_cancel_message(PyFutureObject *self, PyObject *value, void *Py_UNUSED(closure))
+{
+    Py_XSETREF(self->cancel_msg, Py_XNewRef(value));
+    return 0;
+}
+
+static PyObject *
+fut_repr(PyFutureObject *self)
+{
+    const char *name = _PyType_Name(Py_TYPE(self));
+    if (self->state == FUT_PENDING)
+        return PyUnicode_FromFormat("<%s pending>", name);
+    if (self->state == FUT_CANCELLED)
+        return PyUnicode_FromFormat("<%s cancelled>", name);
+    if (self->exception)
+        return PyUnicode_FromFormat("<%s finished exception=%R>", name, self->exception);
+    return PyUnicode_FromFormat("<%s finished result=%R>", name, self->result);
+}
+
+/* await fut: yield the future while pending, then return its result. */
+static PySendResult
+fut_am_send(PyFutureObject *self, PyObject *Py_UNUSED(arg), PyObject **presult)
+{
+    if (self->state == FUT_PENDING) {
+        self->blocking = 1;
+        *presult = Py_NewRef(self);
+        return PYGEN_NEXT;
+    }
+    *presult = _fut_result(self);
+    return *presult ? PYGEN_RETURN : PYGEN_ERROR;
+}
+
+static PyObject *
+fut_iternext(PyFutureObject *self)
+{
+    PyObject *res;
+    PySendResult r = fut_am_send(self, Py_None, &res);
+    if (r != PYGEN_RETURN)
+        return res;
+    if (res != Py_None) {
+        PyObject *stop = PyObject_CallOneArg(PyExc_StopIteration, res);
+        if (stop) {
+            PyErr_SetObject(PyExc_StopIteration, stop);
+            Py_DECREF(stop);
+        }
+    }
+    Py_DECREF(res);
+    return NULL;
+}
+
+static PyObject *
+fut_await(PyFutureObject *self)
+{
+    return Py_NewRef(self);
+}
+
+static PyAsyncMethods fut_as_async = {
+    .am_await = (unaryfunc)fut_await,
+    .am_send = (sendfunc)fut_am_send,
+};
+
+static PyMethodDef fut_methods[] = {
+    {"result", (PyCFunction)fut_result, METH_NOARGS,
+     PyDoc_STR("Return the result or raise the stored exception")},
+    {"exception", (PyCFunction)fut_exception, METH_NOARGS,
+     PyDoc_STR("Return the stored exception, or None")},
+    {"done", (PyCFunction)fut_done, METH_NOARGS,
+     PyDoc_STR("Return True if the future is finished or cancelled")},
+    {"cancelled", (PyCFunction)fut_cancelled, METH_NOARGS,
+     PyDoc_STR("Return True if the future was cancelled")},
+    {"cancel", (PyCFunction)(PyCFunctionWithKeywords)fut_cancel, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Cancel the future and schedule its callbacks")},
+    {"set_result", (PyCFunction)fut_set_result, METH_O,
+     PyDoc_STR("Mark the future done with a result")},
+    {"set_exception", (PyCFunction)fut_set_exception, METH_O,
+     PyDoc_STR("Mark the future done with an exception")},
+    {"add_done_callback", (PyCFunction)(PyCFunctionWithKeywords)fut_add_done_callback,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Call fn(future) once the future is done")},
+    {"remove_done_callback", (PyCFunction)fut_remove_done_callback, METH_O,
+     PyDoc_STR("Remove every registration of fn; return how many there were")},
+    {"get_loop", (PyCFunction)fut_get_loop, METH_NOARGS,
+     PyDoc_STR("Return the loop the future is bound to")},
+    {"_make_cancelled_error", (PyCFunction)fut_make_cancelled_error, METH_NOARGS,
+     PyDoc_STR("Return the CancelledError result() would raise")},
+    {NULL, NULL, 0, NULL},
+};
+
+static PyGetSetDef fut_getset[] = {
+    {"_asyncio_future_blocking", (getter)fut_get_blocking, (setter)fut_set_blocking,
+     PyDoc_STR("True while a task is suspended on this future"), NULL},
+    {"_cancel_message", (getter)fut_get_cancel_message, (setter)fut_set_cancel_message,
+     PyDoc_STR("Message passed to cancel(), read by asyncio.gather()"), NULL},
+    {NULL},
+};
+
+static PyTypeObject PyFuture_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "casyncio.Future",
+    .tp_basicsize = sizeof(PyFutureObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)fut_init,
+    .tp_traverse = (traverseproc)fut_traverse,
+    .tp_clear = (inquiry)fut_clear,
+    .tp_dealloc = (destructor)fut_dealloc,
+    .tp_repr = (reprfunc)fut_repr,
+    .tp_as_async = &fut_as_async,
+    .tp_iter = PyObject_SelfIter,
+    .tp_iternext = (iternextfunc)fut_iternext,
+    .tp_methods = fut_methods,
+    .tp_getset = fut_getset,
+};
+
+/* Task */
+static int
+_task_schedule(PyTaskObject *task, PyObject *exc)
+{
+    Py_XSETREF(task->step_exc, Py_XNewRef(exc));
+    if (task->step_scheduled)
+        return 0;
+    task->step_scheduled = 1;
+    return _ready_push((PyEventLoopObject *)task->base.loop, (PyObject *)task);
+}
+
+/* Throw a RuntimeError into the coroutine on its next step. */
+static int
+_task_bad_yield(PyTaskObject *task, PyObject *msg)
+{
+    if (!msg)
+        return -1;
+    PyObject *exc = PyObject_CallOneArg(PyExc_RuntimeError, msg);
+    Py_DECREF(msg);
+    if (!exc)
+        return -1;
+    int rc = _task_schedule(task, exc);
+    Py_DECREF(exc);
+    return rc;
+}
+
+/* Foreign asyncio-compatible future: wait through its add_done_callback(). */
+static int
+_task_wait_foreign(PyTaskObject *task, PyObject *waiter)
+{
+    PyObject *blocking;
+    int has = _optional_attr(waiter, "_asyncio_future_blocking", &blocking);
+    if (has < 0)
+        return -1;
+    if (!has || blocking == Py_None) {
+        Py_XDECREF(blocking);
+        if (PyGen_CheckExact(waiter))
+            return _task_bad_yield(task, PyUnicode_FromFormat(
+                "yield was used instead of yield from for generator in task %R with %R",
+                task, waiter));
+        return _task_bad_yield(task, PyUnicode_FromFormat(
+            "Task got bad yield: %R", waiter));
+    }
+    int b = PyObject_IsTrue(blocking);
+    Py_DECREF(blocking);
+    if (b < 0)
+        return -1;
+    if (!b)
+        return _task_bad_yield(task, PyUnicode_FromFormat(
+            "yield was used instead of yield from in task %R with %R", task, waiter));
+    PyObject *wloop = PyObject_CallMethod(waiter, "get_loop", NULL);
+    if (!wloop)
+        return -1;
+    Py_DECREF(wloop);
+    if (wloop != task->base.loop)
+        return _task_bad_yield(task, PyUnicode_FromFormat(
+            "Task %R got Future %R attached to a different loop", task, waiter));
+    if (PyObject_SetAttrString(waiter, "_asyncio_future_blocking", Py_False) < 0)
+        return -1;
+    PyObject *wakeup = PyObject_GetAttrString((PyObject *)task, "_wakeup");
+    if (!wakeup)
+        return -1;
+    PyObject *res = _call_with_context(waiter, "add_done_callback", &wakeup, 1, task->context);
+    Py_DECREF(wakeup);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    Py_XSETREF(task->fut_waiter, Py_NewRef(waiter));
+    if (task->must_cancel) {
+        res = PyObject_CallMethod(waiter, "cancel", "O", task->cancel_msg ? task->cancel_msg : Py_None);
+        if (!res)
+            return -1;
+        int cancelled = PyObject_IsTrue(res);
+        Py_DECREF(res);
+        if (cancelled < 0)
+            return -1;
+        if (cancelled)
+            task->must_cancel = 0;
+    }
+    return 0;
+}
+
+/* The coroutine yielded value: arrange for the next step. */
+static int
+_task_handle_yield(PyTaskObject *task, PyObject *value)
+{
+    if (value == Py_None)
+        return _task_schedule(task, NULL);   /* bare yield: run again next pass */
+    if (!PyObject_TypeCheck(value, &PyFuture_Type))
+        return _task_wait_foreign(task, value);
+    PyFutureObject *waiter = (PyFutureObject *)value;
+    if (!waiter->blocking)
+        return _task_bad_yield(task, PyUnicode_FromFormat(
+            "yield was used instead of yield from in task %R with %R", task, value));
+    if (waiter->loop != task->base.loop)
+        return _task_bad_yield(task, PyUnicode_FromFormat(
+            "Task %R got Future %R attached to a different loop", task, value));
+    if (value == (PyObject *)task)
+        return _task_bad_yield(task, PyUnicode_FromFormat(
+            "Task cannot await on itself: %R", task));
+    waiter->blocking = 0;
+    if (_fut_add_callback(waiter, (PyObject *)task, NULL) < 0)
+        return -1;
+    if (waiter->state != FUT_PENDING && _fut_schedule_callbacks(waiter) < 0)
+        return -1;
+    Py_XSETREF(task->fut_waiter, Py_NewRef(value));
+    if (task->must_cancel) {
+        int r = _fut_cancel(waiter, task->cancel_msg);
+        if (r < 0)
+            return -1;
+        if (r)
+            task->must_cancel = 0;
+    }
+    return 0;
+}
+
+/*
+ * Make task asyncio's current task for loop, returning the previous one
+ * (new reference, Py_None if there was none) for _task_leave().
+ */
+static PyObject *
+_task_enter(PyTaskObject *task)
+{
+    if (!asyncio_current_tasks) {
+        PyObject *tasks = _asyncio_attr(&asyncio_tasks, "tasks");
+        if (!tasks)
+            return NULL;
+        asyncio_current_tasks = PyObject_GetAttrString(tasks, "_current_tasks");
+        if (!asyncio_current_tasks)
+            return NULL;
+    }
+    if (!PyDict_Check(asyncio_current_tasks))
+        return Py_NewRef(Py_None);
+    PyObject *prev = PyDict_GetItemWithError(asyncio_current_tasks, task->base.loop);
+    if (!prev && PyErr_Occurred())
+        return NULL;
+    prev = Py_NewRef(prev ? prev : Py_None);
+    if (PyDict_SetItem(asyncio_current_tasks, task->base.loop, (PyObject *)task) < 0) {
+        Py_DECREF(prev);
+        return NULL;
+    }
+    return prev;
+}
+
+static int
+_task_leave(PyTaskObject *task, PyObject *prev)
+{
+    if (!PyDict_Check(asyncio_current_tasks))
+        return 0;
+    if (prev != Py_None)
+        return PyDict_SetItem(asyncio_current_tasks, task->base.loop, prev);
+    return PyDict_DelItem(asyncio_current_tasks, task->base.loop);
+}
+
+/* Advance the coroutine once, throwing exc (borrowed) into it if given. */
+static int
+_task_step(PyTaskObject *task, PyObject *exc)
+{
+    PyFutureObject *fut = &task->base;
+    if (fut->state != FUT_PENDING) {
+        _set_invalid_state("_step(): already done");
+        return -1;
+    }
+    PyObject *thrown = Py_XNewRef(exc);
+    if (task->must_cancel) {
+        PyObject *CancelledError = _asyncio_attr(&asyncio_CancelledError, "CancelledError");
+        if (!CancelledError) {
+            Py_XDECREF(thrown);
+            return -1;
+        }
+        if (!thrown || !PyErr_GivenExceptionMatches(thrown, CancelledError)) {
+            Py_XSETREF(thrown, _make_cancelled_error(task->cancel_msg));
+            if (!thrown)
+                return -1;
+        }
+        task->must_cancel = 0;
+    }
+    Py_CLEAR(task->fut_waiter);
+
+    PyObject *prev = _task_enter(task);
+    if (!prev) {
+        Py_XDECREF(thrown);
+        return -1;
+    }
+    if (PyContext_Enter(task->context) < 0) {
+        Py_XDECREF(thrown);
+        _task_leave(task, prev);
+        Py_DECREF(prev);
+        return -1;
+    }
+    PyObject *value = NULL;
+    PySendResult sr;
+    if (!thrown) {
+        sr = PyIter_Send(task->coro, Py_None, &value);
+    } else {
+        value = PyObject_CallMethod(task->coro, "throw", "O", thrown);
+        sr = value ? PYGEN_NEXT : PYGEN_ERROR;
+        Py_DECREF(thrown);
+    }
+    PyObject *err = sr == PYGEN_ERROR ? _fetch_exception() : NULL;
+    int rc = PyContext_Exit(task->context);
+    if (_task_leave(task, prev) < 0)
+        rc = -1;
+    Py_DECREF(prev);
+    if (rc < 0) {
+        Py_XDECREF(value);
+        Py_XDECREF(err);
+        return -1;
+    }
+
+    if (sr == PYGEN_NEXT) {
+        rc = _task_handle_yield(task, value);
+        Py_DECREF(value);
+        return rc;
+    }
+    if (sr == PYGEN_ERROR && PyErr_GivenExceptionMatches(err, PyExc_StopIteration)) {
+        /* throw() finished the coroutine */
+        value = Py_NewRef(((PyStopIterationObject *)err)->value);
+        Py_CLEAR(err);
+        sr = PYGEN_RETURN;
+    }
+    if (sr == PYGEN_RETURN) {
+        if (task->must_cancel) {
+            /* cancel() arrived while the final step was running */
+            task->must_cancel = 0;
+            rc = _fut_cancel(fut, task->cancel_msg) < 0 ? -1 : 0;
+        } else {
+            rc = _fut_finish(fut, value, NULL);
+        }
+        Py_DECREF(value);
+        return rc;
+    }
+
+    PyObject *CancelledError = _asyncio_attr(&asyncio_CancelledError, "CancelledError");
+    if (!CancelledError) {
+        Py_DECREF(err);
+        return -1;
+    }
+    if (PyErr_GivenExceptionMatches(err, CancelledError)) {
+        PyObject *args = ((PyBaseExceptionObject *)err)->args;
+        PyObject *msg = args && PyTuple_GET_SIZE(args) ? PyTuple_GET_ITEM(args, 0) : NULL;
+        rc = _fut_cancel(fut, msg) < 0 ? -1 : 0;
+        Py_DECREF(err);
+        return rc;
+    }
+    rc = _fut_finish(fut, NULL, err);
+    /* like asyncio, KeyboardInterrupt and SystemExit also stop the loop */
+    if (rc == 0 && !PyErr_GivenExceptionMatches(err, PyExc_Exception)) {
+        _raise_stored(err);
+        rc = -1;
+    }
+    Py_DECREF(err);
+    return rc;
+}
+
+/* The future the task waits on is done: step with its outcome. */
+static int
+_task_wakeup(PyTaskObject *task, PyObject *fut)
+{
+    if (PyObject_TypeCheck(fut, &PyFuture_Type)) {
+        PyFutureObject *f = (PyFutureObject *)fut;
+        if (f->state == FUT_CANCELLED) {
+            PyObject *exc = _make_cancelled_error(f->cancel_msg);
+            if (!exc)
+                return -1;
+            int rc = _task_step(task, exc);
+            Py_DECREF(exc);
+            return rc;
+        }
+        /* a result is picked up by the coroutine's own await */
+        return _task_step(task, f->exception);
+    }
+    PyObject *res = PyObject_CallMethod(fut, "result", NULL);
+    if (res) {
+        Py_DECREF(res);
+        return _task_step(task, NULL);
+    }
+    PyObject *exc = _fetch_exception();
+    int rc = _task_step(task, exc);
+    Py_DECREF(exc);
+    return rc;
+}
+
+static int
+_task_setup(PyTaskObject *task, PyObject *loop, PyObject *coro, PyObject *name,
+            PyObject *context)
+{
+    if (!Py_IS_TYPE(loop, &PyEventLoop_Type)) {
+        PyErr_SetString(PyExc_TypeError, "casyncio.Task requires a casyncio.EventLoop");
+        return -1;
+    }
+    if (!PyCoro_CheckExact(coro) && !PyObject_HasAttrString(coro, "send")) {
+        PyErr_Format(PyExc_TypeError, "a coroutine was expected, got %R", coro);
+        return -1;
+    }
+    if (context && context != Py_None) {
+        Py_INCREF(context);
+    } else {
+        context = PyContext_CopyCurrent();
+        if (!context)
+            return -1;
+    }
+    Py_XSETREF(task->base.loop, Py_NewRef(loop));
+    Py_XSETREF(task->coro, Py_NewRef(coro));
+    Py_XSETREF(task->context, context);
+    if (name && name != Py_None) {
+        Py_XSETREF(task->name, PyUnicode_Check(name) ? Py_NewRef(name) : PyObject_Str(name));
+        if (!task->name)
+            return -1;
+    }
+    task->id = ++task_counter;
+    return 0;
+}
+
+/*
+ * Start a set-up task.  An eager start runs the first step right here, so
+ * a coroutine that returns without suspending never queues anything.
+ */
+static int
+_task_start(PyTaskObject *task, int eager)
+{
+    if (eager)
+        return _task_step(task, NULL);
+    return _task_schedule(task, NULL);
+}
+
+static int
+task_traverse(PyTaskObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->coro);
+    Py_VISIT(self->context);
+    Py_VISIT(self->fut_waiter);
+    Py_VISIT(self->name);
+    Py_VISIT(self->step_exc);
+    Py_VISIT(self->cancel_msg);
+    return fut_traverse(&self->base, visit, arg);
+}
+
+static int
+task_clear(PyTaskObject *self)
+{
+    Py_CLEAR(self->coro);
+    Py_CLEAR(self->context);
+    Py_CLEAR(self->fut_waiter);
+    Py_CLEAR(self->name);
+    Py_CLEAR(self->step_exc);
+    Py_CLEAR(self->cancel_msg);
+    return fut_clear(&self->base);
+}
+
+static int
+task_init(PyTaskObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *coro, *loop = NULL, *name = NULL, *context = NULL;
+    int eager = 0;
+    static char *kwlist[] = {"coro", "loop", "name", "context", "eager_start", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|$OOOp:Task", kwlist,
+                                     &coro, &loop, &name, &context, &eager))
+        return -1;
+    loop = _loop_or_running(loop);
+    if (!loop)
+        return -1;
+    int rc = _task_setup(self, loop, coro, name, context);
+    Py_DECREF(loop);
+    if (rc < 0)
+        return -1;
+    return _task_start(self, eager);
+}
+
+static PyObject *
+task_cancel(PyTaskObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *msg = Py_None;
+    static char *kwlist[] = {"msg", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O:cancel", kwlist, &msg))
+        return NULL;
+    if (self->base.state != FUT_PENDING)
+        Py_RETURN_FALSE;
+    self->num_cancels_requested++;
+    if (self->fut_waiter) {
+        int r;
+        if (PyObject_TypeCheck(self->fut_waiter, &PyFuture_Type)) {
+            r = _fut_cancel((PyFutureObject *)self->fut_waiter, msg);
+        } else {
+            PyObject *res = PyObject_CallMethod(self->fut_waiter, "cancel", "O", msg);
+            if (!res)
+                return NULL;
+            r = PyObject_IsTrue(res);
+            Py_DECREF(res);
+        }
+        if (r < 0)
+            return NULL;
+        if (r)
+            Py_RETURN_TRUE;   /* the wakeup throws CancelledError in */
+    }
+    self->must_cancel = 1;
+    Py_XSETREF(self->cancel_msg, Py_NewRef(msg));
+    Py_RETURN_TRUE;
+}
+
+static PyObject *
+task_cancelling(PyTaskObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromLong(self->num_cancels_requested);
+}
+
+static PyObject *
+task_uncancel(PyTaskObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->num_cancels_requested > 0)
+        self->num_cancels_requested--;
+    return PyLong_FromLong(self->num_cancels_requested);
+}
+
+static PyObject *
+task_set_result(PyTaskObject *self, PyObject *Py_UNUSED(arg))
+{
+    PyErr_SetString(PyExc_RuntimeError, "Task does not support set_result operation");
+    return NULL;
+}
+
+static PyObject *
+task_set_exception(PyTaskObject *self, PyObject *Py_UNUSED(arg))
+{
+    PyErr_SetString(PyExc_RuntimeError, "Task does not support set_exception operation");
+    return NULL;
+}
+
+static PyObject *
+task_wakeup(PyTaskObject *self, PyObject *fut)
+{
+    if (_task_wakeup(self, fut) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+task_get_coro(PyTaskObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return Py_NewRef(self->coro);
+}
+
+static PyObject *
+task_get_context(PyTaskObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return Py_NewRef(self->context);
+}
+
+static PyObject *
+task_get_name(PyTaskObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!self->name) {
+        self->name = PyUnicode_FromFormat("Task-%llu", (unsigned long long)self->id);
+        if (!self->name)
+            return NULL;
+    }
+    return Py_NewRef(self->name);
+}
+
+static PyObject *
+task_set_name(PyTaskObject *self, PyObject *value)
+{
+    PyObject *name = PyUnicode_Check(value) ? Py_NewRef(value) : PyObject_Str(value);
+    if (!name)
+        return NULL;
+    Py_XSETREF(self->name, name);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+task_repr(PyTaskObject *self)
+{
+    PyObject *name = task_get_name(self, NULL);
+    if (!name)
+        return NULL;
+    const char *state = self->base.state == FUT_PENDING ? "pending"
+                      : self->base.state == FUT_CANCELLED ? "cancelled" : "finished";
+    PyObject *r = PyUnicode_FromFormat("<%s %s name=%R coro=%R>", _PyType_Name(Py_TYPE(self)),
+                                       state, name, self->coro);
+    Py_DECREF(name);
+    return r;
+}
+
+static PyMethodDef task_methods[] = {
+    {"cancel", (PyCFunction)(PyCFunctionWithKeywords)task_cancel, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Request cancellation; CancelledError is thrown into the coroutine")},
+    {"cancelling", (PyCFunction)task_cancelling, METH_NOARGS,
+     PyDoc_STR("Return the number of pending cancellation requests")},
+    {"uncancel", (PyCFunction)task_uncancel, METH_NOARGS,
+     PyDoc_STR("Decrement the pending cancellation requests")},
+    {"set_result", (PyCFunction)task_set_result, METH_O,
+     PyDoc_STR("Not supported on tasks")},
+    {"set_exception", (PyCFunction)task_set_exception, METH_O,
+     PyDoc_STR("Not supported on tasks")},
+    {"_wakeup", (PyCFunction)task_wakeup, METH_O,
+     PyDoc_STR("Done callback for foreign futures the task waits on")},
+    {"get_coro", (PyCFunction)task_get_coro, METH_NOARGS,
+     PyDoc_STR("Return the wrapped coroutine")},
+    {"get_context", (PyCFunction)task_get_context, METH_NOARGS,
+     PyDoc_STR("Return the contextvars.Context steps run in")},
+    {"get_name", (PyCFunction)task_get_name, METH_NOARGS,
+     PyDoc_STR("Return the task name")},
+    {"set_name", (PyCFunction)task_set_name, METH_O,
+     PyDoc_STR("Set the task name")},
+    {NULL, NULL, 0, NULL},
+};
+
+static PyTypeObject PyTask_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "casyncio.Task",
+    .tp_basicsize = sizeof(PyTaskObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    .tp_base = &PyFuture_Type,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)task_init,
+    .tp_traverse = (traverseproc)task_traverse,
+    .tp_clear = (inquiry)task_clear,
+    .tp_dealloc = (destructor)fut_dealloc,
+    .tp_repr = (reprfunc)task_repr,
+    .tp_methods = task_methods,
+};
+
+static PyObject *
+loop_create_future(PyEventLoopObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return _future_new((PyObject *)self);
+}
+
+static PyObject *
+loop_create_task(PyEventLoopObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *coro, *name = NULL, *context = NULL, *eager = Py_None;
+    static char *kwlist[] = {"coro", "name", "context", "eager", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|$OOO:create_task", kwlist,
+                                     &coro, &name, &context, &eager))
+        return NULL;
+    int run_eager = self->eager_tasks;
+    if (eager != Py_None && (run_eager = PyObject_IsTrue(eager)) < 0)
+        return NULL;
+    PyTaskObject *task = (PyTaskObject *)PyTask_Type.tp_alloc(&PyTask_Type, 0);
+    if (!task)
+        return NULL;
+    task->base.state = FUT_PENDING;
+    if (_task_setup(task, (PyObject *)self, coro, name, context) < 0 ||
+        _task_start(task, run_eager) < 0) {
+        Py_DECREF(task);
+        return NULL;
+    }
+    return (PyObject *)task;
+}
+
+/* add_reader() without the argument parsing, for native readers. */
+static int
+_set_reader(PyEventLoopObject *self, int fd, PyObject *cb)
+{
+    if (ensure_fdslot(self, fd) < 0)
+        return -1;
+    FDCallback *slot = self->fdmap[fd];
+    PyObject *old = slot->reader;
+    Py_INCREF(cb);
+    slot->reader = cb;
+    if (_fd_interest(self, fd, slot) < 0) {
+        slot->reader = old;
+        Py_DECREF(cb);
+        return -1;
+    }
+    Py_XDECREF(old);
+    return 0;
+}
+
+static PyObject *
+loop_add_reader(PyEventLoopObject *self, PyObject *args)
+{
+    int fd;
+    PyObject *cb;
+    if (!PyArg_ParseTuple(args, "iO:add_reader", &fd, &cb))
+        return NULL;
+    if (!PyCallable_Check(cb)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable");
+        return NULL;
+    }
+    if (_set_reader(self, fd, cb) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+loop_remove_reader(PyEventLoopObject *self, PyObject *arg)
+{
+    int fd = PyLong_AsLong(arg);
+    if (fd == -1 && PyErr_Occurred())
+        return NULL;
+    if (fd >= self->fdcap || !self->fdmap[fd] || !self->fdmap[fd]->reader)
+        Py_RETURN_FALSE;
+    FDCallback *slot = self->fdmap[fd];
+    Py_CLEAR(slot->reader);
+    slot->read_paused = slot->read_missed = 0;
+    if (_fd_interest(self, fd, slot) < 0)
+        return NULL;
+    Py_RETURN_TRUE;
+}
+
+static PyObject *
+loop_add_writer(PyEventLoopObject *self, PyObject *args)
+{
+    int fd;
+    PyObject *cb;
+    if (!PyArg_ParseTuple(args, "iO:add_writer", &fd, &cb))
+        return NULL;
+    if (!PyCallable_Check(cb)) {
+        PyErr_SetString(PyExc_TypeError, "callback must be callable");
+        return NULL;
+    }
+    if (ensure_fdslot(self, fd) < 0)
+        return NULL;
+    FDCallback *slot = self->fdmap[fd];
+    PyObject *old = slot->writer;
+    Py_INCREF(cb);
+    slot->writer = cb;
+    if (_fd_interest(self, fd, slot) < 0) {
+        slot->writer = old;
+        Py_DECREF(cb);
+        return NULL;
+    }
+    Py_XDECREF(old);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+loop_remove_writer(PyEventLoopObject *self, PyObject *arg)
+{
+    int fd = PyLong_AsLong(arg);
+    if (fd == -1 && PyErr_Occurred())
+        return NULL;
+    if (fd >= self->fdcap || !self->fdmap[fd] || !self->fdmap[fd]->writer)
+        Py_RETURN_FALSE;
+    FDCallback *slot = self->fdmap[fd];
+    Py_CLEAR(slot->writer);
+    if (_fd_interest(self, fd, slot) < 0)
+        return NULL;
+    Py_RETURN_TRUE;
+}
+
+static PyObject *
+loop_add_signal_handler(PyEventLoopObject *self, PyObject *args)
+{
+    int signo;
+    PyObject *cb;
+    if (!PyArg_ParseTuple(args, "iO:add_signal_handler", &signo, &cb))
+        return NULL;
+    if (!PyCallable_Check(cb)) {
         PyErr_SetString(PyExc_TypeError, "callback must be callable");
         return NULL;
     }
-    if (ensure_fdslot(self, fd) < 0)
+    PyObject *key = PyLong_FromLong(signo);
+    int r = PyDict_SetItem(self->signal_handlers, key, cb);
+    Py_DECREF(key);
+    if (r < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+loop_remove_signal_handler(PyEventLoopObject *self, PyObject *arg)
+{
+    long signo = PyLong_AsLong(arg);
+    if (signo == -1 && PyErr_Occurred())
+        return NULL;
+    PyObject *key = PyLong_FromLong(signo);
+    if (!key)
+        return NULL;
+    int r = PyDict_Contains(self->signal_handlers, key);
+    if (r > 0 && PyDict_DelItem(self->signal_handlers, key) < 0)
+        r = -1;
+    Py_DECREF(key);
+    if (r < 0)
+        return NULL;
+    return PyBool_FromLong(r);
+}
+
+/*
+ * Write views[0:n] to fd in order, taking ownership of every view.  With
+ * nothing queued the data is sent straight from the callers' buffers and
+ * only an unsent tail is queued; otherwise EPOLLOUT is already pending and
+ * everything is appended without a syscall.
+ */
+static int
+_write_views(PyEventLoopObject *self, int fd, Py_buffer *views, Py_ssize_t n)
+{
+    Py_ssize_t i = 0, off = 0;
+    FDCallback *slot;
+    OutBuf *ob;
+    int rc = -1;
+    if (ensure_fdslot(self, fd) < 0)
+        goto done;
+    slot = self->fdmap[fd];
+    if (!slot->obuf && !(slot->obuf = outbuf_new(self)))
+        goto done;
+    ob = slot->obuf;
+
+    /* zerocopy sends go from the queue, which keeps their objects alive */
+    int zc = 0;
+    for (Py_ssize_t j = 0; ob->zc_threshold && j < n && !zc; j++)
+        zc = views[j].len >= ob->zc_threshold;
+    int was_idle = !ob->count;
+    /* on io_uring the queue goes out as a SENDMSG with the next wait */
+    if (was_idle && !zc && !slot->uio) {
+        struct iovec iov[IOV_MAX];
+        while (i < n) {
+            int iovcnt = 0;
+            for (Py_ssize_t j = i; j < n && iovcnt < IOV_MAX; j++) {
+                Py_ssize_t skip = j == i ? off : 0;
+                iov[iovcnt].iov_base = (char *)views[j].buf + skip;
+                iov[iovcnt].iov_len = (size_t)(views[j].len - skip);
+                iovcnt++;
+            }
+            ssize_t sent = _outbuf_sendv(ob, fd, iov, iovcnt);
+            if (sent == -1) {
+                if (errno == EINTR)
+                    continue;
+                if (errno == EAGAIN || errno == EWOULDBLOCK)
+                    break;
+                PyErr_SetFromErrno(PyExc_OSError);
+                goto done;
+            }
+            while (i < n && sent >= views[i].len - off) {
+                sent -= views[i].len - off;
+                PyBuffer_Release(&views[i]);
+                i++;
+                off = 0;
+            }
+            off += sent;
+        }
+        if (i == n)
+            return 0;
+    }
+    for (; i < n; i++, off = 0) {
+        if (_outbuf_append(ob, &views[i], off) < 0) {
+            i++;
+            goto done;
+        }
+    }
+    if (zc && was_idle && socket_write_now(fd, ob) == -1) {
+        /* as with a direct send, the caller gets the error and nothing stays queued */
+        PyErr_SetFromErrno(PyExc_OSError);
+        for (; ob->count; ob->count--)
+            PyBuffer_Release(&ob->segs[ob->head++].view);
+        ob->head = 0;
+        ob->nbytes = 0;
+        goto done;
+    }
+    if (slot->uio && _uring_send(self, slot) < 0) {
+        PyErr_SetFromErrno(PyExc_OSError);
+        goto done;
+    }
+    if (_outbuf_flow(ob) < 0)
+        goto done;
+    rc = _fd_interest(self, fd, slot);
+done:
+    for (; i < n; i++)
+        PyBuffer_Release(&views[i]);
+    return rc;
+}
+
+static PyObject *
+loop_c_write(PyEventLoopObject *self, PyObject *args)
+{
+    int fd;
+    PyObject *data;
+    Py_buffer view;
+    if (!PyArg_ParseTuple(args, "iO:write", &fd, &data))
+        return NULL;
+    if (PyObject_GetBuffer(data, &view, PyBUF_SIMPLE) < 0)
+        return NULL;
+    if (_write_views(self, fd, &view, 1) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+loop_c_writelines(PyEventLoopObject *self, PyObject *args)
+{
+    int fd;
+    PyObject *iterable;
+    if (!PyArg_ParseTuple(args, "iO:writelines", &fd, &iterable))
+        return NULL;
+    PyObject *seq = PySequence_Fast(iterable, "writelines() argument must be iterable");
+    if (!seq)
+        return NULL;
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(seq);
+    Py_buffer *views = PyMem_Malloc((n ? n : 1) * sizeof(Py_buffer));
+    if (!views) {
+        Py_DECREF(seq);
+        return PyErr_NoMemory();
+    }
+    PyObject **items = PySequence_Fast_ITEMS(seq);
+    for (Py_ssize_t i = 0; i < n; i++) {
+        if (PyObject_GetBuffer(items[i], &views[i], PyBUF_SIMPLE) < 0) {
+            while (i--)
+                PyBuffer_Release(&views[i]);
+            PyMem_Free(views);
+            Py_DECREF(seq);
+            return NULL;
+        }
+    }
+    int r = _write_views(self, fd, views, n);
+    PyMem_Free(views);
+    Py_DECREF(seq);
+    if (r < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+loop_c_drain_waiter(PyEventLoopObject *self, PyObject *arg)
+{
+    int fd = PyLong_AsLong(arg);
+    if (fd == -1 && PyErr_Occurred())
+        return NULL;
+
+    PyObject *fut = _new_future((PyObject *)self);
+    if (!fut)
+        return NULL;
+
+    if (fd >= self->fdcap || !self->fdmap[fd] || !self->fdmap[fd]->obuf ||
+        !self->fdmap[fd]->obuf->paused) {
+        if (_future_resolve(fut, Py_None, NULL) < 0) {
+            Py_DECREF(fut);
+            return NULL;
+        }
+        return fut;
+    }
+
+    OutBuf *ob = self->fdmap[fd]->obuf;
+    if (PyList_Append(ob->waiters, fut) < 0) {
+        Py_DECREF(fut);
+        return NULL;
+    }
+    return fut;
+}
+
+/*
+ * Stop reading fd and close it once its write queue is flushed.  With
+ * nothing queued it is closed immediately.
+ */
+static PyObject *
+loop_c_close(PyEventLoopObject *self, PyObject *arg)
+{
+    int fd = PyLong_AsLong(arg);
+    if (fd == -1 && PyErr_Occurred())
+        return NULL;
+    FDCallback *slot = fd < self->fdcap ? self->fdmap[fd] : NULL;
+    if (slot && slot->obuf && _outbuf_pending(slot->obuf)) {
+        Py_CLEAR(slot->reader);
+        Py_CLEAR(slot->writer);
+        slot->close_pending = 1;
+        if (_fd_interest(self, fd, slot) < 0)
+            return NULL;
+        Py_RETURN_NONE;
+    }
+    if (_fd_close(self, fd) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static OutBuf *
+_fd_outbuf(PyEventLoopObject *self, int fd)
+{
+    if (ensure_fdslot(self, fd) < 0)
+        return NULL;
+    FDCallback *slot = self->fdmap[fd];
+    if (!slot->obuf && !(slot->obuf = outbuf_new(self)))
+        return NULL;
+    return slot->obuf;
+}
+
+/*
+ * sendfile(fd, file_fd, offset=0, count=None): send count bytes of file_fd
+ * (to its end when None) after whatever is already queued for fd, and
+ * return a Future of the bytes sent.  A file shorter than count ends the
+ * send early.  file_fd is duplicated, so it may be closed right away.
+ */
+static PyObject *
+loop_sendfile(PyEventLoopObject *self, PyObject *args, PyObject *kwds)
+{
+    int fd, file_fd;
+    long long offset = 0;
+    PyObject *count_o = Py_None;
+    static char *kwlist[] = {"fd", "file_fd", "offset", "count", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "ii|LO:sendfile", kwlist,
+                                     &fd, &file_fd, &offset, &count_o))
+        return NULL;
+    if (offset < 0) {
+        PyErr_SetString(PyExc_ValueError, "offset must be >= 0");
+        return NULL;
+    }
+    Py_ssize_t count;
+    if (count_o == Py_None) {
+        struct stat st;
+        if (fstat(file_fd, &st) == -1)
+            return PyErr_SetFromErrno(PyExc_OSError);
+        count = st.st_size > offset ? (Py_ssize_t)(st.st_size - offset) : 0;
+    } else if ((count = PyLong_AsSsize_t(count_o)) < 0) {
+        if (!PyErr_Occurred())
+            PyErr_SetString(PyExc_ValueError, "count must be >= 0");
+        return NULL;
+    }
+    PyObject *fut = _new_future((PyObject *)self);
+    if (!fut)
+        return NULL;
+    if (count == 0) {
+        PyObject *zero = PyLong_FromLong(0);
+        int r = zero ? _future_resolve(fut, zero, NULL) : -1;
+        Py_XDECREF(zero);
+        if (r < 0)
+            Py_CLEAR(fut);
+        return fut;
+    }
+    OutBuf *ob = _fd_outbuf(self, fd);
+    if (!ob)
+        goto error;
+    if (!ob->not_socket) {
+        struct stat st;
+        if (fstat(fd, &st) == -1) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            goto error;
+        }
+        ob->not_socket = !S_ISSOCK(st.st_mode);
+    }
+    FileSeg *f = PyMem_Calloc(1, sizeof(FileSeg));
+    if (!f) {
+        PyErr_NoMemory();
+        goto error;
+    }
+    f->fd = fcntl(file_fd, F_DUPFD_CLOEXEC, 0);
+    if (f->fd == -1) {
+        PyMem_Free(f);
+        PyErr_SetFromErrno(PyExc_OSError);
+        goto error;
+    }
+    f->offset = (off_t)offset;
+    f->left = count;
+    f->fut = Py_NewRef(fut);
+    int was_idle = !ob->count;
+    if (_outbuf_append_file(ob, f) < 0)
+        goto error;
+    FDCallback *slot = self->fdmap[fd];
+    if (was_idle) {
+        /* nothing ahead of it: start now, as write() would */
+        int r = socket_write_now(fd, ob);
+        if (r == -1) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            /* drop the segment; the caller gets the error instead */
+            OutSeg *seg = &ob->segs[ob->head];
+            ob->nbytes -= seg->file->left;
+            Py_CLEAR(seg->file->fut);
+            _fileseg_finish(seg->file, NULL);
+            ob->head = ob->count = 0;
+            goto error;
+        }
+    }
+    if (_outbuf_flow(ob) < 0 || _fd_interest(self, fd, slot) < 0)
+        goto error;
+    return fut;
+error:
+    Py_DECREF(fut);
+    return NULL;
+}
+
+static PyObject *
+loop_set_write_buffer_limits(PyEventLoopObject *self, PyObject *args, PyObject *kwds)
+{
+    int fd;
+    PyObject *high_o = Py_None, *low_o = Py_None;
+    static char *kwlist[] = {"fd", "high", "low", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "i|OO:_set_write_buffer_limits",
+                                     kwlist, &fd, &high_o, &low_o))
+        return NULL;
+    Py_ssize_t high = -1, low = -1;
+    if (high_o != Py_None && (high = PyLong_AsSsize_t(high_o)) == -1 && PyErr_Occurred())
+        return NULL;
+    if (low_o != Py_None && (low = PyLong_AsSsize_t(low_o)) == -1 && PyErr_Occurred())
+        return NULL;
+    /* same defaults as asyncio's transports */
+    if (high_o == Py_None)
+        high = low_o == Py_None ? DEFAULT_WRITE_HIGH : 4 * low;
+    if (low_o == Py_None)
+        low = high / 4;
+    if (!(high >= low && low >= 0)) {
+        PyErr_Format(PyExc_ValueError, "high (%zd) must be >= low (%zd) must be >= 0",
+                     high, low);
+        return NULL;
+    }
+    OutBuf *ob = _fd_outbuf(self, fd);
+    if (!ob)
+        return NULL;
+    ob->high = high;
+    ob->low = low;
+    if (_outbuf_flow(ob) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+loop_get_write_buffer_size(PyEventLoopObject *self, PyObject *arg)
+{
+    int fd = PyLong_AsLong(arg);
+    if (fd == -1 && PyErr_Occurred())
+        return NULL;
+    if (fd < 0 || fd >= self->fdcap || !self->fdmap[fd] || !self->fdmap[fd]->obuf)
+        return PyLong_FromLong(0);
+    return PyLong_FromSsize_t(_outbuf_pending(self->fdmap[fd]->obuf));
+}
+
+/*
+ * _set_zerocopy(fd, threshold=None): send queued segments of at least
+ * threshold bytes (128 KiB for None) with MSG_ZEROCOPY; 0 turns it off.
+ * Their objects stay referenced and count as buffered until the kernel
+ * reports the send complete.
+ */
+static PyObject *
+loop_set_zerocopy(PyEventLoopObject *self, PyObject *args)
+{
+    int fd;
+    PyObject *threshold_o = Py_None;
+    if (!PyArg_ParseTuple(args, "i|O:_set_zerocopy", &fd, &threshold_o))
+        return NULL;
+    Py_ssize_t threshold = ZEROCOPY_DEFAULT_THRESHOLD;
+    if (threshold_o != Py_None && (threshold = PyLong_AsSsize_t(threshold_o)) < 0) {
+        if (!PyErr_Occurred())
+            PyErr_SetString(PyExc_ValueError, "threshold must be >= 0");
+        return NULL;
+    }
+    OutBuf *ob = _fd_outbuf(self, fd);
+    if (!ob)
+        return NULL;
+    if (threshold && !ob->zc_threshold) {
+        /* TCP and UDP sockets only; anything else refuses it */
+        int on = 1;
+        if (setsockopt(fd, SOL_SOCKET, SO_ZEROCOPY, &on, sizeof(on)) == -1)
+            return PyErr_SetFromErrno(PyExc_OSError);
+    }
+    ob->zc_threshold = threshold;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+loop_set_write_protocol(PyEventLoopObject *self, PyObject *args)
+{
+    int fd;
+    PyObject *protocol;
+    if (!PyArg_ParseTuple(args, "iO:_set_write_protocol", &fd, &protocol))
+        return NULL;
+    OutBuf *ob = _fd_outbuf(self, fd);
+    if (!ob)
+        return NULL;
+    if (protocol == Py_None)
+        protocol = NULL;
+    Py_XINCREF(protocol);
+    Py_XSETREF(ob->protocol, protocol);
+    Py_RETURN_NONE;
+}
+
+/* Drop or restore EPOLLIN for fd; 0 if there is no reader to pause. */
+static int
+_set_read_paused(PyEventLoopObject *self, int fd, int paused)
+{
+    if (fd < 0 || fd >= self->fdcap || !self->fdmap[fd] || !self->fdmap[fd]->reader)
+        return 0;
+    FDCallback *slot = self->fdmap[fd];
+    if (slot->read_paused == paused)
+        return 1;
+    slot->read_paused = paused;
+    if (_fd_interest(self, fd, slot) < 0)
+        return -1;
+    if (!paused && slot->read_missed) {
+        /* the edge was consumed while paused; re-arming won't repeat it */
+        slot->read_missed = 0;
+        if (_ready_push(self, slot->reader) < 0)
+            return -1;
+    }
+    return 1;
+}
+
+static PyObject *
+loop_pause_reading(PyEventLoopObject *self, PyObject *arg)
+{
+    int fd = PyLong_AsLong(arg);
+    if (fd == -1 && PyErr_Occurred())
+        return NULL;
+    int r = _set_read_paused(self, fd, 1);
+    if (r < 0)
+        return NULL;
+    return PyBool_FromLong(r);
+}
+
+static PyObject *
+loop_resume_reading(PyEventLoopObject *self, PyObject *arg)
+{
+    int fd = PyLong_AsLong(arg);
+    if (fd == -1 && PyErr_Occurred())
+        return NULL;
+    int r = _set_read_paused(self, fd, 0);
+    if (r < 0)
+        return NULL;
+    return PyBool_FromLong(r);
+}
+
+static int _tr_closed(PyObject *tr, PyObject *exc);
+static int _tr_fatal(PyObject *tr, PyObject *exc);
+
+/* Errors after which a multishot accept/recv is simply armed again. */
+static int
+_uring_transient(int err)
+{
+    switch (err) {
+    case ECANCELED:
+    case ENOBUFS:         /* the buffer ring ran dry; stashing refilled it */
+    case ECONNABORTED:    /* that connection is gone */
+    case EPROTO:
+    case EINTR:
+        return 1;
+    default:
+        return 0;
+    }
+}
+
+static int
+_uring_push_fd(UringIO *io, int fd)
+{
+    if (io->nfds == io->fdcap) {
+        size_t cap = io->fdcap ? io->fdcap * 2 : 16;
+        int *fds = realloc(io->fds, cap * sizeof(int));
+        if (!fds)
+            return -1;
+        io->fds = fds;
+        io->fdcap = cap;
+    }
+    io->fds[io->nfds++] = fd;
+    return 0;
+}
+
+/* Report events for io's fd in this wait, merged into one entry. */
+static void
+_uring_emit(PyEventLoopObject *self, UringIO *io, uint32_t events,
+            struct epoll_event *evs, int *out)
+{
+    if (io->ev_seq == self->uring_seq) {
+        evs[io->ev_idx].events |= events;
+        return;
+    }
+    io->ev_seq = self->uring_seq;
+    io->ev_idx = *out;
+    evs[*out].events = events;
+    evs[(*out)++].data.u32 = (uint32_t)io->fd;
+}
+
+/*
+ * Book one accept/recv/send completion without running Python code:
+ * accepted fds and received bytes are stashed in io, a send's bytes are
+ * dropped from the write queue and the next send is queued.  The fd then
+ * reports EPOLLIN or EPOLLOUT so run_forever schedules its reader or
+ * finishes the write side as on epoll.
+ */
+static int
+_uring_complete(PyEventLoopObject *self, const struct io_uring_cqe *cqe,
+                struct epoll_event *evs, int *out)
+{
+    UringIO *io = _uring_op_io(cqe->user_data);
+    int res = cqe->res;
+    FDCallback *slot = io->orphan ? NULL : self->fdmap[io->fd];
+    if ((cqe->user_data & 3) == URING_OP_SEND) {
+        io->sending = 0;
+        _uring_send_release(io);
+        if (slot) {
+            if (res < 0) {
+                io->send_err = -res;
+            } else {
+                self->stats.bytes_sent += (uint64_t)res;
+                _outbuf_consume(slot->obuf, res);
+                if (_uring_send(self, slot) < 0)
+                    io->send_err = errno;
+            }
+            /* run_forever only has work for a failure, flow control, a
+             * pending close, or a segment the send left to readiness */
+            OutBuf *ob = slot->obuf;
+            if (io->send_err || ob->paused || slot->close_pending ||
+                (!io->sending && ob->nbytes))
+                _uring_emit(self, io, EPOLLOUT, evs, out);
+        }
+    } else {
+        if (!(cqe->flags & IORING_CQE_F_MORE))
+            io->armed = io->cancelling = 0;
+        int news = 0;
+        if (cqe->flags & IORING_CQE_F_BUFFER) {
+            unsigned bid = cqe->flags >> IORING_CQE_BUFFER_SHIFT;
+            if (slot && res > 0) {
+                self->stats.ring_recvs++;
+                if (_uring_stash(self, io, uring_buf(self->uring, bid), (size_t)res) < 0)
+                    io->err = ENOMEM;
+                news = 1;
+            }
+            uring_buf_return(self->uring, bid);
+        }
+        if (io->accept && res >= 0) {
+            if (slot && slot->reader && _uring_push_fd(io, res) == 0) {
+                self->stats.ring_accepts++;
+                news = 1;
+            } else {
+                close(res);   /* accepted while being cancelled, or no room */
+            }
+        } else if (slot && res == 0) {
+            io->eof = 1;
+            news = 1;
+        } else if (slot && res < 0 && !_uring_transient(-res)) {
+            io->err = -res;
+            news = 1;
+        }
+        if (slot && news)
+            _uring_emit(self, io, EPOLLIN, evs, out);
+        if (slot && !io->armed && _uring_io_arm(self, slot) < 0)
+            return -1;
+    }
+    if (io->orphan && !io->armed && !io->sending)
+        _uring_io_free(self, io);
+    return 0;
+}
+
+/*
+ * io_uring wait: submit queued poll changes and operations, and collect
+ * completions as epoll events so run_forever dispatches both backends the
+ * same way.  Completions from replaced polls are dropped, and a poll the
+ * kernel terminated (no IORING_CQE_F_MORE) is re-armed while still wanted.
+ */
+static int
+_uring_collect(PyEventLoopObject *self, struct epoll_event *evs, int max,
+               int64_t timeout_ns)
+{
+    struct io_uring_cqe cqes[64];
+    int out = 0;
+    self->uring_seq++;
+    for (;;) {
+        int want = max - out < 64 ? max - out : 64;
+        int n;
+        Py_BEGIN_ALLOW_THREADS
+        n = uring_wait(self->uring, timeout_ns, cqes, want);
+        Py_END_ALLOW_THREADS
+        if (n < 0)
+            return -1;
+        for (int i = 0; i < n; i++) {
+            struct io_uring_cqe *cqe = &cqes[i];
+            if (cqe->user_data == URING_IGNORE)
+                continue;
+            if (cqe->user_data & URING_OP_TAG) {
+                if (_uring_complete(self, cqe, evs, &out) < 0)
+                    return -1;
+                continue;
+            }
+            int fd = (int)(uint32_t)cqe->user_data;
+            uint32_t gen = (uint32_t)(cqe->user_data >> 32);
+            int more = cqe->flags & IORING_CQE_F_MORE;
+            if (gen == 0) {
+                /* internal fd: keep it watched for the loop's lifetime */
+                if (!more && cqe->res != -ECANCELED &&
+                    uring_poll_add(self->uring, fd, EPOLLIN, cqe->user_data) < 0)
+                    return -1;
+                if (cqe->res > 0) {
+                    evs[out].events = EPOLLIN;
+                    evs[out++].data.u32 = (uint32_t)fd;
+                }
+                continue;
+            }
+            FDCallback *slot = fd < self->fdcap ? self->fdmap[fd] : NULL;
+            if (!slot || slot->poll_gen != gen || !slot->registered)
+                continue;
+            if (cqe->res < 0) {
+                /* the fd could not be polled; forget the registration */
+                slot->registered = 0;
+                continue;
+            }
+            if (!more) {
+                _poll_gen_next(slot);
+                if (uring_poll_add(self->uring, fd, EPOLLET | slot->registered,
+                                   _uring_ud(fd, slot->poll_gen)) < 0)
+                    return -1;
+            }
+            evs[out].events = (uint32_t)cqe->res;
+            evs[out++].data.u32 = (uint32_t)fd;
+        }
+        /* a full batch may have left more completions in the ring */
+        if (n < want || out >= max)
+            return out;
+        timeout_ns = 0;
+    }
+}
+
+/*
+ * Loop teardown: cancel every operation and give the kernel up to a second
+ * to finish with the buffers they point into.  -1 if some are still in
+ * flight; the ring and that memory must then be leaked, not freed.
+ */
+static int
+_uring_io_shutdown(PyEventLoopObject *self)
+{
+    UringIO *io = self->uios;
+    while (io) {
+        UringIO *next = io->next;
+        io->orphan = 1;
+        if (!io->armed && !io->sending)
+            _uring_io_free(self, io);
+        io = next;
+    }
+    if (!self->uios || uring_cancel(self->uring, 0) < 0)
+        return self->uios ? -1 : 0;
+
+    struct io_uring_cqe cqes[64];
+    for (int tries = 0; self->uios && tries < 100; tries++) {
+        int n = uring_wait(self->uring, 10000000, cqes, 64);
+        if (n < 0)
+            break;
+        for (int i = 0; i < n; i++) {
+            /* orphans touch neither the events nor the ring's SQEs */
+            if (cqes[i].user_data != URING_IGNORE && (cqes[i].user_data & URING_OP_TAG))
+                (void)_uring_complete(self, &cqes[i], NULL, NULL);
+        }
+    }
+    return self->uios ? -1 : 0;
+}
+
+/* One wait on either backend into ea; -1 with errno set on failure. */
+static int
+_wait_events(PyEventLoopObject *self, EventArray *ea, int timeout_ms, int64_t timeout_ns)
+{
+    if (self->uring)
+        return _uring_collect(self, ea->evs, ea->cap, timeout_ns);
+    int n;
+    Py_BEGIN_ALLOW_THREADS
+    n = epoll_wait(self->epfd, ea->evs, ea->cap, timeout_ms);
+    Py_END_ALLOW_THREADS
+    if (n == -1 && errno == EINTR)
+        n = 0;
+    return n;
+}
+
+/*
+ * Busy-poll: zero-timeout waits until something is ready, the budget is
+ * spent or the next timer is due, so a message arriving meanwhile skips
+ * the sleep and wakeup of a blocking wait.  *spent gets the time spun.
+ */
+static int
+_busy_poll(PyEventLoopObject *self, EventArray *ea, int64_t timeout_ns, int64_t *spent)
+{
+    int64_t start = _monotonic_ns(), now;
+    int64_t budget = self->busy_poll_ns;
+    if (timeout_ns >= 0 && timeout_ns < budget)
+        budget = timeout_ns;
+    int n;
+    self->stats.busy_polls++;
+    do {
+        n = _wait_events(self, ea, 0, 0);
+        now = _monotonic_ns();
+    } while (n == 0 && now - start < budget);
+    *spent = now - start;
+    if (n > 0)
+        self->stats.busy_poll_hits++;
+    return n;
+}
+
+/* Size the event array for the load the last wait saw; keep it on ENOMEM. */
+static void
+_events_adapt(PyEventLoopObject *self, EventArray *ea, int n)
+{
+    int cap = ea->cap;
+    if (n >= cap && cap < EVENTS_MAX) {
+        cap *= 2;
+    } else if (n < cap / 4 && cap > EVENTS_MIN) {
+        if (++ea->quiet < EVENTS_SHRINK_WAITS)
+            return;
+        cap /= 2;
+    } else {
+        ea->quiet = 0;
+        return;
+    }
+    ea->quiet = 0;
+    struct epoll_event *evs = realloc(ea->evs, (size_t)cap * sizeof(*evs));
+    if (!evs)
+        return;
+    ea->evs = evs;
+    ea->cap = cap;
+    self->events_cap = cap;
+}
+
+static PyObject *logging_getLogger;
+static PyObject *casyncio_logger;
+
+/* Account one timed callback; slow ones are logged with their callable. */
+static int
+_stats_callback_done(PyEventLoopObject *self, PyObject *callback, int64_t t0)
+{
+    uint64_t ns = (uint64_t)(_monotonic_ns() - t0);
+    int bucket = ns < 1000 ? 0 : 64 - __builtin_clzll(ns / 1000);
+    if (bucket >= STATS_HIST_BUCKETS)
+        bucket = STATS_HIST_BUCKETS - 1;
+    self->stats.cb_hist[bucket]++;
+    if (!self->slow_cb_ns || (int64_t)ns < self->slow_cb_ns)
+        return 0;
+    self->stats.slow_callbacks++;
+    /* name what actually ran, not the handle wrapped around it */
+    PyObject *what = callback;
+    if (_is_handle(callback) && ((PyHandleObject *)callback)->callback)
+        what = ((PyHandleObject *)callback)->callback;
+    double secs = (double)ns / 1e9;
+    Py_XSETREF(self->last_slow, Py_BuildValue("(Od)", what, secs));
+    if (!self->last_slow)
+        return -1;
+    if (!casyncio_logger) {
+        PyObject *get_logger = _module_attr(&logging_getLogger, "logging", "getLogger");
+        if (!get_logger || !(casyncio_logger = PyObject_CallFunction(get_logger, "s", "casyncio")))
+            return -1;
+    }
+    PyObject *res = PyObject_CallMethod(casyncio_logger, "warning", "sOd",
+                                        "Executing %r took %.3f seconds", what, secs);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    return 0;
+}
+
+static PyObject *
+_run_loop(PyEventLoopObject *self, EventArray *ea)
+{
+    self->running = 1;
+
+    while (self->running) {
+        PyObject *callback;
+        if (__atomic_load_n(&self->xq_top, __ATOMIC_ACQUIRE) && _xq_drain(self) < 0)
+            return NULL;
+        if (self->pool && pool_has_done(self->pool) && _pool_drain(self) < 0)
+            return NULL;
+        self->stats.iterations++;
+        while ((callback = _ready_pop(self))) {
+            int is_handle = _is_handle(callback);
+            if (is_handle && ((PyHandleObject *)callback)->canceled) {
+                Py_DECREF(callback);
+                continue;
+            }
+            self->stats.callbacks++;
+            int64_t t0 = self->cb_timing ? _monotonic_ns() : 0;
+            int rc;
+            if (PyObject_TypeCheck(callback, &PyFuture_Type)) {
+                /* a task step or a done future's callbacks */
+                rc = _fut_ready(callback);
+            } else if (is_handle) {
+                rc = _handle_run((PyHandleObject *)callback);
+            } else {
+                PyObject *res = PyObject_CallNoArgs(callback);
+                rc = res ? 0 : -1;
+                Py_XDECREF(res);
+            }
+            if (t0 && rc == 0)
+                rc = _stats_callback_done(self, callback, t0);
+            Py_DECREF(callback);
+            if (rc < 0)
+                return NULL;
+        }
+
+        if (!self->running)
+            break;
+
+        int have_watchers = self->pool_inflight > 0;
+        for (int i = 0; !have_watchers && i < self->fdcap; i++) {
+            FDCallback *s = self->fdmap[i];
+            if (s && (s->reader || s->writer || s->close_pending)) {
+                have_watchers = 1;
+                break;
+            }
+        }
+        if (!have_watchers)
+            break;
+
+        int n;
+        int timeout_ms = -1;
+        int64_t timeout_ns = -1;
+        TimerNode *next = _heap_peek(self);
+        if (next) {
+            int64_t wake_ns = _timer_wake_ns(self, next->deadline_ns);
+            int64_t diff_ns = wake_ns - _monotonic_ns();
+            timeout_ns = diff_ns > 0 ? diff_ns : 0;
+            if (diff_ns <= 0) {
+                timeout_ms = 0;
+            } else if (self->tfd != -1) {
+                /* nanosecond deadline; epoll_wait blocks until the timerfd fires */
+                if (_timerfd_arm(self, wake_ns) < 0) {
+                    return NULL;
+                }
+            } else {
+                /* round up: truncating would spin at 0 or wake early */
+                int64_t ms = (diff_ns + 999999) / 1000000;
+                timeout_ms = ms > INT_MAX ? INT_MAX : (int)ms;
+            }
+        } else if (self->tfd != -1 && self->tfd_armed_ns) {
+            if (_timerfd_arm(self, 0) < 0) {
+                return NULL;
+            }
+        }
+        if (self->ndirty && _flush_interest(self) < 0) {
+            return NULL;
+        }
+        int blocking = self->uring ? timeout_ns != 0 : timeout_ms != 0;
+        if (blocking) {
+            /* pairs with a producer's push-then-exchange: one side sees the other */
+            __atomic_store_n(&self->xq_sleeping, 1, __ATOMIC_SEQ_CST);
+            if (__atomic_load_n(&self->xq_top, __ATOMIC_SEQ_CST) ||
+                (self->pool && pool_has_done(self->pool)))
+                timeout_ms = timeout_ns = 0;
+        }
+        int64_t wait_start = _monotonic_ns();
+        int64_t spun = 0;
+        n = blocking && self->busy_poll_ns > 0 ? _busy_poll(self, ea, timeout_ns, &spun) : 0;
+        if (n == 0) {
+            if (spun > 0 && timeout_ns >= 0) {
+                /* sleep only for what the spin left of the timeout */
+                timeout_ns = timeout_ns > spun ? timeout_ns - spun : 0;
+                if (timeout_ms > 0)
+                    timeout_ms = (int)((timeout_ns + 999999) / 1000000);
+            }
+            n = _wait_events(self, ea, timeout_ms, timeout_ns);
+        }
+        self->stats.wait_ns += (uint64_t)(_monotonic_ns() - wait_start);
+        self->stats.waits++;
+        if (n > 0) {
+            self->stats.wait_events += (uint64_t)n;
+            if ((uint64_t)n > self->stats.wait_events_max)
+                self->stats.wait_events_max = (uint64_t)n;
+        }
+        if (blocking)
+            __atomic_store_n(&self->xq_sleeping, 0, __ATOMIC_SEQ_CST);
+        if (n == -1) {
+            PyErr_SetFromErrno(PyExc_OSError);
+            return NULL;
+        }
+
+        for (int i = 0; i < n; i++) {
+            int fd = (int)ea->evs[i].data.u32;
+            if (fd == self->sfd) {
+                struct signalfd_siginfo si;
+                while (read(self->sfd, &si, sizeof(si)) == sizeof(si)) {
+                    PyObject *key = PyLong_FromLong((long)si.ssi_signo);
+                    PyObject *cb = PyDict_GetItemWithError(self->signal_handlers, key);
+                    Py_DECREF(key);
+                    if (cb) {
+                        if (_ready_push(self, cb) < 0)
+                            return NULL;
+                    } else if (PyErr_Occurred()) {
+                        return NULL;
+                    }
+                }
+                continue;
+            }
+            if (fd == self->tfd) {
+                uint64_t expirations;
+                if (read(self->tfd, &expirations, sizeof(expirations)) > 0)
+                    self->tfd_armed_ns = 0;
+                continue;
+            }
+            if (fd == self->efd) {
+                /* the submissions themselves are drained at the top of the loop */
+                eventfd_t count;
+                (void)eventfd_read(self->efd, &count);
+                continue;
+            }
+            if (fd >= self->fdcap)
+                continue;
+            FDCallback *slot = self->fdmap[fd];
+            if (!slot)
+                continue;
+            uint32_t events = ea->evs[i].events;
+            int reaped = 0;
+            if ((events & EPOLLERR) && slot->obuf && slot->obuf->zc_count) {
+                reaped = _outbuf_reap_zerocopy(slot->obuf, fd);
+                /* completions, not a socket error: nothing for the reader */
+                if (reaped && !(events & (EPOLLIN | EPOLLHUP)))
+                    events &= ~EPOLLERR;
+            }
+            /* a pipe whose writer is gone reports EPOLLHUP alone, not EPOLLIN */
+            if ((events & (EPOLLIN | EPOLLHUP | EPOLLERR)) && slot->reader) {
+                if (slot->read_paused)
+                    slot->read_missed = 1;  /* edge seen before EPOLLIN was dropped */
+                else if (_ready_push(self, slot->reader) < 0)
+                    return NULL;
+            }
+            /* a full pipe whose reader is gone reports EPOLLERR alone */
+            int writable = (events & (EPOLLOUT | EPOLLERR | EPOLLHUP)) != 0;
+            if (writable || reaped) {
+                if (slot->obuf && (slot->obuf->nbytes || reaped || slot->uio)) {
+                    /* a uio's plain segments go by SENDMSG, the rest as on epoll */
+                    int r = slot->uio ? _uring_send(self, slot) : 0;
+                    if (r == 0 && slot->obuf->nbytes)
+                        r = socket_write_now(fd, slot->obuf);
+                    if (slot->close_pending && (r == -1 || !_outbuf_pending(slot->obuf))) {
+                        /* closing anyway: a failed final flush is not an error */
+                        PyObject *owner = Py_XNewRef(slot->owner);
+                        int rc = _fd_close(self, fd);
+                        if (owner) {
+                            if (rc == 0)
+                                rc = _tr_closed(owner, NULL);
+                            Py_DECREF(owner);
+                        }
+                        if (rc < 0)
+                            return NULL;
+                        continue;
+                    }
+                    if (r == -1) {
+                        PyErr_SetFromErrno(PyExc_OSError);
+                        if (!slot->owner)
+                            return NULL;
+                        /* a transport's write failure is its own, not the loop's */
+                        PyObject *exc = _fetch_exception();
+                        PyObject *owner = Py_NewRef(slot->owner);
+                        int rc = _tr_fatal(owner, exc);
+                        Py_DECREF(owner);
+                        Py_DECREF(exc);
+                        if (rc < 0)
+                            return NULL;
+                        continue;
+                    }
+                    if (_outbuf_flow(slot->obuf) < 0)
+                        return NULL;
+                    if ((slot->uio || !slot->obuf->nbytes) && _fd_interest(self, fd, slot) < 0)
+                        return NULL;
+                }
+                if (slot->writer && writable) {
+                    if (_ready_push(self, slot->writer) < 0)
+                        return NULL;
+                }
+            }
+        }
+        _events_adapt(self, ea, n);
+
+        /* handle expired timers */
+        int64_t now_ns = _monotonic_ns();
+        while ((next = _heap_peek(self)) && next->deadline_ns <= now_ns) {
+            TimerNode *expired = _heap_pop(self);
+            if (expired->base.canceled) {
+                Py_DECREF(expired);
+                continue;
+            }
+            self->stats.timers_fired++;
+            if (_ready_push(self, (PyObject *)expired) < 0) {
+                Py_DECREF(expired);
+                return NULL;
+            }
+            Py_DECREF(expired);
+        }
+    }
+
+    self->running = 0;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+_run_forever(PyEventLoopObject *self)
+{
+    /* a nested run gets its own array, not the one its caller is dispatching */
+    EventArray ea = self->events;
+    self->events = (EventArray){NULL, 0, 0};
+    if (!ea.evs) {
+        ea.cap = self->events_cap;
+        ea.evs = malloc((size_t)ea.cap * sizeof(*ea.evs));
+        if (!ea.evs)
+            return PyErr_NoMemory();
+    }
+    PyObject *res = _run_loop(self, &ea);
+    if (!res)
+        self->running = 0;  /* a raising callback must not leave close() refused */
+    if (self->events.evs)
+        free(ea.evs);
+    else
+        self->events = ea;
+    return res;
+}
+
+/*
+ * Run as asyncio's running loop so coroutines in tasks can find it through
+ * get_running_loop(), restoring whatever was registered before.
+ */
+static PyObject *
+loop_run_forever(PyEventLoopObject *self, PyObject *Py_UNUSED(ignored))
+{
+    PyObject *get_running = _asyncio_attr(&asyncio_get_running_loop, "_get_running_loop");
+    PyObject *set_running = _asyncio_attr(&asyncio_set_running_loop, "_set_running_loop");
+    if (!get_running || !set_running)
+        return NULL;
+    PyObject *prev = PyObject_CallNoArgs(get_running);
+    if (!prev)
+        return NULL;
+    PyObject *res = PyObject_CallOneArg(set_running, (PyObject *)self);
+    if (!res) {
+        Py_DECREF(prev);
+        return NULL;
+    }
+    Py_DECREF(res);
+    PyObject *ret = _run_forever(self);
+    PyObject *type, *value, *tb;
+    PyErr_Fetch(&type, &value, &tb);
+    res = PyObject_CallOneArg(set_running, prev);
+    Py_DECREF(prev);
+    if (!res) {
+        Py_XDECREF(ret);
+        Py_XDECREF(type);
+        Py_XDECREF(value);
+        Py_XDECREF(tb);
+        return NULL;
+    }
+    Py_DECREF(res);
+    PyErr_Restore(type, value, tb);
+    return ret;
+}
+
+static int
+_stats_set(PyObject *d, const char *key, PyObject *v)
+{
+    if (!v)
+        return -1;
+    int r = PyDict_SetItemString(d, key, v);
+    Py_DECREF(v);
+    return r;
+}
+
+static PyObject *
+loop_stats(PyEventLoopObject *self, PyObject *Py_UNUSED(ignored))
+{
+    const LoopStats *st = &self->stats;
+    Py_ssize_t buffered = 0;
+    for (int i = 0; i < self->fdcap; i++)
+        if (self->fdmap[i] && self->fdmap[i]->obuf)
+            buffered += _outbuf_pending(self->fdmap[i]->obuf);
+    PyObject *d = PyDict_New();
+    if (!d)
+        return NULL;
+    struct { const char *key; uint64_t v; } counters[] = {
+        {"iterations", st->iterations},
+        {"callbacks", st->callbacks},
+        {"ready", self->ready_q.count},
+        {"ready_high_water", st->ready_high_water},
+        {"waits", st->waits},
+        {"wait_events", st->wait_events},
+        {"wait_events_max", st->wait_events_max},
+        {"timers", self->timer_count},
+        {"timers_armed", st->timers_armed},
+        {"timers_fired", st->timers_fired},
+        {"timers_cancelled", st->timers_cancelled},
+        {"bytes_sent", st->bytes_sent},
+        {"write_eagain", st->write_eagain},
+        {"read_eagain", st->read_eagain},
+        {"write_buffered", (uint64_t)buffered},
+        {"slow_callbacks", st->slow_callbacks},
+        {"datagrams_received", st->datagrams_received},
+        {"datagrams_sent", st->datagrams_sent},
+        {"dgram_syscalls", st->dgram_syscalls},
+        {"zerocopy_sends", st->zerocopy_sends},
+        {"zerocopy_copied", st->zerocopy_copied},
+        {"interest_updates", st->interest_updates},
+        {"busy_polls", st->busy_polls},
+        {"busy_poll_hits", st->busy_poll_hits},
+        {"ring_accepts", st->ring_accepts},
+        {"ring_recvs", st->ring_recvs},
+        {"ring_sends", st->ring_sends},
+        {"event_array", (uint64_t)self->events_cap},
+    };
+    for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++)
+        if (_stats_set(d, counters[i].key, PyLong_FromUnsignedLongLong(counters[i].v)) < 0)
+            goto error;
+    if (_stats_set(d, "wait_time", PyFloat_FromDouble((double)st->wait_ns / 1e9)) < 0)
+        goto error;
+    /* {upper bound in seconds: count}, nonzero buckets only; inf for the last */
+    PyObject *hist = PyDict_New();
+    if (_stats_set(d, "callback_time", hist) < 0)
+        goto error;
+    for (int b = 0; b < STATS_HIST_BUCKETS; b++) {
+        if (!st->cb_hist[b])
+            continue;
+        double bound = b == STATS_HIST_BUCKETS - 1 ? Py_HUGE_VAL : (double)(1ULL << b) * 1e-6;
+        PyObject *k = PyFloat_FromDouble(bound);
+        PyObject *v = PyLong_FromUnsignedLongLong(st->cb_hist[b]);
+        int r = k && v ? PyDict_SetItem(hist, k, v) : -1;
+        Py_XDECREF(k);
+        Py_XDECREF(v);
+        if (r < 0)
+            goto error;
+    }
+    if (PyDict_SetItemString(d, "last_slow_callback", self->last_slow ? self->last_slow : Py_None) < 0)
+        goto error;
+    return d;
+error:
+    Py_DECREF(d);
+    return NULL;
+}
+
+static PyObject *
+loop_reset_stats(PyEventLoopObject *self, PyObject *Py_UNUSED(ignored))
+{
+    memset(&self->stats, 0, sizeof(self->stats));
+    Py_CLEAR(self->last_slow);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+loop_freelist_stats(PyEventLoopObject *self, PyObject *Py_UNUSED(ignored))
+{
+    const BufPool *bp = &self->bufpool;
+    uint64_t slabs = 0;
+    for (FDSlab *s = self->fd_slabs; s; s = s->next)
+        slabs++;
+    PyObject *d = PyDict_New();
+    if (!d)
+        return NULL;
+    struct { const char *key; uint64_t v; } counters[] = {
+        {"buffer_bytes_in_use", bp->in_use},
+        {"buffer_bytes_retained", bp->retained},
+        {"buffer_limit", bp->limit},
+        {"buffer_hits", bp->hits},
+        {"buffer_misses", bp->misses},
+        {"outbufs_retained", self->outbuf_nfree},
+        {"outbuf_limit", self->outbuf_limit},
+        {"outbuf_hits", self->outbuf_hits},
+        {"outbuf_misses", self->outbuf_misses},
+        {"fd_slots", slabs * FDSLAB_SLOTS},
+        {"handles_retained", (uint64_t)handle_freelist.count},
+        {"timer_handles_retained", (uint64_t)timer_freelist.count},
+        {"handle_limit", (uint64_t)handle_freelist_limit},
+    };
+    for (size_t i = 0; i < sizeof(counters) / sizeof(counters[0]); i++)
+        if (_stats_set(d, counters[i].key, PyLong_FromUnsignedLongLong(counters[i].v)) < 0)
+            goto error;
+    /* {class size: free buffers}, nonempty classes only */
+    PyObject *classes = PyDict_New();
+    if (_stats_set(d, "buffer_classes", classes) < 0)
+        goto error;
+    for (int c = 0; c < BUFPOOL_CLASSES; c++) {
+        if (!bp->nfree[c])
+            continue;
+        PyObject *k = PyLong_FromSize_t((size_t)1 << (BUFPOOL_MIN_SHIFT + c));
+        PyObject *v = PyLong_FromSize_t(bp->nfree[c]);
+        int r = k && v ? PyDict_SetItem(classes, k, v) : -1;
+        Py_XDECREF(k);
+        Py_XDECREF(v);
+        if (r < 0)
+            goto error;
+    }
+    return d;
+error:
+    Py_DECREF(d);
+    return NULL;
+}
+
+/* Parse a limit into *out; None leaves it unchanged.  -1 on error. */
+static int
+_freelist_limit(PyObject *o, Py_ssize_t *out)
+{
+    if (o == Py_None)
+        return 0;
+    Py_ssize_t v = PyLong_AsSsize_t(o);
+    if (v == -1 && PyErr_Occurred())
+        return -1;
+    if (v < 0) {
+        PyErr_SetString(PyExc_ValueError, "freelist limits must be >= 0");
+        return -1;
+    }
+    *out = v;
+    return 0;
+}
+
+/*
+ * set_freelist_limits(buffer_bytes=None, outbufs=None, handles=None):
+ * how much the loop keeps for reuse, trimming at once.  handles applies
+ * to every loop in the process.
+ */
+static PyObject *
+loop_set_freelist_limits(PyEventLoopObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *buffers_o = Py_None, *outbufs_o = Py_None, *handles_o = Py_None;
+    static char *kwlist[] = {"buffer_bytes", "outbufs", "handles", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OOO:set_freelist_limits", kwlist,
+                                     &buffers_o, &outbufs_o, &handles_o))
+        return NULL;
+    Py_ssize_t buffers = (Py_ssize_t)self->bufpool.limit;
+    Py_ssize_t outbufs = (Py_ssize_t)self->outbuf_limit;
+    Py_ssize_t handles = handle_freelist_limit;
+    if (_freelist_limit(buffers_o, &buffers) < 0 || _freelist_limit(outbufs_o, &outbufs) < 0 ||
+        _freelist_limit(handles_o, &handles) < 0)
+        return NULL;
+    self->bufpool.limit = (size_t)buffers;
+    bufpool_trim(&self->bufpool);
+    self->outbuf_limit = (size_t)outbufs;
+    while (self->outbuf_nfree > self->outbuf_limit) {
+        OutBuf *ob = self->outbuf_free;
+        self->outbuf_free = ob->next_free;
+        self->outbuf_nfree--;
+        _outbuf_free(ob);
+    }
+    handle_freelist_limit = handles;
+    _handle_freelist_trim(&handle_freelist);
+    _handle_freelist_trim(&timer_freelist);
+    Py_RETURN_NONE;
+}
+
+#ifndef EPIOCSPARAMS
+/* <linux/eventpoll.h> from Linux 6.9 */
+struct epoll_params {
+    uint32_t busy_poll_usecs;
+    uint16_t busy_poll_budget;
+    uint8_t prefer_busy_poll;
+    uint8_t __pad;
+};
+#define EPIOCSPARAMS _IOW(0x8A, 0x01, struct epoll_params)
+#endif
+
+/*
+ * set_napi_busy_poll(usecs, budget=8, prefer=False): have the kernel poll
+ * the NIC queues of the loop's sockets inside epoll_wait() (Linux 6.9+).
+ * Returns False where the backend or kernel has no such setting.
+ */
+static PyObject *
+loop_set_napi_busy_poll(PyEventLoopObject *self, PyObject *args, PyObject *kwds)
+{
+    unsigned int usecs;
+    unsigned short budget = 8;
+    int prefer = 0;
+    static char *kwlist[] = {"usecs", "budget", "prefer", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "I|Hp:set_napi_busy_poll", kwlist,
+                                     &usecs, &budget, &prefer))
+        return NULL;
+    if (usecs > INT_MAX) {
+        PyErr_SetString(PyExc_ValueError, "usecs is too large");
+        return NULL;
+    }
+    if (self->epfd == -1)
+        Py_RETURN_FALSE;
+    struct epoll_params params = {
+        .busy_poll_usecs = usecs,
+        .busy_poll_budget = budget,
+        .prefer_busy_poll = (uint8_t)prefer,
+    };
+    if (ioctl(self->epfd, EPIOCSPARAMS, &params) < 0) {
+        if (errno == ENOTTY)
+            Py_RETURN_FALSE;
+        /* EPERM: budgets above 64 need CAP_NET_ADMIN */
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+    Py_RETURN_TRUE;
+}
+
+static PyObject *
+loop_close(PyEventLoopObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->running) {
+        PyErr_SetString(PyExc_RuntimeError, "Cannot close a running event loop");
+        return NULL;
+    }
+    _pool_shutdown(self);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+loop_get_debug(PyEventLoopObject *self, PyObject *Py_UNUSED(ignored))
+{
+    Py_RETURN_FALSE;
+}
+
+static PyObject *
+loop_stop(PyEventLoopObject *self, PyObject *Py_UNUSED(ignored))
+{
+    self->running = 0;
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef loop_methods[] = {
+    {"call_soon", (PyCFunction)(void (*)(void))loop_call_soon,
+     METH_FASTCALL | METH_KEYWORDS,
+     PyDoc_STR("call_soon(callback, *args, context=None): run callback(*args) soon")},
+    {"call_soon_threadsafe", (PyCFunction)(void (*)(void))loop_call_soon_threadsafe,
+     METH_FASTCALL | METH_KEYWORDS,
+     PyDoc_STR("Thread-safe variant of call_soon")},
+    {"call_later", (PyCFunction)(void (*)(void))loop_call_later,
+     METH_FASTCALL | METH_KEYWORDS,
+     PyDoc_STR("call_later(delay, callback, *args, context=None)")},
+    {"call_at", (PyCFunction)(void (*)(void))loop_call_at,
+     METH_FASTCALL | METH_KEYWORDS,
+     PyDoc_STR("call_at(when, callback, *args, context=None)")},
+    {"time", (PyCFunction)loop_time, METH_NOARGS,
+     PyDoc_STR("Return the loop's monotonic clock in seconds")},
+    {"create_future", (PyCFunction)loop_create_future, METH_NOARGS,
+     PyDoc_STR("Create a Future bound to the loop")},
+    {"create_task", (PyCFunction)(PyCFunctionWithKeywords)loop_create_task,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Wrap a coroutine in a Task; eager tasks run their first step now")},
+    {"run_in_pool", (PyCFunction)loop_run_in_pool, METH_VARARGS,
+     PyDoc_STR("Call func(*args) on a pool thread; return a Future")},
+    {"pool_pread", (PyCFunction)loop_pool_pread, METH_VARARGS,
+     PyDoc_STR("pread(fd, n, offset) on a pool thread, without the GIL")},
+    {"pool_pwrite", (PyCFunction)loop_pool_pwrite, METH_VARARGS,
+     PyDoc_STR("pwrite(fd, data, offset) on a pool thread, without the GIL")},
+    {"pool_fsync", (PyCFunction)loop_pool_fsync, METH_O,
+     PyDoc_STR("fsync(fd) on a pool thread, without the GIL")},
+    {"pool_stat", (PyCFunction)loop_pool_stat, METH_O,
+     PyDoc_STR("stat(path) or fstat(fd) on a pool thread, without the GIL")},
+    {"getaddrinfo", (PyCFunction)(PyCFunctionWithKeywords)loop_getaddrinfo,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("getaddrinfo() on a pool thread; return a Future of the address list")},
+    {"add_reader", (PyCFunction)loop_add_reader, METH_VARARGS,
+     PyDoc_STR("Register a reader callback for a file descriptor")},
+    {"remove_reader", (PyCFunction)loop_remove_reader, METH_O,
+     PyDoc_STR("Remove reader callback for a file descriptor")},
+    {"add_writer", (PyCFunction)loop_add_writer, METH_VARARGS,
+     PyDoc_STR("Register a writer callback for a file descriptor")},
+    {"remove_writer", (PyCFunction)loop_remove_writer, METH_O,
+     PyDoc_STR("Remove writer callback for a file descriptor")},
+    {"add_signal_handler", (PyCFunction)loop_add_signal_handler, METH_VARARGS,
+     PyDoc_STR("Register a callback for a signal")},
+    {"remove_signal_handler", (PyCFunction)loop_remove_signal_handler, METH_O,
+     PyDoc_STR("Remove the callback for a signal")},
+    {"_c_write", (PyCFunction)loop_c_write, METH_VARARGS,
+     PyDoc_STR("Low level write with buffering")},
+    {"_c_writelines", (PyCFunction)loop_c_writelines, METH_VARARGS,
+     PyDoc_STR("Low level vectored write of several buffers")},
+    {"sendfile", (PyCFunction)(PyCFunctionWithKeywords)loop_sendfile,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Queue count bytes of file_fd for fd with sendfile(); return a Future")},
+    {"_c_drain_waiter", (PyCFunction)loop_c_drain_waiter, METH_O,
+     PyDoc_STR("Return Future resolved once the buffer is below the low mark")},
+    {"_c_close", (PyCFunction)loop_c_close, METH_O,
+     PyDoc_STR("Close a file descriptor once its write buffer is flushed")},
+    {"_set_write_buffer_limits", (PyCFunction)(PyCFunctionWithKeywords)loop_set_write_buffer_limits,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Set the high/low write watermarks for a file descriptor")},
+    {"_get_write_buffer_size", (PyCFunction)loop_get_write_buffer_size, METH_O,
+     PyDoc_STR("Return the number of unsent or uncompleted bytes queued for a file descriptor")},
+    {"_set_zerocopy", (PyCFunction)loop_set_zerocopy, METH_VARARGS,
+     PyDoc_STR("Send large queued writes on a file descriptor with MSG_ZEROCOPY")},
+    {"_set_write_protocol", (PyCFunction)loop_set_write_protocol, METH_VARARGS,
+     PyDoc_STR("Set the protocol told to pause_writing()/resume_writing()")},
+    {"_pause_reading", (PyCFunction)loop_pause_reading, METH_O,
+     PyDoc_STR("Stop polling a file descriptor for reading")},
+    {"_resume_reading", (PyCFunction)loop_resume_reading, METH_O,
+     PyDoc_STR("Resume polling a file descriptor for reading")},
+    {"run_forever", (PyCFunction)loop_run_forever, METH_NOARGS,
+     PyDoc_STR("Run callbacks until queue is empty")},
+    {"stop", (PyCFunction)loop_stop, METH_NOARGS,
+     PyDoc_STR("Stop the running loop")},
+    {"stats", (PyCFunction)loop_stats, METH_NOARGS,
+     PyDoc_STR("Return a dict of loop counters and the callback time histogram")},
+    {"reset_stats", (PyCFunction)loop_reset_stats, METH_NOARGS,
+     PyDoc_STR("Zero every counter")},
+    {"freelist_stats", (PyCFunction)loop_freelist_stats, METH_NOARGS,
+     PyDoc_STR("Return a dict describing what the loop's freelists hold")},
+    {"set_freelist_limits", (PyCFunction)(PyCFunctionWithKeywords)loop_set_freelist_limits,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Set how many bytes, write queues and handles are kept for reuse")},
+    {"set_napi_busy_poll", (PyCFunction)(PyCFunctionWithKeywords)loop_set_napi_busy_poll,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Set the kernel's NAPI busy-poll parameters for epoll_wait()")},
+    {"close", (PyCFunction)loop_close, METH_NOARGS,
+     PyDoc_STR("Join the worker pool; futures of jobs not yet delivered fail")},
+    {"get_debug", (PyCFunction)loop_get_debug, METH_NOARGS,
+     PyDoc_STR("Debug mode is not supported; always False")},
+    {NULL, NULL, 0, NULL},
+};
+
+static PyObject *
+loop_get_timer_slack(PyEventLoopObject *self, void *Py_UNUSED(closure))
+{
+    return PyFloat_FromDouble((double)self->timer_slack_ns / 1e9);
+}
+
+static int
+loop_set_timer_slack(PyEventLoopObject *self, PyObject *value, void *Py_UNUSED(closure))
+{
+    if (!value) {
+        PyErr_SetString(PyExc_AttributeError, "cannot delete timer_slack");
+        return -1;
+    }
+    double slack = PyFloat_AsDouble(value);
+    if (slack == -1.0 && PyErr_Occurred())
+        return -1;
+    if (slack < 0.0) {
+        PyErr_SetString(PyExc_ValueError, "timer_slack must be >= 0");
+        return -1;
+    }
+    return _secs_to_ns(slack, "timer_slack", &self->timer_slack_ns);
+}
+
+static PyObject *
+loop_get_busy_poll(PyEventLoopObject *self, void *Py_UNUSED(closure))
+{
+    return PyFloat_FromDouble((double)self->busy_poll_ns / 1e9);
+}
+
+static int
+loop_set_busy_poll(PyEventLoopObject *self, PyObject *value, void *Py_UNUSED(closure))
+{
+    if (!value) {
+        PyErr_SetString(PyExc_AttributeError, "cannot delete busy_poll");
+        return -1;
+    }
+    double secs = PyFloat_AsDouble(value);
+    if (secs == -1.0 && PyErr_Occurred())
+        return -1;
+    if (secs < 0.0) {
+        PyErr_SetString(PyExc_ValueError, "busy_poll must be >= 0");
+        return -1;
+    }
+    return _secs_to_ns(secs, "busy_poll", &self->busy_poll_ns);
+}
+
+static PyObject *
+loop_get_callback_timing(PyEventLoopObject *self, void *Py_UNUSED(closure))
+{
+    return PyBool_FromLong(self->cb_timing);
+}
+
+static int
+loop_set_callback_timing(PyEventLoopObject *self, PyObject *value, void *Py_UNUSED(closure))
+{
+    if (!value) {
+        PyErr_SetString(PyExc_AttributeError, "cannot delete callback_timing");
+        return -1;
+    }
+    int on = PyObject_IsTrue(value);
+    if (on < 0)
+        return -1;
+    if (!on && self->slow_cb_ns) {
+        PyErr_SetString(PyExc_ValueError, "slow_callback_duration needs callback timing");
+        return -1;
+    }
+    self->cb_timing = on;
+    return 0;
+}
+
+static PyObject *
+loop_get_slow_callback_duration(PyEventLoopObject *self, void *Py_UNUSED(closure))
+{
+    if (!self->slow_cb_ns)
+        Py_RETURN_NONE;
+    return PyFloat_FromDouble((double)self->slow_cb_ns / 1e9);
+}
+
+static int
+loop_set_slow_callback_duration(PyEventLoopObject *self, PyObject *value,
+                                void *Py_UNUSED(closure))
+{
+    if (!value) {
+        PyErr_SetString(PyExc_AttributeError, "cannot delete slow_callback_duration");
+        return -1;
+    }
+    double secs = 0.0;
+    if (value != Py_None) {
+        secs = PyFloat_AsDouble(value);
+        if (secs == -1.0 && PyErr_Occurred())
+            return -1;
+        if (secs <= 0.0) {
+            PyErr_SetString(PyExc_ValueError, "slow_callback_duration must be > 0 or None");
+            return -1;
+        }
+    }
+    if (_secs_to_ns(secs, "slow_callback_duration", &self->slow_cb_ns) < 0)
+        return -1;
+    /* detection needs the timing; turning it off again is left to the caller */
+    if (self->slow_cb_ns)
+        self->cb_timing = 1;
+    return 0;
+}
+
+static PyObject *
+loop_get_backend(PyEventLoopObject *self, void *Py_UNUSED(closure))
+{
+    return PyUnicode_FromString(self->uring ? "io_uring" : "epoll");
+}
+
+static PyObject *
+loop_get_eager_tasks(PyEventLoopObject *self, void *Py_UNUSED(closure))
+{
+    return PyBool_FromLong(self->eager_tasks);
+}
+
+static int
+loop_set_eager_tasks(PyEventLoopObject *self, PyObject *value, void *Py_UNUSED(closure))
+{
+    if (!value) {
+        PyErr_SetString(PyExc_AttributeError, "cannot delete eager_tasks");
+        return -1;
+    }
+    int eager = PyObject_IsTrue(value);
+    if (eager < 0)
+        return -1;
+    self->eager_tasks = eager;
+    return 0;
+}
+
+static PyGetSetDef loop_getset[] = {
+    {"backend", (getter)loop_get_backend, NULL,
+     PyDoc_STR("Readiness backend in use: 'epoll' or 'io_uring'"), NULL},
+    {"eager_tasks", (getter)loop_get_eager_tasks, (setter)loop_set_eager_tasks,
+     PyDoc_STR("Whether create_task() runs the first step immediately by default"), NULL},
+    {"timer_slack", (getter)loop_get_timer_slack, (setter)loop_set_timer_slack,
+     PyDoc_STR("Seconds by which timer wakeups may be delayed to coalesce them"), NULL},
+    {"busy_poll", (getter)loop_get_busy_poll, (setter)loop_set_busy_poll,
+     PyDoc_STR("Seconds to spin with zero-timeout waits before blocking; 0 is off"), NULL},
+    {"callback_timing", (getter)loop_get_callback_timing, (setter)loop_set_callback_timing,
+     PyDoc_STR("Whether callback durations feed stats()['callback_time']"), NULL},
+    {"slow_callback_duration", (getter)loop_get_slow_callback_duration,
+     (setter)loop_set_slow_callback_duration,
+     PyDoc_STR("Log callbacks running at least this many seconds; None disables"), NULL},
+    {NULL},
+};
+
+static PyTypeObject PyEventLoop_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "casyncio.EventLoop",
+    .tp_basicsize = sizeof(PyEventLoopObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)loop_init,
+    .tp_dealloc = (destructor)loop_dealloc,
+    .tp_methods = loop_methods,
+    .tp_getset = loop_getset,
+};
+
+/* StreamReader */
+static int
+sr_traverse(PyStreamReaderObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->loop);
+    Py_VISIT(self->exc);
+    Py_VISIT(self->waiter);
+    Py_VISIT(self->want_sep);
+    return 0;
+}
+
+static int
+sr_clear(PyStreamReaderObject *self)
+{
+    Py_CLEAR(self->loop);
+    Py_CLEAR(self->exc);
+    Py_CLEAR(self->waiter);
+    Py_CLEAR(self->want_sep);
+    return 0;
+}
+
+/* Read buffers come from the loop's pool on casyncio loops, else malloc. */
+static inline BufPool *
+_sr_bufpool(PyStreamReaderObject *self)
+{
+    if (self->loop && PyObject_TypeCheck(self->loop, &PyEventLoop_Type))
+        return &((PyEventLoopObject *)self->loop)->bufpool;
+    return NULL;
+}
+
+static void
+_sr_release_buf(PyStreamReaderObject *self)
+{
+    bufpool_put(_sr_bufpool(self), self->buf, self->cap);
+    self->buf = NULL;
+    self->cap = 0;
+}
+
+static void
+sr_dealloc(PyStreamReaderObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    _sr_release_buf(self);   /* while the loop is still referenced */
+    sr_clear(self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static int
+sr_init(PyStreamReaderObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *loop;
+    int fd;
+    Py_ssize_t limit = SR_DEFAULT_LIMIT;
+    static char *kwlist[] = {"loop", "fd", "limit", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "Oi|n:StreamReader", kwlist,
+                                     &loop, &fd, &limit))
+        return -1;
+    if (limit <= 0) {
+        PyErr_SetString(PyExc_ValueError, "Limit cannot be <= 0");
+        return -1;
+    }
+    Py_INCREF(loop);
+    Py_XSETREF(self->loop, loop);
+    self->fd = fd;
+    self->limit = limit;
+    self->rsize = SR_MIN_READ;
+    PyObject *cb = PyObject_GetAttrString((PyObject *)self, "_on_ready");
+    if (!cb)
+        return -1;
+    if (PyObject_TypeCheck(loop, &PyEventLoop_Type)) {
+        int r = _set_reader((PyEventLoopObject *)loop, fd, cb);
+        Py_DECREF(cb);
+        return r;
+    }
+    PyObject *res = PyObject_CallMethod(loop, "add_reader", "iO", fd, cb);
+    Py_DECREF(cb);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    return 0;
+}
+
+/* Make room for at least need bytes after end, compacting before growing. */
+static int
+_sr_reserve(PyStreamReaderObject *self, size_t need)
+{
+    if (self->cap - self->end >= need)
+        return 0;
+    size_t live = self->end - self->start;
+    if (self->start) {
+        memmove(self->buf, self->buf + self->start, live);
+        self->scan_from -= self->start;
+        self->start = 0;
+        self->end = live;
+        if (self->cap - self->end >= need)
+            return 0;
+    }
+    size_t newcap = self->cap ? self->cap * 2 : need;
+    while (newcap - live < need)
+        newcap *= 2;
+    char *newbuf = bufpool_get(_sr_bufpool(self), &newcap);
+    if (!newbuf) {
+        PyErr_NoMemory();
+        return -1;
+    }
+    if (live)
+        memcpy(newbuf, self->buf, live);
+    _sr_release_buf(self);
+    self->buf = newbuf;
+    self->cap = newcap;
+    return 0;
+}
+
+/*
+ * Stop reading while nobody consumes the buffer.  Only casyncio loops can
+ * drop EPOLLIN; other loops keep reading as before.
+ */
+static int
+_sr_set_paused(PyStreamReaderObject *self, int paused)
+{
+    if (self->paused == paused || !PyObject_TypeCheck(self->loop, &PyEventLoop_Type))
+        return 0;
+    PyEventLoopObject *loop = (PyEventLoopObject *)self->loop;
+    if (_set_read_paused(loop, self->fd, paused) < 0)
+        return -1;
+    self->paused = paused;
+    if (paused && self->fd < loop->fdcap && loop->fdmap[self->fd])
+        loop->fdmap[self->fd]->read_missed = 1;  /* we stopped short of EAGAIN */
+    return 0;
+}
+
+static PyObject *
+_sr_take(PyStreamReaderObject *self, size_t n)
+{
+    PyObject *data = PyBytes_FromStringAndSize(self->buf + self->start, (Py_ssize_t)n);
+    if (!data)
+        return NULL;
+    self->start += n;
+    if (self->start == self->end) {
+        self->start = self->end = 0;
+        /* on a casyncio loop an idle reader holds no buffer at all */
+        if (self->cap > SR_MAX_RETAIN || _sr_bufpool(self))
+            _sr_release_buf(self);
+    }
+    self->scan_from = self->start;
+    if (self->paused && self->end - self->start <= (size_t)self->limit &&
+        _sr_set_paused(self, 0) < 0) {
+        Py_DECREF(data);
+        return NULL;
+    }
+    return data;
+}
+
+/* Offset of the separator's end within the live bytes, or -1. */
+static Py_ssize_t
+_sr_find(PyStreamReaderObject *self, const char *sep, size_t seplen)
+{
+    const char *base = self->buf + self->scan_from;
+    size_t avail = self->end - self->scan_from;
+    const char *hit = NULL;
+    if (avail >= seplen)
+        hit = seplen == 1 ? memchr(base, sep[0], avail) : memmem(base, avail, sep, seplen);
+    if (hit)
+        return (Py_ssize_t)(hit - (self->buf + self->start) + seplen);
+    /* a separator may straddle the next read; keep its possible prefix */
+    if (self->end - self->start >= seplen)
+        self->scan_from = self->end - seplen + 1;
+    return -1;
+}
+
+static int
+_sr_raise_incomplete(PyObject *partial, PyObject *expected)
+{
+    PyObject *IncompleteReadError =
+        _asyncio_attr(&asyncio_IncompleteReadError, "IncompleteReadError");
+    if (!IncompleteReadError) {
+        Py_DECREF(partial);
+        return -1;
+    }
+    PyObject *exc = PyObject_CallFunctionObjArgs(IncompleteReadError, partial, expected, NULL);
+    Py_DECREF(partial);
+    if (exc) {
+        PyErr_SetObject((PyObject *)Py_TYPE(exc), exc);
+        Py_DECREF(exc);
+    }
+    return -1;
+}
+
+/*
+ * Try to satisfy a request from the buffer: 1 with *result set, 0 if more
+ * data is needed, -1 with an exception set.
+ */
+static int
+_sr_fulfil(PyStreamReaderObject *self, int want, Py_ssize_t n, PyObject *sep,
+           PyObject **result)
+{
+    size_t avail = self->end - self->start;
+    size_t take;
+    Py_ssize_t found;
+
+    switch (want) {
+    case SR_WANT_ANY:
+        if (n == 0)
+            return (*result = PyBytes_FromStringAndSize(NULL, 0)) ? 1 : -1;
+        if (!avail && !self->eof)
+            return 0;
+        if (!avail && self->exc)
+            break;
+        take = (n < 0 || (size_t)n > avail) ? avail : (size_t)n;
+        return (*result = _sr_take(self, take)) ? 1 : -1;
+    case SR_WANT_EXACT:
+        if (avail >= (size_t)n)
+            return (*result = _sr_take(self, (size_t)n)) ? 1 : -1;
+        if (!self->eof)
+            return 0;
+        if (self->exc)
+            break;
+        {
+            PyObject *partial = _sr_take(self, avail);
+            PyObject *expected = PyLong_FromSsize_t(n);
+            if (!partial || !expected) {
+                Py_XDECREF(partial);
+                Py_XDECREF(expected);
+                return -1;
+            }
+            int r = _sr_raise_incomplete(partial, expected);
+            Py_DECREF(expected);
+            return r;
+        }
+    default:
+        found = want == SR_WANT_LINE
+            ? _sr_find(self, "\n", 1)
+            : _sr_find(self, PyBytes_AS_STRING(sep), (size_t)PyBytes_GET_SIZE(sep));
+        if (found >= 0)
+            return (*result = _sr_take(self, (size_t)found)) ? 1 : -1;
+        if (!self->eof)
+            return 0;
+        if (self->exc)
+            break;
+        if (want == SR_WANT_LINE)
+            return (*result = _sr_take(self, avail)) ? 1 : -1;
+        {
+            PyObject *partial = _sr_take(self, avail);
+            if (!partial)
+                return -1;
+            return _sr_raise_incomplete(partial, Py_None);
+        }
+    }
+    PyErr_SetObject((PyObject *)Py_TYPE(self->exc), self->exc);
+    return -1;
+}
+
+/* 1 if a waiter is still pending; a cancelled waiter is dropped. */
+static int
+_sr_has_waiter(PyStreamReaderObject *self)
+{
+    if (!self->waiter)
+        return 0;
+    int cancelled = _future_done(self->waiter);
+    if (cancelled < 0)
+        return -1;
+    if (cancelled) {
+        Py_CLEAR(self->waiter);
+        Py_CLEAR(self->want_sep);
+        return 0;
+    }
+    return 1;
+}
+
+/* Resolve the pending waiter if its request can now be satisfied. */
+static int
+_sr_wake(PyStreamReaderObject *self)
+{
+    int active = _sr_has_waiter(self);
+    if (active <= 0)
+        return active;
+    PyObject *result = NULL;
+    int r = _sr_fulfil(self, self->want, self->want_n, self->want_sep, &result);
+    if (r == 0)
+        return 0;
+    PyObject *fut = self->waiter;
+    self->waiter = NULL;
+    Py_CLEAR(self->want_sep);
+    int rc;
+    if (r == 1) {
+        rc = _future_resolve(fut, result, NULL);
+        Py_DECREF(result);
+    } else {
+        PyObject *exc = _fetch_exception();
+        rc = _future_resolve(fut, NULL, exc);
+        Py_DECREF(exc);
+    }
+    Py_DECREF(fut);
+    return rc;
+}
+
+static PyObject *
+sr_on_ready(PyStreamReaderObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->eof)
+        Py_RETURN_NONE;
+    /* edge-triggered: anything left unread now would never be reported */
+    for (;;) {
+        if (_sr_reserve(self, self->rsize) < 0)
+            return NULL;
+        size_t space = self->cap - self->end;
+        ssize_t n = read(self->fd, self->buf + self->end, space);
+        if (n > 0) {
+            self->end += (size_t)n;
+            if ((size_t)n >= self->rsize && self->rsize < SR_MAX_READ)
+                self->rsize *= 2;
+            else if ((size_t)n < self->rsize / 4 && self->rsize > SR_MIN_READ)
+                self->rsize /= 2;
+            /* a pending waiter needs more data, so only pause without one */
+            if (!self->waiter && self->end - self->start > 2 * (size_t)self->limit) {
+                if (_sr_set_paused(self, 1) < 0)
+                    return NULL;
+                if (self->paused)
+                    break;
+            }
+            continue;
+        }
+        if (n == 0) {
+            self->eof = 1;
+            break;
+        }
+        if (errno == EINTR)
+            continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            if (PyObject_TypeCheck(self->loop, &PyEventLoop_Type))
+                ((PyEventLoopObject *)self->loop)->stats.read_eagain++;
+            break;
+        }
+        PyErr_SetFromErrno(PyExc_OSError);
+        self->exc = _fetch_exception();
+        self->eof = 1;
+        break;
+    }
+    if (self->eof) {
+        PyObject *res = PyObject_CallMethod(self->loop, "remove_reader", "i", self->fd);
+        if (!res)
+            return NULL;
+        Py_DECREF(res);
+    }
+    if (_sr_wake(self) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+_sr_request(PyStreamReaderObject *self, int want, Py_ssize_t n, PyObject *sep)
+{
+    int active = _sr_has_waiter(self);
+    if (active < 0)
+        return NULL;
+    if (active) {
+        PyErr_SetString(PyExc_RuntimeError,
+                        "StreamReader is already waiting for incoming data");
+        return NULL;
+    }
+    PyObject *fut = _new_future(self->loop);
+    if (!fut)
+        return NULL;
+    self->scan_from = self->start;
+    PyObject *result = NULL;
+    int r = _sr_fulfil(self, want, n, sep, &result);
+    if (r == 0) {
+        if (_sr_set_paused(self, 0) < 0) {
+            Py_DECREF(fut);
+            return NULL;
+        }
+        Py_INCREF(fut);
+        self->waiter = fut;
+        self->want = want;
+        self->want_n = n;
+        Py_XINCREF(sep);
+        Py_XSETREF(self->want_sep, sep);
+        return fut;
+    }
+    int rc;
+    if (r == 1) {
+        rc = _future_resolve(fut, result, NULL);
+        Py_DECREF(result);
+    } else {
+        PyObject *exc = _fetch_exception();
+        rc = _future_resolve(fut, NULL, exc);
+        Py_DECREF(exc);
+    }
+    if (rc < 0) {
+        Py_DECREF(fut);
+        return NULL;
+    }
+    return fut;
+}
+
+static PyObject *
+sr_read(PyStreamReaderObject *self, PyObject *args)
+{
+    Py_ssize_t n = -1;
+    if (!PyArg_ParseTuple(args, "|n:read", &n))
+        return NULL;
+    return _sr_request(self, SR_WANT_ANY, n, NULL);
+}
+
+static PyObject *
+sr_readexactly(PyStreamReaderObject *self, PyObject *arg)
+{
+    Py_ssize_t n = PyLong_AsSsize_t(arg);
+    if (n == -1 && PyErr_Occurred())
+        return NULL;
+    if (n < 0) {
+        PyErr_SetString(PyExc_ValueError, "readexactly size can not be less than zero");
+        return NULL;
+    }
+    return _sr_request(self, SR_WANT_EXACT, n, NULL);
+}
+
+static PyObject *
+sr_readline(PyStreamReaderObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return _sr_request(self, SR_WANT_LINE, 0, NULL);
+}
+
+static PyObject *
+sr_readuntil(PyStreamReaderObject *self, PyObject *args)
+{
+    PyObject *sep = NULL;
+    if (!PyArg_ParseTuple(args, "|S:readuntil", &sep))
+        return NULL;
+    if (!sep)
+        return _sr_request(self, SR_WANT_LINE, 0, NULL);
+    if (PyBytes_GET_SIZE(sep) == 0) {
+        PyErr_SetString(PyExc_ValueError, "Separator should be at least one-byte string");
+        return NULL;
+    }
+    return _sr_request(self, SR_WANT_UNTIL, 0, sep);
+}
+
+static PyObject *
+sr_at_eof(PyStreamReaderObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyBool_FromLong(self->eof && self->start == self->end);
+}
+
+static PyMethodDef sr_methods[] = {
+    {"_on_ready", (PyCFunction)sr_on_ready, METH_NOARGS,
+     PyDoc_STR("Drain the fd into the buffer until EAGAIN")},
+    {"read", (PyCFunction)sr_read, METH_VARARGS,
+     PyDoc_STR("Future for up to n buffered bytes (all if n < 0)")},
+    {"readexactly", (PyCFunction)sr_readexactly, METH_O,
+     PyDoc_STR("Future for exactly n bytes")},
+    {"readline", (PyCFunction)sr_readline, METH_NOARGS,
+     PyDoc_STR("Future for one line including the newline")},
+    {"readuntil", (PyCFunction)sr_readuntil, METH_VARARGS,
+     PyDoc_STR("Future for data up to and including separator")},
+    {"at_eof", (PyCFunction)sr_at_eof, METH_NOARGS,
+     PyDoc_STR("Return True if the buffer is empty and EOF was seen")},
+    {NULL, NULL, 0, NULL},
+};
+
+static PyTypeObject PyStreamReader_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "casyncio.StreamReader",
+    .tp_basicsize = sizeof(PyStreamReaderObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_BASETYPE | Py_TPFLAGS_HAVE_GC,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)sr_init,
+    .tp_traverse = (traverseproc)sr_traverse,
+    .tp_clear = (inquiry)sr_clear,
+    .tp_dealloc = (destructor)sr_dealloc,
+    .tp_methods = sr_methods,
+};
+
+/* Listener */
+
+static int
+ln_traverse(PyListenerObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->loop);
+    Py_VISIT(self->on_accept);
+    Py_VISIT(self->writer_type);
+    return 0;
+}
+
+static int
+ln_clear(PyListenerObject *self)
+{
+    Py_CLEAR(self->loop);
+    Py_CLEAR(self->on_accept);
+    Py_CLEAR(self->writer_type);
+    return 0;
+}
+
+static void
+ln_dealloc(PyListenerObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    ln_clear(self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+/* Schedule the bound _on_ready: now (call_soon) or after delay seconds. */
+static int
+_ln_reschedule(PyListenerObject *self, double delay)
+{
+    PyObject *cb = PyObject_GetAttrString((PyObject *)self, "_on_ready");
+    if (!cb)
+        return -1;
+    PyObject *res;
+    if (delay > 0)
+        res = PyObject_CallMethod(self->loop, "call_later", "dO", delay, cb);
+    else if (PyObject_TypeCheck(self->loop, &PyEventLoop_Type))
+        res = _ready_push((PyEventLoopObject *)self->loop, cb) < 0 ? NULL : Py_NewRef(Py_None);
+    else
+        res = PyObject_CallMethod(self->loop, "call_soon", "O", cb);
+    Py_DECREF(cb);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    return 0;
+}
+
+static int
+ln_init(PyListenerObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *loop, *on_accept, *writer_type = Py_None;
+    int fd;
+    int max_accept = LISTENER_MAX_ACCEPT;
+    Py_ssize_t limit = SR_DEFAULT_LIMIT;
+    static char *kwlist[] = {"loop", "fd", "on_accept", "writer_type", "max_accept",
+                             "limit", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OiO|$Oin:Listener", kwlist,
+                                     &loop, &fd, &on_accept, &writer_type,
+                                     &max_accept, &limit))
+        return -1;
+    if (!PyCallable_Check(on_accept)) {
+        PyErr_SetString(PyExc_TypeError, "on_accept must be callable");
+        return -1;
+    }
+    if (max_accept <= 0) {
+        PyErr_SetString(PyExc_ValueError, "max_accept must be > 0");
+        return -1;
+    }
+    if (limit <= 0) {
+        PyErr_SetString(PyExc_ValueError, "Limit cannot be <= 0");
+        return -1;
+    }
+    Py_XSETREF(self->loop, Py_NewRef(loop));
+    Py_XSETREF(self->on_accept, Py_NewRef(on_accept));
+    Py_XSETREF(self->writer_type, writer_type == Py_None ? NULL : Py_NewRef(writer_type));
+    self->fd = fd;
+    self->max_accept = max_accept;
+    self->limit = limit;
+    self->closed = 0;
+    PyObject *cb = PyObject_GetAttrString((PyObject *)self, "_on_ready");
+    if (!cb)
+        return -1;
+    int r;
+    if (PyObject_TypeCheck(loop, &PyEventLoop_Type)) {
+        r = _uring_io_attach((PyEventLoopObject *)loop, fd, 1);
+        if (r == 0)
+            r = _set_reader((PyEventLoopObject *)loop, fd, cb);
+    } else {
+        PyObject *res = PyObject_CallMethod(loop, "add_reader", "iO", fd, cb);
+        r = res ? 0 : -1;
+        Py_XDECREF(res);
+    }
+    Py_DECREF(cb);
+    if (r < 0)
+        return -1;
+    /* the backlog may already hold connections; edge-triggered reads would miss them */
+    return _ln_reschedule(self, 0);
+}
+
+/* Wrap one accepted fd in a StreamReader and writer and hand them over. */
+static int
+_ln_dispatch(PyListenerObject *self, int cfd)
+{
+    PyObject *reader = PyObject_CallFunction((PyObject *)&PyStreamReader_Type, "Oin",
+                                             self->loop, cfd, self->limit);
+    if (!reader) {
+        close(cfd);
+        return -1;
+    }
+    PyObject *writer = self->writer_type
+        ? PyObject_CallFunction(self->writer_type, "Oi", self->loop, cfd)
+        : PyLong_FromLong(cfd);
+    if (!writer) {
+        Py_DECREF(reader);
+        if (PyObject_TypeCheck(self->loop, &PyEventLoop_Type))
+            _fd_close((PyEventLoopObject *)self->loop, cfd);
+        else
+            close(cfd);
+        return -1;
+    }
+    PyObject *res = PyObject_CallFunctionObjArgs(self->on_accept, reader, writer, NULL);
+    Py_DECREF(reader);
+    Py_DECREF(writer);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    return 0;
+}
+
+/*
+ * io_uring: dispatch what the multishot accept queued, with the same
+ * max_accept limit and the same handling of its errors as accept4().
+ */
+static PyObject *
+_ln_dispatch_queued(PyListenerObject *self, PyEventLoopObject *loop)
+{
+    FDCallback *slot = loop->fdmap[self->fd];
+    for (int i = 0; i < self->max_accept && slot->uio->nfds; i++) {
+        UringIO *io = slot->uio;
+        int cfd = io->fds[0];
+        memmove(io->fds, io->fds + 1, --io->nfds * sizeof(int));
+        if (_ln_dispatch(self, cfd) < 0)
+            return NULL;
+        if (self->closed)
+            Py_RETURN_NONE;
+    }
+    UringIO *io = slot->uio;
+    if (io->nfds) {
+        if (_ln_reschedule(self, 0) < 0)
+            return NULL;
+        Py_RETURN_NONE;
+    }
+    int err = io->err;
+    io->err = 0;
+    switch (err) {
+    case 0:
+        break;
+    case EMFILE:
+    case ENFILE:
+    case ENOMEM:
+        /* out of resources: re-arm from the retry, not now */
+        if (_ln_reschedule(self, LISTENER_RETRY_DELAY) < 0)
+            return NULL;
+        Py_RETURN_NONE;
+    default:
+        if (_uring_io_arm(loop, slot) == 0)
+            errno = err;
+        return PyErr_SetFromErrno(PyExc_OSError);
+    }
+    if (_uring_io_arm(loop, slot) < 0)
+        return PyErr_SetFromErrno(PyExc_OSError);
+    Py_RETURN_NONE;
+}
+
+/*
+ * Accept until EAGAIN, but at most max_accept connections per call so a
+ * connection storm cannot starve other callbacks; the rest of the backlog
+ * is picked up by re-queueing ourselves.
+ */
+static PyObject *
+ln_on_ready(PyListenerObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->closed)
+        Py_RETURN_NONE;
+    if (PyObject_TypeCheck(self->loop, &PyEventLoop_Type)) {
+        PyEventLoopObject *loop = (PyEventLoopObject *)self->loop;
+        if (self->fd < loop->fdcap && loop->fdmap[self->fd] && loop->fdmap[self->fd]->uio)
+            return _ln_dispatch_queued(self, loop);
+    }
+    for (int i = 0; i < self->max_accept; i++) {
+        int cfd = accept4(self->fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (cfd == -1) {
+            switch (errno) {
+            case EAGAIN:
+#if EWOULDBLOCK != EAGAIN
+            case EWOULDBLOCK:
+#endif
+                Py_RETURN_NONE;
+            case EINTR:
+            case ECONNABORTED:
+            case EPROTO:
+                continue;  /* this connection is gone; keep draining */
+            case EMFILE:
+            case ENFILE:
+            case ENOBUFS:
+            case ENOMEM:
+                /* out of resources: the backlog keeps, try again shortly */
+                if (_ln_reschedule(self, LISTENER_RETRY_DELAY) < 0)
+                    return NULL;
+                Py_RETURN_NONE;
+            default:
+                return PyErr_SetFromErrno(PyExc_OSError);
+            }
+        }
+        if (_ln_dispatch(self, cfd) < 0)
+            return NULL;
+        if (self->closed)
+            Py_RETURN_NONE;
+    }
+    if (_ln_reschedule(self, 0) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+ln_close(PyListenerObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->closed)
+        Py_RETURN_NONE;
+    self->closed = 1;
+    PyObject *res = PyObject_CallMethod(self->loop, "remove_reader", "i", self->fd);
+    if (!res)
+        return NULL;
+    Py_DECREF(res);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+ln_get_fd(PyListenerObject *self, void *Py_UNUSED(closure))
+{
+    return PyLong_FromLong(self->fd);
+}
+
+static PyMethodDef ln_methods[] = {
+    {"_on_ready", (PyCFunction)ln_on_ready, METH_NOARGS,
+     PyDoc_STR("Accept pending connections")},
+    {"close", (PyCFunction)ln_close, METH_NOARGS,
+     PyDoc_STR("Stop accepting; the listening socket itself is left open")},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef ln_getset[] = {
+    {"fd", (getter)ln_get_fd, NULL, PyDoc_STR("Listening file descriptor"), NULL},
+    {NULL},
+};
+
+static PyTypeObject PyListener_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "casyncio.Listener",
+    .tp_basicsize = sizeof(PyListenerObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)ln_init,
+    .tp_traverse = (traverseproc)ln_traverse,
+    .tp_clear = (inquiry)ln_clear,
+    .tp_dealloc = (destructor)ln_dealloc,
+    .tp_methods = ln_methods,
+    .tp_getset = ln_getset,
+};
+
+/* SocketTransport */
+
+static int
+tr_traverse(PySocketTransportObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->loop);
+    Py_VISIT(self->sock);
+    Py_VISIT(self->protocol);
+    Py_VISIT(self->data_received);
+    Py_VISIT(self->get_buffer);
+    Py_VISIT(self->buffer_updated);
+    Py_VISIT(self->extra);
+    Py_VISIT(self->lost_exc);
+    return 0;
+}
+
+static int
+tr_clear(PySocketTransportObject *self)
+{
+    Py_CLEAR(self->loop);
+    Py_CLEAR(self->sock);
+    Py_CLEAR(self->protocol);
+    Py_CLEAR(self->data_received);
+    Py_CLEAR(self->get_buffer);
+    Py_CLEAR(self->buffer_updated);
+    Py_CLEAR(self->extra);
+    Py_CLEAR(self->lost_exc);
+    return 0;
+}
+
+/* Hand the read buffer back to the loop's pool between reads. */
+static void
+_tr_release_rbuf(PySocketTransportObject *self)
+{
+    bufpool_put(self->loop ? &self->loop->bufpool : NULL, self->rbuf, self->rcap);
+    self->rbuf = NULL;
+    self->rcap = 0;
+}
+
+static void
+tr_dealloc(PySocketTransportObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    _tr_release_rbuf(self);
+    tr_clear(self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+/* Cache the protocol's callbacks; get_buffer() marks a buffered protocol. */
+static int
+_tr_bind_protocol(PySocketTransportObject *self, PyObject *protocol)
+{
+    PyObject *get_buffer = NULL, *buffer_updated = NULL, *data_received = NULL;
+    if (_optional_attr(protocol, "get_buffer", &get_buffer) < 0)
+        return -1;
+    if (get_buffer) {
+        buffer_updated = PyObject_GetAttrString(protocol, "buffer_updated");
+        if (!buffer_updated) {
+            Py_DECREF(get_buffer);
+            return -1;
+        }
+    } else {
+        data_received = PyObject_GetAttrString(protocol, "data_received");
+        if (!data_received)
+            return -1;
+    }
+    Py_XSETREF(self->protocol, Py_NewRef(protocol));
+    Py_XSETREF(self->get_buffer, get_buffer);
+    Py_XSETREF(self->buffer_updated, buffer_updated);
+    Py_XSETREF(self->data_received, data_received);
+    return 0;
+}
+
+static int
+tr_init(PySocketTransportObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *loop, *sock, *protocol;
+    static char *kwlist[] = {"loop", "sock", "protocol", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOO:SocketTransport", kwlist,
+                                     &loop, &sock, &protocol))
+        return -1;
+    if (!PyObject_TypeCheck(loop, &PyEventLoop_Type)) {
+        PyErr_SetString(PyExc_TypeError, "SocketTransport needs a casyncio.EventLoop");
+        return -1;
+    }
+    if (self->loop) {
+        PyErr_SetString(PyExc_RuntimeError, "SocketTransport is already initialised");
+        return -1;
+    }
+    PyObject *res = PyObject_CallMethod(sock, "setblocking", "O", Py_False);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    PyObject *fdobj = PyObject_CallMethod(sock, "fileno", NULL);
+    if (!fdobj)
+        return -1;
+    int fd = PyLong_AsLong(fdobj);
+    Py_DECREF(fdobj);
+    if (fd == -1 && PyErr_Occurred())
+        return -1;
+    if (_tr_bind_protocol(self, protocol) < 0)
+        return -1;
+    self->loop = (PyEventLoopObject *)Py_NewRef(loop);
+    self->sock = Py_NewRef(sock);
+    self->fd = fd;
+    self->rsize = SR_MIN_READ;
+
+    self->extra = PyDict_New();
+    if (!self->extra || PyDict_SetItemString(self->extra, "socket", sock) < 0)
+        return -1;
+    static const char *names[] = {"sockname", "peername"};
+    for (int i = 0; i < 2; i++) {
+        char meth[16];
+        snprintf(meth, sizeof(meth), "get%s", names[i]);
+        PyObject *v = PyObject_CallMethod(sock, meth, NULL);
+        if (!v) {
+            /* e.g. an unconnected socket: leave the key unset */
+            if (!PyErr_ExceptionMatches(PyExc_OSError))
+                return -1;
+            PyErr_Clear();
+            continue;
+        }
+        int r = PyDict_SetItemString(self->extra, names[i], v);
+        Py_DECREF(v);
+        if (r < 0)
+            return -1;
+    }
+
+    OutBuf *ob = _fd_outbuf(self->loop, fd);
+    if (!ob)
+        return -1;
+    Py_XSETREF(ob->protocol, Py_NewRef(protocol));
+    FDCallback *slot = self->loop->fdmap[fd];
+    Py_XSETREF(slot->owner, Py_NewRef((PyObject *)self));
+    if (_uring_io_attach(self->loop, fd, 0) < 0)
+        return -1;
+    PyObject *cb = PyObject_GetAttrString((PyObject *)self, "_on_ready");
+    if (!cb)
+        return -1;
+    int r = _set_reader(self->loop, fd, cb);
+    Py_DECREF(cb);
+    if (r < 0)
+        return -1;
+    res = PyObject_CallMethod(protocol, "connection_made", "O", (PyObject *)self);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    return 0;
+}
+
+/* Queue connection_lost(exc) behind the callbacks already ready. */
+static int
+_tr_schedule_lost(PySocketTransportObject *self, PyObject *exc)
+{
+    Py_XSETREF(self->lost_exc, Py_XNewRef(exc));
+    PyObject *cb = PyObject_GetAttrString((PyObject *)self, "_call_connection_lost");
+    if (!cb)
+        return -1;
+    int r = _ready_push(self->loop, cb);
+    Py_DECREF(cb);
+    return r;
+}
+
+/*
+ * Hand the fd over to the loop: the socket object must not close the
+ * number again once the loop has, since it may already be reused.
+ */
+static int
+_tr_detach(PySocketTransportObject *self)
+{
+    PyObject *res = PyObject_CallMethod(self->sock, "detach", NULL);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    return 0;
+}
+
+/* The loop closed our fd after a pending close() flushed. */
+static int
+_tr_closed(PyObject *tr, PyObject *exc)
+{
+    PySocketTransportObject *self = (PySocketTransportObject *)tr;
+    self->fd = -1;
+    _tr_release_rbuf(self);
+    return _tr_schedule_lost(self, exc);
+}
+
+/* Close now, dropping unsent data, and report exc to connection_lost(). */
+static int
+_tr_fatal(PyObject *tr, PyObject *exc)
+{
+    PySocketTransportObject *self = (PySocketTransportObject *)tr;
+    if (self->fd < 0)
+        return 0;
+    int fd = self->fd;
+    self->closing = 1;
+    self->fd = -1;
+    _tr_release_rbuf(self);
+    int rc = _tr_detach(self);
+    if (_fd_close(self->loop, fd) < 0)
+        rc = -1;
+    if (rc == 0)
+        rc = _tr_schedule_lost(self, exc);
+    return rc;
+}
+
+/*
+ * Turn the current exception into a fatal close.  Errors raised by the
+ * protocol are reported like asyncio's default exception handler would;
+ * plain socket errors (resets and the like) only reach connection_lost.
+ */
+static PyObject *
+_tr_fail(PySocketTransportObject *self)
+{
+    PyObject *exc = _fetch_exception();
+    if (!PyErr_GivenExceptionMatches(exc, PyExc_OSError)) {
+        PyErr_Restore(Py_NewRef((PyObject *)Py_TYPE(exc)), Py_NewRef(exc),
+                      PyException_GetTraceback(exc));
+        PyErr_WriteUnraisable(self->protocol);
+    }
+    int rc = _tr_fatal((PyObject *)self, exc);
+    Py_DECREF(exc);
+    if (rc < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *tr_close(PySocketTransportObject *self, PyObject *Py_UNUSED(ignored));
+
+/* EOF from the peer: keep the write side open only if eof_received() asks. */
+static PyObject *
+_tr_eof(PySocketTransportObject *self)
+{
+    PyObject *meth;
+    if (_optional_attr(self->protocol, "eof_received", &meth) < 0)
+        return _tr_fail(self);
+    int keep_open = 0;
+    if (meth) {
+        PyObject *res = PyObject_CallNoArgs(meth);
+        Py_DECREF(meth);
+        if (!res)
+            return _tr_fail(self);
+        keep_open = PyObject_IsTrue(res);
+        Py_DECREF(res);
+        if (keep_open < 0)
+            return _tr_fail(self);
+    }
+    if (keep_open) {
+        FDCallback *slot = self->loop->fdmap[self->fd];
+        Py_CLEAR(slot->reader);
+        slot->read_paused = slot->read_missed = 0;
+        if (_fd_interest(self->loop, self->fd, slot) < 0)
+            return NULL;
+        Py_RETURN_NONE;
+    }
+    return tr_close(self, NULL);
+}
+
+/* The protocol's get_buffer(-1) memory, writable and not empty. */
+static int
+_tr_get_buffer(PySocketTransportObject *self, Py_buffer *view)
+{
+    static PyObject *minus_one;
+    if (!minus_one && !(minus_one = PyLong_FromLong(-1)))
+        return -1;
+    PyObject *mem = PyObject_CallOneArg(self->get_buffer, minus_one);
+    if (!mem)
+        return -1;
+    int r = PyObject_GetBuffer(mem, view, PyBUF_WRITABLE);
+    Py_DECREF(mem);
+    if (r < 0)
+        return -1;
+    if (view->len == 0) {
+        PyBuffer_Release(view);
+        PyErr_SetString(PyExc_RuntimeError, "get_buffer() returned an empty buffer");
+        return -1;
+    }
+    return 0;
+}
+
+/* One recv() into get_buffer() memory; returns bytes read or -1 (errno/exception). */
+static ssize_t
+_tr_recv_buffered(PySocketTransportObject *self)
+{
+    Py_buffer view;
+    if (_tr_get_buffer(self, &view) < 0)
+        return -2;
+    ssize_t n = recv(self->fd, view.buf, (size_t)view.len, 0);
+    PyBuffer_Release(&view);
+    return n;
+}
+
+/* One recv() into the transport's buffer, sized like StreamReader's reads. */
+static ssize_t
+_tr_recv_plain(PySocketTransportObject *self)
+{
+    if (self->rcap < self->rsize) {
+        size_t cap = self->rsize;
+        char *nb = bufpool_get(&self->loop->bufpool, &cap);
+        if (!nb) {
+            PyErr_NoMemory();
+            return -2;
+        }
+        _tr_release_rbuf(self);
+        self->rbuf = nb;
+        self->rcap = cap;
+    }
+    ssize_t n = recv(self->fd, self->rbuf, self->rsize, 0);
+    return n;
+}
+
+/*
+ * io_uring: hand over what the multishot recv stashed, in get_buffer()
+ * sized pieces for a buffered protocol, then report its EOF or error.
+ */
+static PyObject *
+_tr_deliver_stash(PySocketTransportObject *self)
+{
+    FDCallback *slot = self->loop->fdmap[self->fd];
+    UringIO *io = slot->uio;
+    while (!self->closing && !self->paused && io->roff < io->rlen) {
+        size_t avail = io->rlen - io->roff;
+        PyObject *res;
+        if (self->get_buffer) {
+            Py_buffer view;
+            if (_tr_get_buffer(self, &view) < 0)
+                return _tr_fail(self);
+            size_t n = (size_t)view.len < avail ? (size_t)view.len : avail;
+            memcpy(view.buf, io->rbuf + io->roff, n);
+            PyBuffer_Release(&view);
+            io->roff += n;
+            if (io->roff == io->rlen)
+                _uring_stash_release(self->loop, io);
+            PyObject *nbytes = PyLong_FromSize_t(n);
+            if (!nbytes)
+                return _tr_fail(self);
+            res = PyObject_CallOneArg(self->buffer_updated, nbytes);
+            Py_DECREF(nbytes);
+        } else {
+            PyObject *data = PyBytes_FromStringAndSize(io->rbuf + io->roff, (Py_ssize_t)avail);
+            if (!data)
+                return _tr_fail(self);
+            _uring_stash_release(self->loop, io);
+            res = PyObject_CallOneArg(self->data_received, data);
+            Py_DECREF(data);
+        }
+        /* the callback may have closed us, freeing io */
+        if (!res)
+            return _tr_fail(self);
+        Py_DECREF(res);
+    }
+    if (self->closing)
+        Py_RETURN_NONE;
+    if (self->paused) {
+        if (io->roff < io->rlen || io->eof || io->err)
+            slot->read_missed = 1;
+        Py_RETURN_NONE;
+    }
+    if (io->err) {
+        errno = io->err;
+        PyErr_SetFromErrno(PyExc_OSError);
+        return _tr_fail(self);
+    }
+    if (io->eof) {
+        io->eof = 0;
+        return _tr_eof(self);
+    }
+    Py_RETURN_NONE;
+}
+
+/* Read until EAGAIN (registrations are edge-triggered), pause or close. */
+static PyObject *
+tr_on_ready(PySocketTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!self->closing && self->loop->fdmap[self->fd]->uio)
+        return _tr_deliver_stash(self);
+    while (!self->closing && !self->paused) {
+        ssize_t n = self->get_buffer ? _tr_recv_buffered(self) : _tr_recv_plain(self);
+        if (n == -2)
+            return _tr_fail(self);
+        if (n == 0)
+            return _tr_eof(self);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                self->loop->stats.read_eagain++;
+                _tr_release_rbuf(self);   /* idle connections hold no buffer */
+                Py_RETURN_NONE;
+            }
+            PyErr_SetFromErrno(PyExc_OSError);
+            return _tr_fail(self);
+        }
+        PyObject *res;
+        if (self->get_buffer) {
+            PyObject *nbytes = PyLong_FromSsize_t(n);
+            if (!nbytes)
+                return _tr_fail(self);
+            res = PyObject_CallOneArg(self->buffer_updated, nbytes);
+            Py_DECREF(nbytes);
+        } else {
+            if ((size_t)n >= self->rsize && self->rsize < SR_MAX_READ)
+                self->rsize *= 2;
+            else if ((size_t)n < self->rsize / 4 && self->rsize > SR_MIN_READ)
+                self->rsize /= 2;
+            PyObject *data = PyBytes_FromStringAndSize(self->rbuf, n);
+            if (!data)
+                return _tr_fail(self);
+            res = PyObject_CallOneArg(self->data_received, data);
+            Py_DECREF(data);
+        }
+        if (!res)
+            return _tr_fail(self);
+        Py_DECREF(res);
+    }
+    if (self->paused && !self->closing) {
+        /* paused before EAGAIN: have resume_reading() deliver the rest */
+        FDCallback *slot = self->loop->fdmap[self->fd];
+        slot->read_missed = 1;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+tr_call_connection_lost(PySocketTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    PyObject *exc = self->lost_exc ? self->lost_exc : Py_None;
+    PyObject *res = PyObject_CallMethod(self->protocol, "connection_lost", "O", exc);
+    Py_CLEAR(self->lost_exc);
+    if (!res)
+        return NULL;
+    Py_DECREF(res);
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+tr_write(PySocketTransportObject *self, PyObject *data)
+{
+    Py_buffer view;
+    if (PyObject_GetBuffer(data, &view, PyBUF_SIMPLE) < 0)
+        return NULL;
+    if (self->fd < 0) {
+        /* connection already lost; asyncio drops such writes too */
+        PyBuffer_Release(&view);
+        Py_RETURN_NONE;
+    }
+    if (_write_views(self->loop, self->fd, &view, 1) < 0) {
+        if (!PyErr_ExceptionMatches(PyExc_OSError))
+            return NULL;
+        return _tr_fail(self);
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+tr_writelines(PySocketTransportObject *self, PyObject *iterable)
+{
+    if (self->fd < 0)
+        Py_RETURN_NONE;
+    PyObject *res = PyObject_CallMethod((PyObject *)self->loop, "_c_writelines", "iO",
+                                        self->fd, iterable);
+    if (!res) {
+        if (!PyErr_ExceptionMatches(PyExc_OSError))
+            return NULL;
+        return _tr_fail(self);
+    }
+    return res;
+}
+
+/*
+ * Stop reading and close once the write buffer is flushed; the loop
+ * closes the fd and connection_lost(None) follows.
+ */
+static PyObject *
+tr_close(PySocketTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->closing)
+        Py_RETURN_NONE;
+    self->closing = 1;
+    FDCallback *slot = self->loop->fdmap[self->fd];
+    if (slot->obuf && _outbuf_pending(slot->obuf)) {
+        if (_tr_detach(self) < 0)
+            return NULL;
+        Py_CLEAR(slot->reader);
+        slot->read_paused = slot->read_missed = 0;
+        slot->close_pending = 1;
+        if (_fd_interest(self->loop, self->fd, slot) < 0)
+            return NULL;
+        Py_RETURN_NONE;
+    }
+    if (_tr_fatal((PyObject *)self, NULL) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+tr_abort(PySocketTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (_tr_fatal((PyObject *)self, NULL) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+tr_pause_reading(PySocketTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->closing || self->paused)
+        Py_RETURN_NONE;
+    if (_set_read_paused(self->loop, self->fd, 1) < 0)
+        return NULL;
+    self->paused = 1;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+tr_resume_reading(PySocketTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->closing || !self->paused)
+        Py_RETURN_NONE;
+    self->paused = 0;
+    if (_set_read_paused(self->loop, self->fd, 0) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+tr_is_reading(PySocketTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyBool_FromLong(!self->closing && !self->paused);
+}
+
+static PyObject *
+tr_is_closing(PySocketTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyBool_FromLong(self->closing);
+}
+
+static PyObject *
+tr_set_write_buffer_limits(PySocketTransportObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *high = Py_None, *low = Py_None;
+    static char *kwlist[] = {"high", "low", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OO:set_write_buffer_limits", kwlist,
+                                     &high, &low))
+        return NULL;
+    if (self->fd < 0)
+        Py_RETURN_NONE;
+    return PyObject_CallMethod((PyObject *)self->loop, "_set_write_buffer_limits", "iOO",
+                               self->fd, high, low);
+}
+
+static PyObject *
+tr_get_write_buffer_size(PySocketTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    OutBuf *ob = self->fd < 0 ? NULL : self->loop->fdmap[self->fd]->obuf;
+    return PyLong_FromSsize_t(ob ? _outbuf_pending(ob) : 0);
+}
+
+static PyObject *
+tr_set_zerocopy(PySocketTransportObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *threshold = Py_None;
+    static char *kwlist[] = {"threshold", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|O:set_zerocopy", kwlist, &threshold))
+        return NULL;
+    if (self->fd < 0)
+        Py_RETURN_NONE;
+    return PyObject_CallMethod((PyObject *)self->loop, "_set_zerocopy", "iO",
+                               self->fd, threshold);
+}
+
+static PyObject *
+tr_get_extra_info(PySocketTransportObject *self, PyObject *args)
+{
+    PyObject *name, *dflt = Py_None;
+    if (!PyArg_ParseTuple(args, "O|O:get_extra_info", &name, &dflt))
+        return NULL;
+    PyObject *v = PyDict_GetItemWithError(self->extra, name);
+    if (!v && PyErr_Occurred())
+        return NULL;
+    return Py_NewRef(v ? v : dflt);
+}
+
+static PyObject *
+tr_get_protocol(PySocketTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return Py_NewRef(self->protocol);
+}
+
+static PyObject *
+tr_set_protocol(PySocketTransportObject *self, PyObject *protocol)
+{
+    if (_tr_bind_protocol(self, protocol) < 0)
+        return NULL;
+    if (self->fd >= 0 && self->loop->fdmap[self->fd]->obuf)
+        Py_XSETREF(self->loop->fdmap[self->fd]->obuf->protocol, Py_NewRef(protocol));
+    Py_RETURN_NONE;
+}
+
+static PyMethodDef tr_methods[] = {
+    {"_on_ready", (PyCFunction)tr_on_ready, METH_NOARGS,
+     PyDoc_STR("Read until EAGAIN and feed the protocol")},
+    {"_call_connection_lost", (PyCFunction)tr_call_connection_lost, METH_NOARGS,
+     PyDoc_STR("Deliver the scheduled connection_lost()")},
+    {"write", (PyCFunction)tr_write, METH_O,
+     PyDoc_STR("Queue data, sending directly when nothing is buffered")},
+    {"writelines", (PyCFunction)tr_writelines, METH_O,
+     PyDoc_STR("Write several buffers with one vectored send")},
+    {"close", (PyCFunction)tr_close, METH_NOARGS,
+     PyDoc_STR("Close after flushing buffered data")},
+    {"abort", (PyCFunction)tr_abort, METH_NOARGS,
+     PyDoc_STR("Close immediately, discarding buffered data")},
+    {"pause_reading", (PyCFunction)tr_pause_reading, METH_NOARGS,
+     PyDoc_STR("Stop calling the protocol with received data")},
+    {"resume_reading", (PyCFunction)tr_resume_reading, METH_NOARGS,
+     PyDoc_STR("Resume delivery of received data")},
+    {"is_reading", (PyCFunction)tr_is_reading, METH_NOARGS,
+     PyDoc_STR("Return True if the transport is receiving")},
+    {"is_closing", (PyCFunction)tr_is_closing, METH_NOARGS,
+     PyDoc_STR("Return True once close() or abort() was called")},
+    {"set_write_buffer_limits", (PyCFunction)(PyCFunctionWithKeywords)tr_set_write_buffer_limits,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Set the high/low write watermarks")},
+    {"set_zerocopy", (PyCFunction)(PyCFunctionWithKeywords)tr_set_zerocopy,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Send writes of at least threshold bytes with MSG_ZEROCOPY")},
+    {"get_write_buffer_size", (PyCFunction)tr_get_write_buffer_size, METH_NOARGS,
+     PyDoc_STR("Return the number of unsent or uncompleted bytes")},
+    {"get_extra_info", (PyCFunction)tr_get_extra_info, METH_VARARGS,
+     PyDoc_STR("Return 'socket', 'sockname' or 'peername'")},
+    {"get_protocol", (PyCFunction)tr_get_protocol, METH_NOARGS,
+     PyDoc_STR("Return the current protocol")},
+    {"set_protocol", (PyCFunction)tr_set_protocol, METH_O,
+     PyDoc_STR("Switch to a new protocol")},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyTypeObject PySocketTransport_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "casyncio.SocketTransport",
+    .tp_basicsize = sizeof(PySocketTransportObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)tr_init,
+    .tp_traverse = (traverseproc)tr_traverse,
+    .tp_clear = (inquiry)tr_clear,
+    .tp_dealloc = (destructor)tr_dealloc,
+    .tp_methods = tr_methods,
+};
+
+/* DatagramTransport */
+
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+
+/* recv errors that report an ICMP error for an earlier datagram */
+static int
+_dg_soft_error(int err)
+{
+    switch (err) {
+    case ECONNREFUSED:
+    case EHOSTUNREACH:
+    case ENETUNREACH:
+    case EHOSTDOWN:
+    case ENETDOWN:
+    case ECONNRESET:
+    case EPROTO:
+    case EMSGSIZE:
+        return 1;
+    }
+    return 0;
+}
+
+static int
+dg_traverse(PyDatagramTransportObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->loop);
+    Py_VISIT(self->sock);
+    Py_VISIT(self->protocol);
+    Py_VISIT(self->datagram_received);
+    Py_VISIT(self->datagrams_received);
+    Py_VISIT(self->error_received);
+    Py_VISIT(self->extra);
+    Py_VISIT(self->peer);
+    Py_VISIT(self->flush_cb);
+    Py_VISIT(self->last_addr);
+    Py_VISIT(self->last_dst_obj);
+    Py_VISIT(self->lost_exc);
+    return 0;
+}
+
+static void
+_dg_sq_clear(PyDatagramTransportObject *self)
+{
+    for (Py_ssize_t i = self->sq_head; i < self->sq_len; i++)
+        Py_DECREF(self->sq[i].data);
+    self->sq_head = self->sq_len = 0;
+    self->sq_bytes = 0;
+}
+
+static int
+dg_clear(PyDatagramTransportObject *self)
+{
+    Py_CLEAR(self->loop);
+    Py_CLEAR(self->sock);
+    Py_CLEAR(self->protocol);
+    Py_CLEAR(self->datagram_received);
+    Py_CLEAR(self->datagrams_received);
+    Py_CLEAR(self->error_received);
+    Py_CLEAR(self->extra);
+    Py_CLEAR(self->peer);
+    Py_CLEAR(self->flush_cb);
+    Py_CLEAR(self->last_addr);
+    Py_CLEAR(self->last_dst_obj);
+    Py_CLEAR(self->lost_exc);
+    _dg_sq_clear(self);
+    return 0;
+}
+
+static void
+dg_dealloc(PyDatagramTransportObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    dg_clear(self);
+    free(self->sq);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+/* Cache the protocol's callbacks; datagrams_received() takes whole batches. */
+static int
+_dg_bind_protocol(PyDatagramTransportObject *self, PyObject *protocol)
+{
+    PyObject *batch = NULL, *single = NULL, *err = NULL;
+    if (_optional_attr(protocol, "datagrams_received", &batch) < 0)
+        return -1;
+    if (!batch && !(single = PyObject_GetAttrString(protocol, "datagram_received")))
+        return -1;
+    if (_optional_attr(protocol, "error_received", &err) < 0) {
+        Py_XDECREF(batch);
+        Py_XDECREF(single);
+        return -1;
+    }
+    Py_XSETREF(self->protocol, Py_NewRef(protocol));
+    Py_XSETREF(self->datagrams_received, batch);
+    Py_XSETREF(self->datagram_received, single);
+    Py_XSETREF(self->error_received, err);
+    return 0;
+}
+
+/* (host, port[, flowinfo, scope_id]) with a numeric host as a sockaddr. */
+static int
+_dg_parse_addr(int family, PyObject *addr, struct sockaddr_storage *ss, socklen_t *len)
+{
+    const char *host;
+    int port;
+    unsigned int flowinfo = 0, scope_id = 0;
+    if (!PyTuple_Check(addr)) {
+        PyErr_Format(PyExc_TypeError, "address must be a tuple, not %.100s",
+                     Py_TYPE(addr)->tp_name);
+        return -1;
+    }
+    if (family == AF_INET) {
+        if (!PyArg_ParseTuple(addr, "si:sendto", &host, &port))
+            return -1;
+    } else if (!PyArg_ParseTuple(addr, "si|II:sendto", &host, &port, &flowinfo, &scope_id)) {
+        return -1;
+    }
+    if (port < 0 || port > 65535) {
+        PyErr_SetString(PyExc_OverflowError, "port must be 0-65535.");
+        return -1;
+    }
+    memset(ss, 0, sizeof(*ss));
+    int ok;
+    if (family == AF_INET) {
+        struct sockaddr_in *sin = (struct sockaddr_in *)ss;
+        sin->sin_family = AF_INET;
+        sin->sin_port = htons((uint16_t)port);
+        ok = inet_pton(AF_INET, host, &sin->sin_addr) == 1;
+        *len = sizeof(*sin);
+    } else {
+        struct sockaddr_in6 *sin6 = (struct sockaddr_in6 *)ss;
+        sin6->sin6_family = AF_INET6;
+        sin6->sin6_port = htons((uint16_t)port);
+        sin6->sin6_flowinfo = htonl(flowinfo);
+        sin6->sin6_scope_id = scope_id;
+        ok = inet_pton(AF_INET6, host, &sin6->sin6_addr) == 1;
+        *len = sizeof(*sin6);
+    }
+    if (!ok) {
+        PyErr_Format(PyExc_ValueError, "%s is not a numeric address; resolve it first", host);
+        return -1;
+    }
+    return 0;
+}
+
+/* The socket module's tuple for a received address. */
+static PyObject *
+_dg_make_addr(const struct sockaddr_storage *ss, socklen_t len)
+{
+    char host[INET6_ADDRSTRLEN];
+    if (len >= sizeof(struct sockaddr_in) && ss->ss_family == AF_INET) {
+        const struct sockaddr_in *sin = (const struct sockaddr_in *)ss;
+        inet_ntop(AF_INET, &sin->sin_addr, host, sizeof(host));
+        return Py_BuildValue("(si)", host, ntohs(sin->sin_port));
+    }
+    if (len >= sizeof(struct sockaddr_in6) && ss->ss_family == AF_INET6) {
+        const struct sockaddr_in6 *sin6 = (const struct sockaddr_in6 *)ss;
+        inet_ntop(AF_INET6, &sin6->sin6_addr, host, sizeof(host));
+        return Py_BuildValue("(siII)", host, ntohs(sin6->sin6_port),
+                             ntohl(sin6->sin6_flowinfo), sin6->sin6_scope_id);
+    }
+    Py_RETURN_NONE;
+}
+
+/* Borrowed address tuple for a sender; repeated senders reuse the last one. */
+static PyObject *
+_dg_sender(PyDatagramTransportObject *self, const struct sockaddr_storage *ss, socklen_t len)
+{
+    if (!self->last_addr || len != self->last_namelen || memcmp(ss, &self->last_name, len)) {
+        PyObject *addr = _dg_make_addr(ss, len);
+        if (!addr)
+            return NULL;
+        Py_XSETREF(self->last_addr, addr);
+        memcpy(&self->last_name, ss, len);
+        self->last_namelen = len;
+    }
+    return self->last_addr;
+}
+
+static DgramPool *
+_dg_pool(PyEventLoopObject *loop)
+{
+    if (loop->dgram_pool)
+        return loop->dgram_pool;
+    DgramPool *p = calloc(1, sizeof(*p));
+    if (!p || !(p->bufs = malloc((size_t)DGRAM_BATCH * DGRAM_SLOT))) {
+        free(p);
+        PyErr_NoMemory();
+        return NULL;
+    }
+    for (int i = 0; i < DGRAM_BATCH; i++) {
+        p->iov[i].iov_base = p->bufs + (size_t)i * DGRAM_SLOT;
+        p->iov[i].iov_len = DGRAM_SLOT;
+        p->msgs[i].msg_hdr.msg_iov = &p->iov[i];
+        p->msgs[i].msg_hdr.msg_iovlen = 1;
+    }
+    loop->dgram_pool = p;
+    return p;
+}
+
+static int
+dg_init(PyDatagramTransportObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *loop, *sock, *protocol;
+    static char *kwlist[] = {"loop", "sock", "protocol", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "OOO:DatagramTransport", kwlist,
+                                     &loop, &sock, &protocol))
+        return -1;
+    if (!PyObject_TypeCheck(loop, &PyEventLoop_Type)) {
+        PyErr_SetString(PyExc_TypeError, "DatagramTransport needs a casyncio.EventLoop");
+        return -1;
+    }
+    if (self->loop) {
+        PyErr_SetString(PyExc_RuntimeError, "DatagramTransport is already initialised");
+        return -1;
+    }
+    PyObject *v = PyObject_GetAttrString(sock, "family");
+    if (!v)
+        return -1;
+    long family = PyLong_AsLong(v);
+    Py_DECREF(v);
+    if (family == -1 && PyErr_Occurred())
+        return -1;
+    if (family != AF_INET && family != AF_INET6) {
+        PyErr_SetString(PyExc_ValueError, "DatagramTransport needs an AF_INET or AF_INET6 socket");
+        return -1;
+    }
+    PyObject *res = PyObject_CallMethod(sock, "setblocking", "O", Py_False);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    PyObject *fdobj = PyObject_CallMethod(sock, "fileno", NULL);
+    if (!fdobj)
+        return -1;
+    int fd = PyLong_AsLong(fdobj);
+    Py_DECREF(fdobj);
+    if (fd == -1 && PyErr_Occurred())
+        return -1;
+    if (_dg_bind_protocol(self, protocol) < 0)
+        return -1;
+    self->loop = (PyEventLoopObject *)Py_NewRef(loop);
+    self->sock = Py_NewRef(sock);
+    self->fd = fd;
+    self->family = (int)family;
+    self->high = DEFAULT_WRITE_HIGH;
+    self->low = DEFAULT_WRITE_LOW;
+
+    /* probe for GSO; GRO needs opting in and may be refused (non-UDP, old kernel) */
+    int one = 1, seg = 0;
+    socklen_t seglen = sizeof(seg);
+    self->gso = getsockopt(fd, SOL_UDP, UDP_SEGMENT, &seg, &seglen) == 0;
+    self->gso_max_seg = 65535;
+    self->gro = setsockopt(fd, SOL_UDP, UDP_GRO, &one, sizeof(one)) == 0;
+
+    self->extra = PyDict_New();
+    if (!self->extra || PyDict_SetItemString(self->extra, "socket", sock) < 0)
+        return -1;
+    v = PyObject_CallMethod(sock, "getsockname", NULL);
+    if (!v || PyDict_SetItemString(self->extra, "sockname", v) < 0) {
+        Py_XDECREF(v);
+        return -1;
+    }
+    Py_DECREF(v);
+    v = PyObject_CallMethod(sock, "getpeername", NULL);
+    if (v) {
+        self->peer = v;
+        if (PyDict_SetItemString(self->extra, "peername", v) < 0)
+            return -1;
+    } else if (PyErr_ExceptionMatches(PyExc_OSError)) {
+        PyErr_Clear();   /* unconnected */
+    } else {
+        return -1;
+    }
+
+    if (!(self->flush_cb = PyObject_GetAttrString((PyObject *)self, "_flush")))
+        return -1;
+    PyObject *cb = PyObject_GetAttrString((PyObject *)self, "_on_ready");
+    if (!cb)
+        return -1;
+    int r = _set_reader(self->loop, fd, cb);
+    Py_DECREF(cb);
+    if (r < 0)
+        return -1;
+    res = PyObject_CallMethod(protocol, "connection_made", "O", (PyObject *)self);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    return 0;
+}
+
+/* Queue connection_lost(exc) behind the callbacks already ready. */
+static int
+_dg_schedule_lost(PyDatagramTransportObject *self, PyObject *exc)
+{
+    Py_XSETREF(self->lost_exc, Py_XNewRef(exc));
+    PyObject *cb = PyObject_GetAttrString((PyObject *)self, "_call_connection_lost");
+    if (!cb)
+        return -1;
+    int r = _ready_push(self->loop, cb);
+    Py_DECREF(cb);
+    return r;
+}
+
+/* Close now, dropping queued datagrams, and report exc to connection_lost(). */
+static int
+_dg_fatal(PyDatagramTransportObject *self, PyObject *exc)
+{
+    if (self->fd < 0)
+        return 0;
+    int fd = self->fd;
+    self->closing = 1;
+    self->fd = -1;
+    _dg_sq_clear(self);
+    /* the socket object must not close the number the loop closes */
+    PyObject *res = PyObject_CallMethod(self->sock, "detach", NULL);
+    int rc = res ? 0 : -1;
+    Py_XDECREF(res);
+    if (_fd_close(self->loop, fd) < 0)
+        rc = -1;
+    if (rc == 0)
+        rc = _dg_schedule_lost(self, exc);
+    return rc;
+}
+
+/* Like _tr_fail(): protocol errors are reported, socket errors only close. */
+static PyObject *
+_dg_fail(PyDatagramTransportObject *self)
+{
+    PyObject *exc = _fetch_exception();
+    if (!PyErr_GivenExceptionMatches(exc, PyExc_OSError)) {
+        PyErr_Restore(Py_NewRef((PyObject *)Py_TYPE(exc)), Py_NewRef(exc),
+                      PyException_GetTraceback(exc));
+        PyErr_WriteUnraisable(self->protocol);
+    }
+    int rc = _dg_fatal(self, exc);
+    Py_DECREF(exc);
+    if (rc < 0)
         return NULL;
-    FDCallback *slot = self->fdmap[fd];
-    int op = (slot->reader || slot->writer) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
-    uint32_t events = EPOLLET | EPOLLOUT | (slot->reader ? EPOLLIN : 0);
-    struct epoll_event ev = {.events = events, .data.u32 = (uint32_t)fd};
-    if (epoll_ctl(self->epfd, op, fd, &ev) == -1) {
-        PyErr_SetFromErrno(PyExc_OSError);
+    Py_RETURN_NONE;
+}
+
+/* Pass the current OSError to error_received(); -1 if that raised. */
+static int
+_dg_error_received(PyDatagramTransportObject *self)
+{
+    PyObject *exc = _fetch_exception();
+    if (!self->error_received) {
+        Py_DECREF(exc);
+        return 0;
+    }
+    PyObject *res = PyObject_CallOneArg(self->error_received, exc);
+    Py_DECREF(exc);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    return 0;
+}
+
+/* Segment size of a GRO train, or len for a plain datagram. */
+static size_t
+_dg_gro_size(struct msghdr *h, size_t len)
+{
+    for (struct cmsghdr *c = CMSG_FIRSTHDR(h); c; c = CMSG_NXTHDR(h, c)) {
+        if (c->cmsg_level == SOL_UDP && c->cmsg_type == UDP_GRO) {
+            int seg;
+            memcpy(&seg, CMSG_DATA(c), sizeof(seg));
+            if (seg > 0)
+                return (size_t)seg;
+        }
+    }
+    return len;
+}
+
+/* Hand one datagram to the protocol, or append it to the batch list. */
+static int
+_dg_deliver(PyDatagramTransportObject *self, PyObject *batch, const char *buf, size_t len,
+            PyObject *addr)
+{
+    PyObject *data = PyBytes_FromStringAndSize(buf, (Py_ssize_t)len);
+    if (!data)
+        return -1;
+    self->loop->stats.datagrams_received++;
+    if (batch) {
+        PyObject *item = PyTuple_Pack(2, data, addr);
+        Py_DECREF(data);
+        if (!item)
+            return -1;
+        int r = PyList_Append(batch, item);
+        Py_DECREF(item);
+        return r;
+    }
+    PyObject *args[2] = {data, addr};
+    PyObject *res = PyObject_Vectorcall(self->datagram_received, args, 2, NULL);
+    Py_DECREF(data);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    return 0;
+}
+
+/* Copy one recvmmsg() batch out of the pool and deliver it. */
+static int
+_dg_dispatch(PyDatagramTransportObject *self, DgramPool *p, int n)
+{
+    PyObject *batch = NULL;
+    if (self->datagrams_received && !(batch = PyList_New(0)))
+        return -1;
+    int rc = 0;
+    for (int i = 0; i < n && rc == 0 && !self->closing; i++) {
+        struct msghdr *h = &p->msgs[i].msg_hdr;
+        PyObject *addr = _dg_sender(self, &p->names[i], h->msg_namelen);
+        if (!addr) {
+            rc = -1;
+            break;
+        }
+        Py_INCREF(addr);
+        const char *buf = p->iov[i].iov_base;
+        size_t len = p->msgs[i].msg_len;
+        size_t seg = self->gro ? _dg_gro_size(h, len) : len;
+        size_t off = 0;
+        do {
+            size_t chunk = len - off < seg ? len - off : seg;
+            rc = _dg_deliver(self, batch, buf + off, chunk, addr);
+            off += chunk;
+        } while (rc == 0 && off < len && !self->closing);
+        Py_DECREF(addr);
+    }
+    if (rc == 0 && batch && PyList_GET_SIZE(batch)) {
+        PyObject *res = PyObject_CallOneArg(self->datagrams_received, batch);
+        if (!res)
+            rc = -1;
+        Py_XDECREF(res);
+    }
+    Py_XDECREF(batch);
+    return rc;
+}
+
+/*
+ * Drain the socket a batch per recvmmsg().  After DGRAM_MAX_ROUNDS full
+ * batches the reader requeues itself so a flood cannot starve the loop;
+ * the edge would not be reported again.
+ */
+static PyObject *
+dg_on_ready(PyDatagramTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    DgramPool *p = _dg_pool(self->loop);
+    if (!p)
+        return _dg_fail(self);
+    for (int round = 0; !self->closing && !self->paused; round++) {
+        if (round == DGRAM_MAX_ROUNDS) {
+            if (_ready_push(self->loop, self->loop->fdmap[self->fd]->reader) < 0)
+                return NULL;
+            Py_RETURN_NONE;
+        }
+        for (int i = 0; i < DGRAM_BATCH; i++) {
+            struct msghdr *h = &p->msgs[i].msg_hdr;
+            h->msg_name = &p->names[i];
+            h->msg_namelen = sizeof(p->names[i]);
+            h->msg_control = self->gro ? p->control[i] : NULL;
+            h->msg_controllen = self->gro ? sizeof(p->control[i]) : 0;
+            h->msg_flags = 0;
+        }
+        int n = recvmmsg(self->fd, p->msgs, DGRAM_BATCH, 0, NULL);
+        self->loop->stats.dgram_syscalls++;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                self->loop->stats.read_eagain++;
+                Py_RETURN_NONE;
+            }
+            int soft = _dg_soft_error(errno);
+            PyErr_SetFromErrno(PyExc_OSError);
+            if (!soft || _dg_error_received(self) < 0)
+                return _dg_fail(self);
+            continue;
+        }
+        if (_dg_dispatch(self, p, n) < 0)
+            return _dg_fail(self);
+        /* a short batch means the next datagram would have blocked */
+        if (n < DGRAM_BATCH)
+            Py_RETURN_NONE;
+    }
+    if (self->paused && !self->closing) {
+        /* paused before EAGAIN: have resume_reading() deliver the rest */
+        self->loop->fdmap[self->fd]->read_missed = 1;
+    }
+    Py_RETURN_NONE;
+}
+
+static inline int
+_dg_same_dest(const DgramOut *a, const DgramOut *b)
+{
+    return a->addrlen == b->addrlen && memcmp(&a->addr, &b->addr, a->addrlen) == 0;
+}
+
+/* Drop the first k queued datagrams after the kernel took or refused them. */
+static void
+_dg_sq_pop(PyDatagramTransportObject *self, int k)
+{
+    while (k--) {
+        DgramOut *o = &self->sq[self->sq_head++];
+        self->sq_bytes -= PyBytes_GET_SIZE(o->data);
+        Py_DECREF(o->data);
+    }
+    if (self->sq_head == self->sq_len)
+        self->sq_head = self->sq_len = 0;
+}
+
+/*
+ * Send the queue with sendmmsg() until it is empty (0) or the socket is
+ * full (1); -1 if error_received() raised.  With UDP_SEGMENT a run of
+ * same-size datagrams to one destination, the last possibly shorter, is
+ * one message the kernel splits.  A refused message is dropped and
+ * reported to error_received() like asyncio does.
+ */
+static int
+_dg_send_queued(PyDatagramTransportObject *self)
+{
+    struct mmsghdr msgs[DGRAM_BATCH];
+    struct iovec iov[DGRAM_BATCH * 8];
+    int segs[DGRAM_BATCH];
+    size_t seglen[DGRAM_BATCH];
+    char ctl[DGRAM_BATCH][CMSG_SPACE(sizeof(uint16_t))];
+    const int max_iov = (int)(sizeof(iov) / sizeof(iov[0]));
+    while (self->sq_head < self->sq_len) {
+        int nmsg = 0, niov = 0;
+        Py_ssize_t i = self->sq_head;
+        while (i < self->sq_len && nmsg < DGRAM_BATCH && niov < max_iov) {
+            DgramOut *first = &self->sq[i];
+            size_t seg = (size_t)PyBytes_GET_SIZE(first->data), total = 0;
+            int gso = self->gso && seg > 0 && seg <= (size_t)self->gso_max_seg;
+            struct msghdr *h = &msgs[nmsg].msg_hdr;
+            memset(h, 0, sizeof(*h));
+            h->msg_name = first->addrlen ? &first->addr : NULL;
+            h->msg_namelen = first->addrlen;
+            h->msg_iov = &iov[niov];
+            int k = 0;
+            for (;;) {
+                size_t len = (size_t)PyBytes_GET_SIZE(self->sq[i].data);
+                iov[niov].iov_base = PyBytes_AS_STRING(self->sq[i].data);
+                iov[niov++].iov_len = len;
+                total += len;
+                k++;
+                i++;
+                if (!gso || len < seg || i == self->sq_len || k == DGRAM_GSO_SEGS ||
+                    niov == max_iov || !_dg_same_dest(first, &self->sq[i]))
+                    break;
+                size_t next = (size_t)PyBytes_GET_SIZE(self->sq[i].data);
+                if (next > seg || total + next > DGRAM_GSO_BYTES)
+                    break;
+            }
+            h->msg_iovlen = (size_t)k;
+            if (k > 1) {
+                h->msg_control = ctl[nmsg];
+                h->msg_controllen = sizeof(ctl[nmsg]);
+                struct cmsghdr *c = CMSG_FIRSTHDR(h);
+                c->cmsg_level = SOL_UDP;
+                c->cmsg_type = UDP_SEGMENT;
+                c->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+                uint16_t s = (uint16_t)seg;
+                memcpy(CMSG_DATA(c), &s, sizeof(s));
+            }
+            segs[nmsg] = k;
+            seglen[nmsg++] = seg;
+        }
+        int n = sendmmsg(self->fd, msgs, (unsigned)nmsg, 0);
+        self->loop->stats.dgram_syscalls++;
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                self->loop->stats.write_eagain++;
+                return 1;
+            }
+            if (segs[0] > 1 && errno == EIO) {
+                /* the device cannot checksum segments: no GSO on this socket */
+                self->gso = 0;
+                continue;
+            }
+            if (segs[0] > 1 && errno == EINVAL) {
+                /* segments above the path MTU; send those one by one */
+                self->gso_max_seg = (int)seglen[0] - 1;
+                continue;
+            }
+            PyErr_SetFromErrno(PyExc_OSError);
+            _dg_sq_pop(self, segs[0]);
+            if (_dg_error_received(self) < 0)
+                return -1;
+            continue;
+        }
+        for (int m = 0; m < n; m++) {
+            for (size_t j = 0; j < msgs[m].msg_hdr.msg_iovlen; j++)
+                self->loop->stats.bytes_sent += msgs[m].msg_hdr.msg_iov[j].iov_len;
+            self->loop->stats.datagrams_sent += (uint64_t)segs[m];
+            _dg_sq_pop(self, segs[m]);
+        }
+    }
+    return 0;
+}
+
+static int
+_dg_set_writer(PyDatagramTransportObject *self, int on)
+{
+    FDCallback *slot = self->loop->fdmap[self->fd];
+    if (on == (slot->writer != NULL))
+        return 0;
+    if (on)
+        slot->writer = Py_NewRef(self->flush_cb);
+    else
+        Py_CLEAR(slot->writer);
+    return _fd_interest(self->loop, self->fd, slot);
+}
+
+/* Call pause_writing()/resume_writing() if present. */
+static int
+_dg_flow(PyDatagramTransportObject *self, const char *name)
+{
+    PyObject *meth;
+    if (_optional_attr(self->protocol, name, &meth) < 0)
+        return -1;
+    if (!meth)
+        return 0;
+    PyObject *res = PyObject_CallNoArgs(meth);
+    Py_DECREF(meth);
+    if (!res)
+        return -1;
+    Py_DECREF(res);
+    return 0;
+}
+
+/* Queued once per loop pass by sendto(), or run as the EPOLLOUT writer. */
+static PyObject *
+dg_flush(PyDatagramTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    self->flush_pending = 0;
+    if (self->fd < 0)
+        Py_RETURN_NONE;
+    int r = _dg_send_queued(self);
+    if (r < 0)
+        return _dg_fail(self);
+    if (r == 1)
+        self->flush_pending = 1;
+    if (_dg_set_writer(self, r == 1) < 0)
         return NULL;
+    if (self->write_paused && self->sq_bytes <= self->low) {
+        self->write_paused = 0;
+        if (_dg_flow(self, "resume_writing") < 0)
+            return _dg_fail(self);
     }
-    Py_XINCREF(cb);
-    Py_XDECREF(slot->writer);
-    slot->writer = cb;
+    if (r == 0 && self->closing && _dg_fatal(self, NULL) < 0)
+        return NULL;
     Py_RETURN_NONE;
 }
 
 static PyObject *
-loop_remove_writer(PyEventLoopObject *self, PyObject *arg)
+dg_sendto(PyDatagramTransportObject *self, PyObject *args, PyObject *kwds)
 {
-    int fd = PyLong_AsLong(arg);
-    if (fd == -1 && PyErr_Occurred())
+    PyObject *data, *addr = Py_None;
+    static char *kwlist[] = {"data", "addr", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O|O:sendto", kwlist, &data, &addr))
         return NULL;
-    if (fd >= self->fdcap || !self->fdmap[fd] || !self->fdmap[fd]->writer)
-        Py_RETURN_FALSE;
-    FDCallback *slot = self->fdmap[fd];
-    Py_CLEAR(slot->writer);
-    uint32_t events = EPOLLET | (slot->reader ? EPOLLIN : 0);
-    int op = events & (EPOLLIN | EPOLLOUT) ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
-    struct epoll_event ev = {.events = events, .data.u32 = (uint32_t)fd};
-    if (epoll_ctl(self->epfd, op, fd, &ev) == -1) {
-        PyErr_SetFromErrno(PyExc_OSError);
+    if (!PyObject_CheckBuffer(data)) {
+        PyErr_Format(PyExc_TypeError, "data argument must be a bytes-like object, not %.100s",
+                     Py_TYPE(data)->tp_name);
         return NULL;
     }
-    Py_RETURN_TRUE;
+    if (self->closing)
+        Py_RETURN_NONE;   /* asyncio drops these too */
+    DgramOut o = {.addrlen = 0};
+    if (addr != Py_None && self->peer) {
+        int eq = PyObject_RichCompareBool(addr, self->peer, Py_EQ);
+        if (eq < 0)
+            return NULL;
+        if (!eq) {
+            PyErr_Format(PyExc_ValueError, "Invalid address: must be None or %R", self->peer);
+            return NULL;
+        }
+    } else if (addr != Py_None) {
+        if (addr != self->last_dst_obj) {
+            if (_dg_parse_addr(self->family, addr, &self->last_dst, &self->last_dstlen) < 0)
+                return NULL;
+            Py_XSETREF(self->last_dst_obj, Py_NewRef(addr));
+        }
+        memcpy(&o.addr, &self->last_dst, self->last_dstlen);
+        o.addrlen = self->last_dstlen;
+    } else if (!self->peer) {
+        PyErr_SetString(PyExc_ValueError, "sendto() needs an address on an unconnected transport");
+        return NULL;
+    }
+    /* bytes are immutable and can be queued as they are */
+    o.data = PyBytes_CheckExact(data) ? Py_NewRef(data) : PyBytes_FromObject(data);
+    if (!o.data)
+        return NULL;
+    if (self->sq_len == self->sq_cap) {
+        if (self->sq_head) {
+            memmove(self->sq, self->sq + self->sq_head,
+                    (size_t)(self->sq_len - self->sq_head) * sizeof(DgramOut));
+            self->sq_len -= self->sq_head;
+            self->sq_head = 0;
+        } else {
+            Py_ssize_t cap = self->sq_cap ? self->sq_cap * 2 : 64;
+            DgramOut *nq = realloc(self->sq, (size_t)cap * sizeof(DgramOut));
+            if (!nq) {
+                Py_DECREF(o.data);
+                return PyErr_NoMemory();
+            }
+            self->sq = nq;
+            self->sq_cap = cap;
+        }
+    }
+    self->sq[self->sq_len++] = o;
+    self->sq_bytes += PyBytes_GET_SIZE(o.data);
+    if (!self->flush_pending) {
+        if (_ready_push(self->loop, self->flush_cb) < 0)
+            return NULL;
+        self->flush_pending = 1;
+    }
+    if (!self->write_paused && self->sq_bytes > self->high) {
+        self->write_paused = 1;
+        if (_dg_flow(self, "pause_writing") < 0)
+            return NULL;
+    }
+    Py_RETURN_NONE;
 }
 
 static PyObject *
-loop_add_signal_handler(PyEventLoopObject *self, PyObject *args)
+dg_call_connection_lost(PyDatagramTransportObject *self, PyObject *Py_UNUSED(ignored))
 {
-    int signo;
-    PyObject *cb;
-    if (!PyArg_ParseTuple(args, "iO:add_signal_handler", &signo, &cb))
+    PyObject *exc = self->lost_exc ? self->lost_exc : Py_None;
+    PyObject *res = PyObject_CallMethod(self->protocol, "connection_lost", "O", exc);
+    Py_CLEAR(self->lost_exc);
+    if (!res)
         return NULL;
-    if (!PyCallable_Check(cb)) {
-        PyErr_SetString(PyExc_TypeError, "callback must be callable");
+    Py_DECREF(res);
+    Py_RETURN_NONE;
+}
+
+/* Stop reading; close once queued datagrams are sent. */
+static PyObject *
+dg_close(PyDatagramTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->closing)
+        Py_RETURN_NONE;
+    self->closing = 1;
+    if (self->sq_head < self->sq_len) {
+        FDCallback *slot = self->loop->fdmap[self->fd];
+        Py_CLEAR(slot->reader);
+        slot->read_paused = slot->read_missed = 0;
+        if (_fd_interest(self->loop, self->fd, slot) < 0)
+            return NULL;
+        Py_RETURN_NONE;   /* the pending _flush finishes the close */
+    }
+    if (_dg_fatal(self, NULL) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+dg_abort(PyDatagramTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (_dg_fatal(self, NULL) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+dg_is_closing(PyDatagramTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyBool_FromLong(self->closing);
+}
+
+static PyObject *
+dg_pause_reading(PyDatagramTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->closing || self->paused)
+        Py_RETURN_NONE;
+    if (_set_read_paused(self->loop, self->fd, 1) < 0)
+        return NULL;
+    self->paused = 1;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+dg_resume_reading(PyDatagramTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (self->closing || !self->paused)
+        Py_RETURN_NONE;
+    self->paused = 0;
+    if (_set_read_paused(self->loop, self->fd, 0) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+dg_is_reading(PyDatagramTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyBool_FromLong(!self->closing && !self->paused);
+}
+
+static PyObject *
+dg_set_write_buffer_limits(PyDatagramTransportObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *high_o = Py_None, *low_o = Py_None;
+    static char *kwlist[] = {"high", "low", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "|OO:set_write_buffer_limits", kwlist,
+                                     &high_o, &low_o))
+        return NULL;
+    Py_ssize_t high = -1, low = -1;
+    if (high_o != Py_None && (high = PyLong_AsSsize_t(high_o)) == -1 && PyErr_Occurred())
+        return NULL;
+    if (low_o != Py_None && (low = PyLong_AsSsize_t(low_o)) == -1 && PyErr_Occurred())
+        return NULL;
+    if (high_o == Py_None)
+        high = low_o == Py_None ? DEFAULT_WRITE_HIGH : 4 * low;
+    if (low_o == Py_None)
+        low = high / 4;
+    if (!(high >= low && low >= 0)) {
+        PyErr_Format(PyExc_ValueError, "high (%zd) must be >= low (%zd) must be >= 0",
+                     high, low);
         return NULL;
     }
-    PyObject *key = PyLong_FromLong(signo);
-    int r = PyDict_SetItem(self->signal_handlers, key, cb);
-    Py_DECREF(key);
-    if (r < 0)
+    self->high = high;
+    self->low = low;
+    if (!self->write_paused && self->sq_bytes > high) {
+        self->write_paused = 1;
+        if (_dg_flow(self, "pause_writing") < 0)
+            return NULL;
+    } else if (self->write_paused && self->sq_bytes <= low) {
+        self->write_paused = 0;
+        if (_dg_flow(self, "resume_writing") < 0)
+            return NULL;
+    }
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+dg_get_write_buffer_limits(PyDatagramTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return Py_BuildValue("(nn)", self->low, self->high);
+}
+
+static PyObject *
+dg_get_write_buffer_size(PyDatagramTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return PyLong_FromSsize_t(self->sq_bytes);
+}
+
+static PyObject *
+dg_get_extra_info(PyDatagramTransportObject *self, PyObject *args)
+{
+    PyObject *name, *dflt = Py_None;
+    if (!PyArg_ParseTuple(args, "O|O:get_extra_info", &name, &dflt))
+        return NULL;
+    PyObject *v = PyDict_GetItemWithError(self->extra, name);
+    if (!v && PyErr_Occurred())
+        return NULL;
+    return Py_NewRef(v ? v : dflt);
+}
+
+static PyObject *
+dg_get_protocol(PyDatagramTransportObject *self, PyObject *Py_UNUSED(ignored))
+{
+    return Py_NewRef(self->protocol);
+}
+
+static PyObject *
+dg_set_protocol(PyDatagramTransportObject *self, PyObject *protocol)
+{
+    if (_dg_bind_protocol(self, protocol) < 0)
         return NULL;
     Py_RETURN_NONE;
 }
 
 static PyObject *
-loop_c_write(PyEventLoopObject *self, PyObject *args)
+dg_get_offload(PyDatagramTransportObject *self, void *Py_UNUSED(closure))
+{
+    return Py_BuildValue("{sOsO}", "gso", self->gso ? Py_True : Py_False,
+                         "gro", self->gro ? Py_True : Py_False);
+}
+
+static PyMethodDef dg_methods[] = {
+    {"_on_ready", (PyCFunction)dg_on_ready, METH_NOARGS,
+     PyDoc_STR("Drain the socket with recvmmsg() and feed the protocol")},
+    {"_flush", (PyCFunction)dg_flush, METH_NOARGS,
+     PyDoc_STR("Send queued datagrams with sendmmsg()")},
+    {"_call_connection_lost", (PyCFunction)dg_call_connection_lost, METH_NOARGS,
+     PyDoc_STR("Deliver the scheduled connection_lost()")},
+    {"sendto", (PyCFunction)(PyCFunctionWithKeywords)dg_sendto, METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Queue a datagram; the queue is flushed once per loop pass")},
+    {"close", (PyCFunction)dg_close, METH_NOARGS,
+     PyDoc_STR("Close after sending queued datagrams")},
+    {"abort", (PyCFunction)dg_abort, METH_NOARGS,
+     PyDoc_STR("Close immediately, discarding queued datagrams")},
+    {"is_closing", (PyCFunction)dg_is_closing, METH_NOARGS,
+     PyDoc_STR("Return True once close() or abort() was called")},
+    {"pause_reading", (PyCFunction)dg_pause_reading, METH_NOARGS,
+     PyDoc_STR("Stop delivering received datagrams")},
+    {"resume_reading", (PyCFunction)dg_resume_reading, METH_NOARGS,
+     PyDoc_STR("Resume delivery of received datagrams")},
+    {"is_reading", (PyCFunction)dg_is_reading, METH_NOARGS,
+     PyDoc_STR("Return True if the transport is receiving")},
+    {"set_write_buffer_limits", (PyCFunction)(PyCFunctionWithKeywords)dg_set_write_buffer_limits,
+     METH_VARARGS | METH_KEYWORDS,
+     PyDoc_STR("Set the high/low watermarks for queued bytes")},
+    {"get_write_buffer_limits", (PyCFunction)dg_get_write_buffer_limits, METH_NOARGS,
+     PyDoc_STR("Return (low, high)")},
+    {"get_write_buffer_size", (PyCFunction)dg_get_write_buffer_size, METH_NOARGS,
+     PyDoc_STR("Return the number of queued bytes")},
+    {"get_extra_info", (PyCFunction)dg_get_extra_info, METH_VARARGS,
+     PyDoc_STR("Return 'socket', 'sockname' or 'peername'")},
+    {"get_protocol", (PyCFunction)dg_get_protocol, METH_NOARGS,
+     PyDoc_STR("Return the current protocol")},
+    {"set_protocol", (PyCFunction)dg_set_protocol, METH_O,
+     PyDoc_STR("Switch to a new protocol")},
+    {NULL, NULL, 0, NULL}
+};
+
+static PyGetSetDef dg_getset[] = {
+    {"offload", (getter)dg_get_offload, NULL,
+     PyDoc_STR("{'gso': bool, 'gro': bool}: the kernel offloads in use"), NULL},
+    {NULL}
+};
+
+static PyTypeObject PyDatagramTransport_Type = {
+    PyVarObject_HEAD_INIT(NULL, 0)
+    .tp_name = "casyncio.DatagramTransport",
+    .tp_basicsize = sizeof(PyDatagramTransportObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_new = PyType_GenericNew,
+    .tp_init = (initproc)dg_init,
+    .tp_traverse = (traverseproc)dg_traverse,
+    .tp_clear = (inquiry)dg_clear,
+    .tp_dealloc = (destructor)dg_dealloc,
+    .tp_methods = dg_methods,
+    .tp_getset = dg_getset,
+};
+
+/* Process */
+
+#ifndef P_PIDFD
+#define P_PIDFD 3
+#endif
+
+extern char **environ;
+
+static int
+proc_traverse(PyProcessObject *self, visitproc visit, void *arg)
+{
+    Py_VISIT(self->loop);
+    Py_VISIT(self->waiters);
+    return 0;
+}
+
+static int
+proc_clear(PyProcessObject *self)
+{
+    Py_CLEAR(self->loop);
+    Py_CLEAR(self->waiters);
+    return 0;
+}
+
+/* Close the pipe ends still held; stdin's queued input is flushed first. */
+static int
+_proc_close_stdio(PyProcessObject *self)
+{
+    for (int i = 0; i < 3; i++) {
+        int fd = self->stdio[i];
+        if (fd < 0)
+            continue;
+        self->stdio[i] = -1;
+        if (!self->loop) {
+            close(fd);
+            continue;
+        }
+        if (i == 0) {
+            PyObject *arg = PyLong_FromLong(fd);
+            PyObject *res = arg ? loop_c_close(self->loop, arg) : NULL;
+            Py_XDECREF(arg);
+            if (!res)
+                return -1;
+            Py_DECREF(res);
+        } else if (_fd_close(self->loop, fd) < 0) {
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void
+proc_dealloc(PyProcessObject *self)
+{
+    PyObject_GC_UnTrack(self);
+    if (_proc_close_stdio(self) < 0)
+        PyErr_WriteUnraisable(NULL);
+    proc_clear(self);
+    Py_TYPE(self)->tp_free((PyObject *)self);
+}
+
+static PyObject *
+proc_new(PyTypeObject *type, PyObject *args, PyObject *kwds)
 {
-    int fd;
-    Py_buffer buf;
-    if (!PyArg_ParseTuple(args, "iy*:write", &fd, &buf))
+    PyProcessObject *self = (PyProcessObject *)type->tp_alloc(type, 0);
+    if (!self)
+        return NULL;
+    self->pidfd = -1;
+    self->stdio[0] = self->stdio[1] = self->stdio[2] = -1;
+    return (PyObject *)self;
+}
+
+/* NULL-terminated array over the fs-encoded items of seq, kept alive by keep. */
+static char **
+_fs_array(PyObject *seq, PyObject *keep)
+{
+    PyObject *fast = PySequence_Fast(seq, "expected a sequence of str or bytes");
+    if (!fast)
         return NULL;
-    if (ensure_fdslot(self, fd) < 0) {
-        PyBuffer_Release(&buf);
+    Py_ssize_t n = PySequence_Fast_GET_SIZE(fast);
+    char **out = PyMem_Calloc((size_t)n + 1, sizeof(char *));
+    if (!out) {
+        Py_DECREF(fast);
+        PyErr_NoMemory();
         return NULL;
     }
-    FDCallback *slot = self->fdmap[fd];
-    if (!slot->obuf) {
-        slot->obuf = outbuf_new();
-        if (!slot->obuf) {
-            PyBuffer_Release(&buf);
+    for (Py_ssize_t i = 0; i < n; i++) {
+        PyObject *b = NULL;
+        if (!PyUnicode_FSConverter(PySequence_Fast_GET_ITEM(fast, i), &b) ||
+            PyList_Append(keep, b) < 0) {
+            Py_XDECREF(b);
+            Py_DECREF(fast);
+            PyMem_Free(out);
             return NULL;
         }
+        out[i] = PyBytes_AS_STRING(b);
+        Py_DECREF(b);
     }
-    OutBuf *ob = slot->obuf;
-    char *newdata = realloc(ob->data, ob->len + buf.len);
-    if (!newdata) {
-        PyBuffer_Release(&buf);
-        PyErr_NoMemory();
+    Py_DECREF(fast);
+    return out;
+}
+
+/* env mapping -> list of b"KEY=VALUE" */
+static PyObject *
+_env_list(PyObject *env)
+{
+    PyObject *items = PyMapping_Items(env);
+    if (!items)
         return NULL;
+    PyObject *out = PyList_New(0);
+    for (Py_ssize_t i = 0; out && i < PyList_GET_SIZE(items); i++) {
+        PyObject *kv = PyList_GET_ITEM(items, i);
+        PyObject *k = NULL, *v = NULL, *entry = NULL;
+        if (PyUnicode_FSConverter(PyTuple_GET_ITEM(kv, 0), &k) &&
+            PyUnicode_FSConverter(PyTuple_GET_ITEM(kv, 1), &v)) {
+            if (!PyBytes_GET_SIZE(k) || strchr(PyBytes_AS_STRING(k), '='))
+                PyErr_SetString(PyExc_ValueError, "illegal environment variable name");
+            else
+                entry = PyBytes_FromFormat("%s=%s", PyBytes_AS_STRING(k), PyBytes_AS_STRING(v));
+        }
+        Py_XDECREF(k);
+        Py_XDECREF(v);
+        if (!entry || PyList_Append(out, entry) < 0)
+            Py_CLEAR(out);
+        Py_XDECREF(entry);
     }
-    memcpy(newdata + ob->len, buf.buf, buf.len);
-    ob->data = newdata;
-    ob->len += buf.len;
-    PyBuffer_Release(&buf);
+    Py_DECREF(items);
+    return out;
+}
 
-    int res = socket_write_now(fd, ob);
-    if (res == -1) {
-        PyErr_SetFromErrno(PyExc_OSError);
-        return NULL;
+static int
+_stdio_spec(PyObject *obj, int i, int *out)
+{
+    if (obj == Py_None) {
+        *out = PROC_INHERIT;
+        return 0;
     }
-    if (res == 1) {
-        int op = (slot->reader || slot->writer) ? EPOLL_CTL_MOD : EPOLL_CTL_ADD;
-        uint32_t events = EPOLLET | EPOLLOUT | (slot->reader ? EPOLLIN : 0);
-        struct epoll_event ev = {.events = events, .data.u32 = (uint32_t)fd};
-        if (epoll_ctl(self->epfd, op, fd, &ev) == -1) {
-            PyErr_SetFromErrno(PyExc_OSError);
-            return NULL;
+    long v = PyLong_AsLong(obj);
+    if (v == -1 && PyErr_Occurred())
+        return -1;
+    if (v > INT_MAX) {
+        PyErr_SetString(PyExc_OverflowError, "fd is greater than maximum");
+        return -1;
+    }
+    if (v < PROC_DEVNULL || (v == PROC_STDOUT && i != 2)) {
+        PyErr_Format(PyExc_ValueError, "invalid %s", i == 0 ? "stdin" : i == 1 ? "stdout" : "stderr");
+        return -1;
+    }
+    *out = (int)v;
+    return 0;
+}
+
+/*
+ * Fork-free spawn: glibc's posix_spawn() runs the child on the parent's
+ * address space (CLONE_VM | CLONE_VFORK) until exec, so the cost does not
+ * grow with the parent's size.  Returns 0 or an errno value.
+ */
+static int
+_proc_spawn(const char *path, char *const argv[], char *const envp[], const char *cwd,
+            const int spec[3], int parent[3], pid_t *pid)
+{
+    posix_spawn_file_actions_t fa;
+    posix_spawnattr_t attr;
+    int child[3] = {-1, -1, -1};
+    int err = posix_spawn_file_actions_init(&fa);
+    if (err)
+        return err;
+    err = posix_spawnattr_init(&attr);
+    if (err) {
+        posix_spawn_file_actions_destroy(&fa);
+        return err;
+    }
+    for (int i = 0; i < 3 && !err; i++) {
+        if (spec[i] == PROC_INHERIT) {
+            continue;
+        } else if (spec[i] == PROC_PIPE) {
+            int p[2];
+            if (pipe2(p, O_CLOEXEC) == -1) {
+                err = errno;
+                break;
+            }
+            parent[i] = i == 0 ? p[1] : p[0];
+            child[i] = i == 0 ? p[0] : p[1];
+            int fl = fcntl(parent[i], F_GETFL);
+            if (fl == -1 || fcntl(parent[i], F_SETFL, fl | O_NONBLOCK) == -1)
+                err = errno;
+            else
+                err = posix_spawn_file_actions_adddup2(&fa, child[i], i);
+        } else if (spec[i] == PROC_DEVNULL) {
+            err = posix_spawn_file_actions_addopen(&fa, i, "/dev/null",
+                                                   i == 0 ? O_RDONLY : O_WRONLY, 0);
+        } else if (spec[i] == PROC_STDOUT) {
+            err = posix_spawn_file_actions_adddup2(&fa, 1, 2);
+        } else {
+            err = posix_spawn_file_actions_adddup2(&fa, spec[i], i);
         }
     }
-    Py_RETURN_NONE;
+    if (!err && cwd)
+        err = posix_spawn_file_actions_addchdir_np(&fa, cwd);
+    if (!err) {
+        /* the loop's signals are blocked for the signalfd; the child starts clean */
+        sigset_t none, dfl;
+        sigemptyset(&none);
+        sigemptyset(&dfl);
+        sigaddset(&dfl, SIGPIPE);
+        sigaddset(&dfl, SIGXFSZ);
+        posix_spawnattr_setsigmask(&attr, &none);
+        posix_spawnattr_setsigdefault(&attr, &dfl);
+        err = posix_spawnattr_setflags(&attr, POSIX_SPAWN_SETSIGMASK | POSIX_SPAWN_SETSIGDEF);
+    }
+    if (!err) {
+        Py_BEGIN_ALLOW_THREADS
+        if (strchr(path, '/'))
+            err = posix_spawn(pid, path, &fa, &attr, argv, envp);
+        else
+            err = posix_spawnp(pid, path, &fa, &attr, argv, envp);
+        Py_END_ALLOW_THREADS
+    }
+    posix_spawnattr_destroy(&attr);
+    posix_spawn_file_actions_destroy(&fa);
+    for (int i = 0; i < 3; i++) {
+        if (child[i] >= 0)
+            close(child[i]);
+        if (err && parent[i] >= 0) {
+            close(parent[i]);
+            parent[i] = -1;
+        }
+    }
+    return err;
+}
+
+static int
+proc_init(PyProcessObject *self, PyObject *args, PyObject *kwds)
+{
+    PyObject *loop, *argseq, *executable = Py_None, *cwd = Py_None, *env = Py_None;
+    PyObject *stdio_obj[3] = {Py_None, Py_None, Py_None};
+    static char *kwlist[] = {"loop", "args", "executable", "cwd", "env", "stdin", "stdout",
+                             "stderr", NULL};
+    if (!PyArg_ParseTupleAndKeywords(args, kwds, "O!O|$OOOOOO:Process", kwlist,
+                                     &PyEventLoop_Type, &loop, &argseq, &executable, &cwd,
+                                     &env, &stdio_obj[0], &stdio_obj[1], &stdio_obj[2]))
+        return -1;
+    if (self->pid) {
+        PyErr_SetString(PyExc_RuntimeError, "Process already started");
+        return -1;
+    }
+    int spec[3];
+    for (int i = 0; i < 3; i++)
+        if (_stdio_spec(stdio_obj[i], i, &spec[i]) < 0)
+            return -1;
+    if (PyObject_Length(argseq) <= 0) {
+        if (!PyErr_Occurred())
+            PyErr_SetString(PyExc_ValueError, "args must not be empty");
+        return -1;
+    }
+
+    int rc = -1;
+    char **argv = NULL, **envp = NULL;
+    PyObject *path_obj = NULL, *cwd_b = NULL, *envlist = NULL;
+    PyObject *keep = PyList_New(0);
+    if (!keep)
+        return -1;
+    argv = _fs_array(argseq, keep);
+    if (!argv)
+        goto done;
+    path_obj = executable != Py_None ? Py_NewRef(executable) : PySequence_GetItem(argseq, 0);
+    PyObject *path_b = NULL;
+    if (!path_obj || !PyUnicode_FSConverter(path_obj, &path_b))
+        goto done;
+    int app = PyList_Append(keep, path_b);
+    Py_DECREF(path_b);
+    if (app < 0)
+        goto done;
+    if (cwd != Py_None && !PyUnicode_FSConverter(cwd, &cwd_b))
+        goto done;
+    if (env != Py_None) {
+        envlist = _env_list(env);
+        if (!envlist || !(envp = _fs_array(envlist, keep)))
+            goto done;
+    }
+
+    int parent[3] = {-1, -1, -1};
+    pid_t pid;
+    int err = _proc_spawn(PyBytes_AS_STRING(path_b), argv, envp ? envp : environ,
+                          cwd_b ? PyBytes_AS_STRING(cwd_b) : NULL, spec, parent, &pid);
+    if (err) {
+        errno = err;
+        PyErr_SetFromErrnoWithFilenameObject(PyExc_OSError, err == ENOENT && cwd_b &&
+                                             access(PyBytes_AS_STRING(cwd_b), F_OK) ? cwd : path_obj);
+        goto done;
+    }
+    /* the child is ours until reaped, so its pid cannot be recycled under the pidfd */
+    int pidfd = (int)syscall(__NR_pidfd_open, pid, 0);
+    PyObject *cb = NULL;
+    if (pidfd == -1)
+        PyErr_SetFromErrno(PyExc_OSError);
+    else if ((cb = PyObject_GetAttrString((PyObject *)self, "_on_exit")) &&
+             _set_reader((PyEventLoopObject *)loop, pidfd, cb) == 0)
+        rc = 0;
+    Py_XDECREF(cb);
+    if (rc < 0) {
+        if (pidfd != -1)
+            close(pidfd);
+        kill(pid, SIGKILL);
+        waitpid(pid, NULL, 0);
+        for (int i = 0; i < 3; i++)
+            if (parent[i] >= 0)
+                close(parent[i]);
+        goto done;
+    }
+    Py_XSETREF(self->loop, (PyEventLoopObject *)Py_NewRef(loop));
+    self->pid = pid;
+    self->pidfd = pidfd;
+    memcpy(self->stdio, parent, sizeof(parent));
+
+done:
+    PyMem_Free(argv);
+    PyMem_Free(envp);
+    Py_XDECREF(path_obj);
+    Py_XDECREF(cwd_b);
+    Py_XDECREF(envlist);
+    Py_DECREF(keep);
+    return rc;
 }
 
 static PyObject *
-loop_c_drain_waiter(PyEventLoopObject *self, PyObject *arg)
+proc_on_exit(PyProcessObject *self, PyObject *Py_UNUSED(ignored))
 {
-    int fd = PyLong_AsLong(arg);
-    if (fd == -1 && PyErr_Occurred())
+    if (self->pidfd < 0)
+        Py_RETURN_NONE;
+    siginfo_t si;
+    si.si_pid = 0;
+    if (waitid(P_PIDFD, (id_t)self->pidfd, &si, WEXITED | WNOHANG) == -1) {
+        if (errno == EINTR)
+            Py_RETURN_NONE;
+        if (errno != ECHILD)
+            return PyErr_SetFromErrno(PyExc_OSError);
+        /* reaped behind our back by someone else's waitpid(-1) */
+        self->returncode = 255;
+    } else if (si.si_pid == 0) {
+        Py_RETURN_NONE;
+    } else {
+        self->returncode = si.si_code == CLD_EXITED ? si.si_status : -si.si_status;
+    }
+    int fd = self->pidfd;
+    self->pidfd = -1;
+    if (_fd_close(self->loop, fd) < 0)
         return NULL;
-
-    PyObject *asyncio = PyImport_ImportModule("asyncio");
-    if (!asyncio)
+    PyObject *waiters = self->waiters;
+    self->waiters = NULL;
+    if (!waiters)
+        Py_RETURN_NONE;
+    PyObject *code = PyLong_FromLong(self->returncode);
+    int rc = code ? 0 : -1;
+    for (Py_ssize_t i = 0; rc == 0 && i < PyList_GET_SIZE(waiters); i++) {
+        PyObject *fut = PyList_GET_ITEM(waiters, i);
+        int done = _future_done(fut);
+        if (done < 0 || (!done && _future_resolve(fut, code, NULL) < 0))
+            rc = -1;
+    }
+    Py_XDECREF(code);
+    Py_DECREF(waiters);
+    if (rc < 0)
         return NULL;
-    PyObject *Future = PyObject_GetAttrString(asyncio, "Future");
-    Py_DECREF(asyncio);
-    if (!Future)
+    Py_RETURN_NONE;
+}
+
+static PyObject *
+proc_wait(PyProcessObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (!self->loop) {
+        PyErr_SetString(PyExc_RuntimeError, "Process not started");
         return NULL;
-    PyObject *fut = PyObject_CallNoArgs(Future);
-    Py_DECREF(Future);
+    }
+    PyObject *fut = _new_future((PyObject *)self->loop);
     if (!fut)
         return NULL;
-
-    if (fd >= self->fdcap || !self->fdmap[fd] || !self->fdmap[fd]->obuf ||
-        self->fdmap[fd]->obuf->pos >= self->fdmap[fd]->obuf->len) {
-        PyObject *res = PyObject_CallMethod(fut, "set_result", "O", Py_None);
-        Py_XDECREF(res);
-        if (!res) {
-            Py_DECREF(fut);
-            return NULL;
-        }
+    if (self->pidfd < 0) {
+        PyObject *code = PyLong_FromLong(self->returncode);
+        int rc = code ? _future_resolve(fut, code, NULL) : -1;
+        Py_XDECREF(code);
+        if (rc < 0)
+            Py_CLEAR(fut);
         return fut;
     }
-
-    OutBuf *ob = self->fdmap[fd]->obuf;
-    if (PyList_Append(ob->waiters, fut) < 0) {
+    if (!self->waiters && !(self->waiters = PyList_New(0))) {
         Py_DECREF(fut);
         return NULL;
     }
+    if (PyList_Append(self->waiters, fut) < 0)
+        Py_CLEAR(fut);
     return fut;
 }
 
 static PyObject *
-loop_run_forever(PyEventLoopObject *self, PyObject *Py_UNUSED(ignored))
+proc_send_signal(PyProcessObject *self, PyObject *arg)
 {
-    self->running = 1;
-    struct epoll_event evs[64];
-
-    while (self->running) {
-        while (PyList_Size(self->ready_q) > 0) {
-            PyObject *callback = PyList_GetItem(self->ready_q, 0);
-            if (!callback)
-                return NULL;
-            Py_INCREF(callback);
-            if (PySequence_DelItem(self->ready_q, 0) < 0) {
-                Py_DECREF(callback);
-                return NULL;
-            }
-
-            PyObject *res = PyObject_CallNoArgs(callback);
-            Py_DECREF(callback);
-            if (!res)
-                return NULL;
-            Py_DECREF(res);
-        }
-
-        if (!self->running)
-            break;
-
-        int have_watchers = 0;
-        for (int i = 0; i < self->fdcap; i++) {
-            FDCallback *s = self->fdmap[i];
-            if (s && (s->reader || s->writer)) {
-                have_watchers = 1;
-                break;
-            }
-        }
-        if (!have_watchers)
-            break;
-
-        int n;
-        int timeout_ms = -1;
-        TimerNode *next = _heap_peek(self);
-        if (next) {
-            struct timespec now;
-            clock_gettime(CLOCK_MONOTONIC, &now);
-            int64_t now_ns = (int64_t)now.tv_sec * 1000000000 + now.tv_nsec;
-            int64_t diff_ns = next->deadline_ns - now_ns;
-            timeout_ms = diff_ns <= 0 ? 0 : (int)(diff_ns / 1000000);
-        }
-        Py_BEGIN_ALLOW_THREADS
-        n = epoll_wait(self->epfd, evs, 64, timeout_ms);
-        Py_END_ALLOW_THREADS
-        if (n == -1) {
-            PyErr_SetFromErrno(PyExc_OSError);
-            self->running = 0;
-            return NULL;
-        }
+    int sig = (int)PyLong_AsLong(arg);
+    if (sig == -1 && PyErr_Occurred())
+        return NULL;
+    /* through the pidfd: never a recycled pid, and a no-op once reaped */
+    if (self->pidfd >= 0 &&
+        syscall(__NR_pidfd_send_signal, self->pidfd, sig, NULL, 0) == -1 && errno != ESRCH)
+        return PyErr_SetFromErrno(PyExc_OSError);
+    Py_RETURN_NONE;
+}
 
-        for (int i = 0; i < n; i++) {
-            int fd = (int)evs[i].data.u32;
-            if (fd == self->sfd) {
-                struct signalfd_siginfo si;
-                while (read(self->sfd, &si, sizeof(si)) == sizeof(si)) {
-                    PyObject *key = PyLong_FromLong((long)si.ssi_signo);
-                    PyObject *cb = PyDict_GetItemWithError(self->signal_handlers, key);
-                    Py_DECREF(key);
-                    if (cb) {
-                        if (PyList_Append(self->ready_q, cb) < 0)
-                            return NULL;
-                    } else if (PyErr_Occurred()) {
-                        return NULL;
-                    }
-                }
-                continue;
-            }
-            if (fd == self->aw_rfd) {
-                char buf[64];
-                while (read(self->aw_rfd, buf, sizeof(buf)) > 0)
-                    ;
-                continue;
-            }
-            if (fd >= self->fdcap)
-                continue;
-            FDCallback *slot = self->fdmap[fd];
-            if (!slot)
-                continue;
-            if ((evs[i].events & EPOLLIN) && slot->reader) {
-                if (PyList_Append(self->ready_q, slot->reader) < 0)
-                    return NULL;
-            }
-            if (evs[i].events & EPOLLOUT) {
-                if (slot->obuf) {
-                    int r = socket_write_now(fd, slot->obuf);
-                    if (r == -1) {
-                        PyErr_SetFromErrno(PyExc_OSError);
-                        return NULL;
-                    }
-                    if (slot->obuf->pos >= slot->obuf->len) {
-                        free(slot->obuf->data);
-                        slot->obuf->data = NULL;
-                        slot->obuf->len = slot->obuf->pos = 0;
-
-                        Py_ssize_t nw = PyList_Size(slot->obuf->waiters);
-                        for (Py_ssize_t j = 0; j < nw; j++) {
-                            PyObject *fut = PyList_GetItem(slot->obuf->waiters, j);
-                            if (!fut)
-                                return NULL;
-                            PyObject *res = PyObject_CallMethod(fut, "set_result", "O", Py_None);
-                            Py_XDECREF(res);
-                        }
-                        if (PyList_SetSlice(slot->obuf->waiters, 0, nw, NULL) < 0)
-                            return NULL;
+static PyObject *
+proc_close_stdin(PyProcessObject *self, PyObject *Py_UNUSED(ignored))
+{
+    int fd = self->stdio[0];
+    if (fd < 0)
+        Py_RETURN_NONE;
+    self->stdio[0] = -1;
+    PyObject *arg = PyLong_FromLong(fd);
+    if (!arg)
+        return NULL;
+    PyObject *res = loop_c_close(self->loop, arg);
+    Py_DECREF(arg);
+    return res;
+}
 
-                        if (!slot->writer) {
-                            uint32_t events = EPOLLET | (slot->reader ? EPOLLIN : 0);
-                            int op = events ? EPOLL_CTL_MOD : EPOLL_CTL_DEL;
-                            struct epoll_event ev = {.events = events, .data.u32 = (uint32_t)fd};
-                            if (epoll_ctl(self->epfd, op, fd, &ev) == -1) {
-                                PyErr_SetFromErrno(PyExc_OSError);
-                                return NULL;
-                            }
-                        }
-                    }
-                }
-                if (slot->writer) {
-                    if (PyList_Append(self->ready_q, slot->writer) < 0)
-                        return NULL;
-                }
-            }
-        }
+static PyObject *
+proc_close(PyProcessObject *self, PyObject *Py_UNUSED(ignored))
+{
+    if (_proc_close_stdio(self) < 0)
+        return NULL;
+    Py_RETURN_NONE;
+}
 
-        /* handle expired timers */
-        struct timespec now2;
-        clock_gettime(CLOCK_MONOTONIC, &now2);
-        int64_t now2_ns = (int64_t)now2.tv_sec * 1000000000 + now2.tv_nsec;
-        while ((next = _heap_peek(self)) && next->deadline_ns <= now2_ns) {
-            TimerNode *expired = _heap_pop(self);
-            if (!expired->canceled) {
-                if (PyList_Append(self->ready_q, expired->callback) < 0) {
-                    Py_DECREF(expired->callback);
-                    PyMem_Free(expired);
-                    return NULL;
-                }
-            }
-            Py_DECREF(expired->callback);
-            PyMem_Free(expired);
-        }
-    }
+static PyObject *
+proc_get_pid(PyProcessObject *self, void *Py_UNUSED(closure))
+{
+    return PyLong_FromLong(self->pid);
+}
 
-    self->running = 0;
-    Py_RETURN_NONE;
+static PyObject *
+proc_get_returncode(PyProcessObject *self, void *Py_UNUSED(closure))
+{
+    if (!self->pid || self->pidfd >= 0)
+        Py_RETURN_NONE;
+    return PyLong_FromLong(self->returncode);
 }
 
 static PyObject *
-loop_stop(PyEventLoopObject *self, PyObject *Py_UNUSED(ignored))
+proc_get_stdio(PyProcessObject *self, void *closure)
 {
-    self->running = 0;
-    Py_RETURN_NONE;
+    int fd = self->stdio[(intptr_t)closure];
+    if (fd < 0)
+        Py_RETURN_NONE;
+    return PyLong_FromLong(fd);
 }
 
-static PyMethodDef loop_methods[] = {
-    {"call_soon", (PyCFunction)loop_call_soon, METH_O,
-     PyDoc_STR("Schedule a callback to run soon")},
-    {"call_soon_threadsafe", (PyCFunction)loop_call_soon_threadsafe, METH_O,
-     PyDoc_STR("Thread-safe variant of call_soon")},
-    {"call_later", (PyCFunction)(PyCFunctionWithKeywords)loop_call_later,
-     METH_VARARGS | METH_KEYWORDS,
-     PyDoc_STR("Schedule a callback to run after a delay")},
-    {"create_task", (PyCFunction)(PyCFunctionWithKeywords)loop_create_task,
-     METH_VARARGS | METH_KEYWORDS,
-     PyDoc_STR("Create a Task object")},
-    {"add_reader", (PyCFunction)loop_add_reader, METH_VARARGS,
-     PyDoc_STR("Register a reader callback for a file descriptor")},
-    {"remove_reader", (PyCFunction)loop_remove_reader, METH_O,
-     PyDoc_STR("Remove reader callback for a file descriptor")},
-    {"add_writer", (PyCFunction)loop_add_writer, METH_VARARGS,
-     PyDoc_STR("Register a writer callback for a file descriptor")},
-    {"remove_writer", (PyCFunction)loop_remove_writer, METH_O,
-     PyDoc_STR("Remove writer callback for a file descriptor")},
-    {"add_signal_handler", (PyCFunction)loop_add_signal_handler, METH_VARARGS,
-     PyDoc_STR("Register a callback for a signal")},
-    {"_c_write", (PyCFunction)loop_c_write, METH_VARARGS,
-     PyDoc_STR("Low level write with buffering")},
-    {"_c_drain_waiter", (PyCFunction)loop_c_drain_waiter, METH_O,
-     PyDoc_STR("Return Future resolved when buffer drained")},
-    {"run_forever", (PyCFunction)loop_run_forever, METH_NOARGS,
-     PyDoc_STR("Run callbacks until queue is empty")},
-    {"stop", (PyCFunction)loop_stop, METH_NOARGS,
-     PyDoc_STR("Stop the running loop")},
-    {NULL, NULL, 0, NULL},
+static PyMethodDef proc_methods[] = {
+    {"_on_exit", (PyCFunction)proc_on_exit, METH_NOARGS,
+     PyDoc_STR("Reap the child once its pidfd is readable")},
+    {"wait", (PyCFunction)proc_wait, METH_NOARGS,
+     PyDoc_STR("Future resolved with the return code")},
+    {"send_signal", (PyCFunction)proc_send_signal, METH_O,
+     PyDoc_STR("Signal the child through its pidfd; ignored once it has exited")},
+    {"close_stdin", (PyCFunction)proc_close_stdin, METH_NOARGS,
+     PyDoc_STR("Close the stdin pipe once queued input is written")},
+    {"close", (PyCFunction)proc_close, METH_NOARGS,
+     PyDoc_STR("Close every pipe end still open")},
+    {NULL, NULL, 0, NULL}
 };
 
-static PyTypeObject PyEventLoop_Type = {
+static PyGetSetDef proc_getset[] = {
+    {"pid", (getter)proc_get_pid, NULL, PyDoc_STR("Child process id"), NULL},
+    {"returncode", (getter)proc_get_returncode, NULL,
+     PyDoc_STR("Exit status, -signal if killed, or None while running"), NULL},
+    {"stdin", (getter)proc_get_stdio, NULL, PyDoc_STR("Write end of the stdin pipe, or None"),
+     (void *)0},
+    {"stdout", (getter)proc_get_stdio, NULL, PyDoc_STR("Read end of the stdout pipe, or None"),
+     (void *)1},
+    {"stderr", (getter)proc_get_stdio, NULL, PyDoc_STR("Read end of the stderr pipe, or None"),
+     (void *)2},
+    {NULL},
+};
+
+static PyTypeObject PyProcess_Type = {
     PyVarObject_HEAD_INIT(NULL, 0)
-    .tp_name = "casyncio.EventLoop",
-    .tp_basicsize = sizeof(PyEventLoopObject),
-    .tp_flags = Py_TPFLAGS_DEFAULT,
-    .tp_new = PyType_GenericNew,
-    .tp_init = (initproc)loop_init,
-    .tp_dealloc = (destructor)loop_dealloc,
-    .tp_methods = loop_methods,
+    .tp_name = "casyncio.Process",
+    .tp_basicsize = sizeof(PyProcessObject),
+    .tp_flags = Py_TPFLAGS_DEFAULT | Py_TPFLAGS_HAVE_GC,
+    .tp_new = proc_new,
+    .tp_init = (initproc)proc_init,
+    .tp_traverse = (traverseproc)proc_traverse,
+    .tp_clear = (inquiry)proc_clear,
+    .tp_dealloc = (destructor)proc_dealloc,
+    .tp_methods = proc_methods,
+    .tp_getset = proc_getset,
 };
 
 static PyMethodDef casyncio_methods[] = {
@@ -759,6 +8135,24 @@ PyInit_casyncio(void)
     PyObject *m;
     if (PyType_Ready(&PyEventLoop_Type) < 0)
         return NULL;
+    if (PyType_Ready(&PyHandle_Type) < 0)
+        return NULL;
+    if (PyType_Ready(&PyTimerHandle_Type) < 0)
+        return NULL;
+    if (PyType_Ready(&PyStreamReader_Type) < 0)
+        return NULL;
+    if (PyType_Ready(&PyListener_Type) < 0)
+        return NULL;
+    if (PyType_Ready(&PySocketTransport_Type) < 0)
+        return NULL;
+    if (PyType_Ready(&PyDatagramTransport_Type) < 0)
+        return NULL;
+    if (PyType_Ready(&PyFuture_Type) < 0)
+        return NULL;
+    if (PyType_Ready(&PyTask_Type) < 0)
+        return NULL;
+    if (PyType_Ready(&PyProcess_Type) < 0)
+        return NULL;
 
     m = PyModule_Create(&casyncio_module);
     if (!m)
@@ -770,6 +8164,60 @@ PyInit_casyncio(void)
         Py_DECREF(m);
         return NULL;
     }
+    Py_INCREF(&PyHandle_Type);
+    if (PyModule_AddObject(m, "Handle", (PyObject *)&PyHandle_Type) < 0) {
+        Py_DECREF(&PyHandle_Type);
+        Py_DECREF(m);
+        return NULL;
+    }
+    Py_INCREF(&PyTimerHandle_Type);
+    if (PyModule_AddObject(m, "TimerHandle", (PyObject *)&PyTimerHandle_Type) < 0) {
+        Py_DECREF(&PyTimerHandle_Type);
+        Py_DECREF(m);
+        return NULL;
+    }
+    Py_INCREF(&PyStreamReader_Type);
+    if (PyModule_AddObject(m, "StreamReader", (PyObject *)&PyStreamReader_Type) < 0) {
+        Py_DECREF(&PyStreamReader_Type);
+        Py_DECREF(m);
+        return NULL;
+    }
+    Py_INCREF(&PyListener_Type);
+    if (PyModule_AddObject(m, "Listener", (PyObject *)&PyListener_Type) < 0) {
+        Py_DECREF(&PyListener_Type);
+        Py_DECREF(m);
+        return NULL;
+    }
+    Py_INCREF(&PySocketTransport_Type);
+    if (PyModule_AddObject(m, "SocketTransport", (PyObject *)&PySocketTransport_Type) < 0) {
+        Py_DECREF(&PySocketTransport_Type);
+        Py_DECREF(m);
+        return NULL;
+    }
+    Py_INCREF(&PyDatagramTransport_Type);
+    if (PyModule_AddObject(m, "DatagramTransport", (PyObject *)&PyDatagramTransport_Type) < 0) {
+        Py_DECREF(&PyDatagramTransport_Type);
+        Py_DECREF(m);
+        return NULL;
+    }
+    Py_INCREF(&PyFuture_Type);
+    if (PyModule_AddObject(m, "Future", (PyObject *)&PyFuture_Type) < 0) {
+        Py_DECREF(&PyFuture_Type);
+        Py_DECREF(m);
+        return NULL;
+    }
+    Py_INCREF(&PyTask_Type);
+    if (PyModule_AddObject(m, "Task", (PyObject *)&PyTask_Type) < 0) {
+        Py_DECREF(&PyTask_Type);
+        Py_DECREF(m);
+        return NULL;
+    }
+    Py_INCREF(&PyProcess_Type);
+    if (PyModule_AddObject(m, "Process", (PyObject *)&PyProcess_Type) < 0) {
+        Py_DECREF(&PyProcess_Type);
+        Py_DECREF(m);
+        return NULL;
+    }
 
     return m;
 }
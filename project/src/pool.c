@@ -0,0 +1,165 @@
+#include "loop.h"
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <sys/eventfd.h>
+
+/*
+ * Worker threads for blocking calls.  Jobs wait in a mutex-protected FIFO;
+ * finished jobs are pushed onto a lock-free stack that the loop thread
+ * takes whole, so delivering a burst of completions costs one exchange and
+ * at most one eventfd wakeup.  Threads are started on demand up to the
+ * limit and never touch the interpreter unless a job's run() does.
+ */
+struct WorkPool {
+    pthread_mutex_t mu;
+    pthread_cond_t cv;
+    PoolJob *head;          /* queued jobs, oldest first */
+    PoolJob *tail;
+    unsigned queued;
+    unsigned idle;          /* workers blocked on cv */
+    unsigned nthreads;
+    unsigned max_threads;
+    int stopping;
+    pthread_t *threads;
+    PoolJob *done_top;      /* finished jobs, newest first */
+    int efd;                /* the loop's wakeup eventfd */
+    int *sleeping;          /* the loop's xq_sleeping flag */
+};
+
+static void
+_pool_post(struct WorkPool *p, PoolJob *job)
+{
+    job->next = __atomic_load_n(&p->done_top, __ATOMIC_RELAXED);
+    while (!__atomic_compare_exchange_n(&p->done_top, &job->next, job, 1,
+                                        __ATOMIC_SEQ_CST, __ATOMIC_RELAXED))
+        ;
+    if (__atomic_exchange_n(p->sleeping, 0, __ATOMIC_SEQ_CST))
+        (void)eventfd_write(p->efd, 1);
+}
+
+static void *
+_pool_worker(void *arg)
+{
+    struct WorkPool *p = arg;
+    pthread_mutex_lock(&p->mu);
+    for (;;) {
+        while (!p->head && !p->stopping) {
+            p->idle++;
+            pthread_cond_wait(&p->cv, &p->mu);
+            p->idle--;
+        }
+        if (p->stopping)
+            break;
+        PoolJob *job = p->head;
+        p->head = job->next;
+        if (!p->head)
+            p->tail = NULL;
+        p->queued--;
+        pthread_mutex_unlock(&p->mu);
+        job->run(job);
+        _pool_post(p, job);
+        pthread_mutex_lock(&p->mu);
+    }
+    pthread_mutex_unlock(&p->mu);
+    return NULL;
+}
+
+struct WorkPool *
+pool_open(unsigned max_threads, int efd, int *sleeping)
+{
+    struct WorkPool *p = calloc(1, sizeof(*p));
+    if (!p)
+        return NULL;
+    p->threads = calloc(max_threads, sizeof(pthread_t));
+    if (!p->threads) {
+        free(p);
+        return NULL;
+    }
+    pthread_mutex_init(&p->mu, NULL);
+    pthread_cond_init(&p->cv, NULL);
+    p->max_threads = max_threads;
+    p->efd = efd;
+    p->sleeping = sleeping;
+    return p;
+}
+
+/* Queue job; starts a worker when none is free.  -1 with errno set. */
+int
+pool_submit(struct WorkPool *p, PoolJob *job)
+{
+    job->next = NULL;
+    pthread_mutex_lock(&p->mu);
+    if (p->queued + 1 > p->idle && p->nthreads < p->max_threads) {
+        int rc = pthread_create(&p->threads[p->nthreads], NULL, _pool_worker, p);
+        if (rc == 0) {
+            p->nthreads++;
+        } else if (p->nthreads == 0) {
+            pthread_mutex_unlock(&p->mu);
+            errno = rc;
+            return -1;
+        }
+        /* otherwise the running workers get to it */
+    }
+    if (p->tail)
+        p->tail->next = job;
+    else
+        p->head = job;
+    p->tail = job;
+    p->queued++;
+    pthread_cond_signal(&p->cv);
+    pthread_mutex_unlock(&p->mu);
+    return 0;
+}
+
+int
+pool_has_done(struct WorkPool *p)
+{
+    return __atomic_load_n(&p->done_top, __ATOMIC_SEQ_CST) != NULL;
+}
+
+/* Take every finished job, oldest first. */
+PoolJob *
+pool_take_done(struct WorkPool *p)
+{
+    PoolJob *job = __atomic_exchange_n(&p->done_top, NULL, __ATOMIC_ACQUIRE);
+    PoolJob *fifo = NULL;
+    while (job) {
+        PoolJob *next = job->next;
+        job->next = fifo;
+        fifo = job;
+        job = next;
+    }
+    return fifo;
+}
+
+/*
+ * Stop and join the workers; jobs already running finish first.  Returns
+ * every job that was not delivered (queued or finished) for the caller to
+ * free.  Call without the GIL: a running job may need it.
+ */
+PoolJob *
+pool_close(struct WorkPool *p)
+{
+    pthread_mutex_lock(&p->mu);
+    p->stopping = 1;
+    PoolJob *left = p->head;
+    p->head = p->tail = NULL;
+    p->queued = 0;
+    pthread_cond_broadcast(&p->cv);
+    pthread_mutex_unlock(&p->mu);
+    for (unsigned i = 0; i < p->nthreads; i++)
+        pthread_join(p->threads[i], NULL);
+    PoolJob *done = pool_take_done(p);
+    while (done) {
+        PoolJob *next = done->next;
+        done->next = left;
+        left = done;
+        done = next;
+    }
+    pthread_mutex_destroy(&p->mu);
+    pthread_cond_destroy(&p->cv);
+    free(p->threads);
+    free(p);
+    return left;
+}
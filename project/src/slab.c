@@ -0,0 +1,109 @@
+#include "loop.h"
+#include <stdlib.h>
+
+/* Size class index for a request, or -1 when it is too large to pool. */
+static int
+_bufpool_class(size_t size)
+{
+    int c = 0;
+    while (c < BUFPOOL_CLASSES && ((size_t)1 << (BUFPOOL_MIN_SHIFT + c)) < size)
+        c++;
+    return c < BUFPOOL_CLASSES ? c : -1;
+}
+
+/*
+ * A buffer of at least *size bytes, with *size set to its real capacity;
+ * that capacity is what bufpool_put() must be given back.  NULL when out
+ * of memory.
+ */
+void *
+bufpool_get(BufPool *p, size_t *size)
+{
+    int c = _bufpool_class(*size);
+    if (c < 0 || !p)
+        return malloc(*size);
+    *size = (size_t)1 << (BUFPOOL_MIN_SHIFT + c);
+    void *buf = p->free[c];
+    if (buf) {
+        p->free[c] = *(void **)buf;
+        p->nfree[c]--;
+        p->retained -= *size;
+        p->hits++;
+    } else if (!(buf = malloc(*size))) {
+        return NULL;
+    } else {
+        p->misses++;
+    }
+    p->in_use += *size;
+    return buf;
+}
+
+void
+bufpool_put(BufPool *p, void *buf, size_t size)
+{
+    if (!buf)
+        return;
+    int c = p ? _bufpool_class(size) : -1;
+    if (c < 0 || size != (size_t)1 << (BUFPOOL_MIN_SHIFT + c)) {
+        free(buf);
+        return;
+    }
+    p->in_use -= size;
+    if (p->retained + size > p->limit) {
+        free(buf);
+        return;
+    }
+    *(void **)buf = p->free[c];
+    p->free[c] = buf;
+    p->nfree[c]++;
+    p->retained += size;
+}
+
+/* Free retained buffers, largest classes first, until within the limit. */
+void
+bufpool_trim(BufPool *p)
+{
+    for (int c = BUFPOOL_CLASSES - 1; c >= 0 && p->retained > p->limit; c--) {
+        size_t size = (size_t)1 << (BUFPOOL_MIN_SHIFT + c);
+        while (p->free[c] && p->retained > p->limit) {
+            void *buf = p->free[c];
+            p->free[c] = *(void **)buf;
+            p->nfree[c]--;
+            p->retained -= size;
+            free(buf);
+        }
+    }
+}
+
+void
+bufpool_clear(BufPool *p)
+{
+    size_t limit = p->limit;
+    p->limit = 0;
+    bufpool_trim(p);
+    p->limit = limit;
+}
+
+FDCallback *
+fdslab_alloc(FDSlab **slabs)
+{
+    FDSlab *s = *slabs;
+    if (!s || s->used == FDSLAB_SLOTS) {
+        s = calloc(1, sizeof(FDSlab));
+        if (!s)
+            return NULL;
+        s->next = *slabs;
+        *slabs = s;
+    }
+    return &s->slots[s->used++];
+}
+
+void
+fdslab_free_all(FDSlab **slabs)
+{
+    while (*slabs) {
+        FDSlab *next = (*slabs)->next;
+        free(*slabs);
+        *slabs = next;
+    }
+}
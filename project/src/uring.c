@@ -0,0 +1,422 @@
+#include "loop.h"
+#include <errno.h>
+#include <string.h>
+#include <stdlib.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+/*
+ * Minimal io_uring ring driven with raw syscalls.  fd interest becomes
+ * multishot POLL_ADD SQEs queued without a syscall, and one io_uring_enter
+ * per iteration submits every queued change and waits for completions with
+ * a nanosecond timeout.  Native listeners and transports go further: their
+ * accepts and receives are multishot operations that pick buffers from a
+ * registered buffer ring, and their sends are SENDMSG operations, all
+ * submitted by that same io_uring_enter.
+ */
+struct UringRing {
+    int fd;
+    /* submission queue */
+    unsigned *sq_head;
+    unsigned *sq_tail;
+    unsigned *sq_mask;
+    unsigned *sq_array;
+    struct io_uring_sqe *sqes;
+    unsigned sq_entries;
+    unsigned to_submit;
+    /* completion queue */
+    unsigned *cq_head;
+    unsigned *cq_tail;
+    unsigned *cq_mask;
+    struct io_uring_cqe *cqes;
+    /* mappings */
+    void *sq_ring;
+    size_t sq_ring_sz;
+    void *cq_ring;
+    size_t cq_ring_sz;
+    size_t sqes_sz;
+    /* receive buffers for multishot recv, set up on first use */
+    int io_ok;          /* the kernel has the operations (6.0+) */
+    struct io_uring_buf_ring *br;
+    size_t br_sz;
+    char *bufs;
+    unsigned br_tail;
+};
+
+static int
+_sys_setup(unsigned entries, struct io_uring_params *p)
+{
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int
+_sys_enter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags,
+           void *arg, size_t argsz)
+{
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, arg, argsz);
+}
+
+static int
+_sys_register(int fd, unsigned opcode, void *arg, unsigned nr_args)
+{
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, nr_args);
+}
+
+/*
+ * Multishot recv arrived in 6.0, the release that also added SEND_ZC, so
+ * that opcode stands in for the flag, which the probe cannot report.
+ */
+static int
+_probe_io(int fd)
+{
+    static const int need[] = {IORING_OP_ACCEPT, IORING_OP_RECV, IORING_OP_SENDMSG,
+                               IORING_OP_ASYNC_CANCEL, IORING_OP_SEND_ZC};
+    size_t sz = sizeof(struct io_uring_probe) + 256 * sizeof(struct io_uring_probe_op);
+    struct io_uring_probe *p = calloc(1, sz);
+    if (!p)
+        return 0;
+    int ok = _sys_register(fd, IORING_REGISTER_PROBE, p, 256) == 0;
+    for (size_t i = 0; ok && i < sizeof(need) / sizeof(need[0]); i++)
+        ok = need[i] <= p->last_op && (p->ops[need[i]].flags & IO_URING_OP_SUPPORTED);
+    free(p);
+    return ok;
+}
+
+struct UringRing *
+uring_open(unsigned entries)
+{
+    struct io_uring_params p;
+    memset(&p, 0, sizeof(p));
+    /*
+     * COOP_TASKRUN (5.19) stops completions from interrupting other blocking
+     * syscalls in this thread with EINTR; older kernels reject the flag.
+     */
+    p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_COOP_TASKRUN;
+    p.cq_entries = entries * 4;
+    int fd = _sys_setup(entries, &p);
+    if (fd == -1 && errno == EINVAL) {
+        memset(&p, 0, sizeof(p));
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = entries * 4;
+        fd = _sys_setup(entries, &p);
+    }
+    if (fd == -1)
+        return NULL;
+    /* the wait timeout needs IORING_ENTER_EXT_ARG (5.11) */
+    if (!(p.features & IORING_FEAT_EXT_ARG)) {
+        close(fd);
+        errno = ENOSYS;
+        return NULL;
+    }
+
+    struct UringRing *r = calloc(1, sizeof(*r));
+    if (!r) {
+        close(fd);
+        errno = ENOMEM;
+        return NULL;
+    }
+    r->fd = fd;
+    r->sq_entries = p.sq_entries;
+    r->sq_ring_sz = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    r->cq_ring_sz = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        if (r->cq_ring_sz > r->sq_ring_sz)
+            r->sq_ring_sz = r->cq_ring_sz;
+        r->cq_ring_sz = r->sq_ring_sz;
+    }
+    r->sq_ring = mmap(NULL, r->sq_ring_sz, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQ_RING);
+    if (r->sq_ring == MAP_FAILED)
+        goto fail;
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        r->cq_ring = r->sq_ring;
+    } else {
+        r->cq_ring = mmap(NULL, r->cq_ring_sz, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_CQ_RING);
+        if (r->cq_ring == MAP_FAILED) {
+            r->cq_ring = NULL;
+            goto fail;
+        }
+    }
+    r->sqes_sz = p.sq_entries * sizeof(struct io_uring_sqe);
+    r->sqes = mmap(NULL, r->sqes_sz, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, fd, IORING_OFF_SQES);
+    if (r->sqes == MAP_FAILED) {
+        r->sqes = NULL;
+        goto fail;
+    }
+
+    char *sq = r->sq_ring, *cq = r->cq_ring;
+    r->sq_head = (unsigned *)(sq + p.sq_off.head);
+    r->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    r->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    r->sq_array = (unsigned *)(sq + p.sq_off.array);
+    r->cq_head = (unsigned *)(cq + p.cq_off.head);
+    r->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    r->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    r->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    r->io_ok = _probe_io(fd);
+    return r;
+
+fail:
+    {
+        int saved = errno;
+        uring_close(r);
+        errno = saved;
+    }
+    return NULL;
+}
+
+void
+uring_close(struct UringRing *r)
+{
+    if (!r)
+        return;
+    if (r->sqes)
+        munmap(r->sqes, r->sqes_sz);
+    if (r->cq_ring && r->cq_ring != r->sq_ring)
+        munmap(r->cq_ring, r->cq_ring_sz);
+    if (r->sq_ring && r->sq_ring != MAP_FAILED)
+        munmap(r->sq_ring, r->sq_ring_sz);
+    close(r->fd);
+    if (r->br)
+        munmap(r->br, r->br_sz);
+    free(r->bufs);
+    free(r);
+}
+
+/* Publish buffer bid to the kernel again. */
+void
+uring_buf_return(struct UringRing *r, unsigned bid)
+{
+    struct io_uring_buf *b = &r->br->bufs[r->br_tail & (URING_BUFS - 1)];
+    b->addr = (uint64_t)(uintptr_t)(r->bufs + (size_t)bid * URING_BUF_SIZE);
+    b->len = URING_BUF_SIZE;
+    b->bid = (uint16_t)bid;
+    r->br_tail++;
+    __atomic_store_n(&r->br->tail, (uint16_t)r->br_tail, __ATOMIC_RELEASE);
+}
+
+const char *
+uring_buf(struct UringRing *r, unsigned bid)
+{
+    return r->bufs + (size_t)bid * URING_BUF_SIZE;
+}
+
+/*
+ * 1 if accept/recv/send operations can be used, registering the receive
+ * buffer ring the first time; 0 (for good) when the kernel refuses it.
+ */
+int
+uring_enable_io(struct UringRing *r)
+{
+    if (!r->io_ok || r->br)
+        return r->io_ok;
+    r->io_ok = 0;
+    r->br_sz = URING_BUFS * sizeof(struct io_uring_buf);
+    void *ring = mmap(NULL, r->br_sz, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (ring == MAP_FAILED)
+        return 0;
+    r->bufs = malloc((size_t)URING_BUFS * URING_BUF_SIZE);
+    struct io_uring_buf_reg reg;
+    memset(&reg, 0, sizeof(reg));
+    reg.ring_addr = (uint64_t)(uintptr_t)ring;
+    reg.ring_entries = URING_BUFS;
+    reg.bgid = URING_BGID;
+    if (!r->bufs || _sys_register(r->fd, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+        munmap(ring, r->br_sz);
+        free(r->bufs);
+        r->bufs = NULL;
+        return 0;
+    }
+    r->br = ring;
+    for (unsigned i = 0; i < URING_BUFS; i++)
+        uring_buf_return(r, i);
+    r->io_ok = 1;
+    return 1;
+}
+
+/*
+ * Push queued SQEs to the kernel without waiting.  GETEVENTS with no
+ * minimum also runs deferred task work, so a removed poll really drops
+ * its file reference before we return.
+ */
+int
+uring_submit(struct UringRing *r)
+{
+    while (r->to_submit) {
+        int n = _sys_enter(r->fd, r->to_submit, 0, IORING_ENTER_GETEVENTS, NULL, 0);
+        if (n < 0) {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        r->to_submit -= (unsigned)n;
+    }
+    return 0;
+}
+
+static struct io_uring_sqe *
+_uring_get_sqe(struct UringRing *r)
+{
+    unsigned head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+    unsigned tail = *r->sq_tail;
+    if (tail - head >= r->sq_entries) {
+        /* ring full: hand what we have to the kernel first */
+        if (uring_submit(r) < 0)
+            return NULL;
+        head = __atomic_load_n(r->sq_head, __ATOMIC_ACQUIRE);
+        if (tail - head >= r->sq_entries) {
+            errno = EBUSY;
+            return NULL;
+        }
+    }
+    unsigned idx = tail & *r->sq_mask;
+    struct io_uring_sqe *sqe = &r->sqes[idx];
+    memset(sqe, 0, sizeof(*sqe));
+    r->sq_array[idx] = idx;
+    __atomic_store_n(r->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    r->to_submit++;
+    return sqe;
+}
+
+int
+uring_poll_add(struct UringRing *r, int fd, uint32_t events, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = _uring_get_sqe(r);
+    if (!sqe)
+        return -1;
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->fd = fd;
+    sqe->len = IORING_POLL_ADD_MULTI;
+#if __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+    events = events << 16 | events >> 16;
+#endif
+    sqe->poll32_events = events;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+int
+uring_poll_remove(struct UringRing *r, uint64_t target)
+{
+    struct io_uring_sqe *sqe = _uring_get_sqe(r);
+    if (!sqe)
+        return -1;
+    sqe->opcode = IORING_OP_POLL_REMOVE;
+    sqe->fd = -1;
+    sqe->addr = target;
+    sqe->user_data = URING_IGNORE;
+    return 0;
+}
+
+/* Multishot accept4(SOCK_NONBLOCK | SOCK_CLOEXEC): one CQE per connection. */
+int
+uring_accept_multishot(struct UringRing *r, int fd, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = _uring_get_sqe(r);
+    if (!sqe)
+        return -1;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+/* Multishot recv: one CQE per chunk, each in a buffer from the ring. */
+int
+uring_recv_multishot(struct UringRing *r, int fd, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = _uring_get_sqe(r);
+    if (!sqe)
+        return -1;
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BGID;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+/* msg and everything it points to must stay valid until the completion. */
+int
+uring_sendmsg(struct UringRing *r, int fd, const struct msghdr *msg, uint64_t user_data)
+{
+    struct io_uring_sqe *sqe = _uring_get_sqe(r);
+    if (!sqe)
+        return -1;
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = fd;
+    sqe->addr = (uint64_t)(uintptr_t)msg;
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = user_data;
+    return 0;
+}
+
+/* Cancel the operation tagged target, or every operation when target is 0. */
+int
+uring_cancel(struct UringRing *r, uint64_t target)
+{
+    struct io_uring_sqe *sqe = _uring_get_sqe(r);
+    if (!sqe)
+        return -1;
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = target;
+    if (!target)
+        sqe->cancel_flags = IORING_ASYNC_CANCEL_ANY;
+    sqe->user_data = URING_IGNORE;
+    return 0;
+}
+
+/*
+ * Submit queued SQEs and wait up to timeout_ns (-1 forever, 0 poll) for a
+ * completion.  Copies at most max CQEs to out and returns their number.
+ */
+int
+uring_wait(struct UringRing *r, int64_t timeout_ns, struct io_uring_cqe *out, int max)
+{
+    unsigned head = *r->cq_head;
+    unsigned tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    if (head == tail || r->to_submit) {
+        struct __kernel_timespec ts;
+        struct io_uring_getevents_arg arg;
+        memset(&arg, 0, sizeof(arg));
+        unsigned flags = IORING_ENTER_EXT_ARG;
+        unsigned min_complete = 0;
+        /* GETEVENTS even for a zero timeout: it runs deferred task work */
+        if (head == tail)
+            flags |= IORING_ENTER_GETEVENTS;
+        if (head == tail && timeout_ns != 0) {
+            min_complete = 1;
+            if (timeout_ns > 0) {
+                ts.tv_sec = timeout_ns / 1000000000;
+                ts.tv_nsec = timeout_ns % 1000000000;
+                arg.ts = (uint64_t)(uintptr_t)&ts;
+            }
+        }
+        int n = _sys_enter(r->fd, r->to_submit, min_complete, flags, &arg, sizeof(arg));
+        if (n < 0) {
+            if (errno != ETIME && errno != EINTR && errno != EBUSY)
+                return -1;
+        } else {
+            r->to_submit -= (unsigned)n;
+        }
+        tail = __atomic_load_n(r->cq_tail, __ATOMIC_ACQUIRE);
+    }
+    int count = 0;
+    while (head != tail && count < max) {
+        out[count++] = r->cqes[head & *r->cq_mask];
+        head++;
+    }
+    __atomic_store_n(r->cq_head, head, __ATOMIC_RELEASE);
+    return count;
+}
@@ -2,6 +2,7 @@ import sys, os
 sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..", "..")))
 
 import casyncio
+import pytest
 import gc
 import signal
 import asyncio
@@ -43,6 +44,52 @@ def test_multiple_callbacks():
     assert order == ['a', 'b']
 
 
+def test_callbacks_take_args_and_run_in_context():
+    import contextvars
+    var = contextvars.ContextVar('var', default='unset')
+    loop = casyncio.EventLoop()
+    seen = []
+
+    def record(*args):
+        seen.append((args, var.get()))
+
+    token = var.set('copied')
+    loop.call_soon(record, 1, 2)
+    loop.call_soon(record, *range(7))        # more than fit inline
+    var.reset(token)
+    ctx = contextvars.copy_context()
+    ctx.run(var.set, 'explicit')
+    h = loop.call_soon(record, 'x', context=ctx)
+    assert h.get_context() is ctx
+    loop.call_later(0.001, record, 'later')
+    loop.call_at(loop.time() + 0.002, record, 'at', context=ctx)
+    loop.call_later(0.003, loop.stop)
+
+    def cancel_self():
+        me.cancel()
+        seen.append('cancelled self')
+    me = loop.call_soon(cancel_self)
+    r, w = socket.socketpair()
+    loop.add_reader(r.fileno(), lambda: None)   # keep the loop waiting for the timers
+    loop.run_forever()
+    loop.remove_reader(r.fileno())
+    r.close()
+    w.close()
+
+    assert seen == [((1, 2), 'copied'), (tuple(range(7)), 'copied'), (('x',), 'explicit'),
+                    'cancelled self', (('later',), 'unset'), (('at',), 'explicit')]
+    assert var.get() == 'unset'
+
+    with pytest.raises(TypeError):
+        loop.call_soon(record, context=object())
+    with pytest.raises(TypeError):
+        loop.call_soon(record, ctx=ctx)
+    with pytest.raises(TypeError):
+        loop.call_soon(42)
+    with pytest.raises(TypeError):
+        loop.call_later(1)
+
+
 def test_streamwriter_write_and_drain():
     loop = casyncio.EventLoop()
     r, w = socket.socketpair()
@@ -153,3 +200,855 @@ def test_call_soon_threadsafe_during_run():
 
     assert results == ["ok"]
 
+
+
+def test_ready_queue_order_across_wraparound():
+    loop = casyncio.EventLoop()
+    order = []
+
+    def make(i):
+        def cb():
+            order.append(i)
+            # re-queue while draining so the ring wraps and then grows
+            if i < 200:
+                loop.call_soon(make(i + 1000))
+        return cb
+
+    for i in range(100):
+        loop.call_soon(make(i))
+    loop.run_forever()
+
+    assert order[:100] == list(range(100))
+    assert order[100:] == [i + 1000 for i in range(100)]
+
+
+def test_call_soon_handle_cancel():
+    loop = casyncio.EventLoop()
+    results = []
+
+    h = loop.call_soon(lambda: results.append('x'))
+    loop.call_soon(lambda: results.append('y'))
+    assert isinstance(h, casyncio.Handle)
+    assert not h.cancelled()
+    h.cancel()
+    assert h.cancelled()
+    loop.run_forever()
+
+    assert results == ['y']
+
+
+def test_call_later_timer_handle():
+    loop = casyncio.EventLoop()
+    results = []
+    r, w = socket.socketpair()
+    loop.add_reader(r.fileno(), lambda: None)
+
+    before = loop.time()
+    cancelled = loop.call_later(0.01, lambda: results.append('cancelled'))
+    loop.call_at(loop.time() + 0.02, lambda: (results.append('at'), loop.stop()))
+    assert isinstance(cancelled, casyncio.TimerHandle)
+    assert cancelled.when() >= before + 0.01
+    cancelled.cancel()
+    loop.run_forever()
+
+    loop.remove_reader(r.fileno())
+    r.close()
+    w.close()
+    assert results == ['at']
+    # cancelling after the node has left the heap is harmless
+    cancelled.cancel()
+    del cancelled
+    gc.collect()
+
+
+def test_timer_reschedule_and_eager_cancel():
+    loop = casyncio.EventLoop()
+    order = []
+    r, w = socket.socketpair()
+    loop.add_reader(r.fileno(), lambda: None)
+
+    idle = loop.call_later(0.01, lambda: order.append('idle'))
+    loop.call_later(0.02, lambda: order.append('tick'))
+    dead = [loop.call_later(0.015, lambda: order.append('dead')) for _ in range(50)]
+    for h in dead:
+        h.cancel()
+    assert dead[0].reschedule(0.01) is False
+    # pushed back past 'tick', then pulled forward again ahead of 'stop'
+    assert idle.reschedule(0.05) is True
+    assert idle.reschedule(0.03) is True
+    loop.call_later(0.04, loop.stop)
+    loop.run_forever()
+
+    loop.remove_reader(r.fileno())
+    r.close()
+    w.close()
+    assert order == ['tick', 'idle']
+    assert idle.reschedule(0.01) is False
+
+
+@pytest.mark.parametrize('backend', ['epoll', 'io_uring'])
+def test_timer_delays_out_of_range(backend):
+    loop = casyncio.EventLoop(backend=backend, timer_slack=0.001)
+    r, w = socket.socketpair()
+    loop.add_reader(r.fileno(), lambda: None)
+
+    for bad in (float('nan'), float('inf'), float('-inf')):
+        with pytest.raises(ValueError):
+            loop.call_later(bad, loop.stop)
+        with pytest.raises(ValueError):
+            loop.call_at(bad, loop.stop)
+    # far-off timers clamp to never instead of wrapping into the past
+    far = [loop.call_later(1e300, loop.stop), loop.call_at(1e300, loop.stop)]
+    assert all(h.when() == float('inf') for h in far)
+    moved = loop.call_later(0.01, loop.stop)
+    assert moved.reschedule(1e300) is True and moved.when() == float('inf')
+    with pytest.raises(ValueError):
+        moved.reschedule(float('nan'))
+    fired = []
+    loop.call_later(0.01, lambda: (fired.append(1), loop.stop()))
+    loop.run_forever()
+
+    loop.remove_reader(r.fileno())
+    r.close()
+    w.close()
+    assert fired == [1]
+
+
+def test_timerfd_sub_millisecond_timer():
+    loop = casyncio.EventLoop(timerfd=True)
+    r, w = socket.socketpair()
+    loop.add_reader(r.fileno(), lambda: None)
+    fired = []
+
+    h = loop.call_later(0.0003, lambda: (fired.append(loop.time()), loop.stop()))
+    loop.run_forever()
+
+    loop.remove_reader(r.fileno())
+    r.close()
+    w.close()
+    assert fired and fired[0] >= h.when()
+    assert fired[0] - h.when() < 0.05
+
+
+def test_timer_slack_coalesces_wakeups():
+    loop = casyncio.EventLoop(timer_slack=0.02)
+    assert loop.timer_slack == 0.02
+    r, w = socket.socketpair()
+    loop.add_reader(r.fileno(), lambda: None)
+    fired = []
+
+    # two deadlines inside one 20ms slack cell share the wakeup at its end
+    cell = (int(loop.time() / 0.02) + 2) * 0.02
+    loop.call_at(cell + 0.001, lambda: fired.append(loop.time()))
+    loop.call_at(cell + 0.005, lambda: (fired.append(loop.time()), loop.stop()))
+    loop.run_forever()
+
+    loop.remove_reader(r.fileno())
+    r.close()
+    w.close()
+    assert len(fired) == 2
+    assert fired[0] >= cell + 0.02 - 1e-6
+    assert fired[1] - fired[0] < 0.002
+
+    loop.timer_slack = 0
+    assert loop.timer_slack == 0.0
+
+
+def test_reader_toggle_and_fd_reuse():
+    loop = casyncio.EventLoop()
+    results = []
+    r, w = socket.socketpair()
+    loop.add_reader(r.fileno(), lambda: None)   # a first registration is immediate
+    updates = loop.stats()['interest_updates']
+    # toggled off and on within one iteration: no epoll_ctl at all
+    loop.remove_reader(r.fileno())
+    loop.add_reader(r.fileno(), lambda: None)
+    loop.call_later(0.001, loop.stop)
+    loop.run_forever()
+    assert loop.stats()['interest_updates'] == updates
+    # dropped, closed and the number reused before the next flush
+    loop.remove_reader(r.fileno())
+    old_fd = r.fileno()
+    r.close()
+    w.close()
+
+    r2, w2 = socket.socketpair()
+    r2.setblocking(False)
+    assert r2.fileno() == old_fd
+
+    def reader():
+        results.append(r2.recv(1))
+        loop.stop()
+
+    loop.add_reader(r2.fileno(), reader)
+    w2.send(b'Z')
+    loop.run_forever()
+
+    loop.remove_reader(r2.fileno())
+    r2.close()
+    w2.close()
+    assert results == [b'Z']
+
+
+def test_add_reader_rejects_unpollable_fd(tmp_path):
+    loop = casyncio.EventLoop()
+    with open(tmp_path / 'plain', 'wb') as f:
+        try:
+            loop.add_reader(f.fileno(), lambda: None)
+        except OSError:
+            pass
+        else:
+            raise AssertionError('regular files cannot be registered with epoll')
+
+
+def test_writelines_and_queued_copy_semantics():
+    loop = casyncio.EventLoop()
+    r, w = socket.socketpair()
+    w.setblocking(False)
+    r.setblocking(False)
+    writer = StreamWriter(loop, w.fileno())
+
+    writer.writelines([b'head', bytearray(b'er:'), memoryview(b' body')])
+    assert r.recv(64) == b'header: body'
+
+    # fill the socket so later writes are queued, then mutate a bytearray
+    big = b'x' * (4 * 1024 * 1024)
+    writer.write(big)
+    frame = bytearray(b'tail')
+    writer.writelines([frame, b'!'])
+    frame[:] = b'XXXX'
+    fut = loop._c_drain_waiter(w.fileno())
+    assert not fut.done()
+
+    got = bytearray()
+
+    def reader():
+        while True:
+            try:
+                chunk = r.recv(1 << 20)
+            except BlockingIOError:
+                break
+            got.extend(chunk)
+        if len(got) >= len(big) + 5:
+            loop.stop()
+
+    loop.add_reader(r.fileno(), reader)
+    loop.run_forever()
+    loop.remove_reader(r.fileno())
+    assert fut.done()
+    assert bytes(got[-5:]) == b'tail!'
+    assert len(got) == len(big) + 5
+    r.close()
+    w.close()
+
+
+def test_write_to_pipe_uses_writev():
+    loop = casyncio.EventLoop()
+    rfd, wfd = os.pipe()
+    os.set_blocking(wfd, False)
+    writer = StreamWriter(loop, wfd)
+    writer.writelines([b'a', b'b'])
+    writer.write(b'c')
+    assert os.read(rfd, 16) == b'abc'
+    os.close(rfd)
+    os.close(wfd)
+
+
+def test_io_uring_backend_matches_epoll():
+    for backend in ('epoll', 'io_uring'):
+        loop = casyncio.EventLoop(backend=backend)
+        assert loop.backend in ('epoll', backend)
+        r, w = socket.socketpair()
+        r.setblocking(False)
+        got = []
+
+        def reader():
+            got.append(r.recv(16))
+            if len(got) == 1:
+                # re-registering replaces the poll; only the new one may fire
+                loop.remove_reader(r.fileno())
+                loop.add_reader(r.fileno(), reader)
+                loop.call_later(0.0005, lambda: w.send(b'b'))
+            else:
+                loop.stop()
+
+        loop.add_reader(r.fileno(), reader)
+        w.send(b'a')
+        loop.run_forever()
+        loop.remove_reader(r.fileno())
+        r.close()
+        w.close()
+        assert got == [b'a', b'b']
+    with pytest.raises(ValueError):
+        casyncio.EventLoop(backend='kqueue')
+
+
+def test_io_uring_native_listener_and_transport_use_ring_operations():
+    loop = casyncio.EventLoop(backend='io_uring')
+    if loop.backend != 'io_uring':
+        pytest.skip('io_uring unavailable')
+    lsock = socket.create_server(('127.0.0.1', 0))
+    lsock.setblocking(False)
+    lines = []
+
+    def on_accept(reader, fd):
+        fut = reader.readline()
+        fut.add_done_callback(lambda f: lines.append(f.result()))
+        fut.add_done_callback(lambda f: loop._c_close(fd))
+
+    listener = casyncio.Listener(loop, lsock.fileno(), on_accept)
+    clients = [socket.create_connection(lsock.getsockname()) for _ in range(5)]
+    for c in clients:
+        c.sendall(b'hi\n')
+    deadline = time.monotonic() + 5
+    while len(lines) < len(clients) and time.monotonic() < deadline:
+        loop.call_later(0.01, loop.stop)
+        loop.run_forever()
+    assert lines == [b'hi\n'] * len(clients)
+    assert loop.stats()['ring_accepts'] == len(clients)
+    listener.close()
+    lsock.close()
+    for c in clients:
+        c.close()
+
+    class Echo(asyncio.Protocol):
+        lost = None
+
+        def connection_made(self, transport):
+            self.transport = transport
+
+        def data_received(self, data):
+            self.transport.write(data.upper())
+
+        def connection_lost(self, exc):
+            self.lost = exc
+
+    a, b = socket.socketpair()
+    proto = Echo()
+    tr = casyncio.SocketTransport(loop, a, proto)
+    b.sendall(b'ping')
+    b.settimeout(5)
+    loop.call_later(0.05, loop.stop)
+    loop.run_forever()
+    assert b.recv(16) == b'PING'
+    st = loop.stats()
+    assert st['ring_recvs'] >= 1 and st['ring_sends'] >= 1
+
+    # abort with a send still in flight: the buffers outlive the queue
+    tr.write(b'z' * (8 << 20))
+    tr.abort()
+    loop.call_later(0.05, loop.stop)
+    loop.run_forever()
+    assert proto.lost is None and tr.is_closing()
+    b.close()
+
+    # a loop torn down with a send still in flight waits for the kernel
+    loop = casyncio.EventLoop(backend='io_uring')
+    c, d = socket.socketpair()
+    tr = casyncio.SocketTransport(loop, c, Echo())
+    tr.write(b'z' * (8 << 20))
+    tr.abort()
+    loop.call_soon(loop.stop)   # connection_lost() runs, nothing is reaped
+    loop.run_forever()
+    del tr, loop
+    d.close()
+
+
+def test_task_awaits_futures_and_cancels():
+    loop = casyncio.EventLoop()
+    fut = loop.create_future()
+    steps = []
+
+    async def child(x):
+        assert asyncio.get_running_loop() is loop
+        return x * 2
+
+    async def main():
+        steps.append(await fut)
+        steps.append(await loop.create_task(child(21)))
+        try:
+            await loop.create_future()
+        except asyncio.CancelledError as exc:
+            steps.append(exc.args)
+            raise
+
+    task = loop.create_task(main(), name='main')
+    assert isinstance(task, casyncio.Task) and task.get_name() == 'main'
+    loop.call_soon(lambda: fut.set_result('a'))
+
+    def cancel_when_parked():
+        if len(steps) < 2:
+            loop.call_soon(cancel_when_parked)
+        else:
+            task.cancel('bye')
+    loop.call_soon(cancel_when_parked)
+    task.add_done_callback(lambda t: loop.stop())
+    loop.run_forever()
+
+    assert steps == ['a', 42, ('bye',)]
+    assert task.cancelled()
+    with pytest.raises(asyncio.CancelledError):
+        task.result()
+
+
+def test_failing_done_callback_still_wakes_the_rest():
+    loop = casyncio.EventLoop()
+    fut = loop.create_future()
+    ran = []
+
+    def bad(f):
+        raise ValueError('bad')
+
+    async def waiter():
+        return await fut
+
+    fut.add_done_callback(bad)
+    task = loop.create_task(waiter())
+    loop.call_soon(lambda: fut.set_result('ok'))
+    fut.add_done_callback(lambda f: ran.append(f.result()))
+    with pytest.raises(ValueError):
+        loop.run_forever()
+    assert ran == ['ok']
+    # the task was woken despite the failure before it; its step is queued
+    loop.run_forever()
+    assert task.result() == 'ok'
+
+
+def test_eager_task_skips_the_ready_queue():
+    loop = casyncio.EventLoop(eager_tasks=True)
+    order = []
+
+    async def hit():
+        order.append('hit')
+        return 1
+
+    async def miss(fut):
+        order.append('miss')
+        return await fut
+
+    done = loop.create_task(hit())
+    # finished inside create_task(); nothing was queued for it
+    assert done.done() and done.result() == 1 and order == ['hit']
+
+    fut = loop.create_future()
+    parked = loop.create_task(miss(fut))
+    assert not parked.done() and order == ['hit', 'miss']
+    fut.set_result(2)
+    loop.run_forever()
+    assert parked.result() == 2
+
+    lazy = loop.create_task(hit(), eager=False)
+    assert not lazy.done()
+    loop.run_forever()
+    assert lazy.result() == 1
+
+
+def test_future_works_under_asyncio_loop():
+    async def main():
+        aloop = asyncio.get_running_loop()
+        a, b, c = casyncio.Future(), casyncio.Future(), casyncio.Future()
+        assert a.get_loop() is aloop
+        aloop.call_soon(a.set_result, 1)
+        aloop.call_soon(b.set_exception, KeyError('k'))
+        c.cancel()
+        got = await asyncio.gather(a, b, c, return_exceptions=True)
+        with pytest.raises(asyncio.TimeoutError):
+            await asyncio.wait_for(casyncio.Future(), 0.01)
+        return got
+
+    res = asyncio.run(main())
+    assert res[0] == 1 and isinstance(res[1], KeyError)
+    assert isinstance(res[2], asyncio.CancelledError)
+
+
+def test_call_soon_threadsafe_many_producers_keep_order():
+    loop = casyncio.EventLoop()
+    r, w = socket.socketpair()
+    loop.add_reader(r.fileno(), lambda: None)
+    threads, per_thread = 4, 2000
+    seen = {i: [] for i in range(threads)}
+    left = threads * per_thread
+
+    def record(tid, n):
+        nonlocal left
+        seen[tid].append(n)
+        left -= 1
+        if not left:
+            loop.stop()
+
+    def produce(tid):
+        for n in range(per_thread):
+            loop.call_soon_threadsafe(lambda n=n: record(tid, n))
+            if n % 500 == 0:
+                time.sleep(0.001)   # let the loop go back to sleep in between
+
+    workers = [threading.Thread(target=produce, args=(i,)) for i in range(threads)]
+    for t in workers:
+        t.start()
+    loop.run_forever()
+    for t in workers:
+        t.join()
+    loop.remove_reader(r.fileno())
+    r.close()
+    w.close()
+    assert all(seen[i] == list(range(per_thread)) for i in range(threads))
+
+
+def test_pool_file_ops_and_calls(tmp_path):
+    loop = casyncio.EventLoop(pool_size=2)
+    path = tmp_path / 'data'
+    path.write_bytes(b'')
+    fd = os.open(path, os.O_RDWR)
+    try:
+        wrote = loop.pool_pwrite(fd, b'hello world', 0)
+        loop.run_forever()
+        assert wrote.result() == 11
+        futs = {
+            'pread': loop.pool_pread(fd, 100, 6),
+            'fsync': loop.pool_fsync(fd),
+            'stat': loop.pool_stat(str(path)),
+            'missing': loop.pool_stat(str(tmp_path / 'missing')),
+            'call': loop.run_in_pool(lambda a, b: a + b, 1, 2),
+            'raise': loop.run_in_pool(lambda: 1 / 0),
+        }
+        # in-flight jobs keep run_forever() going; all land in the ready pass
+        loop.run_forever()
+        assert futs['pread'].result() == b'world'
+        assert futs['fsync'].result() is None
+        assert futs['stat'].result() == os.stat(path)
+        exc = futs['missing'].exception()
+        assert isinstance(exc, FileNotFoundError)
+        assert exc.filename == str(tmp_path / 'missing')
+        assert futs['call'].result() == 3
+        assert isinstance(futs['raise'].exception(), ZeroDivisionError)
+    finally:
+        os.close(fd)
+
+
+def test_close_fails_undelivered_pool_jobs():
+    loop = casyncio.EventLoop(pool_size=1)
+    running = loop.run_in_pool(time.sleep, 0.05)
+    queued = loop.run_in_pool(lambda: 'never delivered')
+
+    async def wait():
+        return await queued
+
+    waiter = loop.create_task(wait())
+    loop.close()
+    for fut in (running, queued):
+        exc = fut.exception()
+        assert isinstance(exc, RuntimeError) and str(exc) == 'loop closed'
+    # a task awaiting the job sees the failure instead of hanging
+    waiter.add_done_callback(lambda t: loop.stop())
+    loop.run_forever()
+    assert isinstance(waiter.exception(), RuntimeError)
+
+
+def test_close_after_callback_raised():
+    loop = casyncio.EventLoop(pool_size=1)
+    owed = loop.run_in_pool(time.sleep, 0.05)
+
+    def boom():
+        raise ValueError('boom')
+
+    loop.call_soon(boom)
+    try:
+        with pytest.raises(ValueError):
+            loop.run_forever()
+    finally:
+        loop.close()
+    assert isinstance(owed.exception(), RuntimeError)
+
+
+def test_pool_getaddrinfo_matches_socket():
+    loop = casyncio.EventLoop()
+    fut = loop.getaddrinfo('127.0.0.1', 80, type=socket.SOCK_STREAM)
+    loop.run_forever()
+    expected = socket.getaddrinfo('127.0.0.1', 80, type=socket.SOCK_STREAM)
+    assert fut.result() == expected
+
+
+def test_process_spawns_and_reaps_through_pidfd():
+    for backend in ('epoll', 'io_uring'):
+        loop = casyncio.EventLoop(backend=backend)
+        proc = casyncio.Process(loop, ['sh', '-c', 'cat; echo $X >&2; exit 7'],
+                                env={'X': 'from-env'}, stdin=-1, stdout=-1, stderr=-2)
+        assert proc.returncode is None and proc.stdin is not None and proc.stderr is None
+        out = casyncio.StreamReader(loop, proc.stdout)
+        data = out.readexactly(14)
+        loop._c_write(proc.stdin, b'ping\n')
+        proc.close_stdin()
+        code = proc.wait()
+        # the pidfd keeps run_forever() going until the child is reaped
+        loop.run_forever()
+        assert code.result() == 7 and proc.returncode == 7
+        assert data.result() == b'ping\nfrom-env\n'
+
+        sleeper = casyncio.Process(loop, ['sleep', '30'], stdout=-3)
+        sleeper.send_signal(signal.SIGKILL)
+        loop.run_forever()
+        assert sleeper.returncode == -signal.SIGKILL
+        sleeper.send_signal(signal.SIGKILL)  # reaped: ignored
+        proc.close()
+
+    with pytest.raises(FileNotFoundError):
+        casyncio.Process(loop, ['/nonexistent/binary'])
+    with pytest.raises(ValueError):
+        casyncio.Process(loop, ['true'], stdout=-2)
+
+
+def test_stats_counters_and_slow_callbacks(caplog):
+    loop = casyncio.EventLoop()
+    assert loop.callback_timing is False and loop.slow_callback_duration is None
+    for _ in range(10):
+        loop.call_soon(lambda: None)
+    loop.call_later(30, lambda: None).cancel()
+    loop.call_later(0.001, loop.stop)
+    r, w = socket.socketpair()
+    w.setblocking(False)
+    loop.add_reader(r.fileno(), lambda: None)
+    loop._c_write(w.fileno(), b'x' * (8 << 20))  # more than the socket buffer
+    loop.run_forever()
+    st = loop.stats()
+    assert st['callbacks'] == 12 and st['ready_high_water'] >= 10  # + stop, r's reader
+    assert (st['timers_armed'], st['timers_fired'], st['timers_cancelled']) == (2, 1, 1)
+    assert st['waits'] >= 1 and st['iterations'] >= 2
+    assert st['write_eagain'] == 1
+    assert st['bytes_sent'] + st['write_buffered'] == 8 << 20
+    assert st['callback_time'] == {} and st['last_slow_callback'] is None
+
+    def slow():
+        time.sleep(0.02)
+
+    loop.slow_callback_duration = 0.01
+    assert loop.callback_timing
+    loop.reset_stats()
+    loop.call_soon(slow)
+    loop.call_soon(loop.stop)
+    with caplog.at_level('WARNING', logger='casyncio'):
+        loop.run_forever()
+    st = loop.stats()
+    assert st['callbacks'] == 2 and st['slow_callbacks'] == 1
+    assert st['last_slow_callback'][0] is slow and st['last_slow_callback'][1] >= 0.01
+    assert sum(st['callback_time'].values()) == 2
+    assert max(st['callback_time']) > 0.01
+    assert 'slow' in caplog.text
+    with pytest.raises(ValueError):
+        loop.callback_timing = False
+    loop.remove_reader(r.fileno())
+    r.close()
+    w.close()
+
+
+@pytest.mark.parametrize('backend', ['epoll', 'io_uring'])
+def test_busy_poll_and_event_array_growth(backend):
+    loop = casyncio.EventLoop(backend=backend, busy_poll=5.0)
+    assert loop.busy_poll == 5.0
+    assert loop.stats()['event_array'] == 64
+    pairs = [socket.socketpair() for _ in range(300)]
+    got = []
+
+    def on_read(sock):
+        got.append(sock.recv(1))
+        if len(got) == len(pairs):
+            # a spinning loop still notices a cross-thread wakeup
+            threading.Timer(0.01, loop.call_soon_threadsafe, (loop.stop,)).start()
+
+    for r, w in pairs:
+        r.setblocking(False)
+        loop.add_reader(r.fileno(), lambda r=r: on_read(r))
+        w.send(b'x')
+    start = time.monotonic()
+    loop.run_forever()
+    st = loop.stats()
+    assert got == [b'x'] * len(pairs)
+    assert st['event_array'] > 64                  # 300 ready fds overflowed 64
+    assert st['busy_polls'] >= 1 and st['busy_poll_hits'] >= 1
+    assert time.monotonic() - start < 5.0          # woken, not the whole budget
+
+    loop.busy_poll = 0
+    loop.reset_stats()
+    loop.call_later(0.001, loop.stop)
+    loop.run_forever()
+    assert loop.stats()['busy_polls'] == 0
+    with pytest.raises(ValueError):
+        loop.busy_poll = -1
+    assert loop.set_napi_busy_poll(0, budget=0) in (True, False)
+    for r, w in pairs:
+        loop.remove_reader(r.fileno())
+        r.close()
+        w.close()
+
+
+@pytest.mark.parametrize('backend', ['epoll', 'io_uring'])
+def test_sendfile_keeps_order_and_copies_to_pipes(tmp_path, backend):
+    loop = casyncio.EventLoop(backend=backend)
+    body = os.urandom(3 << 20)
+    path = tmp_path / 'body.bin'
+    path.write_bytes(body)
+    r, w = socket.socketpair()
+    w.setblocking(False)
+    r.setblocking(False)
+    writer = StreamWriter(loop, w.fileno())
+    got = bytearray()
+
+    def reader():
+        while True:
+            try:
+                chunk = r.recv(1 << 20)
+            except BlockingIOError:
+                break
+            got.extend(chunk)
+        finished()
+
+    def finished(*_):
+        if len(got) >= (1 << 20) + len(body) - 2 and task.done():
+            loop.stop()
+
+    async def respond():
+        writer.write(b'x' * (1 << 20))   # still queued when sendfile() is called
+        writer.write(b'HEAD')
+        with open(path, 'rb') as f:
+            fut = writer.sendfile(f, offset=10)
+        writer.write(b'TAIL')
+        return await fut
+
+    before = loop.stats()['bytes_sent']
+    task = loop.create_task(respond())
+    task.add_done_callback(finished)
+    loop.add_reader(r.fileno(), reader)
+    loop.run_forever()
+    loop.remove_reader(r.fileno())
+    assert task.result() == len(body) - 10
+    assert bytes(got) == b'x' * (1 << 20) + b'HEAD' + body[10:] + b'TAIL'
+    assert loop.stats()['bytes_sent'] - before == len(got)
+
+    # a pipe takes the copy path; count past the end stops at EOF
+    rfd, wfd = os.pipe()
+    os.set_blocking(wfd, False)
+    with open(path, 'rb') as f:
+        fut = loop.sendfile(wfd, f.fileno(), len(body) - 5, 100)
+    assert fut.done() and fut.result() == 5
+    assert os.read(rfd, 16) == body[-5:]
+
+    # closing with a file still queued fails its future
+    with open(path, 'rb') as f:
+        fut = loop.sendfile(wfd, f.fileno())
+    assert not fut.done()
+    loop._c_close(wfd)
+    os.close(rfd)
+    loop.call_later(0.05, loop.stop)
+    loop.run_forever()
+    assert isinstance(fut.exception(), ConnectionResetError)
+    r.close()
+    w.close()
+
+
+@pytest.mark.parametrize('backend', ['epoll', 'io_uring'])
+def test_zerocopy_holds_buffers_until_completion(backend):
+    loop = casyncio.EventLoop(backend=backend)
+    ls = socket.create_server(('127.0.0.1', 0))
+    w = socket.create_connection(ls.getsockname())
+    r, _ = ls.accept()
+    ls.close()
+    w.setblocking(False)
+    r.setblocking(False)
+    writer = StreamWriter(loop, w.fileno())
+    writer.set_zerocopy(64 * 1024)
+    writer.set_write_buffer_limits(high=0)
+    chunks = [os.urandom(1 << 20) for _ in range(4)]
+    got = bytearray()
+    drained = []
+
+    def reader():
+        while True:
+            try:
+                chunk = r.recv(1 << 20)
+            except BlockingIOError:
+                return
+            got.extend(chunk)
+
+    async def send():
+        for chunk in chunks:
+            writer.write(chunk)
+            writer.write(b'small')   # gathered normally, after the zerocopy send
+        await writer.drain()
+        drained.append(writer.get_write_buffer_size())
+        loop.stop()
+
+    loop.add_reader(r.fileno(), reader)
+    loop.create_task(send())
+    loop.run_forever()
+    loop.remove_reader(r.fileno())
+    reader()
+    # drain() resolved only once every completion was reaped
+    assert drained == [0]
+    assert bytes(got) == b''.join(c + b'small' for c in chunks)
+    stats = loop.stats()
+    assert stats['zerocopy_sends'] >= len(chunks)
+    # loopback delivery copies, and says so in the completion
+    assert stats['zerocopy_copied'] == stats['zerocopy_sends']
+
+    # only TCP and UDP sockets take it
+    a, b = socket.socketpair()
+    with pytest.raises(OSError):
+        loop._set_zerocopy(a.fileno())
+    loop._c_close(w.detach())
+    for s in (a, b, r):
+        s.close()
+
+
+def test_freelists_recycle_buffers_queues_and_handles():
+    loop = casyncio.EventLoop()
+    loop.set_freelist_limits(handles=256)
+
+    def churn():
+        # one connection's worth of allocations: a read buffer, a write queue
+        a, b = socket.socketpair()
+        a.setblocking(False)
+        reader = casyncio.StreamReader(loop, a.fileno())
+        b.send(b'ping\n')
+
+        async def one():
+            line = await reader.readline()
+            loop.stop()
+            return line
+
+        task = loop.create_task(one())
+        loop.run_forever()
+        assert task.result() == b'ping\n'
+        loop.remove_reader(a.fileno())
+        loop._c_write(b.fileno(), b'x')
+        loop._c_close(b.detach())
+        del reader, task
+        a.close()
+
+    churn()
+    stats = loop.freelist_stats()
+    # the drained reader handed its buffer back; the closed fd its queue
+    assert stats['buffer_bytes_in_use'] == 0
+    assert stats['buffer_bytes_retained'] == sum(k * v for k, v in stats['buffer_classes'].items()) > 0
+    assert stats['outbufs_retained'] == 1
+    churn()
+    again = loop.freelist_stats()
+    # the second connection allocates nothing new
+    assert again['buffer_hits'] > stats['buffer_hits']
+    assert again['buffer_misses'] == stats['buffer_misses']
+    assert again['outbuf_hits'] == stats['outbuf_hits'] + 1
+
+    handles = [loop.call_later(10, print) for _ in range(8)]
+    for h in handles:
+        h.cancel()
+    del handles, h
+    gc.collect()
+    assert loop.freelist_stats()['timer_handles_retained'] >= 8
+
+    loop.set_freelist_limits(buffer_bytes=0, outbufs=0, handles=0)
+    trimmed = loop.freelist_stats()
+    assert trimmed['buffer_bytes_retained'] == 0
+    assert trimmed['outbufs_retained'] == 0
+    assert trimmed['timer_handles_retained'] == 0
+    assert trimmed['fd_slots'] % 64 == 0 and trimmed['fd_slots'] > 0
+    with pytest.raises(ValueError):
+        loop.set_freelist_limits(outbufs=-1)
+    loop.set_freelist_limits(buffer_bytes=8 << 20, outbufs=256, handles=256)
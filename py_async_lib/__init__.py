@@ -4,11 +4,12 @@ from .stream_writer import StreamWriter
 from .streams import StreamReader
 from .subprocess import Subprocess, create_subprocess_exec
 from .policy import _CAsyncioPolicy
-from .timer_handle import TimerHandle
+from .timer_handle import Handle, TimerHandle
 from .executor import run_in_executor
 from .dns import async_getaddrinfo
-from .highlevel import open_connection, start_server
-from .transports import BaseProtocol, SocketTransport
+from .highlevel import open_connection, start_server, create_datagram_endpoint
+from .transports import (BaseProtocol, BufferedProtocol, DatagramProtocol,
+                         DatagramTransport, SocketTransport)
 
 def install() -> None:
     """Install the `_CAsyncioPolicy` as the default asyncio policy."""
@@ -22,11 +23,16 @@ __all__ = [
     "Subprocess",
     "create_subprocess_exec",
     "install",
+    "Handle",
     "TimerHandle",
     "run_in_executor",
     "async_getaddrinfo",
     "open_connection",
     "start_server",
+    "create_datagram_endpoint",
     "BaseProtocol",
+    "BufferedProtocol",
     "SocketTransport",
+    "DatagramProtocol",
+    "DatagramTransport",
 ]
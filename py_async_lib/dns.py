@@ -1,6 +1,435 @@
+import os
 import socket
+import struct
+import asyncio
+import time
+from collections import OrderedDict
 from .executor import run_in_executor
 
+try:
+    import casyncio
+except ModuleNotFoundError:  # pragma: no cover - optional C extension
+    casyncio = None
+
+DNS_PORT = 53
+_TYPE_A = 1
+_TYPE_AAAA = 28
+_RCODE_NXDOMAIN = 3
+
+
+def _new_future(loop):
+    # like the C loop: await inside whichever asyncio loop is running
+    running = asyncio._get_running_loop()
+    return (running or loop).create_future()
+
+
+def _system_getaddrinfo(loop, host, port, family, type, proto, flags):
+    if casyncio is not None and isinstance(loop, casyncio.EventLoop):
+        return loop.getaddrinfo(host, port, family=family, type=type, proto=proto, flags=flags)
+    return run_in_executor(
+        loop, socket.getaddrinfo, host, port, family, type, proto, flags
+    )
+
+
+def parse_resolv_conf(path="/etc/resolv.conf"):
+    """Return (nameservers, search, options) from a resolv.conf file."""
+    nameservers, search, options = [], [], {"timeout": 5, "attempts": 2, "ndots": 1}
+    try:
+        with open(path) as f:
+            lines = f.read().splitlines()
+    except OSError:
+        lines = []
+    for line in lines:
+        fields = line.split("#", 1)[0].split(";", 1)[0].split()
+        if len(fields) < 2:
+            continue
+        if fields[0] == "nameserver" and len(nameservers) < 3:
+            nameservers.append(fields[1])
+        elif fields[0] in ("search", "domain"):
+            search = fields[1:]  # the last one wins, as in libc
+        elif fields[0] == "options":
+            for opt in fields[1:]:
+                name, _, value = opt.partition(":")
+                if name in options and value.isdigit():
+                    options[name] = int(value)
+    if not nameservers:
+        nameservers = ["127.0.0.1"]
+    return nameservers, search, options
+
+
+def parse_hosts(path="/etc/hosts"):
+    """Return {lowercased name: [(family, address), ...]} from a hosts file."""
+    hosts = {}
+    try:
+        with open(path) as f:
+            lines = f.read().splitlines()
+    except OSError:
+        return hosts
+    for line in lines:
+        fields = line.split("#", 1)[0].split()
+        if len(fields) < 2:
+            continue
+        family = socket.AF_INET6 if ":" in fields[0] else socket.AF_INET
+        try:
+            socket.inet_pton(family, fields[0].split("%", 1)[0])
+        except OSError:
+            continue
+        for name in fields[1:]:
+            entry = hosts.setdefault(name.lower(), [])
+            if (family, fields[0]) not in entry:
+                entry.append((family, fields[0]))
+    return hosts
+
+
+def _encode_query(qid, name, qtype):
+    labels = b"".join(
+        bytes((len(label),)) + label
+        for label in name.rstrip(".").encode("idna").split(b".")
+        if label
+    )
+    # header: id, RD set, one question
+    return struct.pack("!HHHHHH", qid, 0x0100, 1, 0, 0, 0) + labels + b"\0" + struct.pack("!HH", qtype, 1)
+
+
+def _skip_name(msg, pos):
+    while True:
+        n = msg[pos]
+        if n & 0xC0 == 0xC0:
+            return pos + 2
+        pos += n + 1
+        if n == 0:
+            return pos
+
+
+def _decode_reply(msg, qtype):
+    """Return (rcode, [address, ...], min ttl) for the qtype answers."""
+    _, flags, qdcount, ancount, _, _ = struct.unpack_from("!HHHHHH", msg)
+    pos = 12
+    for _ in range(qdcount):
+        pos = _skip_name(msg, pos) + 4
+    addrs, ttl = [], None
+    for _ in range(ancount):
+        pos = _skip_name(msg, pos)
+        rtype, _, rttl, rdlen = struct.unpack_from("!HHIH", msg, pos)
+        pos += 10
+        rdata = msg[pos:pos + rdlen]
+        pos += rdlen
+        if rtype != qtype:
+            continue  # CNAMEs: the resolver already followed the chain
+        family = socket.AF_INET if rtype == _TYPE_A else socket.AF_INET6
+        addrs.append(socket.inet_ntop(family, rdata))
+        ttl = rttl if ttl is None else min(ttl, rttl)
+    return flags & 0xF, addrs, ttl
+
+
+class _Query:
+    """One A or AAAA question, retried over the nameservers on timeout."""
+
+    def __init__(self, client, loop, names, qtype, fut):
+        self._client = client
+        self._loop = loop
+        self._qtype = qtype
+        self._fut = fut
+        self._tries = [
+            (name, server)
+            for name in names
+            for _ in range(client.attempts)
+            for server in client.nameservers
+        ]
+        self._sock = None
+        self._timer = None
+        self._send_next()
+
+    def _send_next(self, exc=None):
+        self._close()
+        if not self._tries:
+            if not self._fut.done():
+                err = socket.gaierror(socket.EAI_AGAIN, "Temporary failure in name resolution")
+                err.__cause__ = exc
+                self._fut.set_exception(err)
+            return
+        self._name, self._server = self._tries.pop(0)
+        self._qid = int.from_bytes(os.urandom(2), "big")
+        family = socket.AF_INET6 if ":" in self._server[0] else socket.AF_INET
+        try:
+            query = _encode_query(self._qid, self._name, self._qtype)
+            # a fresh socket, and so a fresh source port, for every attempt
+            self._sock = socket.socket(family, socket.SOCK_DGRAM)
+        except (OSError, UnicodeError) as e:
+            # an unencodable name or no fds left: no retry will do better
+            if not self._fut.done():
+                self._fut.set_exception(e)
+            return
+        self._sock.setblocking(False)
+        try:
+            self._sock.connect(self._server)
+            self._sock.send(query)
+        except OSError as e:
+            self._send_next(e)
+            return
+        self._loop.add_reader(self._sock.fileno(), self._on_read)
+        self._timer = self._loop.call_later(self._client.timeout, lambda: self._send_next())
+
+    def _close(self):
+        if self._timer is not None:
+            self._timer.cancel()
+            self._timer = None
+        if self._sock is not None:
+            self._loop.remove_reader(self._sock.fileno())
+            self._sock.close()
+            self._sock = None
+
+    def _on_read(self):
+        # registrations are edge-triggered: drain until EAGAIN
+        while self._sock is not None:
+            try:
+                msg = self._sock.recv(4096)
+            except BlockingIOError:
+                return
+            except OSError as e:  # ICMP port unreachable and friends
+                self._send_next(e)
+                return
+            if len(msg) < 12 or int.from_bytes(msg[:2], "big") != self._qid:
+                continue  # stale or spoofed
+            try:
+                rcode, addrs, ttl = _decode_reply(msg, self._qtype)
+            except (IndexError, struct.error, ValueError):
+                continue
+            if rcode == 0 or rcode == _RCODE_NXDOMAIN:
+                self._answer(rcode, addrs, ttl)
+            else:
+                self._send_next()  # SERVFAIL, REFUSED: next server
+            return
+
+    def _answer(self, rcode, addrs, ttl):
+        self._close()
+        if not addrs:
+            # this name has nothing: go on with the next search candidate
+            self._tries = [t for t in self._tries if t[0] != self._name]
+            if self._tries:
+                self._send_next()
+                return
+        if not self._fut.done():
+            self._fut.set_result((addrs, ttl))
+
+
+class DNSClient:
+    """Non-blocking stub resolver speaking DNS over UDP on the loop.
+
+    Names are looked up in the hosts file first, then sent as A/AAAA
+    questions to the resolv.conf nameservers, honouring its search list and
+    ``timeout``/``attempts``/``ndots`` options.  Every attempt uses a new
+    socket with a random query id.  Truncated replies are used as they are;
+    there is no TCP fallback.
+    """
+
+    def __init__(self, nameservers=None, *, search=None, timeout=None, attempts=None,
+                 ndots=None, resolv_conf="/etc/resolv.conf", hosts="/etc/hosts"):
+        conf_servers, conf_search, options = parse_resolv_conf(resolv_conf)
+        self.nameservers = [
+            (ns, DNS_PORT) if isinstance(ns, str) else tuple(ns)
+            for ns in (nameservers or conf_servers)
+        ]
+        self.search = conf_search if search is None else list(search)
+        self.timeout = options["timeout"] if timeout is None else timeout
+        self.attempts = max(1, options["attempts"] if attempts is None else attempts)
+        self.ndots = options["ndots"] if ndots is None else ndots
+        self.hosts = parse_hosts(hosts) if isinstance(hosts, str) else dict(hosts or {})
+
+    def _candidates(self, host):
+        if host.endswith(".") or not self.search:
+            return [host]
+        searched = [f"{host}.{domain}" for domain in self.search]
+        if host.count(".") >= self.ndots:
+            return [host] + searched
+        return searched + [host]
+
+    def resolve(self, loop, host, family=0):
+        """Future for ([(family, address), ...], ttl); ttl is None for hosts entries."""
+        fut = loop.create_future()
+        known = [a for a in self.hosts.get(host.lower(), ()) if family in (0, a[0])]
+        if known:
+            fut.set_result((known, None))
+            return fut
+        qtypes = []
+        if family in (0, socket.AF_INET):
+            qtypes.append((socket.AF_INET, _TYPE_A))
+        if family in (0, socket.AF_INET6):
+            qtypes.append((socket.AF_INET6, _TYPE_AAAA))
+        names = self._candidates(host)
+        pending = [(fam, loop.create_future()) for fam, _ in qtypes]
+        for (fam, qtype), (_, qfut) in zip(qtypes, pending):
+            _Query(self, loop, names, qtype, qfut)
+
+        def on_done(_):
+            if fut.done() or not all(q.done() for _, q in pending):
+                return
+            addrs, ttls, exc = [], [], None
+            for fam, q in pending:
+                if q.exception() is not None:
+                    exc = q.exception()
+                    continue
+                found, ttl = q.result()
+                addrs += [(fam, a) for a in found]
+                if ttl is not None:
+                    ttls.append(ttl)
+            if addrs:
+                fut.set_result((addrs, min(ttls) if ttls else None))
+            else:
+                fut.set_exception(exc or socket.gaierror(
+                    socket.EAI_NONAME, "Name or service not known"))
+        for _, q in pending:
+            q.add_done_callback(on_done)
+        return fut
+
+    def getaddrinfo(self, loop, host, port, family=0, type=0, proto=0, flags=0):
+        """Future for (getaddrinfo()-shaped list, ttl)."""
+        fut = loop.create_future()
+        try:
+            if host is None or flags & socket.AI_NUMERICHOST or _is_numeric(host):
+                # nothing to ask a server: libc answers without blocking
+                fut.set_result((socket.getaddrinfo(host, port, family, type, proto, flags), None))
+                return fut
+            if isinstance(port, str) and not port.isdigit():
+                port = socket.getservbyname(port)
+            port = int(port or 0)
+        except OSError as e:
+            fut.set_exception(e)
+            return fut
+        kinds = [
+            (socket.SOCK_STREAM, socket.IPPROTO_TCP),
+            (socket.SOCK_DGRAM, socket.IPPROTO_UDP),
+            (socket.SOCK_RAW, 0),
+        ]
+        if type:
+            kinds = [k for k in kinds if k[0] == type] or [(type, 0)]
+
+        def on_done(res):
+            if fut.done():
+                return
+            if res.exception() is not None:
+                fut.set_exception(res.exception())
+                return
+            addrs, ttl = res.result()
+            infos = []
+            for fam, addr in addrs:
+                sockaddr = (addr, port) if fam == socket.AF_INET else (addr, port, 0, 0)
+                for kind, kproto in kinds:
+                    infos.append((fam, kind, proto or kproto, "", sockaddr))
+            fut.set_result((infos, ttl))
+        self.resolve(loop, host, family).add_done_callback(on_done)
+        return fut
+
+
+def _is_numeric(host):
+    for family in (socket.AF_INET, socket.AF_INET6):
+        try:
+            socket.inet_pton(family, host.split("%", 1)[0])
+            return True
+        except (OSError, ValueError):
+            pass
+    return False
+
+
+class Resolver:
+    """getaddrinfo() with a bounded cache and single-flight lookups.
+
+    Results are cached per (host, port, family, type, proto, flags) for
+    ``ttl`` seconds (capped by the record TTL when ``client`` is a
+    :class:`DNSClient`), failures for ``negative_ttl``, and the least
+    recently used entry is dropped past ``maxsize``.  Concurrent lookups of
+    the same key on one loop share a single query; each caller gets its own
+    future, so cancelling one does not cancel the others.
+    """
+
+    def __init__(self, *, ttl=30.0, negative_ttl=1.0, maxsize=1024, client=None):
+        self.ttl = ttl
+        self.negative_ttl = negative_ttl
+        self.maxsize = maxsize
+        self.client = client
+        self._cache = OrderedDict()   # key -> (expires, infos, exc)
+        self._inflight = {}           # (loop, key) -> [waiter, ...]
+
+    def clear(self):
+        self._cache.clear()
+
+    def getaddrinfo(self, loop, host, port, family=0, type=0, proto=0, flags=0):
+        key = (host, port, family, type, proto, flags)
+        fut = _new_future(loop)
+        entry = self._cache.get(key)
+        if entry is not None:
+            if entry[0] > time.monotonic():
+                self._cache.move_to_end(key)
+                exc = entry[2]
+                if exc is not None:
+                    exc = exc.__class__(*exc.args)  # a fresh traceback per caller
+                self._deliver(fut, entry[1], exc)
+                return fut
+            self._cache.pop(key, None)
+        waiters = self._inflight.get((loop, key))
+        if waiters is not None:
+            waiters.append(fut)
+            return fut
+        self._inflight[(loop, key)] = [fut]
+        try:
+            if self.client is not None:
+                query = self.client.getaddrinfo(loop, host, port, family, type, proto, flags)
+            else:
+                query = _system_getaddrinfo(loop, host, port, family, type, proto, flags)
+        except Exception as e:
+            # nothing started: later lookups must not join a query that never finishes
+            for waiter in self._inflight.pop((loop, key), ()):
+                self._deliver(waiter, None, e)
+            return fut
+        query.add_done_callback(lambda q: self._finish(loop, key, q))
+        return fut
+
+    def _finish(self, loop, key, query):
+        waiters = self._inflight.pop((loop, key), ())
+        infos = exc = None
+        if query.cancelled():
+            exc = socket.gaierror(socket.EAI_AGAIN, "lookup cancelled")
+            ttl = 0
+        elif query.exception() is not None:
+            exc = query.exception()
+            ttl = self.negative_ttl
+        else:
+            infos, ttl = query.result(), self.ttl
+            if self.client is not None:
+                infos, rttl = infos
+                if rttl is not None:
+                    ttl = min(ttl, rttl)
+        if ttl > 0 and self.maxsize > 0:
+            self._cache[key] = (time.monotonic() + ttl, infos, exc)
+            self._cache.move_to_end(key)
+            while len(self._cache) > self.maxsize:
+                self._cache.popitem(last=False)
+        for fut in waiters:
+            self._deliver(fut, infos, exc)
+
+    @staticmethod
+    def _deliver(fut, infos, exc):
+        if fut.done():
+            return  # the caller gave up
+        if exc is not None:
+            fut.set_exception(exc)
+        else:
+            fut.set_result(list(infos))
+
+
+_default_resolver = Resolver()
+
+
+def get_resolver():
+    return _default_resolver
+
+
+def set_resolver(resolver):
+    """Replace the resolver used by async_getaddrinfo() and open_connection()."""
+    global _default_resolver
+    _default_resolver = resolver
+
+
 def async_getaddrinfo(
     loop,
     host: str,
@@ -10,7 +439,9 @@ def async_getaddrinfo(
     proto: int = 0,
     flags: int = 0,
 ):
-    """Resolve host asynchronously using run_in_executor."""
-    return run_in_executor(
-        loop, socket.getaddrinfo, host, port, family, type, proto, flags
-    )
+    """Resolve host asynchronously through the cached, single-flight resolver.
+
+    Without a DNS client the lookup runs getaddrinfo() off the loop thread;
+    casyncio loops call it on their C worker pool.
+    """
+    return _default_resolver.getaddrinfo(loop, host, port, family, type, proto, flags)
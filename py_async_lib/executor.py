@@ -1,27 +1,38 @@
-import asyncio
 from concurrent.futures import ThreadPoolExecutor
 from typing import Any, Callable, Optional
 
+try:
+    import casyncio
+except ModuleNotFoundError:  # pragma: no cover - optional C extension
+    casyncio = None
+
 _DEFAULT_EXECUTOR: Optional[ThreadPoolExecutor] = None
 
 
 def run_in_executor(loop, func: Callable[..., Any], *args: Any, executor: Optional[ThreadPoolExecutor] = None):
-    """Execute *func* in a thread and return an asyncio Future."""
+    """Execute *func* in a thread and return a Future bound to *loop*.
+
+    Without an explicit *executor*, casyncio loops run the call on their own
+    C worker pool and deliver completions in batches.
+    """
+    if executor is None and casyncio is not None and isinstance(loop, casyncio.EventLoop):
+        return loop.run_in_pool(func, *args)
+
     global _DEFAULT_EXECUTOR
     if executor is None:
         if _DEFAULT_EXECUTOR is None:
             _DEFAULT_EXECUTOR = ThreadPoolExecutor()
         executor = _DEFAULT_EXECUTOR
 
-    fut = asyncio.Future()
+    fut = loop.create_future()
 
     def _work():
         try:
             res = func(*args)
         except Exception as exc:  # pragma: no cover - error path
-            loop.call_soon_threadsafe(lambda: fut.set_exception(exc))
+            loop.call_soon_threadsafe(fut.set_exception, exc)
         else:
-            loop.call_soon_threadsafe(lambda: fut.set_result(res))
+            loop.call_soon_threadsafe(fut.set_result, res)
 
     executor.submit(_work)
     return fut
@@ -1,13 +1,21 @@
+import os
+import signal
 import socket
 import asyncio
+import traceback
 from .streams import StreamReader
 from .stream_writer import StreamWriter
 from .dns import async_getaddrinfo
 
+try:
+    import casyncio
+except ModuleNotFoundError:  # pragma: no cover - optional C extension
+    casyncio = None
+
 async def open_connection(host, port, *, loop=None):
     if loop is None:
         loop = asyncio.get_event_loop()
-    infos = await async_getaddrinfo(loop, host, port)
+    infos = await async_getaddrinfo(loop, host, port, type=socket.SOCK_STREAM)
     family, type_, proto, _, sockaddr = infos[0]
     sock = socket.socket(family, type_, proto)
     sock.setblocking(False)
@@ -30,34 +38,209 @@ async def open_connection(host, port, *, loop=None):
     writer = StreamWriter(loop, sock.fileno())
     return reader, writer
 
-async def start_server(client_connected_cb, host, port, *, loop=None, backlog=100):
+async def create_datagram_endpoint(protocol_factory, local_addr=None, remote_addr=None, *,
+                                   family=0, reuse_port=False, allow_broadcast=False,
+                                   sock=None, loop=None):
+    """Open a UDP endpoint; returns ``(transport, protocol)``.
+
+    On a ``casyncio.EventLoop`` the transport is a native
+    ``DatagramTransport`` (recvmmsg/sendmmsg batching, GSO/GRO when the
+    kernel has them); other loops use their own implementation.  Host
+    names are resolved through :func:`async_getaddrinfo`.
+    """
     if loop is None:
         loop = asyncio.get_event_loop()
+    if casyncio is None or not isinstance(loop, casyncio.EventLoop):
+        return await loop.create_datagram_endpoint(
+            protocol_factory, local_addr, remote_addr, family=family,
+            reuse_port=reuse_port, allow_broadcast=allow_broadcast, sock=sock)
+    if sock is None:
+        local = remote = None
+        if remote_addr is not None:
+            infos = await async_getaddrinfo(loop, remote_addr[0], remote_addr[1],
+                                            family=family, type=socket.SOCK_DGRAM)
+            family, _, _, _, remote = infos[0]
+        if local_addr is not None:
+            infos = await async_getaddrinfo(loop, local_addr[0], local_addr[1],
+                                            family=family, type=socket.SOCK_DGRAM)
+            family, _, _, _, local = infos[0]
+        sock = socket.socket(family or socket.AF_INET, socket.SOCK_DGRAM)
+        try:
+            if reuse_port:
+                sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+            if allow_broadcast:
+                sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+            if local is not None:
+                sock.bind(local)
+            if remote is not None:
+                sock.connect(remote)  # no handshake: returns at once
+        except BaseException:
+            sock.close()
+            raise
+    protocol = protocol_factory()
+    transport = casyncio.DatagramTransport(loop, sock, protocol)
+    return transport, protocol
+
+
+def _listen(host, port, backlog, *, reuse_port=False):
     srv_sock = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
     srv_sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    if reuse_port:
+        srv_sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
     srv_sock.bind((host, port))
     srv_sock.listen(backlog)
     srv_sock.setblocking(False)
+    return srv_sock
 
-    def accept():
-        try:
-            client, _ = srv_sock.accept()
-        except BlockingIOError:
-            return
-        client.setblocking(False)
-        reader = StreamReader(loop, client.fileno())
-        writer = StreamWriter(loop, client.fileno())
+
+def _serve(loop, srv_sock, client_connected_cb):
+    """Accept on srv_sock, calling client_connected_cb(reader, writer)."""
+    def on_accept(reader, writer):
+        # a partial or lambda can return a coroutine too, so check the result
         res = client_connected_cb(reader, writer)
         if asyncio.iscoroutine(res):
-            # best-effort: run coroutine to completion
-            async def runner():
-                await res
-            loop.call_soon(lambda: asyncio.run(runner()))
+            loop.create_task(res)
+    if casyncio is not None:
+        # native accept4() loop; readers are created and registered in C
+        return casyncio.Listener(loop, srv_sock.fileno(), on_accept,
+                                 writer_type=StreamWriter)
+
+    def accept():
+        while True:
+            try:
+                client, _ = srv_sock.accept()
+            except BlockingIOError:
+                return
+            client.setblocking(False)
+            fd = client.detach()
+            on_accept(StreamReader(loop, fd), StreamWriter(loop, fd))
     loop.add_reader(srv_sock.fileno(), accept)
 
+
+def _worker_main(client_connected_cb, host, port, backlog):
+    """Body of a forked worker: own loop, own SO_REUSEPORT listener."""
+    status = 1
+    try:
+        # the parent may have forked from inside a running asyncio loop
+        asyncio._set_running_loop(None)
+        loop = casyncio.EventLoop()
+        srv_sock = _listen(host, port, backlog, reuse_port=True)
+        _serve(loop, srv_sock, client_connected_cb)
+        loop.add_signal_handler(signal.SIGTERM, loop.stop)
+        loop.add_signal_handler(signal.SIGINT, loop.stop)
+        loop.run_forever()
+        status = 0
+    except BaseException:
+        traceback.print_exc()
+    finally:
+        os._exit(status)
+
+
+class _WorkerPool:
+    """Forks and supervises SO_REUSEPORT workers from the parent's loop.
+
+    Each worker is watched through a pidfd, so exits are seen as ordinary
+    readable events; crashed workers are restarted after RESTART_DELAY.
+    SIGTERM delivered to the parent (via the loop's signalfd) is forwarded
+    to every worker and stops the restarts.  ``close()`` waits for the exits
+    through the same pidfds, so it must be awaited on the supervising loop;
+    workers still alive after KILL_TIMEOUT are sent SIGKILL.
+    """
+
+    RESTART_DELAY = 0.1
+    KILL_TIMEOUT = 5.0
+
+    def __init__(self, loop, workers, spawn):
+        self._loop = loop
+        self._spawn = spawn
+        self._pids = {}  # pid -> pidfd
+        self._closing = False
+        self._exited = None  # set by close(), done once every worker is reaped
+        for _ in range(workers):
+            self._start()
+        loop.add_signal_handler(signal.SIGTERM, self.terminate)
+
+    def _start(self):
+        if self._closing:
+            return
+        pid = os.fork()
+        if pid == 0:
+            self._spawn()
+        pidfd = os.pidfd_open(pid)
+        self._pids[pid] = pidfd
+        self._loop.add_reader(pidfd, lambda: self._reap(pid))
+
+    def _reap(self, pid):
+        pidfd = self._pids.pop(pid)
+        self._loop.remove_reader(pidfd)
+        os.close(pidfd)
+        # the pidfd is readable: the worker has exited and this cannot block
+        os.waitpid(pid, 0)
+        if not self._closing:
+            self._loop.call_later(self.RESTART_DELAY, self._start)
+        elif not self._pids and self._exited is not None and not self._exited.done():
+            self._exited.set_result(None)
+
+    def _kill(self):
+        for pid in self._pids:
+            os.kill(pid, signal.SIGKILL)
+
+    def terminate(self):
+        self._closing = True
+        for pid in self._pids:
+            os.kill(pid, signal.SIGTERM)
+
+    async def close(self):
+        self._loop.remove_signal_handler(signal.SIGTERM)
+        self.terminate()
+        if not self._pids:
+            return
+        self._exited = self._loop.create_future()
+        timer = self._loop.call_later(self.KILL_TIMEOUT, self._kill)
+        try:
+            await self._exited
+        finally:
+            timer.cancel()
+
+
+async def start_server(client_connected_cb, host, port, *, loop=None, backlog=100,
+                       workers=None):
+    """Serve on (host, port); returns ``(close, port)``.
+
+    With ``workers=N`` the calling process forks N workers, each running its
+    own ``casyncio.EventLoop`` with its own SO_REUSEPORT listener so the
+    kernel spreads connections across them.  The parent only supervises.
+    """
+    if loop is None:
+        loop = asyncio.get_event_loop()
+    if workers:
+        if casyncio is None:
+            raise RuntimeError("workers= requires the casyncio extension")
+        # a bound, non-listening socket reserves the port (and resolves 0)
+        # for the reuseport group without receiving connections itself
+        reserve = socket.socket(socket.AF_INET, socket.SOCK_STREAM)
+        reserve.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+        reserve.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEPORT, 1)
+        reserve.bind((host, port))
+        port = reserve.getsockname()[1]
+        pool = _WorkerPool(
+            loop, workers,
+            lambda: _worker_main(client_connected_cb, host, port, backlog))
+
+        async def close():
+            await pool.close()
+            reserve.close()
+
+        return close, port
+
+    srv_sock = _listen(host, port, backlog)
+    listener = _serve(loop, srv_sock, client_connected_cb)
+
     async def close():
-        loop.remove_reader(srv_sock.fileno())
+        if listener is not None:
+            listener.close()
+        else:
+            loop.remove_reader(srv_sock.fileno())
         srv_sock.close()
 
     return close, srv_sock.getsockname()[1]
-
@@ -8,6 +8,39 @@ class StreamWriter:
     def write(self, data: bytes) -> None:
         self._loop._c_write(self._fd, data)
 
+    def writelines(self, data) -> None:
+        """Write several buffers with one vectored send."""
+        self._loop._c_writelines(self._fd, data)
+
+    def set_write_buffer_limits(self, high=None, low=None) -> None:
+        self._loop._set_write_buffer_limits(self._fd, high, low)
+
+    def get_write_buffer_size(self) -> int:
+        return self._loop._get_write_buffer_size(self._fd)
+
+    def set_zerocopy(self, threshold=None) -> None:
+        """Send writes of at least threshold bytes (128 KiB by default) with MSG_ZEROCOPY.
+
+        TCP and UDP sockets only; 0 turns it off.  Zerocopy writes count as
+        buffered, and hold drain(), until the kernel reports them complete.
+        """
+        self._loop._set_zerocopy(self._fd, threshold)
+
+    def sendfile(self, file, offset=0, count=None):
+        """Queue count bytes of file (to its end by default) behind earlier writes.
+
+        Uses sendfile(2) for sockets and a bounded copy otherwise.  The
+        file is queued at call time, so later write()s follow it; await
+        the returned future for the number of bytes sent.
+        """
+        fd = file.fileno() if hasattr(file, "fileno") else file
+        return self._loop.sendfile(self._fd, fd, offset, count)
+
     async def drain(self):
+        """Wait until the write buffer is at or below its low watermark."""
         fut = self._loop._c_drain_waiter(self._fd)
         await fut
+
+    def close(self) -> None:
+        """Stop reading and close the fd once queued data has been sent."""
+        self._loop._c_close(self._fd)
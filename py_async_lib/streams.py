@@ -1,8 +1,14 @@
 import os
 import asyncio
 
-class StreamReader:
-    """Minimal asynchronous stream reader."""
+try:
+    import casyncio
+except ModuleNotFoundError:  # pragma: no cover - optional C extension
+    casyncio = None
+
+
+class PyStreamReader:
+    """Pure-Python stream reader used when the C extension is missing."""
 
     def __init__(self, loop, fd: int):
         self._loop = loop
@@ -18,11 +24,16 @@ class StreamReader:
             self._waiter = None
 
     def _on_ready(self):
-        data = os.read(self._fd, 4096)
-        if not data:
-            self._eof = True
-            self._loop.remove_reader(self._fd)
-        else:
+        # registrations are edge-triggered, so drain until EAGAIN
+        while True:
+            try:
+                data = os.read(self._fd, 65536)
+            except BlockingIOError:
+                break
+            if not data:
+                self._eof = True
+                self._loop.remove_reader(self._fd)
+                break
             self._buffer.extend(data)
         self._wakeup()
 
@@ -53,3 +64,6 @@ class StreamReader:
             self._waiter = asyncio.Future()
             await self._waiter
 
+
+# The C reader buffers per fd, drains until EAGAIN and scans with memchr/memmem.
+StreamReader = casyncio.StreamReader if casyncio is not None else PyStreamReader
@@ -1,5 +1,115 @@
+import asyncio
+import signal
+from subprocess import PIPE, STDOUT, DEVNULL
+from .streams import StreamReader
+from .stream_writer import StreamWriter
+
+try:
+    import casyncio
+except ModuleNotFoundError:  # pragma: no cover - optional C extension
+    casyncio = None
+
+_DEFAULT_LIMIT = 2 ** 16
+
+
+class _StdinWriter(StreamWriter):
+    """stdin pipe writer; the pipe end belongs to the process."""
+
+    def __init__(self, loop, proc):
+        super().__init__(loop, proc.stdin)
+        self._proc = proc
+
+    def close(self) -> None:
+        self._proc.close_stdin()
+
+
+async def _read_all(reader):
+    chunks = []
+    while True:
+        chunk = await reader.read()
+        if not chunk:
+            return b"".join(chunks)
+        chunks.append(chunk)
+
+
 class Subprocess:
-    pass
+    """A child started by create_subprocess_exec().
+
+    ``stdin`` is a StreamWriter and ``stdout``/``stderr`` are StreamReaders
+    for the pipes that were asked for.  The pipes stay open until the
+    process object is closed or collected, so keep it while reading them.
+    """
+
+    def __init__(self, loop, proc, limit=_DEFAULT_LIMIT):
+        self._loop = loop
+        self._proc = proc
+        self.pid = proc.pid
+        self.stdin = _StdinWriter(loop, proc) if proc.stdin is not None else None
+        self.stdout = StreamReader(loop, proc.stdout, limit) if proc.stdout is not None else None
+        self.stderr = StreamReader(loop, proc.stderr, limit) if proc.stderr is not None else None
+
+    def __repr__(self):
+        return f"<Subprocess {self.pid}>"
+
+    @property
+    def returncode(self):
+        return self._proc.returncode
+
+    async def wait(self):
+        """Wait for the child to exit and return its returncode."""
+        return await self._proc.wait()
+
+    def send_signal(self, sig):
+        self._proc.send_signal(sig)
+
+    def terminate(self):
+        self._proc.send_signal(signal.SIGTERM)
+
+    def kill(self):
+        self._proc.send_signal(signal.SIGKILL)
+
+    def close(self):
+        self._proc.close()
+
+    async def communicate(self, input=None):
+        """Send input, read stdout and stderr to EOF, wait; returns (stdout, stderr)."""
+        # read both pipes while writing, or a child blocked on a full
+        # stdout would stop reading its stdin
+        readers = [
+            self._loop.create_task(_read_all(r)) if r is not None else None
+            for r in (self.stdout, self.stderr)
+        ]
+        if self.stdin is not None:
+            try:
+                if input:
+                    self.stdin.write(input)
+                    await self.stdin.drain()
+            except (BrokenPipeError, ConnectionResetError):
+                pass  # the child exited without reading everything
+            self.stdin.close()
+        out, err = [await t if t is not None else None for t in readers]
+        await self.wait()
+        self.close()
+        return out, err
+
+
+async def create_subprocess_exec(program, *args, stdin=None, stdout=None, stderr=None,
+                                 loop=None, limit=_DEFAULT_LIMIT, cwd=None, env=None,
+                                 executable=None):
+    """Start program with posix_spawn() and return a :class:`Subprocess`.
+
+    ``stdin``/``stdout``/``stderr`` take ``PIPE``, ``DEVNULL``, ``STDOUT``
+    (stderr only), a file descriptor or an object with ``fileno()``; None
+    inherits the parent's.  Exit is watched through a pidfd on the loop.
+    """
+    if casyncio is None:
+        raise RuntimeError("create_subprocess_exec requires the casyncio extension")
+    if loop is None:
+        loop = asyncio.get_event_loop()
+    stdio = [s.fileno() if hasattr(s, "fileno") else s for s in (stdin, stdout, stderr)]
+    proc = casyncio.Process(loop, [program, *args], executable=executable, cwd=cwd, env=env,
+                            stdin=stdio[0], stdout=stdio[1], stderr=stdio[2])
+    return Subprocess(loop, proc, limit)
+
 
-def create_subprocess_exec(*args, **kwargs):
-    raise NotImplementedError
+__all__ = ["PIPE", "STDOUT", "DEVNULL", "Subprocess", "create_subprocess_exec"]
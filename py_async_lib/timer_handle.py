@@ -1,26 +1,12 @@
-import ctypes
+"""Handles returned by ``call_soon``/``call_later``/``call_at``.
 
-_py_get_ptr = ctypes.pythonapi.PyCapsule_GetPointer
-_py_get_ptr.restype = ctypes.c_void_p
-_py_get_ptr.argtypes = [ctypes.py_object, ctypes.c_char_p]
+Both types are implemented natively by the casyncio extension; cancelling
+is a plain C method call on the handle.
+"""
 
-class _CNode(ctypes.Structure):
-    _fields_ = [
-        ("deadline_ns", ctypes.c_longlong),
-        ("callback", ctypes.py_object),
-        ("canceled", ctypes.c_int),
-        ("heap_index", ctypes.c_int),
-    ]
-
-class TimerHandle:
-    """Handle returned by call_later to allow cancellation."""
-
-    def __init__(self, capsule):
-        self._capsule = capsule
-
-    def cancel(self):
-        ptr = _py_get_ptr(self._capsule, b"TimerNode")
-        if ptr:
-            node = ctypes.cast(ptr, ctypes.POINTER(_CNode))
-            node.contents.canceled = 1
+try:
+    from casyncio import Handle, TimerHandle
+except ModuleNotFoundError:  # pragma: no cover - optional C extension
+    Handle = TimerHandle = None
 
+__all__ = ["Handle", "TimerHandle"]
@@ -1,6 +1,11 @@
 import os
 import asyncio
 
+try:
+    import casyncio
+except ModuleNotFoundError:  # pragma: no cover - optional C extension
+    casyncio = None
+
 class BaseProtocol:
     def connection_made(self, transport):
         pass
@@ -11,27 +16,109 @@ class BaseProtocol:
     def connection_lost(self, exc):
         pass
 
-class SocketTransport:
+    def pause_writing(self):
+        pass
+
+    def resume_writing(self):
+        pass
+
+    def eof_received(self):
+        """Return True to keep the write side open after the peer's EOF."""
+        return None
+
+
+class BufferedProtocol(BaseProtocol):
+    """Receives into memory it provides instead of fresh bytes objects."""
+
+    def get_buffer(self, sizehint: int):
+        raise NotImplementedError
+
+    def buffer_updated(self, nbytes: int):
+        pass
+
+
+class DatagramProtocol:
+    """Protocol for DatagramTransport.
+
+    Define ``datagrams_received(batch)`` instead of ``datagram_received``
+    to get each recvmmsg() batch as one list of ``(data, addr)`` pairs.
+    """
+
+    def connection_made(self, transport):
+        pass
+
+    def datagram_received(self, data: bytes, addr):
+        pass
+
+    def error_received(self, exc):
+        pass
+
+    def connection_lost(self, exc):
+        pass
+
+    def pause_writing(self):
+        pass
+
+    def resume_writing(self):
+        pass
+
+
+class PySocketTransport:
+    """Pure-Python fallback used when the extension is not built."""
+
     def __init__(self, loop, sock, protocol):
         self._loop = loop
         self._sock = sock
         self._protocol = protocol
+        self._paused = False
         sock.setblocking(False)
+        loop._set_write_protocol(sock.fileno(), protocol)
         loop.add_reader(sock.fileno(), self._on_read)
         protocol.connection_made(self)
 
     def _on_read(self):
-        data = os.read(self._sock.fileno(), 4096)
-        if not data:
-            self.close()
-        else:
+        # registrations are edge-triggered: drain until EAGAIN
+        while True:
+            try:
+                data = os.read(self._sock.fileno(), 65536)
+            except BlockingIOError:
+                return
+            if not data:
+                self.close()
+                return
             self._protocol.data_received(data)
 
     def write(self, data: bytes):
         self._loop._c_write(self._sock.fileno(), data)
 
+    def writelines(self, data):
+        self._loop._c_writelines(self._sock.fileno(), data)
+
+    def set_write_buffer_limits(self, high=None, low=None):
+        self._loop._set_write_buffer_limits(self._sock.fileno(), high, low)
+
+    def get_write_buffer_size(self) -> int:
+        return self._loop._get_write_buffer_size(self._sock.fileno())
+
+    def pause_reading(self):
+        if not self._paused:
+            self._paused = True
+            self._loop._pause_reading(self._sock.fileno())
+
+    def resume_reading(self):
+        if self._paused:
+            self._paused = False
+            self._loop._resume_reading(self._sock.fileno())
+
+    def is_reading(self) -> bool:
+        return not self._paused
+
     def close(self):
+        self._loop._set_write_protocol(self._sock.fileno(), None)
         self._loop.remove_reader(self._sock.fileno())
         self._sock.close()
         self._protocol.connection_lost(None)
 
+
+SocketTransport = casyncio.SocketTransport if casyncio is not None else PySocketTransport
+DatagramTransport = casyncio.DatagramTransport if casyncio is not None else None
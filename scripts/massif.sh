@@ -1,5 +1,6 @@
 #!/bin/sh
-# Run valgrind massif on the timer benchmark
+# Run valgrind massif on the benchmark suite on casyncio.
+# Extra arguments go to benchmarks.suite, e.g. --only timers --scale 0.1
 
 set -e
-valgrind --tool=massif python -m benchmarks.throughput
+valgrind --tool=massif python -m benchmarks.suite --loops casyncio --out suite.json "$@"
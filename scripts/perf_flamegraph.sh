@@ -1,7 +1,8 @@
 #!/bin/sh
-# Generate a perf-based flamegraph for the echo benchmark
+# Generate a perf-based flamegraph of the benchmark suite on casyncio.
+# Extra arguments go to benchmarks.suite, e.g. --only echo_small
 
 set -e
-perf record -F 99 -g -- python -m benchmarks.throughput
+perf record -F 99 -g -- python -m benchmarks.suite --loops casyncio --out suite.json "$@"
 perf script | stackcollapse-perf.pl > out.folded
 flamegraph.pl out.folded > flamegraph.svg
@@ -6,7 +6,8 @@ setup(
     ext_modules=[
         Extension(
             "casyncio",
-            sources=["project/src/loopmodule.c"],
+            sources=["project/src/loopmodule.c", "project/src/uring.c", "project/src/pool.c",
+                     "project/src/slab.c"],
             include_dirs=["project/src"],
         )
     ],
@@ -8,3 +8,97 @@ def test_bench_runs_quickly():
     cas, std = bench(10)
     assert cas >= 0
     assert std >= 0
+
+
+def test_ready_queue_bench_runs():
+    from benchmarks.ready_queue import bench as rq_bench
+
+    rows = rq_bench((10, 100))
+    assert [d for d, _, _ in rows] == [10, 100]
+    assert all(cas > 0 and std > 0 for _, cas, std in rows)
+
+
+def test_timer_churn_bench_runs():
+    from benchmarks.timer_churn import bench as churn_bench
+
+    (row,) = churn_bench((100,))
+    assert row["timers"] == 100
+    assert row["arm_ops"] > 0 and row["cancel_ops"] > 0
+
+
+def test_echo_backends_bench_runs():
+    from benchmarks.echo_backends import bench as echo_bench
+
+    rows = echo_bench((8,), rounds=2)
+    assert [r["connections"] for r in rows] == [8, 8]
+    assert rows[0]["backend"] == "epoll"
+    assert all(r["msgs_per_s"] > 0 for r in rows)
+
+
+def test_accept_storm_bench_runs():
+    from benchmarks.accept_storm import bench as storm_bench
+
+    ((burst, native, python),) = storm_bench((20,))
+    assert burst == 20 and native > 0 and python > 0
+
+
+def test_transport_recv_bench_runs():
+    from benchmarks.transport_recv import bench as recv_bench
+
+    rates = recv_bench(1 << 20)
+    assert set(rates) == {"buffered", "plain", "python"}
+    assert all(r > 0 for r in rates.values())
+
+
+def test_tasks_bench_runs():
+    from benchmarks.tasks import bench as tasks_bench
+
+    rates = tasks_bench(1000)
+    assert set(rates) == {"eager", "lazy", "asyncio"}
+    assert all(r > 0 for r in rates.values())
+
+
+def test_threadsafe_bench_runs():
+    from benchmarks.threadsafe import bench as ts_bench
+
+    ((threads, cas, std),) = ts_bench((2,), per_thread=200)
+    assert threads == 2 and cas > 0 and std > 0
+
+
+def test_pool_bench_runs():
+    from benchmarks.pool import bench as pool_bench
+
+    rates = pool_bench(200)
+    assert set(rates) == {"pool", "executor", "asyncio"}
+    assert all(r > 0 for r in rates.values())
+
+
+def test_spawn_bench_runs():
+    from benchmarks.spawn import bench as spawn_bench
+
+    rates = spawn_bench(20, ballast_mb=1)
+    assert set(rates) == {"casyncio", "asyncio"}
+    assert all(r > 0 for r in rates.values())
+
+
+def test_suite_reports_percentiles(tmp_path):
+    import json
+    from benchmarks import suite
+
+    out = tmp_path / "suite.json"
+    suite.main(["--loops", "casyncio,asyncio", "--scale", "0.002", "--out", str(out)])
+    report = json.loads(out.read_text())
+    assert report["meta"]["loops"] == ["casyncio", "asyncio"]
+    assert set(report["results"]) == set(suite._scenarios(1.0))
+    for per_loop in report["results"].values():
+        for r in per_loop.values():
+            assert r["ops_per_s"] > 0
+            assert r["p50_us"] <= r["p99_us"] <= r["p999_us"]
+
+
+def test_sendfile_bench_runs():
+    from benchmarks.sendfile import bench as sendfile_bench
+
+    rates = sendfile_bench(file_mb=2, rounds=2)
+    assert set(rates) == {"sendfile", "read_write"}
+    assert all(r > 0 for r in rates.values())
@@ -1,7 +1,9 @@
-import casyncio
 import socket
+import struct
+import threading
 import casyncio
 from py_async_lib import run_in_executor, async_getaddrinfo
+from py_async_lib.dns import DNSClient, Resolver, parse_hosts, parse_resolv_conf
 
 
 def test_run_in_executor_executes():
@@ -50,3 +52,148 @@ def test_async_getaddrinfo():
     loop.run_forever()
 
     assert results and len(results[0]) > 0
+
+
+class _StubDNS:
+    """Answers every A question with 10.0.0.<n>, counting the queries."""
+
+    def __init__(self, ttl=300):
+        self.sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+        self.sock.bind(("127.0.0.1", 0))
+        self.addr = self.sock.getsockname()
+        self.ttl = ttl
+        self.queries = []
+        self._thread = threading.Thread(target=self._serve, daemon=True)
+        self._thread.start()
+
+    def _serve(self):
+        while True:
+            try:
+                msg, peer = self.sock.recvfrom(512)
+            except OSError:
+                return
+            qid = msg[:2]
+            pos, labels = 12, []
+            while msg[pos]:
+                labels.append(msg[pos + 1:pos + 1 + msg[pos]].decode())
+                pos += msg[pos] + 1
+            question = msg[12:pos + 5]
+            qtype = struct.unpack_from("!H", msg, pos + 1)[0]
+            name = ".".join(labels)
+            self.queries.append((name, qtype))
+            if name.startswith("missing"):
+                reply = qid + struct.pack("!HHHHH", 0x8183, 1, 0, 0, 0) + question
+            elif qtype != 1:
+                reply = qid + struct.pack("!HHHHH", 0x8180, 1, 0, 0, 0) + question
+            else:
+                # one CNAME then the A record, names compressed to the question
+                n = len(self.queries) & 0xFF
+                reply = (qid + struct.pack("!HHHHH", 0x8180, 1, 2, 0, 0) + question
+                         + struct.pack("!HHHIH", 0xC00C, 5, 1, self.ttl, 2) + b"\xc0\x0c"
+                         + struct.pack("!HHHIH", 0xC00C, 1, 1, self.ttl, 4) + bytes((10, 0, 0, n)))
+            self.sock.sendto(reply, peer)
+
+    def close(self):
+        self.sock.close()
+
+
+def _gather(loop, futs):
+    keep_r, keep_w = socket.socketpair()
+    loop.add_reader(keep_r.fileno(), lambda: None)
+    left = [len(futs)]
+
+    def done(_):
+        left[0] -= 1
+        if not left[0]:
+            loop.stop()
+
+    for fut in futs:
+        fut.add_done_callback(done)
+    loop.call_later(5, loop.stop)
+    loop.run_forever()
+    loop.remove_reader(keep_r.fileno())
+    keep_r.close(); keep_w.close()
+    return [f.exception() or f.result() for f in futs]
+
+
+def test_resolver_single_flight_and_cache():
+    stub = _StubDNS()
+    try:
+        loop = casyncio.EventLoop()
+        client = DNSClient([stub.addr], search=[], hosts={})
+        resolver = Resolver(client=client, maxsize=2)
+        futs = [resolver.getaddrinfo(loop, "svc.example", 80, socket.AF_INET, socket.SOCK_STREAM)
+                for _ in range(200)]
+        results = _gather(loop, futs)
+        assert stub.queries == [("svc.example", 1)]
+        assert all(r == [(socket.AF_INET, socket.SOCK_STREAM, socket.IPPROTO_TCP, "",
+                          ("10.0.0.1", 80))] for r in results)
+
+        # hits are answered from the cache; the LRU entry falls out past maxsize
+        again = _gather(loop, [resolver.getaddrinfo(loop, "svc.example", 80, socket.AF_INET,
+                                                    socket.SOCK_STREAM)])
+        assert again == results[:1] and len(stub.queries) == 1
+        _gather(loop, [resolver.getaddrinfo(loop, f"n{i}.example", 80, socket.AF_INET)
+                       for i in range(2)])
+        _gather(loop, [resolver.getaddrinfo(loop, "svc.example", 80, socket.AF_INET,
+                                            socket.SOCK_STREAM)])
+        assert [q for q in stub.queries if q[0] == "svc.example"] == [("svc.example", 1)] * 2
+
+        # NXDOMAIN is a gaierror, cached for negative_ttl
+        miss = _gather(loop, [resolver.getaddrinfo(loop, "missing.example", 80)] * 1)
+        assert isinstance(miss[0], socket.gaierror)
+        queries = len(stub.queries)
+        miss = _gather(loop, [resolver.getaddrinfo(loop, "missing.example", 80)])
+        assert isinstance(miss[0], socket.gaierror) and len(stub.queries) == queries
+    finally:
+        stub.close()
+
+
+def test_dns_client_hosts_search_and_timeout(tmp_path):
+    conf = tmp_path / "resolv.conf"
+    conf.write_text("# local\nnameserver 192.0.2.1\nsearch corp.example\n"
+                    "options timeout:1 attempts:3 ndots:2\n")
+    hosts = tmp_path / "hosts"
+    hosts.write_text("127.0.0.1 localhost\n10.1.2.3  db.internal db # primary\n::1 localhost\n")
+    assert parse_resolv_conf(str(conf)) == (
+        ["192.0.2.1"], ["corp.example"], {"timeout": 1, "attempts": 3, "ndots": 2})
+    assert parse_hosts(str(hosts))["db"] == [(socket.AF_INET, "10.1.2.3")]
+
+    stub = _StubDNS()
+    silent = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    silent.bind(("127.0.0.1", 0))
+    try:
+        loop = casyncio.EventLoop()
+        client = DNSClient([silent.getsockname(), stub.addr], resolv_conf=str(conf),
+                           hosts=str(hosts), timeout=0.05, attempts=1)
+        assert client.search == ["corp.example"] and client.ndots == 2
+        files, dns = _gather(loop, [
+            client.getaddrinfo(loop, "DB", 5432, type=socket.SOCK_STREAM),
+            client.getaddrinfo(loop, "api", 443, socket.AF_INET, socket.SOCK_STREAM),
+        ])
+        assert files[0] == [(socket.AF_INET, socket.SOCK_STREAM, socket.IPPROTO_TCP, "",
+                             ("10.1.2.3", 5432))] and files[1] is None
+        # the silent server timed out; fewer dots than ndots: search list first
+        assert stub.queries == [("api.corp.example", 1)]
+        assert dns[0][0][4][1] == 443 and dns[1] == 300
+    finally:
+        stub.close()
+        silent.close()
+
+
+def test_resolver_query_that_fails_to_start():
+    loop = casyncio.EventLoop()
+    client = DNSClient([("127.0.0.1", 53)], search=[], hosts={})
+    resolver = Resolver(client=client)
+    host = "a" * 70 + ".example"  # a label past 63 bytes cannot be encoded
+    first, second = _gather(loop, [resolver.getaddrinfo(loop, host, 80) for _ in range(2)])
+    assert isinstance(first, UnicodeError) and isinstance(second, UnicodeError)
+    assert not resolver._inflight
+
+    class Broken:
+        def getaddrinfo(self, *args):
+            raise OSError(24, "Too many open files")
+
+    resolver = Resolver(client=Broken())
+    fut = resolver.getaddrinfo(loop, "svc.example", 80)
+    assert isinstance(fut.exception(), OSError) and not resolver._inflight
@@ -0,0 +1,162 @@
+import sys, os
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..")))
+
+import asyncio
+import functools
+import signal
+import socket
+import time
+import casyncio
+import pytest
+from py_async_lib import start_server
+
+
+def _report_pid(reader, writer):
+    writer.write(str(os.getpid()).encode())
+    writer.close()
+
+
+def _worker_pids(port, attempts=64):
+    pids = set()
+    for _ in range(attempts):
+        with socket.create_connection(("127.0.0.1", port), timeout=5) as c:
+            pids.add(int(c.recv(16)))
+    return pids
+
+
+def _pump(loop, seconds):
+    loop.call_later(seconds, loop.stop)
+    loop.run_forever()
+
+
+def _run(loop, coro):
+    task = loop.create_task(coro)
+    task.add_done_callback(lambda t: loop.stop())
+    loop.run_forever()
+    return task.result()
+
+
+def test_start_server_workers_spread_and_restart():
+    loop = casyncio.EventLoop()
+    close, port = asyncio.run(
+        start_server(_report_pid, "127.0.0.1", 0, loop=loop, workers=2))
+    try:
+        deadline = time.monotonic() + 5
+        pids = set()
+        while len(pids) < 2 and time.monotonic() < deadline:
+            pids |= _worker_pids(port)
+        assert len(pids) == 2 and os.getpid() not in pids
+
+        victim = pids.pop()
+        os.kill(victim, signal.SIGKILL)
+        _pump(loop, 0.3)  # reap through the pidfd, then restart
+        seen = set()
+        deadline = time.monotonic() + 5
+        while len(seen) < 2 and time.monotonic() < deadline:
+            seen |= _worker_pids(port)
+        assert victim not in seen and len(seen) == 2
+    finally:
+        _run(loop, close())
+
+
+def test_worker_pool_close_kills_stuck_workers():
+    from py_async_lib.highlevel import _WorkerPool
+    loop = casyncio.EventLoop()
+    # the loop's blocked SIGTERM is inherited, so these workers ignore it
+    pool = _WorkerPool(loop, 2, lambda: (time.sleep(30), os._exit(0)))
+    pool.KILL_TIMEOUT = 0.2
+    ticks = []
+
+    def tick():
+        ticks.append(time.monotonic())
+        loop.call_later(0.02, tick)
+
+    loop.call_soon(tick)
+    start = time.monotonic()
+    _run(loop, pool.close())
+    assert 0.2 <= time.monotonic() - start < 5 and not pool._pids
+    assert len(ticks) >= 5  # the loop kept running while the workers hung
+    assert not loop.remove_signal_handler(signal.SIGTERM)
+
+
+@pytest.mark.parametrize("backend", ["epoll", "io_uring"])
+def test_listener_drains_connection_burst(backend):
+    loop = casyncio.EventLoop(backend=backend)
+    served = []
+
+    def on_client(reader, writer):
+        served.append(writer)
+        writer.write(b"ok")
+        writer.close()
+
+    close, port = asyncio.run(
+        start_server(on_client, "127.0.0.1", 0, loop=loop, backlog=1024))
+    # the whole burst is queued before the loop sees a single edge
+    clients = [socket.create_connection(("127.0.0.1", port)) for _ in range(500)]
+    deadline = time.monotonic() + 5
+    while len(served) < len(clients) and time.monotonic() < deadline:
+        _pump(loop, 0.01)
+    assert len(served) == len(clients)
+    for c in clients:
+        assert c.recv(2) == b"ok"
+        c.close()
+    asyncio.run(close())
+
+
+def test_listener_caps_accepts_per_wakeup():
+    loop = casyncio.EventLoop()
+    lsock = socket.create_server(("127.0.0.1", 0), backlog=64)
+    lsock.setblocking(False)
+    batches = []
+    accepted = []
+
+    def on_accept(reader, fd):
+        accepted.append(fd)
+
+    listener = casyncio.Listener(loop, lsock.fileno(), on_accept, max_accept=4)
+    clients = [socket.create_connection(lsock.getsockname()) for _ in range(10)]
+
+    def tick():
+        batches.append(len(accepted))
+        if len(accepted) < len(clients):
+            loop.call_soon(tick)
+        else:
+            loop.stop()
+
+    loop.call_soon(tick)
+    loop.run_forever()
+    # other callbacks run between batches of at most max_accept
+    assert all(b - a <= 4 for a, b in zip(batches, batches[1:]))
+    assert len(set(accepted)) == 10
+    listener.close()
+    for fd in accepted:
+        loop._c_close(fd)
+    for c in clients:
+        c.close()
+    lsock.close()
+
+
+@pytest.mark.parametrize("wrap", [False, True])
+def test_start_server_runs_async_handler_as_task(wrap):
+    loop = casyncio.EventLoop()
+    served = []
+
+    async def on_client(reader, writer):
+        line = await reader.readline()
+        served.append(line)
+        writer.write(line.upper())
+        await writer.drain()
+        writer.close()
+
+    # a plain callable returning the coroutine is served the same way
+    cb = functools.partial(on_client) if wrap else on_client
+    close, port = asyncio.run(start_server(cb, "127.0.0.1", 0, loop=loop))
+    with socket.create_connection(("127.0.0.1", port), timeout=5) as c:
+        c.sendall(b"ping\n")
+        deadline = time.monotonic() + 5
+        while not served and time.monotonic() < deadline:
+            _pump(loop, 0.01)
+        _pump(loop, 0.01)
+        assert served == [b"ping\n"]
+        assert c.recv(16) == b"PING\n"
+    asyncio.run(close())
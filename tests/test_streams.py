@@ -32,3 +32,83 @@ def test_stream_reader_writer():
     r.close(); w.close()
 
 
+def _pump(loop, seconds=0.01):
+    loop.call_later(seconds, loop.stop)
+    loop.run_forever()
+
+
+def test_stream_reader_drains_until_eagain():
+    loop = casyncio.EventLoop()
+    r, w = socket.socketpair()
+    r.setblocking(False)
+    reader = StreamReader(loop, r.fileno())
+
+    payload = bytes(range(256)) * 800
+    w.sendall(payload)
+    # one edge-triggered wakeup must pull everything out of the kernel
+    _pump(loop)
+
+    async def consume():
+        return await reader.readexactly(len(payload))
+
+    assert asyncio.run(consume()) == payload
+    r.close(); w.close()
+
+
+def test_stream_reader_wakes_only_when_satisfied():
+    loop = casyncio.EventLoop()
+    r, w = socket.socketpair()
+    r.setblocking(False)
+    reader = StreamReader(loop, r.fileno())
+
+    fut = reader.readexactly(10)
+    w.send(b"12345")
+    _pump(loop)
+    assert not fut.done()
+    w.send(b"67890tail")
+    _pump(loop)
+    assert fut.result() == b"1234567890"
+
+    sep = reader.readuntil(b"\r\n")
+    assert not sep.done()
+    w.send(b"\r")
+    _pump(loop)
+    assert not sep.done()
+    w.send(b"\nrest")
+    _pump(loop)
+    assert sep.result() == b"tail\r\n"
+
+    w.close()
+    _pump(loop)
+    incomplete = reader.readuntil(b"\r\n")
+    try:
+        incomplete.result()
+    except asyncio.IncompleteReadError as exc:
+        assert exc.partial == b"rest"
+    else:
+        raise AssertionError("readuntil must fail at EOF without a separator")
+    assert reader.at_eof()
+    r.close()
+
+
+def test_stream_reader_pauses_when_not_consumed():
+    loop = casyncio.EventLoop()
+    r, w = socket.socketpair()
+    r.setblocking(False)
+    w.setblocking(False)
+    reader = StreamReader(loop, r.fileno(), limit=1024)
+
+    payload = b"y" * 64 * 1024
+    w.send(payload)
+    _pump(loop)
+    # reading stopped after crossing 2 * limit, the rest stays in the kernel
+    first = reader.read()
+    assert 2048 < len(first.result()) < len(payload)
+
+    got = bytearray(first.result())
+    while len(got) < len(payload):
+        fut = reader.read()
+        _pump(loop)
+        got.extend(fut.result())
+    assert bytes(got) == payload
+    r.close(); w.close()
@@ -0,0 +1,49 @@
+import sys, os
+sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..")))
+
+import casyncio
+from py_async_lib import create_subprocess_exec
+from py_async_lib.subprocess import PIPE, DEVNULL
+
+
+def _run(loop, coro):
+    task = loop.create_task(coro)
+    task.add_done_callback(lambda _: loop.stop())
+    loop.run_forever()
+    return task.result()
+
+
+def test_communicate_round_trips_large_input(tmp_path):
+    loop = casyncio.EventLoop()
+    payload = os.urandom(1 << 20)
+
+    async def main():
+        proc = await create_subprocess_exec("cat", stdin=PIPE, stdout=PIPE, stderr=DEVNULL)
+        out, err = await proc.communicate(payload)
+        return out, err, proc.returncode
+
+    assert _run(loop, main()) == (payload, None, 0)
+
+    async def failing():
+        proc = await create_subprocess_exec(
+            "sh", "-c", "pwd; echo oops >&2; exit 3", stdout=PIPE, stderr=PIPE, cwd=tmp_path)
+        return await proc.communicate(), await proc.wait()
+
+    (out, err), code = _run(loop, failing())
+    assert (out, err, code) == (f"{tmp_path}\n".encode(), b"oops\n", 3)
+
+
+def test_terminate_and_many_short_children():
+    loop = casyncio.EventLoop()
+
+    async def main():
+        proc = await create_subprocess_exec("sleep", "30")
+        proc.terminate()
+        codes = [await proc.wait()]
+        children = [await create_subprocess_exec("true") for _ in range(50)]
+        for child in children:
+            codes.append(await child.wait())
+        return codes
+
+    codes = _run(loop, main())
+    assert codes[0] == -15 and codes[1:] == [0] * 50
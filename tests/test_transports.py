@@ -1,8 +1,10 @@
 import sys, os
 sys.path.insert(0, os.path.abspath(os.path.join(os.path.dirname(__file__), "..")))
 
+import pytest
 import casyncio
-from py_async_lib import SocketTransport, BaseProtocol
+from py_async_lib import SocketTransport, BaseProtocol, BufferedProtocol
+from py_async_lib import DatagramProtocol, DatagramTransport, create_datagram_endpoint
 
 class EchoProtocol(BaseProtocol):
     def __init__(self, loop):
@@ -16,8 +18,9 @@ class EchoProtocol(BaseProtocol):
         self.data.append(data)
         self.loop.call_soon(self.loop.stop)
 
-def test_socket_transport():
-    loop = casyncio.EventLoop()
+@pytest.mark.parametrize('backend', ['epoll', 'io_uring'])
+def test_socket_transport(backend):
+    loop = casyncio.EventLoop(backend=backend)
     import socket
     r, w = socket.socketpair()
     r.setblocking(False)
@@ -30,3 +33,305 @@ def test_socket_transport():
     assert prot.data == [b'hi']
     w.close(); r.close()
 
+
+
+class FlowProtocol(BaseProtocol):
+    def __init__(self):
+        self.events = []
+
+    def pause_writing(self):
+        self.events.append('pause')
+
+    def resume_writing(self):
+        self.events.append('resume')
+
+
+@pytest.mark.parametrize('backend', ['epoll', 'io_uring'])
+def test_transport_write_watermarks(backend):
+    loop = casyncio.EventLoop(backend=backend)
+    import socket
+    r, w = socket.socketpair()
+    r.setblocking(False)
+
+    prot = FlowProtocol()
+    transport = SocketTransport(loop, w, prot)
+    transport.set_write_buffer_limits(high=64 * 1024, low=16 * 1024)
+    while not prot.events:
+        transport.write(b'x' * 65536)
+    assert prot.events == ['pause']
+    assert transport.get_write_buffer_size() > 64 * 1024
+    drained = loop._c_drain_waiter(w.fileno())
+    assert not drained.done()
+
+    def consume():
+        while True:
+            try:
+                if not r.recv(1 << 20):
+                    break
+            except BlockingIOError:
+                break
+        if drained.done():
+            loop.stop()
+
+    loop.add_reader(r.fileno(), consume)
+    loop.run_forever()
+    loop.remove_reader(r.fileno())
+    assert prot.events == ['pause', 'resume']
+    assert transport.get_write_buffer_size() <= 16 * 1024
+    transport.close()
+    r.close()
+
+
+@pytest.mark.parametrize('backend', ['epoll', 'io_uring'])
+def test_transport_pause_reading(backend):
+    loop = casyncio.EventLoop(backend=backend)
+    import socket
+    r, w = socket.socketpair()
+    w.setblocking(False)
+
+    prot = EchoProtocol(loop)
+    transport = SocketTransport(loop, r, prot)
+    transport.pause_reading()
+    assert not transport.is_reading()
+    w.send(b'early')
+    loop.call_later(0.02, loop.stop)
+    loop.run_forever()
+    assert prot.data == []
+
+    transport.resume_reading()
+    loop.run_forever()
+    assert prot.data == [b'early']
+    w.close(); r.close()
+
+
+class FrameProtocol(BufferedProtocol):
+    """Parses length-prefixed frames straight out of its own buffer."""
+
+    def __init__(self, loop, nframes):
+        self.loop = loop
+        self.buf = bytearray(256)
+        self.view = memoryview(self.buf)
+        self.used = 0
+        self.frames = []
+        self.nframes = nframes
+        self.lost = []
+
+    def get_buffer(self, sizehint):
+        return self.view[self.used:]
+
+    def buffer_updated(self, nbytes):
+        self.used += nbytes
+        start = 0
+        while self.used - start >= 1 and self.used - start > self.buf[start]:
+            n = self.buf[start]
+            self.frames.append(bytes(self.view[start + 1:start + 1 + n]))
+            start += 1 + n
+        # keep the partial frame at the front; same-size copy, no resize
+        self.view[:self.used - start] = self.view[start:self.used]
+        self.used -= start
+        if len(self.frames) == self.nframes:
+            self.loop.stop()
+
+    def connection_lost(self, exc):
+        self.lost.append(exc)
+
+
+@pytest.mark.parametrize('backend', ['epoll', 'io_uring'])
+def test_native_transport_buffered_protocol(backend):
+    loop = casyncio.EventLoop(backend=backend)
+    import socket
+    r, w = socket.socketpair()
+    prot = FrameProtocol(loop, 3)
+    transport = SocketTransport(loop, r, prot)
+    assert isinstance(transport, casyncio.SocketTransport)
+    assert transport.get_extra_info('socket') is r
+    w.send(b'\x03abc\x00\x05hel')
+    w.send(b'lo')
+    loop.run_forever()
+    assert prot.frames == [b'abc', b'', b'hello']
+
+    # EOF closes the transport and reports a clean connection_lost
+    w.close()
+    loop.call_later(0.05, loop.stop)
+    loop.run_forever()
+    assert prot.lost == [None]
+    assert transport.is_closing()
+    assert r.fileno() == -1  # the loop closed the fd; the socket is detached
+
+
+class LostProtocol(BaseProtocol):
+    def __init__(self, loop):
+        self.loop = loop
+        self.lost = []
+
+    def data_received(self, data):
+        raise ValueError('bad frame')
+
+    def connection_lost(self, exc):
+        self.lost.append(exc)
+        self.loop.stop()
+
+
+@pytest.mark.parametrize('backend', ['epoll', 'io_uring'])
+def test_native_transport_protocol_error_closes(monkeypatch, backend):
+    loop = casyncio.EventLoop(backend=backend)
+    import socket
+    reported = []
+    monkeypatch.setattr(sys, 'unraisablehook', reported.append)
+    r, w = socket.socketpair()
+    prot = LostProtocol(loop)
+    SocketTransport(loop, r, prot)
+    w.send(b'x')
+    loop.run_forever()
+    assert len(prot.lost) == 1 and isinstance(prot.lost[0], ValueError)
+    assert isinstance(reported[0].exc_value, ValueError)
+    assert w.recv(1) == b''  # peer sees the close
+    w.close()
+
+
+@pytest.mark.parametrize('backend', ['epoll', 'io_uring'])
+def test_native_transport_close_flushes_first(backend):
+    loop = casyncio.EventLoop(backend=backend)
+    import socket
+    r, w = socket.socketpair()
+    r.setblocking(False)
+    prot = LostProtocol(loop)
+    transport = SocketTransport(loop, w, prot)
+    payload = b'y' * (4 << 20)
+    transport.write(payload)
+    assert transport.get_write_buffer_size() > 0
+    transport.close()
+    assert prot.lost == []
+    got = bytearray()
+
+    def consume():
+        while True:
+            try:
+                chunk = r.recv(1 << 20)
+            except BlockingIOError:
+                return
+            if not chunk:
+                loop.remove_reader(r.fileno())
+                return
+            got.extend(chunk)
+
+    loop.add_reader(r.fileno(), consume)
+    loop.run_forever()
+    assert prot.lost == [None]
+    loop.remove_reader(r.fileno())
+    r.setblocking(True)
+    while chunk := r.recv(1 << 20):
+        got.extend(chunk)
+    assert bytes(got) == payload
+    r.close()
+
+
+class CollectDatagrams(DatagramProtocol):
+    def __init__(self, loop, want):
+        self.loop = loop
+        self.want = want
+        self.got = []
+        self.batches = 0
+        self.errors = []
+        self.lost = []
+
+    def datagrams_received(self, batch):
+        self.batches += 1
+        self.got.extend(batch)
+        if len(self.got) >= self.want:
+            self.loop.stop()
+
+    def error_received(self, exc):
+        self.errors.append(exc)
+        self.loop.stop()
+
+    def connection_lost(self, exc):
+        self.lost.append(exc)
+
+
+def _run_until_stopped(loop, coro=None):
+    import socket
+    keep_r, keep_w = socket.socketpair()
+    loop.add_reader(keep_r.fileno(), lambda: None)
+    task = loop.create_task(coro) if coro else None
+    loop.run_forever()
+    loop.remove_reader(keep_r.fileno())
+    keep_r.close()
+    keep_w.close()
+    return task.result() if task else None
+
+
+def test_datagram_endpoint_batches_and_offload():
+    import socket
+    loop = casyncio.EventLoop()
+    sink = CollectDatagrams(loop, 600)
+
+    async def open_endpoints():
+        rt, _ = await create_datagram_endpoint(lambda: sink, local_addr=('127.0.0.1', 0),
+                                               loop=loop)
+        st, src = await create_datagram_endpoint(lambda: CollectDatagrams(loop, 0),
+                                                 remote_addr=rt.get_extra_info('sockname'),
+                                                 loop=loop)
+        # equal sizes form GSO runs; the odd sizes end or break them
+        for i in range(600):
+            st.sendto(b'%04d' % i + b'x' * (96 if i % 100 else 7))
+        return rt, st
+
+    rt, st = _run_until_stopped(loop, open_endpoints())
+    got = sorted(d for d, _ in sink.got)
+    assert got == sorted(b'%04d' % i + b'x' * (96 if i % 100 else 7) for i in range(600))
+    assert {a for _, a in sink.got} == {st.get_extra_info('sockname')}
+    stats = loop.stats()
+    assert stats['datagrams_sent'] == stats['datagrams_received'] == 600
+    assert stats['dgram_syscalls'] < 100
+    if st.offload['gso'] and rt.offload['gro']:
+        assert sink.batches < 10
+
+    # a plain socket sees the GSO runs as separate datagrams
+    plain = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    plain.bind(('127.0.0.1', 0))
+    plain.settimeout(5)
+    with pytest.raises(ValueError):
+        st.sendto(b'no', plain.getsockname())
+    rt.sendto(b'a' * 50, plain.getsockname())
+    rt.sendto(b'b' * 50, plain.getsockname())
+    rt.sendto(b'c' * 20, plain.getsockname())
+    assert rt.get_write_buffer_size() == 120
+    rt.close()
+    st.close()
+    loop.call_later(0.01, loop.stop)
+    _run_until_stopped(loop)
+    assert [plain.recv(100) for _ in range(3)] == [b'a' * 50, b'b' * 50, b'c' * 20]
+    assert sink.lost == [None]
+    plain.close()
+
+
+def test_datagram_errors_and_write_flow():
+    import socket
+    loop = casyncio.EventLoop()
+    gone = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    gone.bind(('127.0.0.1', 0))
+    addr = gone.getsockname()
+    gone.close()
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.connect(addr)
+    prot = CollectDatagrams(loop, 1)
+    events = []
+    prot.pause_writing = lambda: events.append('pause')
+    prot.resume_writing = lambda: events.append('resume')
+    tr = DatagramTransport(loop, sock, prot)
+    tr.set_write_buffer_limits(high=1000)
+    for _ in range(20):
+        tr.sendto(b'z' * 100)
+    assert events == ['pause']
+    # the port is closed: ICMP comes back as ECONNREFUSED, not a fatal error
+    _run_until_stopped(loop)
+    assert events == ['pause', 'resume']
+    assert isinstance(prot.errors[0], ConnectionRefusedError)
+    assert not tr.is_closing()
+    with pytest.raises(ValueError):
+        tr.sendto(b'x', ('127.0.0.1', 1))
+    tr.abort()
+    loop.call_soon(loop.stop)
+    _run_until_stopped(loop)
+    assert prot.lost == [None]